@@ -0,0 +1,1270 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// etherlink-bench: times the data path primitives of the server in isolation, across payload
+// sizes, alignments and ring positions, and prints the results as JSON. The driver runs against
+// the simulated IP, so MMIO costs what a host memory access plus the driver's accessor costs.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_embed.h"
+#include "intel_st_debug_if_server.h"
+#include "intel_st_debug_if_st_dbg_ip_allocator.h"
+#include "intel_st_debug_if_sim_ip.h"
+
+enum
+{
+    MAX_PAYLOAD_SZ = 65536,
+    HEADER_BATCH = 256,
+    SOCKET_BUFF_SZ = 1 << 20
+};
+
+#define ARRAY_LEN(array) (sizeof(array) / sizeof((array)[0]))
+
+typedef enum
+{
+    RING_POSITION_NONE,
+    RING_POSITION_INSIDE,  // The payload ends before the end of the ring
+    RING_POSITION_WRAP,    // The payload wraps around the end of the ring
+    RING_POSITION_END,     // The payload ends exactly at the end of the ring
+    NUM_RING_POSITIONS
+} RING_POSITION;
+
+static const char* const RING_POSITION_NAMES[NUM_RING_POSITIONS] = {
+    "none", "inside", "wrap", "end"};
+
+typedef struct BENCH_CASE
+{
+    const char* name;
+    size_t size;
+    size_t align;  // Byte offset of the host buffer from a cache line boundary
+    RING_POSITION position;
+    int moves_data;  // Reported with a throughput
+    // Runs 'iterations' operations and returns the nanoseconds they took
+    uint64_t (*run)(const struct BENCH_CASE* bench_case, uint64_t iterations);
+} BENCH_CASE;
+
+typedef struct
+{
+    const char* name;
+    uint64_t (*run)(const BENCH_CASE* bench_case, uint64_t iterations);
+    const size_t* sizes;
+    size_t num_sizes;
+    const size_t* aligns;
+    size_t num_aligns;
+    int use_positions;
+    int moves_data;
+} BENCHMARK;
+
+static unsigned char g_host_buff[MAX_PAYLOAD_SZ + 64] __attribute__((aligned(64)));
+static unsigned char g_host_rx_buff[MAX_PAYLOAD_SZ + 64] __attribute__((aligned(64)));
+static intel_stream_debug_if_driver_context g_driver_cxt;
+static SOCKET g_socket_pair[2] = {INVALID_SOCKET, INVALID_SOCKET};
+static volatile uint64_t g_sink;
+static FILE* g_json = NULL;
+static int g_first_result = 1;
+
+static void show_help(const char* program)
+{
+    printf("Usage:\n"
+           " %s [--min-time=<seconds>] [--filter=<name>]\n"
+           " %s --mmio-budget\n"
+           " %s --embed [--min-time=<seconds>]\n"
+           " %s --allocator\n\n"
+           "Times the server's data path primitives against a simulated IP and prints JSON.\n"
+           "With --mmio-budget, counts the MMIO operations per packet and per empty poll instead,\n"
+           "and fails if any exceeds its budget. With --embed, loops packets back through the\n"
+           "in-process API, times their round trips and fails if any comes back different. With\n"
+           "--allocator, checks the H2T/MGMT rings and descriptor tracking instead.\n\n"
+           "Optional arguments:\n"
+           " --min-time=<seconds>, -t <s>  Time each case for at least this long (default: 0.2)\n"
+           " --filter=<name>, -f <name>    Only run the benchmarks whose name contains <name>\n"
+           " --mmio-budget, -b             Check the MMIO operations against their budgets\n"
+           " --embed, -e                   Check and time the in-process API\n"
+           " --allocator, -a               Check the H2T/MGMT ring and descriptor allocator\n"
+           " --help, -h                    Print this usage description\n",
+           program,
+           program,
+           program,
+           program);
+}
+
+static uint64_t get_monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static uint64_t run_memcpy64_host2fpga(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    uint64_t* host_buff = (uint64_t*) &(g_host_buff[bench_case->align]);
+    const int32_t fpga_buff = (int32_t) g_driver_cxt.std_dbg_ip_info.H2T_MEM_BASE_ADDR;
+    const uint64_t start_ns = get_monotonic_ns();
+    uint64_t i;
+    for (i = 0; i < iterations; ++i)
+    {
+        memcpy64_host2fpga(host_buff, fpga_buff, bench_case->size);
+    }
+    return get_monotonic_ns() - start_ns;
+}
+
+static uint64_t run_memcpy64_fpga2host(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    uint64_t* host_buff = (uint64_t*) &(g_host_buff[bench_case->align]);
+    const int32_t fpga_buff = (int32_t) g_driver_cxt.std_dbg_ip_info.T2H_MEM_BASE_ADDR;
+    const uint64_t start_ns = get_monotonic_ns();
+    uint64_t i;
+    for (i = 0; i < iterations; ++i)
+    {
+        memcpy64_fpga2host(fpga_buff, host_buff, bench_case->size);
+    }
+    return get_monotonic_ns() - start_ns;
+}
+
+// Places the write offset so that the first allocation lands at the given ring position
+static void init_cbuff_at(CIRCLE_BUFF* cbuff, size_t span, size_t size, RING_POSITION position)
+{
+    cbuff_init(cbuff, g_driver_cxt.std_dbg_ip_info.H2T_MEM_BASE_ADDR, span);
+    if (position == RING_POSITION_WRAP)
+    {
+        cbuff->write_offset = cbuff->read_offset = span - GET_ALIGNED_SZ(size / 2);
+    }
+    else if (position == RING_POSITION_END)
+    {
+        cbuff->write_offset = cbuff->read_offset = span - size;
+    }
+}
+
+// Allocates and frees the same amount, so every operation starts from the same ring position
+static uint64_t run_cbuff_alloc_free(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    CIRCLE_BUFF cbuff;
+    uint64_t sum = 0;
+    uint64_t i;
+    init_cbuff_at(&cbuff, 2 * MAX_PAYLOAD_SZ, bench_case->size, bench_case->position);
+    const size_t start_offset = cbuff.write_offset;
+
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        sum += cbuff_alloc(&cbuff, bench_case->size);
+        cbuff_free(&cbuff, bench_case->size);
+        cbuff.write_offset = cbuff.read_offset = start_offset;
+    }
+    const uint64_t elapsed_ns = get_monotonic_ns() - start_ns;
+    g_sink = sum;
+    return elapsed_ns;
+}
+
+// Pushes 'size' 64-byte descriptors, then completes and frees them all at once, the way
+// get_h2t_buffer() does once the IP reports them processed
+static uint64_t run_descriptor_bulk_free(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    static const size_t payload_sz = 64;
+    const uint32_t batch = (uint32_t) bench_case->size;
+    CIRCLE_BUFF cbuff;
+    DESCRIPTOR_TRACKER descriptors = DESCRIPTOR_TRACKER_default;
+    uint64_t sum = 0;
+    uint64_t i;
+    uint32_t j;
+    cbuff_init(&cbuff, g_driver_cxt.std_dbg_ip_info.H2T_MEM_BASE_ADDR, 2 * MAX_PAYLOAD_SZ);
+    if (desc_tracker_init(&descriptors, batch) != 0)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate the descriptor tracker\n");
+        exit(1);
+    }
+
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        for (j = 0; j < batch; ++j)
+        {
+            sum += cbuff_alloc(&cbuff, payload_sz);
+            desc_tracker_reserve(&descriptors, cbuff.write_offset);
+            desc_tracker_push(&descriptors);
+        }
+        cbuff_free_to(&cbuff, desc_tracker_complete(&descriptors, batch));
+    }
+    const uint64_t elapsed_ns = get_monotonic_ns() - start_ns;
+    if (cbuff_space_available(&cbuff) != cbuff.span)
+    {
+        fprintf(stderr,
+                "ERROR: Bulk free left %zu bytes allocated\n",
+                cbuff.span - cbuff_space_available(&cbuff));
+        exit(1);
+    }
+    free(descriptors.ring_end_offsets);
+    g_sink = sum;
+    return elapsed_ns;
+}
+
+static uint64_t run_buff_len_to_wrap_boundary(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    const uint64_t base = g_driver_cxt.std_dbg_ip_info.H2T_MEM_BASE_ADDR;
+    const size_t span = 2 * MAX_PAYLOAD_SZ;
+    CIRCLE_BUFF cbuff;
+    uint64_t sum = 0;
+    uint64_t i;
+    init_cbuff_at(&cbuff, span, bench_case->size, bench_case->position);
+    const uint64_t buff = base + cbuff.write_offset;
+
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        sum += buff_len_to_wrap_boundary(base, span, buff, bench_case->size);
+    }
+    const uint64_t elapsed_ns = get_monotonic_ns() - start_ns;
+    g_sink = sum;
+    return elapsed_ns;
+}
+
+// Grants and pushes one H2T packet per operation. The simulated IP consumes descriptors as soon
+// as they are pushed, so each grant also frees the previous packet's descriptor and memory.
+static uint64_t run_h2t_descriptor(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    H2T_PACKET_HEADER header;
+    uint64_t i;
+    populate_h2t_packet_header(&header, 1, 1, 0, 0, (unsigned short) bench_case->size);
+
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        const uint32_t buff = get_h2t_buffer(bench_case->size);
+        if (buff == 0)
+        {
+            fprintf(stderr, "ERROR: No H2T buffer was granted\n");
+            exit(1);
+        }
+        push_h2t_data(&header, buff);
+    }
+    return get_monotonic_ns() - start_ns;
+}
+
+// Takes 'size' 64-byte H2T packets per write batch, the way the server takes the packets a client
+// has already sent: grant, payload copy and push for each, then one burst of MMIO writes
+static uint64_t run_h2t_write_batch(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    static const size_t payload_sz = 64;
+    const size_t batch = bench_case->size;
+    H2T_PACKET_HEADER header;
+    uint64_t i;
+    size_t j;
+    populate_h2t_packet_header(&header, 1, 1, 0, 0, (unsigned short) payload_sz);
+
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        begin_mmio_write_batch();
+        for (j = 0; j < batch; ++j)
+        {
+            const uint32_t buff = get_h2t_buffer(payload_sz);
+            if (buff == 0)
+            {
+                fprintf(stderr, "ERROR: No H2T buffer was granted\n");
+                exit(1);
+            }
+            memcpy64_host2fpga((uint64_t*) g_host_buff, (int32_t) buff, payload_sz);
+            push_h2t_data(&header, buff);
+        }
+        end_mmio_write_batch();
+    }
+    return get_monotonic_ns() - start_ns;
+}
+
+static uint64_t run_t2h_header_build(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    uint64_t i;
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        populate_h2t_packet_bytes(g_host_buff, 1, 1, (unsigned char) i, (unsigned short) i, 64);
+    }
+    const uint64_t elapsed_ns = get_monotonic_ns() - start_ns;
+    g_sink = g_host_buff[5];
+    return elapsed_ns;
+}
+
+// Times how the server reads the guardband and header of H2T packets off a socket. The headers
+// are written to the socket in batches, outside the timed part.
+static uint64_t run_h2t_header_recv(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    static const size_t header_len = SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER;
+    SERVER_BUFFERS buffers = SERVER_BUFFERS_default;
+    SERVER_CONN server_conn = SERVER_CONN_default;
+    CLIENT_CONN client_conn = CLIENT_CONN_default;
+    uint64_t elapsed_ns = 0;
+    uint64_t done = 0;
+    size_t i;
+
+    server_conn.buff = &buffers;
+    client_conn.h2t_data_fd = g_socket_pair[1];
+    for (i = 0; i < HEADER_BATCH; ++i)
+    {
+        populate_h2t_packet_bytes(&(g_host_buff[i * header_len]), 1, 1, 0, 0, 64);
+    }
+    while (done < iterations)
+    {
+        const size_t batch = (size_t) MIN_MACRO(iterations - done, HEADER_BATCH);
+        if (socket_send_all(
+                g_socket_pair[0], (const char*) g_host_buff, batch * header_len, 0, NULL) != OK)
+        {
+            fprintf(stderr, "ERROR: Failed to send the H2T headers\n");
+            exit(1);
+        }
+        const uint64_t start_ns = get_monotonic_ns();
+        for (i = 0; i < batch; ++i)
+        {
+            if (update_curr_h2t_header(&client_conn, &server_conn) != OK)
+            {
+                fprintf(stderr, "ERROR: Failed to receive an H2T header\n");
+                exit(1);
+            }
+        }
+        elapsed_ns += get_monotonic_ns() - start_ns;
+        done += batch;
+    }
+    return elapsed_ns;
+}
+
+static uint64_t run_socket_send_recv(const BENCH_CASE* bench_case, uint64_t iterations)
+{
+    const char* tx_buff = (const char*) &(g_host_buff[bench_case->align]);
+    char* rx_buff = (char*) &(g_host_rx_buff[bench_case->align]);
+    uint64_t i;
+    const uint64_t start_ns = get_monotonic_ns();
+    for (i = 0; i < iterations; ++i)
+    {
+        if ((socket_send_all(g_socket_pair[0], tx_buff, bench_case->size, 0, NULL) != OK) ||
+            (socket_recv_accumulate(g_socket_pair[1], rx_buff, bench_case->size, 0, NULL) != OK))
+        {
+            fprintf(stderr, "ERROR: Socket pair transfer failed\n");
+            exit(1);
+        }
+    }
+    return get_monotonic_ns() - start_ns;
+}
+
+static void print_result(const BENCH_CASE* bench_case, uint64_t iterations, uint64_t elapsed_ns)
+{
+    const double ns_per_op = (double) elapsed_ns / (double) iterations;
+    fprintf(g_json,
+            "%s    {\"name\": \"%s\", \"size\": %zu, \"align\": %zu, \"position\": \"%s\", "
+            "\"iterations\": %llu, \"ns_per_op\": %.3f",
+            g_first_result ? "" : ",\n",
+            bench_case->name,
+            bench_case->size,
+            bench_case->align,
+            RING_POSITION_NAMES[bench_case->position],
+            (unsigned long long) iterations,
+            ns_per_op);
+    if (bench_case->moves_data && (ns_per_op > 0))
+    {
+        fprintf(g_json, ", \"mb_per_s\": %.3f", (double) bench_case->size * 1e3 / ns_per_op);
+    }
+    fprintf(g_json, "}");
+    g_first_result = 0;
+    fflush(g_json);
+}
+
+// Doubles the iteration count, at least, until a run takes 'min_ns'
+static void run_case(const BENCH_CASE* bench_case, uint64_t min_ns)
+{
+    uint64_t iterations = 1;
+    uint64_t elapsed_ns;
+    bench_case->run(bench_case, 1);  // Warm up
+    while ((elapsed_ns = bench_case->run(bench_case, iterations)) < min_ns)
+    {
+        const double scale = (elapsed_ns > 0) ? 1.2 * (double) min_ns / (double) elapsed_ns : 100;
+        iterations = (uint64_t) ((double) iterations * MIN_MACRO(MAX_MACRO(scale, 2.0), 100.0));
+    }
+    print_result(bench_case, iterations, elapsed_ns);
+}
+
+static void run_benchmark(const BENCHMARK* benchmark, uint64_t min_ns)
+{
+    size_t i;
+    size_t j;
+    int position;
+    for (i = 0; i < benchmark->num_sizes; ++i)
+    {
+        for (j = 0; j < benchmark->num_aligns; ++j)
+        {
+            for (position = benchmark->use_positions ? RING_POSITION_INSIDE : RING_POSITION_NONE;
+                 position < (benchmark->use_positions ? NUM_RING_POSITIONS : RING_POSITION_INSIDE);
+                 ++position)
+            {
+                const BENCH_CASE bench_case = {benchmark->name,
+                                               benchmark->sizes[i],
+                                               benchmark->aligns[j],
+                                               (RING_POSITION) position,
+                                               benchmark->moves_data,
+                                               benchmark->run};
+                run_case(&bench_case, min_ns);
+            }
+        }
+    }
+}
+
+static RETURN_CODE open_socket_pair(SOCKET* pair)
+{
+    int buff_sz = SOCKET_BUFF_SZ;
+    int i;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+    {
+        perror("socketpair");
+        return FAILURE;
+    }
+    for (i = 0; i < 2; ++i)
+    {
+        setsockopt(pair[i], SOL_SOCKET, SO_SNDBUF, &buff_sz, sizeof(buff_sz));
+        setsockopt(pair[i], SOL_SOCKET, SO_RCVBUF, &buff_sz, sizeof(buff_sz));
+    }
+    return OK;
+}
+
+static RETURN_CODE init_benchmarks()
+{
+    size_t i;
+    for (i = 0; i < sizeof(g_host_buff); ++i)
+    {
+        g_host_buff[i] = (unsigned char) i;
+    }
+    if ((init_sim_ip(NULL) != OK) ||
+        (init_driver(&g_driver_cxt, 0, FPGA_MMIO_INTERFACE_INVALID_HANDLE) != 0))
+    {
+        fprintf(stderr, "ERROR: Failed to initialize the driver against the simulated IP\n");
+        return FAILURE;
+    }
+    set_sim_ip_discard_mode(1);
+    return open_socket_pair(g_socket_pair);
+}
+
+// MMIO operations each server data path step may issue. A packet costs a fixed number of CSR
+// accesses plus, per started 8-byte payload word, 'per_word' memory accesses.
+typedef struct
+{
+    const char* name;
+    uint64_t reads;
+    uint64_t reads_per_word;
+    uint64_t writes;
+    uint64_t writes_per_word;
+} MMIO_BUDGET;
+
+typedef enum
+{
+    MMIO_BUDGET_H2T,
+    MMIO_BUDGET_T2H,
+    MMIO_BUDGET_T2H_EMPTY_POLL,
+    MMIO_BUDGET_MGMT,
+    MMIO_BUDGET_MGMT_RSP,
+    MMIO_BUDGET_MGMT_RSP_EMPTY_POLL,
+    NUM_MMIO_BUDGETS
+} MMIO_BUDGET_ID;
+
+// Budgets per MMIO width, the 32-bit one accesses descriptor CSRs and payload words in halves
+static const MMIO_WIDTH MMIO_BUDGET_WIDTHS[] = {MMIO_WIDTH_64, MMIO_WIDTH_32};
+#define NUM_MMIO_BUDGET_WIDTHS ARRAY_LEN(MMIO_BUDGET_WIDTHS)
+
+static const MMIO_BUDGET MMIO_BUDGETS[NUM_MMIO_BUDGET_WIDTHS][NUM_MMIO_BUDGETS] = {
+    {// AVAILABLE_SLOTS; HOW_LONG + WHERE, CONNECTION_ID + CHANNEL_ID_PUSH
+     {"h2t", 1, 0, 2, 1},
+     // HOW_LONG + WHERE, CONNECTION_ID + CHANNEL_ID_ADVANCE; DESCRIPTORS_DONE
+     {"t2h", 2, 1, 1, 0},
+     // HOW_LONG + WHERE
+     {"t2h_empty_poll", 1, 0, 0, 0},
+     // AVAILABLE_SLOTS; HOW_LONG + WHERE, CHANNEL_ID_PUSH
+     {"mgmt", 1, 0, 2, 1},
+     // HOW_LONG + WHERE, CHANNEL_ID_ADVANCE; DESCRIPTORS_DONE
+     {"mgmt_rsp", 2, 1, 1, 0},
+     // HOW_LONG + WHERE
+     {"mgmt_rsp_empty_poll", 1, 0, 0, 0}},
+    {// AVAILABLE_SLOTS; HOW_LONG, WHERE, CONNECTION_ID, CHANNEL_ID_PUSH
+     {"h2t", 1, 0, 4, 2},
+     // HOW_LONG, WHERE, CONNECTION_ID, CHANNEL_ID_ADVANCE; DESCRIPTORS_DONE
+     {"t2h", 4, 2, 1, 0},
+     // HOW_LONG
+     {"t2h_empty_poll", 1, 0, 0, 0},
+     // AVAILABLE_SLOTS; HOW_LONG, WHERE, CHANNEL_ID_PUSH
+     {"mgmt", 1, 0, 3, 2},
+     // HOW_LONG, WHERE, CHANNEL_ID_ADVANCE; DESCRIPTORS_DONE
+     {"mgmt_rsp", 3, 2, 1, 0},
+     // HOW_LONG
+     {"mgmt_rsp_empty_poll", 1, 0, 0, 0}}};
+
+typedef struct
+{
+    uint64_t reads;
+    uint64_t writes;
+} MMIO_COUNTS;
+
+static const size_t MMIO_BUDGET_SIZES[] = {8, 12, 64, 100, 1024, H2T_PACKET_MAX_PAYLOAD_BYTES};
+
+enum
+{
+    MMIO_BUDGET_PACKETS = 64  // Per size, enough to wrap around the H2T and MGMT memories
+};
+
+typedef struct
+{
+    SERVER_BUFFERS buffers;
+    SERVER_CONN server_conn;
+    CLIENT_CONN client_conn;
+    SOCKET h2t_pair[2];
+    SOCKET t2h_pair[2];
+    SOCKET mgmt_pair[2];
+    SOCKET mgmt_rsp_pair[2];
+} BUDGET_SESSION;
+
+static SERVER_HW_CALLBACKS get_driver_callbacks()
+{
+    SERVER_HW_CALLBACKS result = SERVER_HW_CALLBACKS_default;
+    result.get_h2t_buffer = get_h2t_buffer;
+    result.get_h2t_buffer_chunk = get_h2t_buffer_chunk;
+    result.get_h2t_wait_reason = get_h2t_buffer_wait_reason;
+    result.h2t_data_received = push_h2t_data;
+    result.acquire_t2h_data = get_t2h_data;
+    result.t2h_data_complete = t2h_data_complete;
+    result.begin_write_batch = begin_mmio_write_batch;
+    result.end_write_batch = end_mmio_write_batch;
+    result.has_mgmt_support = get_mgmt_support;
+    result.get_mgmt_buffer = get_mgmt_buffer;
+    result.get_mgmt_wait_reason = get_mgmt_buffer_wait_reason;
+    result.mgmt_data_received = push_mgmt_data;
+    result.acquire_mgmt_rsp_data = get_mgmt_rsp_data;
+    result.mgmt_rsp_data_complete = mgmt_rsp_data_complete;
+    return result;
+}
+
+// Sets up a server session whose client ends are socket pairs, the way handle_client() does
+static RETURN_CODE open_budget_session(BUDGET_SESSION* session)
+{
+    const ST_DBG_IP_DESIGN_INFO* info = &(g_driver_cxt.std_dbg_ip_info);
+    session->buffers = SERVER_BUFFERS_default;
+    session->buffers.use_wrapping_data_buffers = 1;
+    session->buffers.h2t_rx_buff = info->H2T_MEM_BASE_ADDR;
+    session->buffers.h2t_rx_buff_sz = info->H2T_MEM_SZ;
+    session->buffers.t2h_tx_buff = info->T2H_MEM_BASE_ADDR;
+    session->buffers.t2h_tx_buff_sz = info->T2H_MEM_SZ;
+    session->buffers.mgmt_rx_buff = info->MGMT_MEM_BASE_ADDR;
+    session->buffers.mgmt_rx_buff_sz = info->MGMT_MEM_SZ;
+    session->buffers.mgmt_rsp_tx_buff = info->MGMT_RSP_MEM_BASE_ADDR;
+    session->buffers.mgmt_rsp_tx_buff_sz = info->MGMT_RSP_MEM_SZ;
+    session->server_conn = SERVER_CONN_default;
+    session->server_conn.buff = &(session->buffers);
+    session->server_conn.hw_callbacks = get_driver_callbacks();
+    select_server_path(&(session->server_conn));
+    session->client_conn = CLIENT_CONN_default;
+
+    calibrate_timestamp_ticks();
+    if ((alloc_tcpip_recv_send_buffer(info->H2T_MEM_SZ) != OK) ||
+        (alloc_channel_stats(&(session->server_conn.channel_stats)) != OK) ||
+        (open_socket_pair(session->h2t_pair) != OK) ||
+        (open_socket_pair(session->t2h_pair) != OK) ||
+        (open_socket_pair(session->mgmt_pair) != OK) ||
+        (open_socket_pair(session->mgmt_rsp_pair) != OK))
+    {
+        return FAILURE;
+    }
+    session->client_conn.h2t_data_fd = session->h2t_pair[1];
+    session->client_conn.t2h_data_fd = session->t2h_pair[1];
+    session->client_conn.mgmt_fd = session->mgmt_pair[1];
+    session->client_conn.mgmt_rsp_fd = session->mgmt_rsp_pair[1];
+    return OK;
+}
+
+static MMIO_COUNTS get_mmio_counts()
+{
+    MMIO_COUNTS counts;
+    get_mmio_op_counts(&(counts.reads), &(counts.writes));
+    return counts;
+}
+
+// Runs one server data path step and adds the MMIO operations it issued to 'total'
+static RETURN_CODE count_mmio(RETURN_CODE (*step)(CLIENT_CONN*, SERVER_CONN*),
+                              BUDGET_SESSION* session,
+                              MMIO_COUNTS* total)
+{
+    const MMIO_COUNTS before = get_mmio_counts();
+    const RETURN_CODE rc = step(&(session->client_conn), &(session->server_conn));
+    const MMIO_COUNTS after = get_mmio_counts();
+    total->reads += after.reads - before.reads;
+    total->writes += after.writes - before.writes;
+    return rc;
+}
+
+// Sends a packet as the client
+static RETURN_CODE send_client_packet(SOCKET fd, size_t size)
+{
+    unsigned char header[SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER];
+    populate_h2t_packet_bytes(header, 1, 1, 0, 0, (unsigned short) size);
+    return ((socket_send_all(fd, (const char*) header, sizeof(header), 0, NULL) == OK) &&
+            (socket_send_all(fd, (const char*) g_host_buff, size, 0, NULL) == OK))
+               ? OK
+               : FAILURE;
+}
+
+// Receives a packet as the client
+static RETURN_CODE recv_client_packet(SOCKET fd, size_t size)
+{
+    return socket_recv_accumulate(fd,
+                                  (char*) g_host_rx_buff,
+                                  SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER + size,
+                                  0,
+                                  NULL);
+}
+
+// Passes MMIO_BUDGET_PACKETS packets of each stream through the server, checking their loopback
+static RETURN_CODE count_packet_mmio(BUDGET_SESSION* session,
+                                     size_t size,
+                                     MMIO_COUNTS counts[NUM_MMIO_BUDGETS])
+{
+    SERVER_CONN* server_conn = &(session->server_conn);
+    int i;
+    for (i = 0; i < MMIO_BUDGET_PACKETS; ++i)
+    {
+        if ((send_client_packet(session->h2t_pair[0], size) != OK) ||
+            (count_mmio(process_h2t_data, session, &(counts[MMIO_BUDGET_H2T])) != OK) ||
+            (count_mmio(process_t2h_data, session, &(counts[MMIO_BUDGET_T2H])) != OK) ||
+            (recv_client_packet(session->t2h_pair[0], size) != OK) ||
+            (memcmp(&(g_host_rx_buff[SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER]),
+                    g_host_buff,
+                    size) != 0) ||
+            (count_mmio(process_t2h_data, session, &(counts[MMIO_BUDGET_T2H_EMPTY_POLL])) != OK))
+        {
+            fprintf(stderr, "ERROR: A %zu byte H2T packet did not loop back\n", size);
+            return FAILURE;
+        }
+        if ((send_client_packet(session->mgmt_pair[0], size) != OK) ||
+            (count_mmio(process_mgmt_data, session, &(counts[MMIO_BUDGET_MGMT])) != OK) ||
+            (count_mmio(process_mgmt_rsp_data, session, &(counts[MMIO_BUDGET_MGMT_RSP])) != OK) ||
+            (recv_client_packet(session->mgmt_rsp_pair[0], size) != OK) ||
+            (server_conn->has_mgmt_pkt_sent != 0))
+        {
+            fprintf(stderr, "ERROR: A %zu byte MGMT packet did not loop back\n", size);
+            return FAILURE;
+        }
+        // Polls the way the server does while a MGMT request waits for its response
+        server_conn->has_mgmt_pkt_sent = 1;
+        const RETURN_CODE rc = count_mmio(
+            process_mgmt_rsp_data, session, &(counts[MMIO_BUDGET_MGMT_RSP_EMPTY_POLL]));
+        server_conn->has_mgmt_pkt_sent = 0;
+        if (rc != OK)
+        {
+            return FAILURE;
+        }
+    }
+    return OK;
+}
+
+static int print_budget_result(size_t width,
+                               MMIO_BUDGET_ID id,
+                               size_t size,
+                               const MMIO_COUNTS* counts)
+{
+    const int width_bits = (MMIO_BUDGET_WIDTHS[width] == MMIO_WIDTH_32) ? 32 : 64;
+    const MMIO_BUDGET* budget = &(MMIO_BUDGETS[width][id]);
+    const int has_payload = (budget->reads_per_word != 0) || (budget->writes_per_word != 0);
+    const uint64_t words = has_payload ? (size + 7) / 8 : 0;
+    const uint64_t read_budget = budget->reads + budget->reads_per_word * words;
+    const uint64_t write_budget = budget->writes + budget->writes_per_word * words;
+    const int over_budget = (counts->reads > read_budget * MMIO_BUDGET_PACKETS) ||
+                            (counts->writes > write_budget * MMIO_BUDGET_PACKETS);
+
+    fprintf(g_json,
+            "%s    {\"name\": \"%s\", \"mmio_width\": %d, \"size\": %zu, "
+            "\"reads_per_op\": %.3f, \"read_budget\": %llu, \"writes_per_op\": %.3f, "
+            "\"write_budget\": %llu, \"over_budget\": %s}",
+            g_first_result ? "" : ",\n",
+            budget->name,
+            width_bits,
+            size,
+            (double) counts->reads / MMIO_BUDGET_PACKETS,
+            (unsigned long long) read_budget,
+            (double) counts->writes / MMIO_BUDGET_PACKETS,
+            (unsigned long long) write_budget,
+            over_budget ? "true" : "false");
+    g_first_result = 0;
+    if (over_budget)
+    {
+        fprintf(stderr,
+                "ERROR: %s with %zu bytes over %d-bit MMIO costs %.3f reads and %.3f writes, "
+                "the budget is %llu and %llu\n",
+                budget->name,
+                size,
+                width_bits,
+                (double) counts->reads / MMIO_BUDGET_PACKETS,
+                (double) counts->writes / MMIO_BUDGET_PACKETS,
+                (unsigned long long) read_budget,
+                (unsigned long long) write_budget);
+    }
+    return over_budget;
+}
+
+// Counts the MMIO operations per packet and per empty poll through the server and driver paths.
+// Returns the process exit code: 0 if all are within budget.
+static int check_mmio_budgets()
+{
+    static BUDGET_SESSION session;
+    int over_budget = 0;
+    size_t width;
+    size_t i;
+    int id;
+
+    set_sim_ip_discard_mode(0);
+    if (open_budget_session(&session) != OK)
+    {
+        return 1;
+    }
+    fprintf(g_json, "{\n  \"mmio\": \"sw_model\",\n  \"mmio_budgets\": [\n");
+    for (width = 0; width < NUM_MMIO_BUDGET_WIDTHS; ++width)
+    {
+        // One access per word, the way the driver starts before calibrating
+        const COPY_STRATEGY strategy = {(MMIO_BUDGET_WIDTHS[width] == MMIO_WIDTH_32)
+                                            ? COPY_KERNEL_MMIO32
+                                            : COPY_KERNEL_MMIO64,
+                                        1};
+        set_mmio_width(MMIO_BUDGET_WIDTHS[width]);
+        set_copy_strategy(COPY_DIRECTION_H2T, strategy);
+        set_copy_strategy(COPY_DIRECTION_T2H, strategy);
+        for (i = 0; i < ARRAY_LEN(MMIO_BUDGET_SIZES); ++i)
+        {
+            MMIO_COUNTS counts[NUM_MMIO_BUDGETS];
+            memset(counts, 0, sizeof(counts));
+            if (count_packet_mmio(&session, MMIO_BUDGET_SIZES[i], counts) != OK)
+            {
+                return 1;
+            }
+            for (id = 0; id < NUM_MMIO_BUDGETS; ++id)
+            {
+                over_budget |= print_budget_result(
+                    width, (MMIO_BUDGET_ID) id, MMIO_BUDGET_SIZES[i], &(counts[id]));
+            }
+        }
+    }
+    fprintf(g_json, "\n  ],\n  \"passed\": %s\n}\n", over_budget ? "false" : "true");
+    fclose(g_json);
+    return over_budget ? 1 : 0;
+}
+
+static const size_t EMBED_RTT_SIZES[] = {8, 64, 1024, H2T_PACKET_MAX_PAYLOAD_BYTES};
+
+enum
+{
+    // Not a divisor of the H2T memory of the simulated IP, so that some packets only fit in part
+    EMBED_RESUME_PACKET_SZ = 0xC000,
+    EMBED_RESUME_PACKETS = 64,
+    EMBED_MAX_IDLE_DISPATCHES = 1000
+};
+
+// Reassembles the T2H parts that dispatch_st_dbg_packets() passes to the callback
+typedef struct
+{
+    size_t expected_len;
+    size_t len;
+    uint64_t parts;
+    uint64_t packets;
+    uint64_t mismatched;
+} EMBED_T2H_RX;
+
+static void on_embed_t2h(void* user_data,
+                         const H2T_PACKET_HEADER* header,
+                         const unsigned char* payload)
+{
+    EMBED_T2H_RX* rx = (EMBED_T2H_RX*) user_data;
+    if (header->SOP_EOP & H2T_PACKET_HEADER_MASK_SOP)
+    {
+        rx->len = 0;
+    }
+    if (rx->len + header->DATA_LEN_BYTES <= MAX_PAYLOAD_SZ)
+    {
+        memcpy(&(g_host_rx_buff[rx->len]), payload, header->DATA_LEN_BYTES);
+    }
+    rx->len += header->DATA_LEN_BYTES;
+    rx->parts++;
+    if (header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP)
+    {
+        rx->packets++;
+        if ((rx->len != rx->expected_len) || (memcmp(g_host_rx_buff, g_host_buff, rx->len) != 0))
+        {
+            rx->mismatched++;
+        }
+    }
+}
+
+// Times 'size' byte H2T packets looped back as T2H, each polled for before the next is submitted.
+// Returns the nanoseconds per round trip, or 0 if a packet did not loop back.
+static uint64_t time_embed_round_trips(ST_DBG_INSTANCE* instance,
+                                       size_t size,
+                                       uint64_t min_ns,
+                                       uint64_t* iterations)
+{
+    const H2T_PACKET_HEADER header = {
+        H2T_PACKET_HEADER_MASK_SOP | H2T_PACKET_HEADER_MASK_EOP, 1, 0, (unsigned short) size};
+    const uint64_t start_ns = get_monotonic_ns();
+    uint64_t elapsed_ns = 0;
+    *iterations = 0;
+    while (elapsed_ns < min_ns)
+    {
+        H2T_PACKET_HEADER t2h_header;
+        const unsigned char* payload;
+        int rc;
+        if (submit_st_dbg_h2t(instance, &header, g_host_buff) != 1)
+        {
+            return 0;
+        }
+        while ((rc = poll_st_dbg_t2h(instance, &t2h_header, &payload)) == 0)
+        {
+        }
+        if ((rc < 0) || (t2h_header.DATA_LEN_BYTES != size) ||
+            (memcmp(payload, g_host_buff, size) != 0))
+        {
+            return 0;
+        }
+        ++*iterations;
+        elapsed_ns = get_monotonic_ns() - start_ns;
+    }
+    return elapsed_ns / *iterations;
+}
+
+// Submits H2T packets back to back to an IP that consumes them only when a submit returns 0, so
+// that packets are handed over in parts and resumed. T2H is drained through the callback after
+// each 0, the way the API documents. Returns the number of such submits, or -1 if a packet did not
+// loop back whole.
+static int64_t check_embed_resume(ST_DBG_INSTANCE* instance, EMBED_T2H_RX* rx)
+{
+    const H2T_PACKET_HEADER header = {H2T_PACKET_HEADER_MASK_SOP | H2T_PACKET_HEADER_MASK_EOP,
+                                      1,
+                                      0,
+                                      (unsigned short) EMBED_RESUME_PACKET_SZ};
+    int64_t resumed = 0;
+    int idle = 0;
+    int i;
+    int rc;
+
+    memset(rx, 0, sizeof(*rx));
+    rx->expected_len = EMBED_RESUME_PACKET_SZ;
+    set_st_dbg_callbacks(instance, on_embed_t2h, NULL, rx);
+    set_sim_ip_h2t_hold(1);
+    for (i = 0; i < EMBED_RESUME_PACKETS; ++i)
+    {
+        while ((rc = submit_st_dbg_h2t(instance, &header, g_host_buff)) == 0)
+        {
+            resumed++;
+            set_sim_ip_h2t_hold(0);
+            set_sim_ip_h2t_hold(1);
+            if (dispatch_st_dbg_packets(instance, 16) < 0)
+            {
+                return -1;
+            }
+        }
+        if (rc < 0)
+        {
+            return -1;
+        }
+    }
+    set_sim_ip_h2t_hold(0);
+    while ((rx->packets < EMBED_RESUME_PACKETS) && (idle < EMBED_MAX_IDLE_DISPATCHES))
+    {
+        if ((rc = dispatch_st_dbg_packets(instance, 16)) < 0)
+        {
+            return -1;
+        }
+        idle = (rc == 0) ? idle + 1 : 0;
+    }
+    set_st_dbg_callbacks(instance, NULL, NULL, NULL);
+    return ((rx->packets == EMBED_RESUME_PACKETS) && (rx->mismatched == 0)) ? resumed : -1;
+}
+
+// Checks and times the in-process API against the simulated IP. Returns the process exit code.
+static int check_embed_api(uint64_t min_ns)
+{
+    ST_DBG_INSTANCE* instance;
+    EMBED_T2H_RX rx;
+    int failed = 0;
+    size_t i;
+
+    set_sim_ip_discard_mode(0);
+    if ((instance = open_st_dbg_instance(FPGA_MMIO_INTERFACE_INVALID_HANDLE, 0)) == NULL)
+    {
+        return 1;
+    }
+    fprintf(g_json, "{\n  \"mmio\": \"sw_model\",\n  \"embed_round_trips\": [\n");
+    for (i = 0; i < ARRAY_LEN(EMBED_RTT_SIZES); ++i)
+    {
+        uint64_t iterations;
+        const uint64_t rtt_ns =
+            time_embed_round_trips(instance, EMBED_RTT_SIZES[i], min_ns, &iterations);
+        if (rtt_ns == 0)
+        {
+            fprintf(stderr, "ERROR: A %zu byte H2T packet did not loop back\n", EMBED_RTT_SIZES[i]);
+            failed = 1;
+            break;
+        }
+        fprintf(g_json,
+                "%s    {\"size\": %zu, \"iterations\": %llu, \"ns_per_round_trip\": %llu}",
+                (i == 0) ? "" : ",\n",
+                EMBED_RTT_SIZES[i],
+                (unsigned long long) iterations,
+                (unsigned long long) rtt_ns);
+    }
+
+    const int64_t resumed = failed ? -1 : check_embed_resume(instance, &rx);
+    if (!failed && (resumed < 0))
+    {
+        fprintf(stderr,
+                "ERROR: %d byte H2T packets submitted in parts did not loop back\n",
+                EMBED_RESUME_PACKET_SZ);
+        failed = 1;
+    }
+    else if (!failed && ((resumed == 0) || (rx.parts == rx.packets)))
+    {
+        fprintf(stderr,
+                "ERROR: No %d byte H2T packet was resumed after part of it was handed over\n",
+                EMBED_RESUME_PACKET_SZ);
+        failed = 1;
+    }
+    if (!failed)
+    {
+        fprintf(g_json,
+                "\n  ],\n  \"embed_resume\": {\"size\": %d, \"packets\": %llu, "
+                "\"t2h_parts\": %llu, \"submits_returning_0\": %lld}",
+                EMBED_RESUME_PACKET_SZ,
+                (unsigned long long) rx.packets,
+                (unsigned long long) rx.parts,
+                (long long) resumed);
+    }
+    fprintf(g_json, "%s,\n  \"passed\": %s\n}\n", failed ? "\n  ]" : "", failed ? "false" : "true");
+    fclose(g_json);
+    close_st_dbg_instance(instance);
+    return failed;
+}
+
+enum
+{
+    ALLOCATOR_RING_SZ = 8192,
+    // Above the 127 descriptors the driver could free at once before it tracked them by mask
+    ALLOCATOR_DEPTH = 200,
+    ALLOCATOR_ROUNDS = 10,
+    ALLOCATOR_PACKET_SZ = 8
+};
+
+static int g_first_check = 1;
+
+static int report_allocator_check(const char* name, int passed)
+{
+    fprintf(g_json,
+            "%s    {\"name\": \"%s\", \"passed\": %s}",
+            g_first_check ? "" : ",\n",
+            name,
+            passed ? "true" : "false");
+    g_first_check = 0;
+    if (!passed)
+    {
+        fprintf(stderr, "ERROR: Allocator check %s failed\n", name);
+    }
+    return !passed;
+}
+
+// Allocates across the end of a ring whose offsets have passed 32 bits. Each address must be the
+// masked offset, and the ring must come back to its base.
+static int check_cbuff_mask_wrap()
+{
+    static const size_t payload_sz = 64;
+    const uint32_t base = g_driver_cxt.std_dbg_ip_info.H2T_MEM_BASE_ADDR;
+    CIRCLE_BUFF cbuff;
+    int wraps = 0;
+    int i;
+
+    cbuff_init(&cbuff, base, ALLOCATOR_RING_SZ);
+    cbuff.write_offset = cbuff.read_offset = (1ULL << 32) - ALLOCATOR_RING_SZ / 2;
+    for (i = 0; i < 4 * ALLOCATOR_RING_SZ / (int) payload_sz; ++i)
+    {
+        if (cbuff_space_available(&cbuff) < payload_sz)
+        {
+            cbuff_free(&cbuff, ALLOCATOR_RING_SZ / 2);
+        }
+        const uint64_t offset = cbuff.write_offset;
+        const uint32_t addr = cbuff_alloc(&cbuff, payload_sz);
+        if ((addr != base + (offset % ALLOCATOR_RING_SZ)) ||
+            (addr + payload_sz > base + cbuff.span))
+        {
+            return 0;
+        }
+        wraps += (addr == base) ? 1 : 0;
+    }
+    return (wraps >= 3) && (cbuff.write_offset > (1ULL << 32));
+}
+
+// Completes more descriptors at once than fit in 7 bits, in rounds that wrap the tracker's mask.
+// Each bulk completion must free exactly the payloads of the descriptors it covers.
+static int check_descriptor_bulk_completion()
+{
+    uint64_t ring_end_offsets[ALLOCATOR_DEPTH];
+    DESCRIPTOR_TRACKER descriptors = DESCRIPTOR_TRACKER_default;
+    CIRCLE_BUFF cbuff;
+    int passed = 1;
+    int round;
+    int j;
+
+    cbuff_init(&cbuff, g_driver_cxt.std_dbg_ip_info.H2T_MEM_BASE_ADDR, ALLOCATOR_RING_SZ);
+    if (desc_tracker_init(&descriptors, ALLOCATOR_DEPTH) != 0)
+    {
+        return 0;
+    }
+    for (round = 0; passed && (round < ALLOCATOR_ROUNDS); ++round)
+    {
+        const int first_batch = ALLOCATOR_DEPTH - round;
+        for (j = 0; j < ALLOCATOR_DEPTH; ++j)
+        {
+            cbuff_alloc(&cbuff, 8 * (size_t) (1 + (j % 4)));
+            desc_tracker_reserve(&descriptors, cbuff.write_offset);
+            desc_tracker_push(&descriptors);
+            ring_end_offsets[j] = cbuff.write_offset;
+        }
+        passed = (desc_tracker_in_flight(&descriptors) == ALLOCATOR_DEPTH) &&
+                 (desc_tracker_slots_available(&descriptors) == 0);
+
+        cbuff_free_to(&cbuff, desc_tracker_complete(&descriptors, (uint32_t) first_batch));
+        passed = passed && (cbuff.read_offset == ring_end_offsets[first_batch - 1]) &&
+                 (desc_tracker_in_flight(&descriptors) == (uint32_t) round);
+        if (round > 0)
+        {
+            cbuff_free_to(&cbuff, desc_tracker_complete(&descriptors, (uint32_t) round));
+        }
+        passed = passed && (cbuff_space_available(&cbuff) == cbuff.span) &&
+                 (desc_tracker_slots_available(&descriptors) == ALLOCATOR_DEPTH);
+    }
+    // An IP reporting more descriptors complete than are in flight frees nothing more
+    cbuff_free_to(&cbuff, desc_tracker_complete(&descriptors, ALLOCATOR_DEPTH));
+    passed = passed && (cbuff_space_available(&cbuff) == cbuff.span) &&
+             (desc_tracker_in_flight(&descriptors) == 0);
+    free(descriptors.ring_end_offsets);
+    return passed;
+}
+
+// The driver must refuse an IP whose H2T/T2H memory is not a power of two, as the rings mask
+// their offsets
+static int check_non_pow_2_rejected()
+{
+    intel_stream_debug_if_driver_context driver_cxt;
+    set_sim_ip_config(ALLOCATOR_RING_SZ - ALLOCATOR_RING_SZ / 4, 0);
+    const int rc = init_driver(&driver_cxt, 0, FPGA_MMIO_INTERFACE_INVALID_HANDLE);
+    set_sim_ip_config(0, 0);
+    return (rc == INIT_ERROR_CODE_UNSUPPORTED_CONFIG) && !is_pow_2(ALLOCATOR_RING_SZ - 1) &&
+           is_pow_2(ALLOCATOR_RING_SZ);
+}
+
+// Submits ALLOCATOR_DEPTH packets to an IP as deep that holds them, then releases them all at
+// once, so the driver frees more than 127 descriptors in one go before it can submit the next
+// ALLOCATOR_DEPTH. All packets must loop back.
+static int check_driver_bulk_completion()
+{
+    const H2T_PACKET_HEADER header = {H2T_PACKET_HEADER_MASK_SOP | H2T_PACKET_HEADER_MASK_EOP,
+                                      1,
+                                      0,
+                                      (unsigned short) ALLOCATOR_PACKET_SZ};
+    ST_DBG_INSTANCE* instance;
+    EMBED_T2H_RX rx;
+    int passed = 1;
+    int idle = 0;
+    int round;
+    int i;
+    int rc;
+
+    set_sim_ip_discard_mode(0);
+    set_sim_ip_config(0, ALLOCATOR_DEPTH);
+    if ((instance = open_st_dbg_instance(FPGA_MMIO_INTERFACE_INVALID_HANDLE, 0)) == NULL)
+    {
+        set_sim_ip_config(0, 0);
+        return 0;
+    }
+    memset(&rx, 0, sizeof(rx));
+    rx.expected_len = ALLOCATOR_PACKET_SZ;
+    set_st_dbg_callbacks(instance, on_embed_t2h, NULL, &rx);
+    for (round = 0; passed && (round < 2); ++round)
+    {
+        set_sim_ip_h2t_hold(1);
+        for (i = 0; passed && (i < ALLOCATOR_DEPTH); ++i)
+        {
+            passed = (submit_st_dbg_h2t(instance, &header, g_host_buff) == 1);
+        }
+        set_sim_ip_h2t_hold(0);
+    }
+    while (passed && (rx.packets < 2 * ALLOCATOR_DEPTH) && (idle < EMBED_MAX_IDLE_DISPATCHES))
+    {
+        rc = dispatch_st_dbg_packets(instance, 16);
+        passed = (rc >= 0);
+        idle = (rc == 0) ? idle + 1 : 0;
+    }
+    close_st_dbg_instance(instance);
+    set_sim_ip_config(0, 0);
+    return passed && (rx.packets == 2 * ALLOCATOR_DEPTH) && (rx.mismatched == 0);
+}
+
+// Checks the H2T/MGMT ring and descriptor tracker against the simulated IP. Returns the process
+// exit code.
+static int check_allocator()
+{
+    int failed = 0;
+
+    fprintf(g_json, "{\n  \"mmio\": \"sw_model\",\n  \"allocator_checks\": [\n");
+    failed |= report_allocator_check("cbuff_mask_wrap", check_cbuff_mask_wrap());
+    failed |= report_allocator_check("descriptor_bulk_completion",
+                                     check_descriptor_bulk_completion());
+    failed |= report_allocator_check("non_pow_2_rejected", check_non_pow_2_rejected());
+    failed |= report_allocator_check("driver_bulk_completion", check_driver_bulk_completion());
+    fprintf(g_json, "\n  ],\n  \"passed\": %s\n}\n", failed ? "false" : "true");
+    fclose(g_json);
+    return failed;
+}
+
+static const size_t PAYLOAD_SIZES[] = {8, 64, 256, 1024, 4096, 16384, 65536};
+static const size_t H2T_PAYLOAD_SIZES[] = {8, 64, 256, 1024, H2T_PACKET_MAX_PAYLOAD_BYTES};
+static const size_t HEADER_SIZES[] = {SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER};
+static const size_t DESCRIPTOR_BATCHES[] = {1, 16, 128, 1024};
+static const size_t WRITE_BATCHES[] = {1, 4, 16};
+static const size_t WORD_ALIGNS[] = {0, 8};
+static const size_t BYTE_ALIGNS[] = {0, 1};
+static const size_t NO_ALIGN[] = {0};
+
+#define BENCHMARK_ENTRY(name, sizes, aligns, use_positions, moves_data)                        \
+    {                                                                                          \
+        #name, run_##name, sizes, ARRAY_LEN(sizes), aligns, ARRAY_LEN(aligns), use_positions, \
+            moves_data                                                                         \
+    }
+
+static const BENCHMARK BENCHMARKS[] = {
+    BENCHMARK_ENTRY(memcpy64_host2fpga, PAYLOAD_SIZES, WORD_ALIGNS, 0, 1),
+    BENCHMARK_ENTRY(memcpy64_fpga2host, PAYLOAD_SIZES, WORD_ALIGNS, 0, 1),
+    BENCHMARK_ENTRY(cbuff_alloc_free, PAYLOAD_SIZES, NO_ALIGN, 1, 0),
+    BENCHMARK_ENTRY(descriptor_bulk_free, DESCRIPTOR_BATCHES, NO_ALIGN, 0, 0),
+    BENCHMARK_ENTRY(buff_len_to_wrap_boundary, PAYLOAD_SIZES, NO_ALIGN, 1, 0),
+    BENCHMARK_ENTRY(h2t_descriptor, H2T_PAYLOAD_SIZES, NO_ALIGN, 0, 0),
+    BENCHMARK_ENTRY(h2t_write_batch, WRITE_BATCHES, NO_ALIGN, 0, 0),
+    BENCHMARK_ENTRY(h2t_header_recv, HEADER_SIZES, NO_ALIGN, 0, 1),
+    BENCHMARK_ENTRY(t2h_header_build, HEADER_SIZES, NO_ALIGN, 0, 0),
+    BENCHMARK_ENTRY(socket_send_recv, PAYLOAD_SIZES, BYTE_ALIGNS, 0, 1)};
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    double min_time = 0.2;
+    int mmio_budget = 0;
+    int embed = 0;
+    int allocator = 0;
+    size_t i;
+    int c;
+
+    const struct option longopts[] = {{"help", no_argument, NULL, 'h'},
+                                      {"min-time", required_argument, NULL, 't'},
+                                      {"filter", required_argument, NULL, 'f'},
+                                      {"mmio-budget", no_argument, NULL, 'b'},
+                                      {"embed", no_argument, NULL, 'e'},
+                                      {"allocator", no_argument, NULL, 'a'},
+                                      {0, 0, 0, 0}};
+    while ((c = getopt_long(argc, argv, "ht:f:bea", longopts, NULL)) != -1)
+    {
+        switch (c)
+        {
+            case 't':
+                min_time = atof(optarg);
+                break;
+
+            case 'f':
+                filter = optarg;
+                break;
+
+            case 'b':
+                mmio_budget = 1;
+                break;
+
+            case 'e':
+                embed = 1;
+                break;
+
+            case 'a':
+                allocator = 1;
+                break;
+
+            case 'h':
+            default:
+                show_help(argv[0]);
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+    // The library prints its messages to stdout, keep them out of the JSON
+    const int json_fd = dup(STDOUT_FILENO);
+    if ((json_fd < 0) || (dup2(STDERR_FILENO, STDOUT_FILENO) < 0) ||
+        ((g_json = fdopen(json_fd, "w")) == NULL))
+    {
+        perror("stdout");
+        return 1;
+    }
+    if (init_benchmarks() != OK)
+    {
+        return 1;
+    }
+    if (mmio_budget)
+    {
+        return check_mmio_budgets();
+    }
+    if (allocator)
+    {
+        return check_allocator();
+    }
+
+    const uint64_t min_ns = (uint64_t) (min_time * 1e9);
+    if (embed)
+    {
+        return check_embed_api(min_ns);
+    }
+    fprintf(g_json,
+            "{\n  \"mmio\": \"sw_model\",\n  \"min_time_s\": %.3f,\n  \"results\": [\n",
+            min_time);
+    for (i = 0; i < ARRAY_LEN(BENCHMARKS); ++i)
+    {
+        if ((filter == NULL) || (strstr(BENCHMARKS[i].name, filter) != NULL))
+        {
+            run_benchmark(&(BENCHMARKS[i]), min_ns);
+        }
+    }
+    fprintf(g_json, "\n  ]\n}\n");
+    fclose(g_json);
+
+    close_socket_fd(g_socket_pair[0]);
+    close_socket_fd(g_socket_pair[1]);
+    cleanup_sim_ip();
+    return 0;
+}
@@ -40,6 +40,18 @@
 #include "intel_st_debug_if_stream_dbg.h"
 #include "app_version.h"
 #include "intel_fpga_api.h"
+#ifdef ST_DBG_IP_SW_MODEL
+#include "intel_st_debug_if_sim_ip.h"
+
+#define SW_MODEL_USAGE " [--sim-capture=<path>] [--sim-32bit-bridge]"
+#define SW_MODEL_HELP                                                                     \
+    " --sim-capture=<path>                      Answer with the packets of this capture " \
+    "instead of looping packets back\n"                                                   \
+    " --sim-32bit-bridge                        Model a bridge without 64-bit MMIO\n"
+#else
+#define SW_MODEL_USAGE ""
+#define SW_MODEL_HELP ""
+#endif
 
 // etherlink Command line input help
 static void show_help(const char* program)
@@ -47,7 +59,12 @@ static void show_help(const char* program)
     printf(
         "Usage:\n"
         " %s [--uio-driver-path=<path>] [--start-address=<address>] [--h2t-t2h-mem-size=<size>] "
-        "[--port=<port>] [--ip=<ip address>]\n"
+        "[--port=<port>] [--ip=<ip address>] [--listen-fd=<fd>]\n"
+        "    [--unix-socket=<path>] [--metrics-port=<port>] [--metrics-socket=<path>] "
+        "[--stats-shm=<name>] [--trace-file=<path>]\n"
+        "    [--mmio-log=<path>] [--capture=<path>] [--copy-strategy=<strategy>] "
+        "[--mmio-width=<bits>]\n"
+        "    [--h2t-coalesce=<bytes>[,<microseconds>]] [--self-bench]" SW_MODEL_USAGE "\n"
         " %s --version\n"
         " %s --help\n\n"
         "Optional arguments:\n"
@@ -57,6 +74,33 @@ static void show_help(const char* program)
         " --h2t-t2h-mem-size=<size>, -m <size>      H2T/T2H memory size in "
         "bytes (default: 4096)\n"
         " --port=<port>, -p <port>                  Listening port (default: 0)\n"
+        " --listen-fd=<fd>                          Serve an already bound and listening socket "
+        "instead of binding --port\n"
+        " --unix-socket=<path>                      Listen on this unix socket instead of "
+        "--port, for clients on the same host\n"
+        " --metrics-port=<port>                     Serve Prometheus metrics over HTTP on this "
+        "port (0 picks a free port)\n"
+        " --metrics-socket=<path>                   Serve Prometheus metrics over HTTP on this "
+        "unix socket\n"
+        " --stats-shm=<name>                        Publish live statistics to /dev/shm/<name> "
+        "for etherlink-top\n"
+        " --trace-file=<path>                       Packet trace dump file (default: "
+        "/tmp/etherlink-trace.<pid>.bin)\n"
+        " --mmio-log=<path>                         Log all MMIO accesses from start-up to this "
+        "file (decode with etherlink-mmio-log)\n"
+        " --capture=<path>                          Capture all packets from start-up to this "
+        "file (replay with etherlink-replay)\n"
+        " --copy-strategy=<strategy>                Payload copy kernel and chunk size, e.g. "
+        "mmio64:4 or <h2t>,<t2h>\n"
+        "                                           (default: auto, timed at start-up)\n"
+        " --mmio-width=<bits>                       32 or 64-bit MMIO accesses (default: probed "
+        "at start-up)\n"
+        " --h2t-coalesce=<bytes>[,<microseconds>]   Merge consecutive non-EOP H2T packets of a "
+        "channel into one descriptor,\n"
+        "                                           up to <bytes> and held at most <microseconds> "
+        "(default: off, 50 us)\n"
+        " --self-bench                              Benchmark and verify the data path over the "
+        "IP's H2T/T2H loopback, then exit\n" SW_MODEL_HELP
         " --version, -v                             Print version and exit\n"
         " --help, -h                                Print this usage description\n"
         "\n"
@@ -64,6 +108,13 @@ static void show_help(const char* program)
         " In the device tree, the address span of the whole CSR interface should be "
         "bound to the specified UIO driver.\n"
         " Typically, the base address starts at 0x0.\n\n"
+        " A listening socket passed by a service manager (sd_listen_fds protocol, e.g. systemd "
+        "socket activation)\n"
+        "takes precedence over --listen-fd, --unix-socket and --port. On SIGUSR2 the server "
+        "re-executes itself once idle and\n"
+        "hands its listening socket to the new process.\n\n"
+        " On SIGUSR1 the server writes its recent packet history to the trace dump file; "
+        "etherlink-trace decodes it.\n\n"
         " The option --h2t-t2h-mem-size is not used for HS ST Debug Interface IP because the "
         "size information is available on\n"
         "the CSR interface.\n\n",
@@ -90,33 +141,79 @@ struct EtherlinkCommandLine
     size_t h2t_t2h_mem_size;
     int port;
     char ip[IP_MAX_STR_LEN + 1];
+    int listen_fd;
+    const char* unix_socket;
+    char** argv;
+    int metrics_port;
+    const char* metrics_socket;
+    const char* stats_shm;
+    const char* trace_file;
+    const char* mmio_log;
+    const char* capture;
+    const char* sim_capture;
+    bool self_bench;
+    const char* copy_strategy;
+    int mmio_width;
+    const char* h2t_coalesce;
+    bool sim_32bit_bridge;
 };
 
 static int parse_cmd_args(EtherlinkCommandLine* etherlink_cmdline, int argc, char* argv[]);
 static long parse_integer_arg(const char* name);
 static int run_etherlink(const struct EtherlinkCommandLine* etherlink_cmdline);
 static void install_sigint_handler();
+static void install_sigusr1_handler();
+static void install_sigusr2_handler();
+static void cleanup_platform();
 
 class StreamingDebug : public IRemoteDebug
 {
 public:
-    StreamingDebug() {}
+    explicit StreamingDebug(const EtherlinkCommandLine* etherlink_cmdline)
+        : m_etherlink_cmdline(etherlink_cmdline)
+    {
+    }
     virtual ~StreamingDebug() { terminate(); }
     int run(size_t h2t_t2h_mem_size, const char* /*unused*/, int port) override
     {
+#ifdef ST_DBG_IP_SW_MODEL
+        FPGA_MMIO_INTERFACE_HANDLE handle = FPGA_MMIO_INTERFACE_INVALID_HANDLE;
+#else
         const int fpga_index = 0;  // Only 1 IP instance is supported.
         FPGA_MMIO_INTERFACE_HANDLE handle = fpga_open(fpga_index);
+#endif
         init_st_dbg_transport_server_over_tcpip(&m_server_context, handle, h2t_t2h_mem_size, port);
+        m_server_context.listen_fd = m_etherlink_cmdline->listen_fd;
+        m_server_context.unix_socket_path = m_etherlink_cmdline->unix_socket;
+        m_server_context.exec_argv = m_etherlink_cmdline->argv;
+        m_server_context.metrics_port = m_etherlink_cmdline->metrics_port;
+        m_server_context.metrics_unix_path = m_etherlink_cmdline->metrics_socket;
+        m_server_context.stats_page_name = m_etherlink_cmdline->stats_shm;
+        m_server_context.trace_file = m_etherlink_cmdline->trace_file;
+        m_server_context.mmio_log_file = m_etherlink_cmdline->mmio_log;
+        m_server_context.capture_file = m_etherlink_cmdline->capture;
+        m_server_context.copy_strategy = m_etherlink_cmdline->copy_strategy;
+        m_server_context.mmio_width = (m_etherlink_cmdline->mmio_width == 32)   ? MMIO_WIDTH_32
+                                      : (m_etherlink_cmdline->mmio_width == 64) ? MMIO_WIDTH_64
+                                                                                : MMIO_WIDTH_AUTO;
+        m_server_context.h2t_coalesce = m_etherlink_cmdline->h2t_coalesce;
+        if (m_etherlink_cmdline->self_bench)
+        {
+            return run_st_dbg_transport_self_bench(&m_server_context);
+        }
         return start_st_dbg_transport_server_over_tcpip(&m_server_context);
     }
 
     void terminate() override
     {
+#ifndef ST_DBG_IP_SW_MODEL
         fpga_close(m_server_context.driver_cxt.mmio_handle);
+#endif
         terminate_st_dbg_transport_server_over_tcpip();
     }
 
 private:
+    const EtherlinkCommandLine* m_etherlink_cmdline;
     intel_remote_debug_server_context m_server_context;
 };
 
@@ -126,7 +223,22 @@ int main(int argc, char** argv)
                                               0,
                                               {
                                                   0,
-                                              }};
+                                              },
+                                              -1,
+                                              nullptr,
+                                              argv,
+                                              -1,
+                                              nullptr,
+                                              nullptr,
+                                              nullptr,
+                                              nullptr,
+                                              nullptr,
+                                              nullptr,
+                                              false,
+                                              nullptr,
+                                              0,
+                                              nullptr,
+                                              false};
     int rc = parse_cmd_args(&etherlink_cmdline, argc, argv);
     if (rc)
     {
@@ -155,28 +267,95 @@ int main(int argc, char** argv)
 
     printf("INFO: Etherlink Server Configuration:\n");
     printf("INFO:    H2T/T2H Memory Size  : %ld\n", etherlink_cmdline.h2t_t2h_mem_size);
-    printf("INFO:    Listening Port       : %d\n", etherlink_cmdline.port);
-    printf("INFO:    IP Address           : %s\n", etherlink_cmdline.ip);
+    if (etherlink_cmdline.self_bench)
+    {
+        printf("INFO:    Mode                 : Loopback self-benchmark\n");
+    }
+    else
+    {
+        printf("INFO:    Listening Port       : %d\n", etherlink_cmdline.port);
+        printf("INFO:    IP Address           : %s\n", etherlink_cmdline.ip);
+    }
+    if (etherlink_cmdline.listen_fd >= 0)
+    {
+        printf("INFO:    Listening FD         : %d\n", etherlink_cmdline.listen_fd);
+    }
+    if (etherlink_cmdline.unix_socket != nullptr)
+    {
+        printf("INFO:    Unix Socket          : %s\n", etherlink_cmdline.unix_socket);
+    }
+    if (etherlink_cmdline.metrics_socket != nullptr)
+    {
+        printf("INFO:    Metrics Socket       : %s\n", etherlink_cmdline.metrics_socket);
+    }
+    else if (etherlink_cmdline.metrics_port >= 0)
+    {
+        printf("INFO:    Metrics Port         : %d\n", etherlink_cmdline.metrics_port);
+    }
+    if (etherlink_cmdline.stats_shm != nullptr)
+    {
+        printf("INFO:    Statistics Page      : %s\n", etherlink_cmdline.stats_shm);
+    }
+    if (etherlink_cmdline.trace_file != nullptr)
+    {
+        printf("INFO:    Trace File           : %s\n", etherlink_cmdline.trace_file);
+    }
+    if (etherlink_cmdline.mmio_log != nullptr)
+    {
+        printf("INFO:    MMIO Log             : %s\n", etherlink_cmdline.mmio_log);
+    }
+    if (etherlink_cmdline.capture != nullptr)
+    {
+        printf("INFO:    Capture File         : %s\n", etherlink_cmdline.capture);
+    }
+    if (etherlink_cmdline.copy_strategy != nullptr)
+    {
+        printf("INFO:    Copy Strategy        : %s\n", etherlink_cmdline.copy_strategy);
+    }
+    if (etherlink_cmdline.mmio_width != 0)
+    {
+        printf("INFO:    MMIO Width           : %d\n", etherlink_cmdline.mmio_width);
+    }
+    if (etherlink_cmdline.h2t_coalesce != nullptr)
+    {
+        printf("INFO:    H2T Coalescing       : %s\n", etherlink_cmdline.h2t_coalesce);
+    }
 
+#ifdef ST_DBG_IP_SW_MODEL
+    if (init_sim_ip(etherlink_cmdline.sim_capture) != OK)
+#else
     if (fpga_platform_init(argc, (const char**) argv) == false)
+#endif
     {
         printf("ERROR: Platform failed to initialize; exiting\n\n");
         show_help(argv[0]);
         rc = -1;
         goto out_exit;
     }
+#ifdef ST_DBG_IP_SW_MODEL
+    set_sim_ip_32bit_bridge(etherlink_cmdline.sim_32bit_bridge);
+#endif
 
     // Install SIGINT handler
     install_sigint_handler();
+    install_sigusr1_handler();
+    install_sigusr2_handler();
 
     if (run_etherlink(&etherlink_cmdline) != 0)
     {
-        printf("ERROR: Etherlink server failed to start successfully; exiting.\n");
+        if (etherlink_cmdline.self_bench)
+        {
+            printf("ERROR: Loopback self-benchmark failed; exiting.\n");
+        }
+        else
+        {
+            printf("ERROR: Etherlink server failed to start successfully; exiting.\n");
+        }
         rc = 3;
     }
 
 out_exit:
-    fpga_platform_cleanup();
+    cleanup_platform();
 
     return rc;
 }
@@ -185,7 +364,7 @@ int run_etherlink(const struct EtherlinkCommandLine* etherlink_cmdline)
 {
     int res = 0;
 
-    s_etherlink_server = new StreamingDebug();
+    s_etherlink_server = new StreamingDebug(etherlink_cmdline);
     if (s_etherlink_server)
     {
         res = s_etherlink_server->run(
@@ -210,6 +389,22 @@ int parse_cmd_args(EtherlinkCommandLine* etherlink_cmdline, int argc, char* argv
                                 {"h2t-t2h-mem-size", required_argument, NULL, 'm'},
                                 {"port", required_argument, NULL, 'p'},
                                 {"ip", required_argument, NULL, 'i'},
+                                {"listen-fd", required_argument, NULL, 'L'},
+                                {"unix-socket", required_argument, NULL, 'U'},
+                                {"metrics-port", required_argument, NULL, 'M'},
+                                {"metrics-socket", required_argument, NULL, 'S'},
+                                {"stats-shm", required_argument, NULL, 'T'},
+                                {"trace-file", required_argument, NULL, 'R'},
+                                {"mmio-log", required_argument, NULL, 'G'},
+                                {"capture", required_argument, NULL, 'C'},
+                                {"self-bench", no_argument, NULL, 'B'},
+                                {"copy-strategy", required_argument, NULL, 'K'},
+                                {"mmio-width", required_argument, NULL, 'W'},
+                                {"h2t-coalesce", required_argument, NULL, 'H'},
+#ifdef ST_DBG_IP_SW_MODEL
+                                {"sim-capture", required_argument, NULL, 'I'},
+                                {"sim-32bit-bridge", no_argument, NULL, 'J'},
+#endif
                                 {0, 0, 0, 0}};
 
     opterr = 0;  // Suppress stderr output from getopt_long upon unrecognized options
@@ -254,6 +449,85 @@ int parse_cmd_args(EtherlinkCommandLine* etherlink_cmdline, int argc, char* argv
                 strncpy(etherlink_cmdline->ip, optarg, 15);
                 etherlink_cmdline->ip[15] = '\0';
                 break;
+
+            case 'L':
+                // Pre-bound listening socket
+                etherlink_cmdline->listen_fd = parse_integer_arg("listen-fd");
+                if (etherlink_cmdline->listen_fd == 0)
+                {
+                    return -3;
+                }
+                break;
+
+            case 'U':
+                // Unix socket listener instead of the TCP port
+                etherlink_cmdline->unix_socket = optarg;
+                break;
+
+            case 'M':
+                // Metrics endpoint TCP port
+                etherlink_cmdline->metrics_port = parse_integer_arg("metrics-port");
+                break;
+
+            case 'S':
+                // Metrics endpoint unix socket
+                etherlink_cmdline->metrics_socket = optarg;
+                break;
+
+            case 'T':
+                // Shared memory statistics page
+                etherlink_cmdline->stats_shm = optarg;
+                break;
+
+            case 'R':
+                // Trace dump file
+                etherlink_cmdline->trace_file = optarg;
+                break;
+
+            case 'G':
+                // MMIO access log
+                etherlink_cmdline->mmio_log = optarg;
+                break;
+
+            case 'C':
+                // Packet capture
+                etherlink_cmdline->capture = optarg;
+                break;
+
+            case 'B':
+                // Loopback self-benchmark instead of serving clients
+                etherlink_cmdline->self_bench = true;
+                break;
+
+            case 'K':
+                // Payload copy strategy instead of the start-up calibration
+                etherlink_cmdline->copy_strategy = optarg;
+                break;
+
+            case 'W':
+                // MMIO access width instead of probing the bridge
+                etherlink_cmdline->mmio_width = parse_integer_arg("mmio-width");
+                if ((etherlink_cmdline->mmio_width != 32) && (etherlink_cmdline->mmio_width != 64))
+                {
+                    printf("ERROR: mmio-width must be 32 or 64\n");
+                    return -3;
+                }
+                break;
+
+            case 'H':
+                // Opt-in H2T coalescing, the spec is checked by the server
+                etherlink_cmdline->h2t_coalesce = optarg;
+                break;
+
+            case 'I':
+                // Capture answered by the simulated IP
+                etherlink_cmdline->sim_capture = optarg;
+                break;
+
+            case 'J':
+                // Simulated IP behind a bridge without 64-bit MMIO
+                etherlink_cmdline->sim_32bit_bridge = true;
+                break;
         }
     }
 
@@ -349,22 +623,43 @@ long parse_integer_arg(const char* name)
     return ret;
 }
 
+void cleanup_platform()
+{
+#ifdef ST_DBG_IP_SW_MODEL
+    cleanup_sim_ip();
+#else
+    fpga_platform_cleanup();
+#endif
+}
+
+static volatile sig_atomic_t s_sigint_count = 0;
+
+// Only async-signal-safe calls are made here. The server stops from its own thread, which finishes
+// the capture and MMIO log, and main() cleans up. A second SIGINT exits at once, leaving those
+// files without their trailer.
 void etherlink_sig_handler(int signo)
 {
+    static const char TERMINATING[] =
+        "\nINFO: Signal, SIGINT, was triggered; the program is terminating.\n";
+    static const char EXITING[] = "\nINFO: Signal, SIGINT, was triggered again; exiting now.\n";
     if (signo == SIGINT)
     {
-        printf("\nINFO: Signal, SIGINT, was triggered; the program is terminating.\n");
-        fpga_platform_cleanup();
-        if (s_etherlink_server != nullptr)
+        if (s_sigint_count++ == 0)
         {
-            delete s_etherlink_server;
-            s_etherlink_server = nullptr;
+            request_st_dbg_transport_server_termination();
+            if (write(STDOUT_FILENO, TERMINATING, sizeof(TERMINATING) - 1) < 0)
+            {
+                // Nothing more can be reported from here
+            }
+        }
+        else
+        {
+            if (write(STDOUT_FILENO, EXITING, sizeof(EXITING) - 1) < 0)
+            {
+                // Nothing more can be reported from here
+            }
+            _exit(0);
         }
-        exit(0);
-    }
-    else
-    {
-        printf("WARNING: Unexpected signal, %d, triggered; it is ignored\n", signo);
     }
 }
 
@@ -382,3 +677,41 @@ void install_sigint_handler()
             "gracefully.\n");
     }
 }
+
+void etherlink_sigusr1_handler(int signo)
+{
+    (void) signo;
+    dump_st_dbg_transport_server_trace();
+}
+
+void install_sigusr1_handler()
+{
+    struct sigaction sig_action;
+    memset(&sig_action, 0, sizeof(sig_action));
+    sig_action.sa_handler = &etherlink_sigusr1_handler;
+    sig_action.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGUSR1, &sig_action, NULL) != 0)
+    {
+        printf("WARNING: SIGUSR1 handler installment failed; trace dumps are unavailable.\n");
+    }
+}
+
+void etherlink_sigusr2_handler(int signo)
+{
+    (void) signo;
+    request_st_dbg_transport_server_listener_handoff();
+}
+
+void install_sigusr2_handler()
+{
+    struct sigaction sig_action;
+    memset(&sig_action, 0, sizeof(sig_action));
+    sig_action.sa_handler = &etherlink_sigusr2_handler;
+    sig_action.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGUSR2, &sig_action, NULL) != 0)
+    {
+        printf("WARNING: SIGUSR2 handler installment failed; listener hand-off is unavailable.\n");
+    }
+}
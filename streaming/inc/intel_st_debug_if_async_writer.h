@@ -0,0 +1,87 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "intel_st_debug_if_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Appends records to a file without blocking the producer. The producer (one thread) copies
+    // records into a ring and a background thread writes the ring to the file. A record that does
+    // not fit into the free part of the ring is refused, never waited for.
+    typedef struct
+    {
+        unsigned char* ring;
+        size_t ring_sz;  // Power of two
+        uint64_t head;   // Bytes committed by the producer
+        uint64_t tail;   // Bytes written to the file
+        uint64_t reserve_pos;
+        uint64_t reserve_end;
+        size_t header_len;
+        int fd;
+        int running;
+        pthread_t thread;
+    } ASYNC_WRITER;
+
+    extern const ASYNC_WRITER ASYNC_WRITER_default;
+
+    // Creates or replaces 'path', writes 'header' and starts the background writer. 'ring' is
+    // owned by the caller and must stay valid until close_async_writer().
+    RETURN_CODE open_async_writer(ASYNC_WRITER* writer,
+                                  const char* path,
+                                  unsigned char* ring,
+                                  size_t ring_sz,
+                                  const void* header,
+                                  size_t header_len);
+    // Writes everything committed, then 'trailer', and closes the file.
+    void close_async_writer(ASYNC_WRITER* writer, const void* trailer, size_t trailer_len);
+
+    static inline int is_async_writer_open(const ASYNC_WRITER* writer)
+    {
+        return writer->fd >= 0;
+    }
+
+    // A record is reserved, filled in any number of appends and committed. Returns 0 if 'len'
+    // bytes are not free.
+    int async_writer_reserve(ASYNC_WRITER* writer, size_t len);
+    void async_writer_append(ASYNC_WRITER* writer, const void* data, size_t len);
+    void async_writer_commit(ASYNC_WRITER* writer);
+    // Reserve, append and commit in one go
+    int async_writer_push(ASYNC_WRITER* writer, const void* data, size_t len);
+    // File offset the next reserved record starts at
+    uint64_t get_async_writer_file_offset(const ASYNC_WRITER* writer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_packet.h"
+#include "intel_st_debug_if_capture_layout.h"
+
+#define CAPTURE_DEFAULT_FILE "etherlink_capture.bin"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Session capture. The server thread copies every packet exchanged with the client into an
+    // in-memory ring and a background thread writes the ring to the capture file. A packet that
+    // does not fit into the ring is dropped as a whole and the loss is recorded in the capture.
+    //
+    // A packet is captured in three steps because its payload is only seen piecewise, by the
+    // socket layer: capture_packet_begin() with the header, capture_packet_data() for each piece
+    // of payload moved between the socket and the HW buffer, and capture_packet_end(). The latter
+    // two do nothing unless a packet was begun.
+    extern int g_capture_enabled;
+
+    static inline int is_capture_enabled()
+    {
+        return g_capture_enabled;
+    }
+
+    void capture_session();
+    void capture_packet_begin(CAPTURE_STREAM stream,
+                              uint8_t conn_id,
+                              uint16_t channel,
+                              uint16_t length,
+                              uint8_t sop_eop);
+    void capture_packet_data(const void* data, size_t len);
+    void capture_packet_end();
+
+    static inline void capture_h2t_packet_begin(CAPTURE_STREAM stream,
+                                                const H2T_PACKET_HEADER* header)
+    {
+        if (g_capture_enabled)
+        {
+            capture_packet_begin(
+                stream, header->CONN_ID, header->CHANNEL, header->DATA_LEN_BYTES, header->SOP_EOP);
+        }
+    }
+
+    static inline void capture_mgmt_packet_begin(CAPTURE_STREAM stream,
+                                                 const MGMT_PACKET_HEADER* header)
+    {
+        if (g_capture_enabled)
+        {
+            capture_packet_begin(
+                stream, 0, header->CHANNEL, header->DATA_LEN_BYTES, header->SOP_EOP);
+        }
+    }
+
+    // Sets the file used by the next start_capture(), NULL restores CAPTURE_DEFAULT_FILE.
+    RETURN_CODE set_capture_file(const char* path);
+    const char* get_capture_file();
+    // Starts a new capture, replacing the file. Called from the server thread.
+    RETURN_CODE start_capture();
+    // Flushes the capture, appends the index and closes the file. Called from the server thread.
+    void stop_capture();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,105 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Layout of the session capture files written by the server. The replay tool and the simulated
+// IP include only this header, so it must not depend on any other header of the library.
+
+#include <stdint.h>
+
+#define ETHERLINK_CAPTURE_MAGIC 0x545041434C485445ULL  // "ETHLCAPT" in little endian memory
+#define ETHERLINK_CAPTURE_INDEX_MAGIC 0x58444E494C485445ULL  // "ETHLINDX"
+#define ETHERLINK_CAPTURE_VERSION 1
+
+// A record of every CAPTURE_INDEX_INTERVAL is listed in the index
+#define CAPTURE_INDEX_INTERVAL 1024
+
+#define ETHERLINK_CAPTURE_STREAM_NAMES {"h2t", "t2h", "mgmt", "mgmt_rsp"}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        CAPTURE_STREAM_H2T,       // Received from the client
+        CAPTURE_STREAM_T2H,       // Sent to the client
+        CAPTURE_STREAM_MGMT,      // Received from the client
+        CAPTURE_STREAM_MGMT_RSP,  // Sent to the client
+        NUM_CAPTURE_STREAMS
+    } CAPTURE_STREAM;
+
+    typedef enum
+    {
+        CAPTURE_RECORD_PACKET,   // A packet, the payload follows
+        CAPTURE_RECORD_SESSION,  // A client connected, no payload
+        CAPTURE_RECORD_DROPPED   // Packets were not captured, a uint64_t count follows
+    } CAPTURE_RECORD_TYPE;
+
+    // Followed by 'length' payload bytes, zero padded to a multiple of 8 bytes
+    typedef struct
+    {
+        uint64_t timestamp;  // Timestamp ticks
+        uint16_t length;
+        uint16_t channel;
+        uint8_t conn_id;  // 0 for MGMT / MGMT RSP
+        uint8_t stream;   // CAPTURE_STREAM
+        uint8_t sop_eop;  // SOP_EOP field of the packet header
+        uint8_t type;     // CAPTURE_RECORD_TYPE
+    } CAPTURE_RECORD;
+
+    typedef struct
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t record_size;       // sizeof(CAPTURE_RECORD) of the writer
+        uint64_t ticks_per_second;  // To convert record timestamps
+        uint64_t start_ticks;       // Timestamp ticks when the capture started
+        uint64_t start_realtime_ns;
+    } CAPTURE_FILE_HEADER;
+
+    typedef struct
+    {
+        uint64_t record_number;
+        uint64_t timestamp;
+        uint64_t file_offset;
+    } CAPTURE_INDEX_ENTRY;
+
+    // A capture that was closed cleanly ends with 'index_count' index entries followed by this
+    // footer. Without the footer, e.g. after a crash, the records are still read sequentially.
+    typedef struct
+    {
+        uint64_t index_offset;
+        uint64_t index_count;
+        uint64_t record_count;
+        uint64_t magic;  // ETHERLINK_CAPTURE_INDEX_MAGIC
+    } CAPTURE_FILE_FOOTER;
+
+#ifdef __cplusplus
+}
+#endif
@@ -39,6 +39,12 @@ typedef enum
 
 #define HW_LOOPBACK_PARAM "#HW_LOOPBACK"
 #define HW_LOOPBACK_PARAM_LEN 13
+#define MMIO_LOG_PARAM "#MMIO_LOG"
+#define MMIO_LOG_PARAM_LEN 10
+#define COPY_STRATEGY_PARAM "#COPY_STRATEGY"
+#define COPY_STRATEGY_PARAM_LEN 15
+#define MMIO_WIDTH_PARAM "#MMIO_WIDTH"
+#define MMIO_WIDTH_PARAM_LEN 12
 
 #ifdef __cplusplus
 extern "C"
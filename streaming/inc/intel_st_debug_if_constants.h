@@ -40,6 +40,7 @@ extern "C"
     extern const char* MANAGEMENT_RSP_SOCK_NAME;
     extern const char* H2T_SOCK_NAME;
     extern const char* T2H_SOCK_NAME;
+    extern const char* MUX_SOCK_NAME;
 
     // Server control messages
     extern const char* READY_MSG;
@@ -63,6 +64,8 @@ extern "C"
     extern const size_t SET_DRIVER_PARAM_CMD_LEN;
     extern const char* GET_DRIVER_PARAM_CMD;
     extern const size_t GET_DRIVER_PARAM_CMD_LEN;
+    extern const char* ATTACH_SHM_RINGS_CMD;
+    extern const size_t ATTACH_SHM_RINGS_CMD_LEN;
 
     // Control command responses
     extern const char* UNRECOGNIZED_CMD_RSP;
@@ -77,6 +80,10 @@ extern "C"
     extern const size_t GET_PARAM_CMD_FAIL_RSP_LEN;
     extern const char* DISCONNECT_CMD_RSP;
     extern const size_t DISCONNECT_CMD_RSP_LEN;
+    extern const char* ATTACH_SHM_RINGS_CMD_RSP;
+    extern const size_t ATTACH_SHM_RINGS_CMD_RSP_LEN;
+    extern const char* ATTACH_SHM_RINGS_CMD_FAIL_RSP;
+    extern const size_t ATTACH_SHM_RINGS_CMD_FAIL_RSP_LEN;
 
     // Server control params
     extern const size_t MAX_SERVER_PARAM_VALUE_LEN;
@@ -94,6 +101,23 @@ extern "C"
     extern const size_t MGMT_RSP_NAGLE_PARAM_LEN;
     extern const char* MGMT_SUPPORT_PARAM;
     extern const size_t MGMT_SUPPORT_PARAM_LEN;
+    extern const char* MUX_SUPPORT_PARAM;
+    extern const size_t MUX_SUPPORT_PARAM_LEN;
+    extern const char* STALL_STATS_PARAM;
+    extern const size_t STALL_STATS_PARAM_LEN;
+    extern const char* LATENCY_PARAM;
+    extern const size_t LATENCY_PARAM_LEN;
+    extern const char* LATENCY_RESET_PARAM;
+    extern const size_t LATENCY_RESET_PARAM_LEN;
+    extern const char* LATENCY_RESET_ALL;
+    extern const char* CHANNEL_TOP_PARAM;
+    extern const size_t CHANNEL_TOP_PARAM_LEN;
+    extern const char* CHANNEL_STATS_PARAM;
+    extern const size_t CHANNEL_STATS_PARAM_LEN;
+    extern const char* TRACE_DUMP_PARAM;
+    extern const size_t TRACE_DUMP_PARAM_LEN;
+    extern const char* CAPTURE_PARAM;
+    extern const size_t CAPTURE_PARAM_LEN;
 
 // Global ST Host params
 #define HOSTNAMES_PARAM "hostnames"
@@ -0,0 +1,100 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// In-process access to the ST Debug IP, for host software that exchanges packets with the IP
+// itself instead of through an etherlink server. Packets are copied between the caller's memory
+// and the IP memories by the driver, with no socket and no second process in between.
+//
+// The caller opens the FPGA platform and the MMIO interface (fpga_platform_init(), fpga_open())
+// and hands the handle to open_st_dbg_instance(). The driver keeps its state in globals: one
+// instance can be open in a process at a time, and its functions must not be called from more
+// than one thread at a time.
+
+#include <stddef.h>
+#include "intel_st_debug_if_packet.h"
+#include "intel_fpga_platform.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct ST_DBG_INSTANCE ST_DBG_INSTANCE;
+
+    // 'payload' is valid until the callback returns
+    typedef void (*ST_DBG_T2H_CALLBACK)(void* user_data,
+                                        const H2T_PACKET_HEADER* header,
+                                        const unsigned char* payload);
+    typedef void (*ST_DBG_MGMT_RSP_CALLBACK)(void* user_data,
+                                             const MGMT_PACKET_HEADER* header,
+                                             const unsigned char* payload);
+
+    // Initializes the driver against the IP behind 'mmio_handle'. 'h2t_t2h_mem_size' is only used
+    // for IPs that do not report their memory sizes in the CSRs, as the --h2t-t2h-mem-size option
+    // of the server. Returns NULL on failure, or if an instance is already open.
+    ST_DBG_INSTANCE* open_st_dbg_instance(FPGA_MMIO_INTERFACE_HANDLE mmio_handle,
+                                          size_t h2t_t2h_mem_size);
+    void close_st_dbg_instance(ST_DBG_INSTANCE* instance);
+    int has_st_dbg_mgmt_support(const ST_DBG_INSTANCE* instance);
+
+    // Submits an H2T packet of header->DATA_LEN_BYTES bytes. Returns 1 once the whole packet is
+    // handed to the IP, 0 if the H2T memory is full, or < 0 on error. A payload larger than the
+    // free H2T memory is handed over in parts; after a return of 0 the same packet must be
+    // submitted again, and the parts already handed over are not sent twice.
+    int submit_st_dbg_h2t(ST_DBG_INSTANCE* instance,
+                          const H2T_PACKET_HEADER* header,
+                          const void* payload);
+    // Submits a MGMT packet, which is handed to the IP whole. Returns 1 once it is, 0 if the MGMT
+    // memory is full, or < 0 on error.
+    int submit_st_dbg_mgmt(ST_DBG_INSTANCE* instance,
+                           const MGMT_PACKET_HEADER* header,
+                           const void* payload);
+
+    // Polling: takes the next T2H / MGMT RSP packet from the IP. Returns 1 and sets '*payload' to
+    // the packet data, valid until the next poll of the same stream, 0 if there is no packet, or
+    // < 0 on error. MGMT RSP is only read from the IP while a MGMT packet is unanswered.
+    int poll_st_dbg_t2h(ST_DBG_INSTANCE* instance,
+                        H2T_PACKET_HEADER* header,
+                        const unsigned char** payload);
+    int poll_st_dbg_mgmt_rsp(ST_DBG_INSTANCE* instance,
+                             MGMT_PACKET_HEADER* header,
+                             const unsigned char** payload);
+
+    // Callbacks: dispatch_st_dbg_packets() polls both streams and passes each packet taken to the
+    // callback of its stream, up to 'max_packets' packets. A NULL callback leaves its stream to
+    // poll_st_dbg_t2h() / poll_st_dbg_mgmt_rsp(). Returns the number of packets dispatched, or
+    // < 0 on error.
+    void set_st_dbg_callbacks(ST_DBG_INSTANCE* instance,
+                              ST_DBG_T2H_CALLBACK t2h_callback,
+                              ST_DBG_MGMT_RSP_CALLBACK mgmt_rsp_callback,
+                              void* user_data);
+    int dispatch_st_dbg_packets(ST_DBG_INSTANCE* instance, int max_packets);
+
+#ifdef __cplusplus
+}
+#endif
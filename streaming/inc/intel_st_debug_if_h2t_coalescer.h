@@ -0,0 +1,131 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_packet.h"
+
+#define H2T_COALESCE_DEFAULT_WINDOW_US 50
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Opt-in merging of consecutive non-EOP H2T packets of one CONN_ID / CHANNEL into a single
+    // descriptor. The payloads are held in host memory and pushed as one packet when a packet
+    // ends the run (EOP, another stream, or more than 'limit' bytes in total) or when the window
+    // has elapsed since the first held packet.
+    typedef struct
+    {
+        size_t max_bytes;          // Configured size window, 0 disables coalescing
+        unsigned int window_us;    // Configured time window
+        size_t limit;              // 'max_bytes' capped to the H2T memory of the session
+        uint64_t window_ticks;     // 'window_us' in timestamp ticks
+        unsigned char* buff;       // Held payloads, 'max_bytes' long
+        H2T_PACKET_HEADER header;  // Header of the held run, DATA_LEN_BYTES is the held total
+        uint64_t first_received;   // Timestamp ticks of the first held header
+        char closed;               // The held run ended and has to be pushed first
+    } H2T_COALESCER;
+
+    // Parses "<bytes>[,<microseconds>]". Returns FAILURE on a malformed spec or a size window
+    // outside (0, H2T_PACKET_MAX_PAYLOAD_BYTES].
+    RETURN_CODE parse_h2t_coalescer_spec(H2T_COALESCER* coalescer, const char* spec);
+    // Allocates the host buffer, no-op when coalescing is disabled. Timestamp ticks must be
+    // calibrated first.
+    RETURN_CODE alloc_h2t_coalescer(H2T_COALESCER* coalescer);
+    void free_h2t_coalescer(H2T_COALESCER* coalescer);
+    // Drops anything held and fits the size window into the H2T memory of a new session
+    void reset_h2t_coalescer(H2T_COALESCER* coalescer, size_t h2t_mem_sz);
+
+    static inline size_t h2t_coalescer_held(const H2T_COALESCER* coalescer)
+    {
+        return coalescer->header.DATA_LEN_BYTES;
+    }
+
+    // Whether the packet can join the held run. A packet that would be alone in its run is left
+    // to the normal path if it ends the run anyway.
+    static inline char h2t_coalescer_accepts(const H2T_COALESCER* coalescer,
+                                             const H2T_PACKET_HEADER* header)
+    {
+        if ((coalescer->limit == 0) || coalescer->closed || (header->DATA_LEN_BYTES == 0))
+        {
+            return 0;
+        }
+        if (h2t_coalescer_held(coalescer) == 0)
+        {
+            return ((header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP) == 0) &&
+                   (header->DATA_LEN_BYTES < coalescer->limit);
+        }
+        return (header->CONN_ID == coalescer->header.CONN_ID) &&
+               (header->CHANNEL == coalescer->header.CHANNEL) &&
+               ((header->SOP_EOP & H2T_PACKET_HEADER_MASK_SOP) == 0) &&
+               (h2t_coalescer_held(coalescer) + header->DATA_LEN_BYTES <= coalescer->limit);
+    }
+
+    // Appends the header of a packet whose payload was received at 'h2t_coalescer_tail()'. An
+    // EOP packet closes the run.
+    static inline void h2t_coalescer_add(H2T_COALESCER* coalescer,
+                                         const H2T_PACKET_HEADER* header,
+                                         uint64_t received)
+    {
+        if (h2t_coalescer_held(coalescer) == 0)
+        {
+            coalescer->header = *header;
+            coalescer->first_received = received;
+        }
+        else
+        {
+            coalescer->header.DATA_LEN_BYTES += header->DATA_LEN_BYTES;
+            coalescer->header.SOP_EOP |= header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP;
+        }
+        coalescer->closed = (header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP) != 0;
+    }
+
+    static inline unsigned char* h2t_coalescer_tail(const H2T_COALESCER* coalescer)
+    {
+        return coalescer->buff + h2t_coalescer_held(coalescer);
+    }
+
+    // Whether the held run has to be pushed before anything else
+    static inline char h2t_coalescer_due(const H2T_COALESCER* coalescer, uint64_t now)
+    {
+        return (h2t_coalescer_held(coalescer) != 0) &&
+               (coalescer->closed || (now - coalescer->first_received >= coalescer->window_ticks));
+    }
+
+    static inline void h2t_coalescer_clear(H2T_COALESCER* coalescer)
+    {
+        coalescer->header.DATA_LEN_BYTES = 0;
+        coalescer->closed = 0;
+    }
+
+#ifdef __cplusplus
+}
+#endif
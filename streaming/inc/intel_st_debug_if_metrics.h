@@ -0,0 +1,61 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_stats.h"
+#include "intel_st_debug_if_metrics_layout.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Interval at which the server loop publishes a new snapshot
+#define SERVER_METRICS_PUBLISH_INTERVAL_NS 100000000ULL
+
+    // Seqlock writer, called from the server thread only. Never blocks.
+    void publish_server_metrics(const SERVER_METRICS_SNAPSHOT* snapshot);
+    // Seqlock reader, safe from any thread.
+    void read_server_metrics(SERVER_METRICS_SNAPSHOT* snapshot);
+
+    // Serves the latest snapshot in the Prometheus text exposition format on a background thread.
+    // Listens on 'unix_path' if it is not NULL, on TCP 'port' otherwise.
+    RETURN_CODE start_metrics_server(int port, const char* unix_path);
+    void stop_metrics_server();
+
+    // Moves the published snapshot into a SERVER_STATS_PAGE mapped from 'name' under /dev/shm, or
+    // from 'name' itself if it is an absolute path. The file is kept when the server exits so that
+    // a replacement process after a listener hand-off continues on the same page.
+    RETURN_CODE open_stats_page(const char* name);
+    void close_stats_page();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Layout of the statistics page that the server publishes to shared memory. External tools map
+// the page read-only and include only this header, so it must not depend on any other header of
+// the library. Fields are only ever appended; ETHERLINK_STATS_VERSION is bumped when they are.
+
+#include <stdint.h>
+
+#define ETHERLINK_STATS_MAGIC 0x544154534C485445ULL  // "ETHLSTAT" in little endian memory
+#define ETHERLINK_STATS_VERSION 1
+
+// Streams, in the order of the per-stream arrays
+#define ETHERLINK_STATS_STREAM_COUNT 4
+#define ETHERLINK_STATS_STREAM_NAMES {"h2t", "t2h", "mgmt", "mgmt_rsp"}
+
+// Stall reasons, in the order of the per-reason arrays
+#define ETHERLINK_STATS_STALL_REASON_COUNT 8
+#define ETHERLINK_STATS_STALL_REASON_NAMES \
+    {"h2t_desc", "h2t_ring", "mgmt_desc", "mgmt_ring", "t2h_empty", "t2h_send", "mgmt_rsp", "ctrl"}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Server counters as seen by observers outside of the data path. Counters are monotonic over
+    // the life of the server, all fields are 64-bit so the snapshot can be copied word by word.
+    typedef struct
+    {
+        uint64_t packets[ETHERLINK_STATS_STREAM_COUNT];
+        uint64_t bytes[ETHERLINK_STATS_STREAM_COUNT];
+        uint64_t stall_events[ETHERLINK_STATS_STALL_REASON_COUNT];
+        uint64_t stall_ns[ETHERLINK_STATS_STALL_REASON_COUNT];
+        uint64_t mmio_reads;
+        uint64_t mmio_writes;
+        uint64_t sessions;        // Client sessions accepted
+        uint64_t session_active;  // 1 while a client is connected
+        uint64_t loopback_mode;
+        uint64_t server_thread_cpu_ns;
+
+        // Occupancy as last seen by the driver
+        uint64_t h2t_ring_used;  // Bytes
+        uint64_t h2t_ring_size;
+        uint64_t h2t_descriptors_used;
+        uint64_t h2t_descriptor_depth;
+        uint64_t mgmt_ring_used;
+        uint64_t mgmt_ring_size;
+        uint64_t mgmt_descriptors_used;
+        uint64_t mgmt_descriptor_depth;
+    } SERVER_METRICS_SNAPSHOT;
+
+    // The shared memory page. 'sequence' is odd while the server updates 'snapshot'; a reader
+    // copies 'snapshot' and retries if 'sequence' was odd or changed in the meantime.
+    typedef struct
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t size;  // sizeof(SERVER_STATS_PAGE) of the writer
+        uint64_t pid;   // Process id of the writer
+        uint64_t sequence;
+        uint64_t publish_time_ns;  // CLOCK_MONOTONIC
+        SERVER_METRICS_SNAPSHOT snapshot;
+    } SERVER_STATS_PAGE;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_mmio_log_layout.h"
+
+#define MMIO_LOG_DEFAULT_FILE "mmlink_mmio_log.bin"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Binary MMIO access log. The driver thread encodes accesses into an in-memory ring and a
+    // background thread writes the ring to the log file, so logging never waits on file I/O. If
+    // the writer falls behind, accesses are dropped and the loss is recorded in the log.
+    extern int g_mmio_log_enabled;
+
+    static inline int is_mmio_log_enabled()
+    {
+        return g_mmio_log_enabled;
+    }
+
+    void mmio_log_access(
+        MMIO_LOG_OP op, uint64_t offset, uint64_t value, int line, const char* function);
+    void mmio_log_regions(const uint64_t bases[NUM_MMIO_LOG_REGIONS]);
+
+    // Sets the file used by the next start_mmio_log(), NULL restores MMIO_LOG_DEFAULT_FILE.
+    RETURN_CODE set_mmio_log_file(const char* path);
+    // Starts a new log, replacing the file. Called from the driver thread.
+    RETURN_CODE start_mmio_log();
+    // Flushes and closes the log. Called from the driver thread.
+    void stop_mmio_log();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,99 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Layout of the binary MMIO access logs written by the driver. The offline decoder includes only
+// this header, so it must not depend on any other header of the library.
+//
+// A log is a MMIO_LOG_FILE_HEADER followed by a stream of variable length records. Every record
+// starts with a tag byte. Integers are LEB128 varints; deltas are zigzag encoded first. Deltas are
+// taken against the previous record in the file, starting from 'start_ticks' and zero.
+//
+//  access  tag = op (MMIO_LOG_OP) | MMIO_LOG_TAG_FUNCTION_FLAG if the function changed
+//          varint ticks since the previous access
+//          zigzag source line delta
+//          varint function id, only with MMIO_LOG_TAG_FUNCTION_FLAG
+//          zigzag offset delta
+//          varint value
+//  MMIO_LOG_TAG_FUNCTION_NAME  varint id, length byte, name (not terminated)
+//  MMIO_LOG_TAG_REGIONS        NUM_MMIO_LOG_REGIONS varints, base offset of each region
+//  MMIO_LOG_TAG_DROPPED        varint number of accesses lost because the writer fell behind
+
+#include <stdint.h>
+
+#define ETHERLINK_MMIO_LOG_MAGIC 0x4F494D4D4C485445ULL  // "ETHLMMIO" in little endian memory
+#define ETHERLINK_MMIO_LOG_VERSION 1
+
+#define ETHERLINK_MMIO_LOG_OP_NAMES {"R32", "R64", "W32", "W64"}
+#define ETHERLINK_MMIO_LOG_REGION_NAMES {"CSR", "H2T", "T2H", "MGMT", "MGMT_RSP"}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        MMIO_LOG_OP_READ_32,
+        MMIO_LOG_OP_READ_64,
+        MMIO_LOG_OP_WRITE_32,
+        MMIO_LOG_OP_WRITE_64,
+        NUM_MMIO_LOG_OPS
+    } MMIO_LOG_OP;
+
+    typedef enum
+    {
+        MMIO_LOG_REGION_CSR,
+        MMIO_LOG_REGION_H2T,
+        MMIO_LOG_REGION_T2H,
+        MMIO_LOG_REGION_MGMT,
+        MMIO_LOG_REGION_MGMT_RSP,
+        NUM_MMIO_LOG_REGIONS
+    } MMIO_LOG_REGION;
+
+    enum
+    {
+        MMIO_LOG_TAG_OP_MASK = 0x03,
+        MMIO_LOG_TAG_FUNCTION_FLAG = 0x04,
+        MMIO_LOG_TAG_FUNCTION_NAME = 0xF0,
+        MMIO_LOG_TAG_REGIONS = 0xF1,
+        MMIO_LOG_TAG_DROPPED = 0xF2
+    };
+
+    typedef struct
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t ticks_per_second;
+        uint64_t start_ticks;
+        uint64_t start_realtime_ns;  // CLOCK_REALTIME at 'start_ticks'
+    } MMIO_LOG_FILE_HEADER;
+
+#ifdef __cplusplus
+}
+#endif
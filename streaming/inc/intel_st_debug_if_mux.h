@@ -0,0 +1,84 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Frames of the multiplexed transport, in which all five streams of a session share the CTRL
+// socket. Clients include only this header, so it must not depend on any other header of the
+// library.
+//
+// The welcome message ends in "MUX_SUPPORT=1", after "HANDLE=<handle>", when the server offers it.
+// A client opts in by answering the welcome message with "MUX HANDLE=<handle>" instead of
+// "Control HANDLE=<handle>" and then connects no data sockets. Once the server has sent its final
+// READY, every message in either direction is a frame: a MUX_FRAME_HEADER_SZ byte header, then
+// 'len' bytes of body. The header holds the stream in its first byte and the body length in the
+// next three, little endian.
+//
+// CTRL bodies are the NUL terminated commands and responses of the CTRL socket. H2T, T2H, MGMT
+// and MGMT RSP bodies are an H2T_PACKET_HEADER or MGMT_PACKET_HEADER followed by its payload, with
+// no guardband. A frame carries one whole packet.
+
+#include <stdint.h>
+
+#define MUX_FRAME_HEADER_SZ 4
+#define MUX_FRAME_MAX_LEN 0xFFFFFF
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        MUX_STREAM_CTRL,      // Both directions
+        MUX_STREAM_MGMT,      // Sent by the client
+        MUX_STREAM_MGMT_RSP,  // Sent by the server
+        MUX_STREAM_H2T,       // Sent by the client
+        MUX_STREAM_T2H,       // Sent by the server
+        NUM_MUX_STREAMS
+    } MUX_STREAM;
+
+    static inline void mux_frame_header_pack(unsigned char* bytes, MUX_STREAM stream, uint32_t len)
+    {
+        bytes[0] = (unsigned char) stream;
+        bytes[1] = (unsigned char) len;
+        bytes[2] = (unsigned char) (len >> 8);
+        bytes[3] = (unsigned char) (len >> 16);
+    }
+
+    static inline MUX_STREAM mux_frame_header_stream(const unsigned char* bytes)
+    {
+        return (MUX_STREAM) bytes[0];
+    }
+
+    static inline uint32_t mux_frame_header_len(const unsigned char* bytes)
+    {
+        return (uint32_t) bytes[1] | ((uint32_t) bytes[2] << 8) | ((uint32_t) bytes[3] << 16);
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -31,6 +31,13 @@
 #include "intel_st_debug_if_platform.h"
 #include "intel_st_debug_if_st_dbg_ip_driver.h"
 #include "intel_st_debug_if_stream_dbg.h"
+#include "intel_st_debug_if_stats.h"
+#include "intel_st_debug_if_metrics.h"
+#include "intel_st_debug_if_trace.h"
+#include "intel_st_debug_if_capture.h"
+#include "intel_st_debug_if_h2t_coalescer.h"
+#include "intel_st_debug_if_shm_rings.h"
+#include "intel_st_debug_if_mux.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -50,6 +57,20 @@ typedef const char* printf_format_arg;
         MULTIPLE_CLIENTS  // Server will serve an unlimited number of clients, one at a time
     } SERVER_LIFESPAN;
 
+    // Per-packet path of the data streams, see select_server_path()
+    typedef enum
+    {
+        SERVER_PATH_GENERIC,   // Goes through the SERVER_HW_CALLBACKS table
+        SERVER_PATH_ST_DBG_IP  // ST Debug IP driver called directly, wrapping buffers, no loopback
+    } SERVER_PATH;
+
+// Frame buffers of the multiplexed transport hold a frame at MUX_FRAME_OFFSET, which puts the
+// payload behind the frame and packet headers on a 64-bit boundary, and have room for the word the
+// driver's copies may write past the end of the payload
+#define MUX_FRAME_OFFSET 6
+#define MUX_MAX_BODY_LEN (SIZEOF_MGMT_PACKET_HEADER + MGMT_PACKET_MAX_PAYLOAD_BYTES)
+#define MUX_BUFF_SZ (MUX_FRAME_OFFSET + MUX_FRAME_HEADER_SZ + MUX_MAX_BODY_LEN + 8)
+
     // Structure Definitions
     typedef struct
     {
@@ -58,6 +79,10 @@ typedef const char* printf_format_arg;
         char* ctrl_tx_buff;
         size_t ctrl_tx_buff_sz;
 
+        // MUX_BUFF_SZ bytes each, the multiplexed transport is not offered to clients if NULL
+        unsigned char* mux_rx_buff;
+        unsigned char* mux_tx_buff;
+
         char h2t_header_buff[SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER];
         char t2h_header_buff[SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER];
         char mgmt_header_buff[SIZEOF_PACKET_GUARDBAND + SIZEOF_MGMT_PACKET_HEADER];
@@ -93,15 +118,26 @@ typedef const char* printf_format_arg;
         // Will return NULL if a buffer of size 'sz' is unavailable
         uint32_t (*get_h2t_buffer)(size_t sz);
 
+        // Optional callback used instead of get_h2t_buffer(). May grant only a leading part of
+        // 'sz', setting 'granted_sz' accordingly. The server then pushes the payload in parts, each
+        // with a header of its own whose EOP is only set on the last part.
+        uint32_t (*get_h2t_buffer_chunk)(size_t sz, size_t* granted_sz);
+
         // A return value of < 0 indicates an error condition
         int (*h2t_data_received)(H2T_PACKET_HEADER* header, uint32_t payload);
 
+        // Optional callback, returns a BUFFER_WAIT_REASON for the last get_h2t_buffer() call.
+        int (*get_h2t_wait_reason)();
+
         // Will return NULL if a buffer of size 'sz' is unavailable
         uint32_t (*get_mgmt_buffer)(size_t sz);
 
         // A return value of < 0 indicates an error condition
         int (*mgmt_data_received)(MGMT_PACKET_HEADER* header, uint32_t payload);
 
+        // Optional callback, returns a BUFFER_WAIT_REASON for the last get_mgmt_buffer() call.
+        int (*get_mgmt_wait_reason)();
+
         // 'payload' & 'header' are outputs to be filled -- a header->DATA_LEN_BYTES equal to 0
         // implies no data. A return value of < 0 indicates an error condition
         int (*acquire_t2h_data)(H2T_PACKET_HEADER* header, uint32_t* payload);
@@ -130,6 +166,20 @@ typedef const char* printf_format_arg;
         // Optional callback to get a driver parameter.  Returns NULL if param is undefined.
         char* (*get_param)(const char* param);
 
+        // Optional callback to report the MMIO reads and writes issued since start-up.
+        void (*get_mmio_counts)(uint64_t* reads, uint64_t* writes);
+
+        // Optional callbacks to report how much H2T / MGMT memory and how many descriptors are
+        // currently handed to the HW.
+        void (*get_h2t_occupancy)(BUFFER_OCCUPANCY* occupancy);
+        void (*get_mgmt_occupancy)(BUFFER_OCCUPANCY* occupancy);
+
+        // Optional callbacks bracketing the MGMT and H2T packets taken in one pass of the server
+        // loop, so that the driver can issue their MMIO writes as one burst. The writes must have
+        // been issued when end_write_batch() returns.
+        void (*begin_write_batch)();
+        void (*end_write_batch)();
+
     } SERVER_HW_CALLBACKS;
 
     typedef struct
@@ -138,6 +188,10 @@ typedef const char* printf_format_arg;
         size_t t2h_cnt;
         size_t mgmt_cnt;
         size_t mgmt_rsp_cnt;
+        size_t h2t_bytes;
+        size_t t2h_bytes;
+        size_t mgmt_bytes;
+        size_t mgmt_rsp_bytes;
     } SERVER_PKT_STATS;
 
     typedef struct
@@ -145,6 +199,8 @@ typedef const char* printf_format_arg;
         // Buffers
         SERVER_BUFFERS* buff;
         char h2t_waiting;
+        size_t h2t_payload_offset;  // Bytes of the current H2T payload already pushed in parts
+        H2T_COALESCER h2t_coalescer;
         char mgmt_waiting;
 
         char
@@ -153,16 +209,28 @@ typedef const char* printf_format_arg;
 
         // Callbacks
         SERVER_HW_CALLBACKS hw_callbacks;
-        char loopback_mode;  // 1 enabled, 0 disabled (default)
+        char loopback_mode;   // 1 enabled, 0 disabled (default)
+        char* loopback_buff;  // Host memory the server loopback echoes packets through
+        SERVER_PATH path;
 
         // Connection info
         SOCKET server_fd;
         struct sockaddr_in server_addr;
+        const char* unix_path;  // AF_UNIX socket file this server created, removed on close
+        char unix_listener;     // Listening on an AF_UNIX socket, so there is no Nagle to turn off
         char t2h_nagle;
         char mgmt_rsp_nagle;
+        SHM_RINGS* shm_rings;  // Attached by the client, replaces the data sockets if not NULL
+        char mux;              // The client multiplexes all streams over the CTRL socket
+        char mux_rx_pending;   // The frame in mux_rx_buff waits for room in the H2T or MGMT memory
 
         // Misc
         SERVER_PKT_STATS pkt_stats;
+        SERVER_STALL_STATS stall_stats;
+        SERVER_LATENCY_STATS latency_stats;
+        SERVER_CHANNEL_STATS channel_stats;
+        SERVER_METRICS_SNAPSHOT metrics_totals;  // Counters of all completed sessions
+        uint64_t metrics_next_publish;           // Timestamp ticks
     } SERVER_CONN;
 
     typedef struct
@@ -184,6 +252,26 @@ typedef const char* printf_format_arg;
     RETURN_CODE initialize_server(unsigned short port,
                                   SERVER_CONN* server_conn,
                                   const char* port_filename);
+    RETURN_CODE initialize_server_with_listener(SOCKET listen_fd,
+                                                SERVER_CONN* server_conn,
+                                                const char* port_filename);
+    // Listens on the AF_UNIX socket 'unix_path' instead of a TCP port. A socket file left behind
+    // at the path is replaced. Linux only.
+    RETURN_CODE initialize_server_on_unix_socket(const char* unix_path, SERVER_CONN* server_conn);
+    // Returns the socket passed in by the service manager (sd_listen_fds protocol) if any,
+    // otherwise 'listen_fd' (INVALID_SOCKET if negative).
+    SOCKET get_activated_listener_socket(int listen_fd);
+    // Async-signal-safe. The server re-executes itself with its listener once it is idle.
+    void request_server_listener_handoff();
+    // Async-signal-safe. The server ends the active session, if any, and server_main() returns.
+    void request_server_termination();
+    // Resolves the binary re-executed on a listener hand-off from argv[0]. Call at start-up.
+    RETURN_CODE set_server_exec_path(const char* argv0);
+    // Returns 'path', or '<path>.<pid>' in a replacement started by a listener hand-off so that
+    // the output file of the previous server is left alone. 'buff' holds the latter.
+    const char* get_server_output_path(const char* path, char* buff, size_t buff_sz);
+    RETURN_CODE handoff_server_listener(intel_remote_debug_server_context* context,
+                                        SERVER_CONN* server_conn);
     int server_main(intel_remote_debug_server_context* context,
                     SERVER_LIFESPAN lifespan,
                     SERVER_CONN* server_conn);
@@ -216,6 +304,9 @@ typedef const char* printf_format_arg;
     RETURN_CODE process_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn);
     RETURN_CODE process_t2h_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn);
     RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn);
+    // Picks the path the process_* functions take from the callbacks, buffers and loopback mode.
+    // Called at the start of each session and whenever the loopback mode changes.
+    void select_server_path(SERVER_CONN* server_conn);
 
     // Misc helper
     void reset_buffers(SERVER_CONN* server_conn);
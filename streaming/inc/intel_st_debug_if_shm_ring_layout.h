@@ -0,0 +1,201 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Layout of the shared memory rings a client on the same host can exchange packets with instead
+// of the data sockets. Clients include only this header, so it must not depend on any other header
+// of the library.
+//
+// The memory holds an SHM_RINGS_LAYOUT followed by four rings, each with one producer and one
+// consumer. A ring carries records of an SHM_RING_RECORD_HEADER and its payload, zero padded to a
+// multiple of 8 bytes. A record never wraps: a producer that reaches the end of the ring first
+// fills the rest of it with a SHM_RING_PAD record, which the consumer skips.
+//
+// Each side has an eventfd doorbell. A producer rings the doorbell of the consumer when
+// shm_ring_commit() says the consumer may have found the ring empty; a consumer blocks on its
+// doorbell only after shm_ring_peek() found the ring empty.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define ETHERLINK_SHM_RINGS_MAGIC 0x474E49524C485445ULL  // "ETHLRING" in little endian memory
+#define ETHERLINK_SHM_RINGS_VERSION 1
+
+// SOP_EOP bit of a record that only fills the end of the ring
+#define SHM_RING_PAD 0x80
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        SHM_RING_H2T,       // Written by the client
+        SHM_RING_MGMT,      // Written by the client
+        SHM_RING_T2H,       // Written by the server
+        SHM_RING_MGMT_RSP,  // Written by the server
+        NUM_SHM_RINGS
+    } SHM_RING;
+
+    // H2T_PACKET_HEADER, or MGMT_PACKET_HEADER with 'conn_id' reserved, padded to 8 bytes
+    typedef struct
+    {
+        uint8_t sop_eop;
+        uint8_t conn_id;
+        uint16_t channel;
+        uint16_t data_len_bytes;
+        uint16_t reserved;
+    } SHM_RING_RECORD_HEADER;
+
+    // Each index on a cache line of its own, written by one side only
+    typedef struct
+    {
+        uint64_t head;  // Bytes committed by the producer
+        uint8_t head_pad[56];
+        uint64_t tail;  // Bytes released by the consumer
+        uint8_t tail_pad[56];
+    } SHM_RING_INDICES;
+
+    typedef struct
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t ring_sz;                     // Bytes of each ring, a power of two
+        uint64_t ring_offset[NUM_SHM_RINGS];  // From the start of the memory
+        uint8_t pad[16];
+        SHM_RING_INDICES indices[NUM_SHM_RINGS];
+    } SHM_RINGS_LAYOUT;
+
+    static inline size_t shm_ring_record_len(size_t payload_len)
+    {
+        return sizeof(SHM_RING_RECORD_HEADER) + ((payload_len + 7) & ~(size_t) 7);
+    }
+
+    static inline unsigned char* shm_ring_at(SHM_RINGS_LAYOUT* rings, SHM_RING ring, uint64_t pos)
+    {
+        return (unsigned char*) rings + rings->ring_offset[ring] + (pos & (rings->ring_sz - 1));
+    }
+
+    // Producer side. Bytes a record of 'payload_len' takes, including the pad record in front of
+    // it if it does not fit before the end of the ring.
+    static inline size_t shm_ring_space_needed(const SHM_RINGS_LAYOUT* rings,
+                                               SHM_RING ring,
+                                               size_t payload_len)
+    {
+        const size_t len = shm_ring_record_len(payload_len);
+        const size_t to_end = rings->ring_sz - (size_t) (rings->indices[ring].head &
+                                                         (rings->ring_sz - 1));
+        return (to_end < len) ? to_end + len : len;
+    }
+
+    static inline int shm_ring_has_room(SHM_RINGS_LAYOUT* rings, SHM_RING ring, size_t payload_len)
+    {
+        const SHM_RING_INDICES* indices = &(rings->indices[ring]);
+        const uint64_t tail = __atomic_load_n(&(indices->tail), __ATOMIC_ACQUIRE);
+        return rings->ring_sz - (indices->head - tail) >=
+               shm_ring_space_needed(rings, ring, payload_len);
+    }
+
+    // Producer side. Returns the record to fill in for a 'payload_len' byte payload, or NULL if
+    // the ring has no room for it.
+    static inline SHM_RING_RECORD_HEADER* shm_ring_reserve(SHM_RINGS_LAYOUT* rings,
+                                                           SHM_RING ring,
+                                                           size_t payload_len)
+    {
+        const uint64_t head = rings->indices[ring].head;
+        if (!shm_ring_has_room(rings, ring, payload_len))
+        {
+            return NULL;
+        }
+        const size_t to_end = rings->ring_sz - (size_t) (head & (rings->ring_sz - 1));
+        if (to_end >= shm_ring_record_len(payload_len))
+        {
+            return (SHM_RING_RECORD_HEADER*) shm_ring_at(rings, ring, head);
+        }
+        SHM_RING_RECORD_HEADER* pad = (SHM_RING_RECORD_HEADER*) shm_ring_at(rings, ring, head);
+        memset(pad, 0, sizeof(*pad));
+        pad->sop_eop = SHM_RING_PAD;
+        return (SHM_RING_RECORD_HEADER*) shm_ring_at(rings, ring, head + to_end);
+    }
+
+    // Producer side. Publishes 'record', returned by shm_ring_reserve(), once its header and
+    // payload are filled in, together with the pad record in front of it if there is one. Returns
+    // nonzero if the consumer has to be woken up.
+    static inline int shm_ring_commit(SHM_RINGS_LAYOUT* rings,
+                                      SHM_RING ring,
+                                      const SHM_RING_RECORD_HEADER* record)
+    {
+        SHM_RING_INDICES* indices = &(rings->indices[ring]);
+        const uint64_t start = indices->head;
+        const size_t pad_len =
+            (size_t) (((const unsigned char*) record - shm_ring_at(rings, ring, start)) &
+                      (rings->ring_sz - 1));
+        __atomic_store_n(&(indices->head),
+                         start + pad_len + shm_ring_record_len(record->data_len_bytes),
+                         __ATOMIC_SEQ_CST);
+        return __atomic_load_n(&(indices->tail), __ATOMIC_SEQ_CST) == start;
+    }
+
+    // Consumer side. Returns the oldest record, or NULL if the ring is empty. The record stays
+    // valid until shm_ring_release().
+    static inline const SHM_RING_RECORD_HEADER* shm_ring_peek(SHM_RINGS_LAYOUT* rings,
+                                                              SHM_RING ring)
+    {
+        SHM_RING_INDICES* indices = &(rings->indices[ring]);
+        uint64_t tail = indices->tail;
+        while (tail != __atomic_load_n(&(indices->head), __ATOMIC_SEQ_CST))
+        {
+            const SHM_RING_RECORD_HEADER* record =
+                (const SHM_RING_RECORD_HEADER*) shm_ring_at(rings, ring, tail);
+            if ((record->sop_eop & SHM_RING_PAD) == 0)
+            {
+                return record;
+            }
+            tail += rings->ring_sz - (size_t) (tail & (rings->ring_sz - 1));
+            __atomic_store_n(&(indices->tail), tail, __ATOMIC_SEQ_CST);
+        }
+        return NULL;
+    }
+
+    // Consumer side. Frees the record returned by shm_ring_peek(). 'header' is that record, or the
+    // consumer's own copy of its header when the producer is not trusted: the length is not read
+    // from the ring again.
+    static inline void shm_ring_release(SHM_RINGS_LAYOUT* rings,
+                                        SHM_RING ring,
+                                        const SHM_RING_RECORD_HEADER* header)
+    {
+        SHM_RING_INDICES* indices = &(rings->indices[ring]);
+        __atomic_store_n(&(indices->tail),
+                         indices->tail + shm_ring_record_len(header->data_len_bytes),
+                         __ATOMIC_SEQ_CST);
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,73 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_sockets.h"
+#include "intel_st_debug_if_shm_ring_layout.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Bytes of each ring, unless the client asks for another power of two within the limits
+#define SHM_RING_DEFAULT_SZ (1u << 20)
+#define SHM_RING_MIN_SZ (1u << 18)
+#define SHM_RING_MAX_SZ (1u << 26)
+
+    // Shared memory rings attached by a client of the unix socket listener. The memory is a
+    // memfd, handed to the client over the control socket together with both doorbells.
+    typedef struct
+    {
+        SHM_RINGS_LAYOUT* layout;
+        size_t map_sz;
+        int memfd;
+        int server_doorbell;  // eventfd rung by the client, readable by select()
+        int client_doorbell;  // eventfd rung by the server
+        char wake_client;     // A T2H or MGMT RSP record was committed to a ring found empty
+    } SHM_RINGS;
+
+    // 'ring_sz' must be a power of two between SHM_RING_MIN_SZ and SHM_RING_MAX_SZ. Returns NULL
+    // on failure.
+    SHM_RINGS* create_shm_rings(size_t ring_sz);
+    void destroy_shm_rings(SHM_RINGS* rings);
+
+    // Sends 'msg' over the unix socket 'fd' with the memfd, the server doorbell and the client
+    // doorbell attached, in that order.
+    RETURN_CODE send_shm_rings(SOCKET fd, const SHM_RINGS* rings, const char* msg, size_t msg_len);
+
+    // Clears the server doorbell
+    void drain_shm_rings_doorbell(SHM_RINGS* rings);
+    // Rings the client doorbell if 'wake_client' is set, and clears the latter
+    void ring_shm_rings_client_doorbell(SHM_RINGS* rings);
+
+#ifdef __cplusplus
+}
+#endif
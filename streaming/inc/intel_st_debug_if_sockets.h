@@ -69,6 +69,13 @@ extern "C"
 #define INVALID_SOCKET -1
 #else
 typedef int ssize_t;
+#endif
+
+// A peer that closes its end must fail the send rather than raise SIGPIPE in the server
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+#define SEND_NO_SIGNAL MSG_NOSIGNAL
+#else
+#define SEND_NO_SIGNAL 0
 #endif
 
     extern const struct timeval ZERO_TIMEOUT;
@@ -95,7 +102,15 @@ typedef int ssize_t;
     int set_linger_socket_option(SOCKET socket_fd, int l_onoff, int l_linger);
     char is_last_socket_error_would_block();
     int close_socket_fd(SOCKET socket_fd);
-    void wait_for_read_event(SOCKET socket_fd, long seconds, long useconds);
+    int wait_for_read_event(SOCKET socket_fd, long seconds, long useconds);
+    int is_listening_stream_socket(SOCKET socket_fd);
+    int is_unix_domain_socket(SOCKET socket_fd);
+    // Removes the socket file a previous instance left at 'unix_path', so that it can be bound
+    // again. Returns -1 and leaves the path alone if it is not a socket (errno ENOTSOCK) or something
+    // listens on it (errno EADDRINUSE).
+    int remove_stale_unix_socket(const char* unix_path);
+    int get_socket_local_port(SOCKET socket_fd);
+    int set_close_on_exec(SOCKET socket_fd, int close_on_exec);
     int get_last_socket_error();
     const char* get_last_socket_error_msg(char* buff, size_t buff_sz);
     RETURN_CODE alloc_tcpip_recv_send_buffer(size_t sz);
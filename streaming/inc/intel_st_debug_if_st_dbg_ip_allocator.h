@@ -26,39 +26,147 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "intel_fpga_api.h"
+
+// Ring over a power of two sized IP memory. The offsets only ever grow and are masked when used
+// as an address, so the used space is their difference and no division is needed.
 typedef struct
 {
     uint32_t raw_buff;
     size_t span;
-    size_t write_offset;
-    size_t read_offset;
-    size_t space_available;
+    uint64_t mask;
+    uint64_t write_offset;
+    uint64_t read_offset;
 } CIRCLE_BUFF;
 
+static inline int is_pow_2(size_t n)
+{
+    return (n & (n - 1)) == 0;
+}
+
+// 'raw_buff_sz' must be a power of two, or 0 for a ring nothing can be allocated from
 static inline void cbuff_init(CIRCLE_BUFF* cbuff, uint32_t raw_buff, size_t raw_buff_sz)
 {
     cbuff->raw_buff = raw_buff;
     cbuff->span = raw_buff_sz;
+    cbuff->mask = raw_buff_sz - 1;
     cbuff->write_offset = 0;
     cbuff->read_offset = 0;
-    cbuff->space_available = raw_buff_sz;
+}
+
+static inline size_t cbuff_space_available(const CIRCLE_BUFF* cbuff)
+{
+    return cbuff->span - (size_t) (cbuff->write_offset - cbuff->read_offset);
 }
 
 // No safety here. Assumptions are there is enough valid data to prevent underflowing, and 'amt' is
 // > 0.
 static inline void cbuff_free(CIRCLE_BUFF* cbuff, size_t amt)
 {
-    cbuff->space_available += amt;
-    cbuff->read_offset = (cbuff->read_offset + amt) % cbuff->span;
+    cbuff->read_offset += amt;
+}
+
+// Frees everything allocated before 'write_offset', an earlier value of cbuff->write_offset
+static inline void cbuff_free_to(CIRCLE_BUFF* cbuff, uint64_t write_offset)
+{
+    cbuff->read_offset = write_offset;
 }
 
 // No safety here. Assumptions are there is enough space to prevent overflowing, and 'amt' is > 0.
 static inline uint32_t cbuff_alloc(CIRCLE_BUFF* cbuff, size_t amt)
 {
-    cbuff->space_available -= amt;
-    uint32_t result = cbuff->raw_buff + cbuff->write_offset;
-    cbuff->write_offset = (cbuff->write_offset + amt) % cbuff->span;
+    uint32_t result = cbuff->raw_buff + (uint32_t) (cbuff->write_offset & cbuff->mask);
+    cbuff->write_offset += amt;
     return result;
 }
+
+// Tracks the descriptors handed to the IP in order. For each one it keeps the ring write offset
+// after its payload, i.e. a running sum of the payload sizes, so the memory of any number of
+// completed descriptors is freed with a single lookup.
+typedef struct
+{
+    uint64_t* ring_end_offsets;  // Indexed by descriptor sequence number & mask
+    uint32_t mask;
+    uint32_t depth;      // Descriptors the IP accepts at once, from its CSR
+    uint64_t pushed;         // Sequence number of the next descriptor
+    uint64_t completed;      // Descriptors the IP is done with
+    uint64_t completed_end;  // Ring offset after the payload of the last completed descriptor
+} DESCRIPTOR_TRACKER;
+
+#define DESCRIPTOR_TRACKER_default {NULL, 0, 0, 0, 0, 0}
+
+// Sizes the tracker for 'depth' descriptors, reusing its storage when large enough. Returns -1 if
+// the storage cannot be allocated.
+static inline int desc_tracker_init(DESCRIPTOR_TRACKER* tracker, uint32_t depth)
+{
+    uint64_t slots = 1;
+    while (slots < depth)
+    {
+        slots <<= 1;
+    }
+    if ((tracker->ring_end_offsets == NULL) || (slots > (uint64_t) tracker->mask + 1))
+    {
+        uint64_t* storage =
+            (uint64_t*) realloc(tracker->ring_end_offsets, (size_t) slots * sizeof(uint64_t));
+        if (storage == NULL)
+        {
+            return -1;
+        }
+        tracker->ring_end_offsets = storage;
+        tracker->mask = (uint32_t) (slots - 1);
+    }
+    tracker->depth = depth;
+    tracker->pushed = 0;
+    tracker->completed = 0;
+    tracker->completed_end = 0;
+    return 0;
+}
+
+static inline uint32_t desc_tracker_in_flight(const DESCRIPTOR_TRACKER* tracker)
+{
+    return (uint32_t) (tracker->pushed - tracker->completed);
+}
+
+static inline uint32_t desc_tracker_slots_available(const DESCRIPTOR_TRACKER* tracker)
+{
+    return tracker->depth - desc_tracker_in_flight(tracker);
+}
+
+// Records where the payload of the next descriptor ends. Calling it again before
+// desc_tracker_push() replaces the record.
+static inline void desc_tracker_reserve(DESCRIPTOR_TRACKER* tracker, uint64_t ring_end_offset)
+{
+    tracker->ring_end_offsets[tracker->pushed & tracker->mask] = ring_end_offset;
+}
+
+// Assumes a slot is available and its descriptor has been reserved
+static inline void desc_tracker_push(DESCRIPTOR_TRACKER* tracker)
+{
+    ++tracker->pushed;
+}
+
+// Marks the 'n' oldest descriptors in flight complete and returns the ring offset up to which
+// their memory can be freed. 'n' comes from an IP CSR, so it is clamped to the descriptors in
+// flight rather than trusted to free memory that is still in use.
+static inline uint64_t desc_tracker_complete(DESCRIPTOR_TRACKER* tracker, uint32_t n)
+{
+    const uint32_t in_flight = desc_tracker_in_flight(tracker);
+    if (n > in_flight)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "IP reports %u descriptors complete, only %u are in flight\n",
+                        (unsigned int) n,
+                        (unsigned int) in_flight);
+        n = in_flight;
+    }
+    if (n > 0)
+    {
+        tracker->completed += n;
+        tracker->completed_end =
+            tracker->ring_end_offsets[(tracker->completed - 1) & tracker->mask];
+    }
+    return tracker->completed_end;
+}
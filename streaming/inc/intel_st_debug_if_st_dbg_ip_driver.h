@@ -44,6 +44,7 @@ extern "C"
 #define SUPPORTED_VERSION 1
 #define INIT_ERROR_CODE_MISSING_INFO -1
 #define INIT_ERROR_CODE_INCOMPATIBLE_IP -2
+#define INIT_ERROR_CODE_UNSUPPORTED_CONFIG -3
 
 // Customize here from FPGA design
 #define ST_DBG_IF_BASE 0x0000
@@ -91,15 +92,65 @@ JOP_MEM_SIZE_2K is used to match SW H2T/T2H memory base address with HW tcl defi
         ST_DBG_IP_DESIGN_INFO std_dbg_ip_info;
     } intel_stream_debug_if_driver_context;
 
-// The ST Debug IP allows these to be queried dynamically, but since we are not using malloc,
-// I will reserve enough space for the upperlimit of how many descriptors the IP supports.
-#define MAX_H2T_DESCRIPTOR_DEPTH 128
-#define MAX_MGMT_DESCRIPTOR_DEPTH 128
+    // Why the most recent get_h2t_buffer() / get_mgmt_buffer() call did not grant a buffer
+    typedef enum
+    {
+        BUFFER_GRANTED,
+        BUFFER_WAIT_DESCRIPTOR_SLOTS,
+        BUFFER_WAIT_SPACE
+    } BUFFER_WAIT_REASON;
+
+    // Host side view of the H2T or MGMT memory and descriptors handed to the IP
+    typedef struct
+    {
+        uint64_t ring_used;  // Bytes
+        uint64_t ring_size;
+        uint64_t descriptors_used;
+        uint64_t descriptor_depth;
+    } BUFFER_OCCUPANCY;
+
+    // Width of the driver's MMIO accesses. On 32-bit bridges the descriptor sequences and the
+    // payload copies are made of 32-bit accesses only.
+    typedef enum
+    {
+        MMIO_WIDTH_AUTO,  // Probed by init_driver()
+        MMIO_WIDTH_32,
+        MMIO_WIDTH_64
+    } MMIO_WIDTH;
+
+    // How memcpy64_host2fpga() / memcpy64_fpga2host() access the IP memories
+    typedef enum
+    {
+        COPY_KERNEL_MMIO64,  // One 64-bit access per word
+        COPY_KERNEL_MMIO32,  // Two 32-bit accesses per word, low half first
+        NUM_COPY_KERNELS
+    } COPY_KERNEL;
+
+    typedef enum
+    {
+        COPY_DIRECTION_H2T,  // memcpy64_host2fpga(), H2T and MGMT payloads
+        COPY_DIRECTION_T2H,  // memcpy64_fpga2host(), T2H and MGMT RSP payloads
+        NUM_COPY_DIRECTIONS
+    } COPY_DIRECTION;
+
+    typedef struct
+    {
+        COPY_KERNEL kernel;
+        uint32_t chunk_words;  // Words accessed back to back before host memory is touched
+    } COPY_STRATEGY;
+
+#define COPY_STRATEGY_MAX_CHUNK_WORDS 8
+// Longest "<h2t strategy>,<t2h strategy>", e.g. "mmio64:8,mmio32:1"
+#define COPY_STRATEGY_SPEC_MAX_LEN 32
 
 // This is used to keep addresses passed to the H2T / MGMT CSR aligned to the native word size
 // of the ST Debug IP's DMA masters.
 #define ST_DBG_IP_BUFF_ALIGN_POW_2 3  // Aligned to 64-bit boundaries
 
+// Smallest part of an H2T payload get_h2t_buffer_chunk() grants when the whole payload does not
+// fit, unless the H2T memory is smaller. Each part takes a descriptor slot and a descriptor push.
+#define ST_DBG_IP_H2T_MIN_CHUNK_SZ 512
+
 // Config CSR
 #define ST_DBG_IP_CONFIG_TYPE 0x0
 #define ST_DBG_IP_CONFIG_VERSION 0x4
@@ -162,10 +213,15 @@ JOP_MEM_SIZE_2K is used to match SW H2T/T2H memory base address with HW tcl defi
 
     // H2T
     uint32_t get_h2t_buffer(size_t sz);
+    // Like get_h2t_buffer(), but when the whole payload does not fit, grants a leading part of it
+    // of at least ST_DBG_IP_H2T_MIN_CHUNK_SZ bytes. '*granted_sz' is set to the bytes granted.
+    uint32_t get_h2t_buffer_chunk(size_t sz, size_t* granted_sz);
+    int get_h2t_buffer_wait_reason();
     int push_h2t_data(H2T_PACKET_HEADER* header, uint32_t payload);
 
     // MGMT
     uint32_t get_mgmt_buffer(size_t sz);
+    int get_mgmt_buffer_wait_reason();
     int push_mgmt_data(MGMT_PACKET_HEADER* header, uint32_t payload);
 
     // T2H
@@ -176,6 +232,11 @@ JOP_MEM_SIZE_2K is used to match SW H2T/T2H memory base address with HW tcl defi
     int get_mgmt_rsp_data(MGMT_PACKET_HEADER* header, uint32_t* payload);
     void mgmt_rsp_data_complete();
 
+    // MMIO width, applies from the next init_driver() when probing, otherwise right away
+    void set_mmio_width(MMIO_WIDTH width);
+    // The width in use, never MMIO_WIDTH_AUTO
+    MMIO_WIDTH get_mmio_width();
+
     // Config CSR
     void set_loopback_mode(int val);
     int get_loopback_mode();
@@ -188,6 +249,24 @@ JOP_MEM_SIZE_2K is used to match SW H2T/T2H memory base address with HW tcl defi
     // buffer data exchange
     void memcpy64_fpga2host(int32_t fpga_buff, uint64_t* host_buff, size_t len);
     void memcpy64_host2fpga(uint64_t* host_buff, int32_t fpga_buff, size_t len);
+    // Write batch: until end_mmio_write_batch(), the payload stores of memcpy64_host2fpga() and
+    // the descriptor CSR writes of push_h2t_data() / push_mgmt_data() are queued, then issued as
+    // one burst with a single ordering fence between the payloads and the descriptors. Other MMIO
+    // accesses are not deferred, memcpy64_fpga2host() issues the queue before reading.
+    void begin_mmio_write_batch();
+    void end_mmio_write_batch();
+    void set_copy_strategy(COPY_DIRECTION direction, COPY_STRATEGY strategy);
+    COPY_STRATEGY get_copy_strategy(COPY_DIRECTION direction);
+    // "<kernel>:<chunk words>", e.g. "mmio64:4"
+    int format_copy_strategy(COPY_STRATEGY strategy, char* buff, size_t buff_sz);
+    // Sets both directions from "<strategy>" or "<h2t strategy>,<t2h strategy>". Returns 0 on
+    // success, nothing is changed otherwise.
+    int set_copy_strategy_spec(const char* spec);
+
+    // Statistics
+    void get_h2t_occupancy(BUFFER_OCCUPANCY* occupancy);
+    void get_mgmt_occupancy(BUFFER_OCCUPANCY* occupancy);
+    void get_mmio_op_counts(uint64_t* reads, uint64_t* writes);
 
     // Misc settings
     int set_driver_param(const char* param, const char* val);
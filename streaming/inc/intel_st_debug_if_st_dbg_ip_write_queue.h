@@ -0,0 +1,125 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+// Posted MMIO writes of several packets, gathered while a write batch is open. They are issued in
+// two groups: all payload stores, one ordering fence, then all descriptor CSR writes in the order
+// they were queued. Every payload store thus reaches the IP before any descriptor that may refer
+// to it, with a single fence per batch instead of one per packet.
+enum
+{
+    WRITE_QUEUE_PAYLOAD_WORDS = 2048,  // 16 KiB of staged payload
+    WRITE_QUEUE_PAYLOADS = 64,
+    WRITE_QUEUE_CSR_WRITES = 128  // 32 descriptors over 32-bit MMIO
+};
+
+typedef struct
+{
+    uint32_t fpga_buff;
+    uint32_t first_word;  // In 'staging'
+    uint32_t len;         // Bytes
+} QUEUED_PAYLOAD;
+
+typedef struct
+{
+    uint64_t offset;
+    uint64_t value;
+    char is_64bit;
+    int line;  // Where the write was queued, for the MMIO log
+    const char* function;
+} QUEUED_CSR_WRITE;
+
+typedef struct
+{
+    char is_open;
+    uint32_t num_payloads;
+    uint32_t staged_words;
+    uint32_t num_csr_writes;
+    uint32_t num_h2t_pushes;  // Queued descriptors, the IP does not count them as used slots yet
+    uint32_t num_mgmt_pushes;
+    QUEUED_PAYLOAD payloads[WRITE_QUEUE_PAYLOADS];
+    QUEUED_CSR_WRITE csr_writes[WRITE_QUEUE_CSR_WRITES];
+    uint64_t staging[WRITE_QUEUE_PAYLOAD_WORDS];
+} MMIO_WRITE_QUEUE;
+
+static inline int write_queue_is_empty(const MMIO_WRITE_QUEUE* queue)
+{
+    return (queue->num_payloads == 0) && (queue->num_csr_writes == 0);
+}
+
+static inline int write_queue_has_payload_room(const MMIO_WRITE_QUEUE* queue, size_t len)
+{
+    return (queue->num_payloads < WRITE_QUEUE_PAYLOADS) &&
+           ((len + 7) / 8 <= WRITE_QUEUE_PAYLOAD_WORDS - queue->staged_words);
+}
+
+static inline int write_queue_has_csr_room(const MMIO_WRITE_QUEUE* queue, uint32_t num_writes)
+{
+    return num_writes <= WRITE_QUEUE_CSR_WRITES - queue->num_csr_writes;
+}
+
+// Assumes write_queue_has_payload_room()
+static inline void write_queue_add_payload(MMIO_WRITE_QUEUE* queue,
+                                           const uint64_t* host_buff,
+                                           uint32_t fpga_buff,
+                                           size_t len)
+{
+    QUEUED_PAYLOAD* payload = &(queue->payloads[queue->num_payloads++]);
+    payload->fpga_buff = fpga_buff;
+    payload->first_word = queue->staged_words;
+    payload->len = (uint32_t) len;
+    memcpy(&(queue->staging[queue->staged_words]), host_buff, len);
+    queue->staged_words += (uint32_t) ((len + 7) / 8);
+}
+
+// Assumes write_queue_has_csr_room()
+static inline void write_queue_add_csr_write(MMIO_WRITE_QUEUE* queue,
+                                             uint64_t offset,
+                                             uint64_t value,
+                                             char is_64bit,
+                                             int line,
+                                             const char* function)
+{
+    QUEUED_CSR_WRITE* write = &(queue->csr_writes[queue->num_csr_writes++]);
+    write->offset = offset;
+    write->value = value;
+    write->is_64bit = is_64bit;
+    write->line = line;
+    write->function = function;
+}
+
+static inline void write_queue_clear(MMIO_WRITE_QUEUE* queue)
+{
+    queue->num_payloads = 0;
+    queue->staged_words = 0;
+    queue->num_csr_writes = 0;
+    queue->num_h2t_pushes = 0;
+    queue->num_mgmt_pushes = 0;
+}
@@ -0,0 +1,245 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "intel_st_debug_if_packet.h"
+#include "intel_st_debug_if_timestamp.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Reasons why data is not moving. Time is accumulated in timestamp ticks.
+    typedef enum
+    {
+        STALL_H2T_DESCRIPTOR_SLOTS,   // H2T packet waiting, no free H2T descriptor slot
+        STALL_H2T_RING_SPACE,         // H2T packet waiting, not enough free H2T memory
+        STALL_MGMT_DESCRIPTOR_SLOTS,  // MGMT packet waiting, no free MGMT descriptor slot
+        STALL_MGMT_RING_SPACE,        // MGMT packet waiting, not enough free MGMT memory
+        STALL_T2H_EMPTY_POLL,         // T2H polled, nothing available
+        STALL_T2H_SEND_BLOCKED,       // T2H socket not writable, client not draining
+        STALL_MGMT_RSP_PENDING,       // MGMT sent, MGMT_RSP polling gated until its EOP
+        STALL_CONTROL,                // Time spent handling control messages
+        NUM_STALL_REASONS
+    } SERVER_STALL_REASON;
+
+    typedef struct
+    {
+        uint64_t events[NUM_STALL_REASONS];
+        uint64_t ticks[NUM_STALL_REASONS];
+        uint64_t since[NUM_STALL_REASONS];  // Start of an open stall interval, 0 if none
+        uint64_t session_start;
+    } SERVER_STALL_STATS;
+
+    // Opens a stall interval unless one is already open for this reason.
+    static inline void stall_begin(SERVER_STALL_STATS* stats, SERVER_STALL_REASON reason)
+    {
+        if (stats->since[reason] == 0)
+        {
+            stats->since[reason] = get_timestamp_ticks();
+            stats->events[reason]++;
+        }
+    }
+
+    // Closes the stall interval for this reason, if one is open.
+    static inline void stall_end(SERVER_STALL_STATS* stats, SERVER_STALL_REASON reason)
+    {
+        if (stats->since[reason] != 0)
+        {
+            stats->ticks[reason] += get_timestamp_ticks() - stats->since[reason];
+            stats->since[reason] = 0;
+        }
+    }
+
+    // Accounts one complete event whose duration was measured by the caller.
+    static inline void stall_add(SERVER_STALL_STATS* stats,
+                                 SERVER_STALL_REASON reason,
+                                 uint64_t ticks)
+    {
+        stats->events[reason]++;
+        stats->ticks[reason] += ticks;
+    }
+
+    void reset_stall_stats(SERVER_STALL_STATS* stats);
+    const char* get_stall_reason_name(SERVER_STALL_REASON reason);
+    // Includes the still open part of an ongoing stall
+    uint64_t get_stall_time_ns(const SERVER_STALL_STATS* stats, SERVER_STALL_REASON reason);
+    // Writes "<name>=<events>:<us> ..." for all reasons, or "<events> <us>" when 'reason_name'
+    // names a single reason. Returns a negative value if 'reason_name' is unknown.
+    int format_stall_stats(const SERVER_STALL_STATS* stats,
+                           const char* reason_name,
+                           char* buff,
+                           size_t buff_sz);
+    void dump_stall_stats(const SERVER_STALL_STATS* stats);
+
+// Log-linear (HDR style) buckets: values below 2^LATENCY_SUB_BUCKET_BITS get one bucket each, every
+// power of two above that is split into 2^LATENCY_SUB_BUCKET_BITS linear sub-buckets, i.e. the
+// relative bucket width is at most 12.5%. Values are in timestamp ticks and are clamped to
+// 2^(LATENCY_MAX_EXPONENT + 1) - 1.
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKET_COUNT (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_EXPONENT 47
+#define LATENCY_BUCKET_COUNT \
+    ((LATENCY_MAX_EXPONENT - LATENCY_SUB_BUCKET_BITS + 2) * LATENCY_SUB_BUCKET_COUNT)
+
+    typedef enum
+    {
+        LATENCY_H2T,       // H2T header received until the descriptor is pushed
+        LATENCY_T2H,       // T2H descriptor observed until the packet is sent
+        LATENCY_MGMT,      // MGMT request pushed until the MGMT_RSP EOP is sent
+        LATENCY_MGMT_RSP,  // MGMT_RSP descriptor observed until the packet is sent
+        NUM_LATENCY_STREAMS
+    } SERVER_LATENCY_STREAM;
+
+    typedef struct
+    {
+        uint64_t counts[LATENCY_BUCKET_COUNT];
+        uint64_t total;
+        uint64_t min;
+        uint64_t max;
+    } LATENCY_HISTOGRAM;
+
+    typedef struct
+    {
+        LATENCY_HISTOGRAM histograms[NUM_LATENCY_STREAMS];
+        uint64_t h2t_header_received;  // Start of the H2T packet in flight
+        uint64_t mgmt_request_pushed;  // Start of the outstanding MGMT request
+    } SERVER_LATENCY_STATS;
+
+    static inline unsigned int latency_bucket_index(uint64_t ticks)
+    {
+        if (ticks < LATENCY_SUB_BUCKET_COUNT)
+        {
+            return (unsigned int) ticks;
+        }
+        if (ticks >> (LATENCY_MAX_EXPONENT + 1))
+        {
+            ticks = (1ULL << (LATENCY_MAX_EXPONENT + 1)) - 1;
+        }
+        const unsigned int exponent = 63 - (unsigned int) __builtin_clzll(ticks);
+        const unsigned int shift = exponent - LATENCY_SUB_BUCKET_BITS;
+        return ((shift + 1) << LATENCY_SUB_BUCKET_BITS) +
+               (unsigned int) ((ticks >> shift) & (LATENCY_SUB_BUCKET_COUNT - 1));
+    }
+
+    static inline void latency_record(LATENCY_HISTOGRAM* histogram, uint64_t ticks)
+    {
+        histogram->counts[latency_bucket_index(ticks)]++;
+        if ((histogram->total++ == 0) || (ticks < histogram->min))
+        {
+            histogram->min = ticks;
+        }
+        if (ticks > histogram->max)
+        {
+            histogram->max = ticks;
+        }
+    }
+
+    void reset_latency_histogram(LATENCY_HISTOGRAM* histogram);
+    void reset_latency_stats(SERVER_LATENCY_STATS* stats);
+    // Returns the stream for 'h2t', 't2h', 'mgmt' or 'mgmt_rsp', NUM_LATENCY_STREAMS otherwise.
+    SERVER_LATENCY_STREAM get_latency_stream(const char* stream_name);
+    const char* get_latency_stream_name(SERVER_LATENCY_STREAM stream);
+    // Writes "n=<count> min=<ns> p50=<ns> p90=<ns> p99=<ns> p999=<ns> max=<ns>". Percentiles are
+    // the upper bound of the bucket holding them, capped at the maximum seen.
+    int format_latency_histogram(const LATENCY_HISTOGRAM* histogram, char* buff, size_t buff_sz);
+    void dump_latency_stats(const SERVER_LATENCY_STATS* stats);
+
+#define CHANNEL_STATS_CHANNEL_COUNT (H2T_PACKET_HEADER_MASK_CHANNEL + 1)
+#define CHANNEL_STATS_SIZE_BUCKET_COUNT 6
+#define CHANNEL_STATS_MAX_TOP_N 16
+
+    typedef enum
+    {
+        CHANNEL_H2T,
+        CHANNEL_T2H,
+        NUM_CHANNEL_DIRECTIONS
+    } CHANNEL_DIRECTION;
+
+    // 32 bytes, two channels per cache line. The packet count is the sum of the size buckets.
+    typedef struct
+    {
+        uint64_t bytes;
+        // Payload size <= 64, <= 256, <= 512, <= 1024, <= 2048 and larger
+        uint32_t size_buckets[CHANNEL_STATS_SIZE_BUCKET_COUNT];
+    } CHANNEL_STATS_ENTRY;
+
+    typedef struct
+    {
+        // NUM_CHANNEL_DIRECTIONS x CHANNEL_STATS_CHANNEL_COUNT entries, indexed by
+        // direction * CHANNEL_STATS_CHANNEL_COUNT + channel
+        CHANNEL_STATS_ENTRY* entries;
+    } SERVER_CHANNEL_STATS;
+
+    static inline unsigned int channel_size_bucket_index(unsigned short payload_bytes)
+    {
+        return (payload_bytes <= 64)     ? 0
+               : (payload_bytes <= 256)  ? 1
+               : (payload_bytes <= 512)  ? 2
+               : (payload_bytes <= 1024) ? 3
+               : (payload_bytes <= 2048) ? 4
+                                         : 5;
+    }
+
+    static inline void channel_stats_record(SERVER_CHANNEL_STATS* stats,
+                                            CHANNEL_DIRECTION direction,
+                                            unsigned short channel,
+                                            unsigned short payload_bytes)
+    {
+        CHANNEL_STATS_ENTRY* entry =
+            &(stats->entries[direction * CHANNEL_STATS_CHANNEL_COUNT +
+                             (channel & H2T_PACKET_HEADER_MASK_CHANNEL)]);
+        entry->bytes += payload_bytes;
+        entry->size_buckets[channel_size_bucket_index(payload_bytes)]++;
+    }
+
+    RETURN_CODE alloc_channel_stats(SERVER_CHANNEL_STATS* stats);
+    void free_channel_stats(SERVER_CHANNEL_STATS* stats);
+    void reset_channel_stats(SERVER_CHANNEL_STATS* stats);
+    // Returns the direction for 'h2t' or 't2h', NUM_CHANNEL_DIRECTIONS otherwise.
+    CHANNEL_DIRECTION get_channel_direction(const char* direction_name);
+    // Writes "<channel>=<bytes>:<packets> ..." for the 'top_n' channels with the most bytes, as
+    // many as fit.
+    int format_channel_top(const SERVER_CHANNEL_STATS* stats,
+                           CHANNEL_DIRECTION direction,
+                           unsigned int top_n,
+                           char* buff,
+                           size_t buff_sz);
+    // Writes "bytes=<n> packets=<n> le64=<n> le256=<n> le512=<n> le1k=<n> le2k=<n> gt2k=<n>".
+    int format_channel_stats(const SERVER_CHANNEL_STATS* stats,
+                             CHANNEL_DIRECTION direction,
+                             unsigned short channel,
+                             char* buff,
+                             size_t buff_sz);
+
+#ifdef __cplusplus
+}
+#endif
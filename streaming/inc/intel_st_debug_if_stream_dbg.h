@@ -39,6 +39,18 @@ extern "C"
         intel_stream_debug_if_driver_context driver_cxt;
         size_t h2t_t2h_mem_size;
         int port;
+        int listen_fd;                  // Pre-bound listening socket, -1 to bind 'port' instead
+        const char* unix_socket_path;   // Unix socket to listen on instead of 'port', NULL for TCP
+        char* const* exec_argv;         // Command line used to re-execute on a listener hand-off
+        int metrics_port;               // Metrics endpoint TCP port, -1 to disable
+        const char* metrics_unix_path;  // Metrics endpoint unix socket, used instead of the port
+        const char* stats_page_name;    // Shared memory stats page, NULL to disable
+        const char* trace_file;         // Trace dump file, NULL for the default under /tmp
+        const char* mmio_log_file;      // Log MMIO accesses from start-up, NULL to disable
+        const char* capture_file;       // Capture packets from start-up, NULL to disable
+        const char* copy_strategy;      // Payload copy strategy, NULL to calibrate at start-up
+        MMIO_WIDTH mmio_width;          // MMIO_WIDTH_AUTO to probe the bridge
+        const char* h2t_coalesce;       // H2T coalescing "<bytes>[,<microseconds>]", NULL for off
     } intel_remote_debug_server_context;
 
     int start_st_dbg_transport_server_over_tcpip(intel_remote_debug_server_context* context);
@@ -46,7 +58,15 @@ extern "C"
                                                  FPGA_MMIO_INTERFACE_HANDLE mmio_handle,
                                                  size_t size,
                                                  int port);
+    // Runs the H2T -> T2H loopback self-benchmark instead of serving clients
+    int run_st_dbg_transport_self_bench(intel_remote_debug_server_context* context);
+    // Not async-signal-safe, see request_st_dbg_transport_server_termination()
     void terminate_st_dbg_transport_server_over_tcpip();
+    // Async-signal-safe. start_st_dbg_transport_server_over_tcpip() stops serving and returns.
+    void request_st_dbg_transport_server_termination();
+    void request_st_dbg_transport_server_listener_handoff();
+    // Async-signal-safe
+    int dump_st_dbg_transport_server_trace();
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,106 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_packet.h"
+#include "intel_st_debug_if_timestamp.h"
+#include "intel_st_debug_if_trace_layout.h"
+
+// Number of records kept, must be a power of two. 16 bytes per record.
+#ifndef SERVER_TRACE_RING_RECORDS
+#define SERVER_TRACE_RING_RECORDS (1 << 18)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Always-on record of the last SERVER_TRACE_RING_RECORDS data-path events. There is a single
+    // writer, the server thread; 'head' counts the records written so far and is only advanced
+    // once a record is complete.
+    typedef struct
+    {
+        uint64_t head;
+        TRACE_RECORD records[SERVER_TRACE_RING_RECORDS];
+    } SERVER_TRACE_RING;
+
+    extern SERVER_TRACE_RING g_server_trace_ring;
+
+    static inline void trace_event(TRACE_EVENT event,
+                                   TRACE_STREAM stream,
+                                   uint8_t conn_id,
+                                   uint16_t channel,
+                                   uint16_t length,
+                                   uint8_t sop_eop)
+    {
+        const uint64_t head = g_server_trace_ring.head;
+        TRACE_RECORD* record =
+            &(g_server_trace_ring.records[head & (SERVER_TRACE_RING_RECORDS - 1)]);
+        record->timestamp = get_timestamp_ticks();
+        record->channel = channel;
+        record->length = length;
+        record->conn_id = conn_id;
+        record->stream = (uint8_t) stream;
+        record->event = (uint8_t) event;
+        record->sop_eop = sop_eop;
+        __atomic_store_n(&(g_server_trace_ring.head), head + 1, __ATOMIC_RELEASE);
+    }
+
+    static inline void trace_h2t_event(TRACE_EVENT event,
+                                       TRACE_STREAM stream,
+                                       const H2T_PACKET_HEADER* header)
+    {
+        trace_event(event,
+                    stream,
+                    header->CONN_ID,
+                    header->CHANNEL,
+                    header->DATA_LEN_BYTES,
+                    header->SOP_EOP);
+    }
+
+    static inline void trace_mgmt_event(TRACE_EVENT event,
+                                        TRACE_STREAM stream,
+                                        const MGMT_PACKET_HEADER* header)
+    {
+        trace_event(event, stream, 0, header->CHANNEL, header->DATA_LEN_BYTES, header->SOP_EOP);
+    }
+
+    // Sets the file that dump_server_trace() writes, NULL restores the default
+    // /tmp/etherlink-trace.<pid>.bin.
+    RETURN_CODE set_server_trace_file(const char* path);
+    const char* get_server_trace_file();
+    // Writes the ring to the trace file, replacing an earlier dump. Async-signal-safe, the server
+    // keeps recording while the dump is written.
+    RETURN_CODE dump_server_trace();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Layout of the binary trace dumps written by the server. The offline decoder includes only this
+// header, so it must not depend on any other header of the library.
+
+#include <stdint.h>
+
+#define ETHERLINK_TRACE_MAGIC 0x454352544C485445ULL  // "ETHLTRCE" in little endian memory
+#define ETHERLINK_TRACE_VERSION 1
+
+#define ETHERLINK_TRACE_STREAM_NAMES {"h2t", "t2h", "mgmt", "mgmt_rsp"}
+#define ETHERLINK_TRACE_EVENT_NAMES                                                         \
+    {                                                                                       \
+        "header_received", "buffer_wait", "buffer_granted", "descriptor_pushed", "fetched", \
+            "send_done", "completion"                                                       \
+    }
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        TRACE_STREAM_H2T,
+        TRACE_STREAM_T2H,
+        TRACE_STREAM_MGMT,
+        TRACE_STREAM_MGMT_RSP,
+        NUM_TRACE_STREAMS
+    } TRACE_STREAM;
+
+    typedef enum
+    {
+        TRACE_EVENT_HEADER_RECEIVED,    // H2T / MGMT header read from the client
+        TRACE_EVENT_BUFFER_WAIT,        // No H2T / MGMT buffer available yet
+        TRACE_EVENT_BUFFER_GRANTED,     // H2T / MGMT buffer handed out by the driver
+        TRACE_EVENT_DESCRIPTOR_PUSHED,  // H2T / MGMT payload handed to the HW
+        TRACE_EVENT_FETCHED,            // T2H / MGMT RSP data picked up from the HW
+        TRACE_EVENT_SEND_DONE,          // T2H / MGMT RSP (or loopback) payload sent to the client
+        TRACE_EVENT_COMPLETION,         // T2H / MGMT RSP buffer returned to the HW
+        NUM_TRACE_EVENTS
+    } TRACE_EVENT;
+
+    typedef struct
+    {
+        uint64_t timestamp;  // Timestamp ticks
+        uint16_t channel;
+        uint16_t length;  // Payload bytes
+        uint8_t conn_id;  // 0 for MGMT / MGMT RSP
+        uint8_t stream;   // TRACE_STREAM
+        uint8_t event;    // TRACE_EVENT
+        uint8_t sop_eop;  // SOP_EOP field of the packet header
+    } TRACE_RECORD;
+
+    // A dump file is this header followed by 'record_count' records, oldest first. The first
+    // 'records_invalid' of them were being overwritten while the dump was written and are to be
+    // skipped.
+    typedef struct
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t record_size;  // sizeof(TRACE_RECORD) of the writer
+        uint64_t record_count;
+        uint64_t records_invalid;
+        uint64_t records_total;     // Events recorded since start-up
+        uint64_t ticks_per_second;  // To convert record timestamps
+        uint64_t dump_ticks;        // Timestamp ticks when the dump started
+        uint64_t dump_realtime_ns;  // CLOCK_REALTIME when the dump started
+        uint64_t pid;
+    } TRACE_FILE_HEADER;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,679 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_capture_layout.h"
+#include "intel_st_debug_if_st_dbg_ip_driver.h"
+#include "intel_st_debug_if_sim_ip.h"
+
+enum
+{
+    SIM_IP_H2T_MEM_BASE = SIM_IP_H2T_T2H_MEM_SZ,
+    SIM_IP_T2H_MEM_BASE = 2 * SIM_IP_H2T_T2H_MEM_SZ,
+    SIM_IP_MGMT_MEM_BASE = 3 * SIM_IP_H2T_T2H_MEM_SZ,
+    SIM_IP_MGMT_RSP_MEM_BASE = SIM_IP_MGMT_MEM_BASE + SIM_IP_MGMT_MEM_SZ,
+    SIM_IP_ADDRESS_SPAN = SIM_IP_MGMT_RSP_MEM_BASE + SIM_IP_MGMT_MEM_SZ,
+    SIM_IP_MAX_REPORTED_MISMATCHES = 10
+};
+
+_Static_assert(SIM_IP_H2T_T2H_MEM_SZ > JOP_MEM_SIZE_2K,
+               "The driver maps memories of up to 2K differently");
+
+typedef struct SIM_IP_PACKET
+{
+    struct SIM_IP_PACKET* next;
+    const unsigned char* data;
+    uint16_t length;
+    uint16_t channel;
+    uint8_t conn_id;
+    uint8_t last;
+    unsigned char payload[];  // Holds 'data' of looped back packets
+} SIM_IP_PACKET;
+
+// T2H or MGMT RSP packets waiting to be read by the driver. Only the head packet is placed into
+// the memory, at the next free offset, when the driver asks for it.
+typedef struct
+{
+    SIM_IP_PACKET* head;
+    SIM_IP_PACKET* tail;
+    uint32_t mem_base;
+    uint32_t mem_sz;
+    uint32_t write_offset;
+    uint32_t where;
+    int head_placed;
+} SIM_IP_QUEUE;
+
+// Descriptor being written by the driver
+typedef struct
+{
+    uint32_t last_howlong;
+    uint32_t where;
+    uint32_t conn_id;
+} SIM_IP_DESCRIPTOR;
+
+static unsigned char g_mem[SIM_IP_ADDRESS_SPAN];  // The CSR part is not used
+static unsigned char g_rx_buff[MAX_MACRO(SIM_IP_H2T_T2H_MEM_SZ, SIM_IP_MGMT_MEM_SZ)];
+static uint32_t g_reset_and_loopback = 0;
+static uint32_t g_interrupts = 0;
+static SIM_IP_DESCRIPTOR g_h2t_descriptor;
+static SIM_IP_DESCRIPTOR g_mgmt_descriptor;
+static SIM_IP_QUEUE g_t2h_queue = {.mem_base = SIM_IP_T2H_MEM_BASE,
+                                   .mem_sz = SIM_IP_H2T_T2H_MEM_SZ};
+static SIM_IP_QUEUE g_mgmt_rsp_queue = {.mem_base = SIM_IP_MGMT_RSP_MEM_BASE,
+                                        .mem_sz = SIM_IP_MGMT_MEM_SZ};
+
+// Capture replay, 'g_records' lists the packet records of the capture in order. H2T and MGMT
+// packets arrive over separate sockets, so they are matched against the capture per stream and
+// 'g_cursor' only passes a captured H2T / MGMT packet once it has been received.
+static unsigned char* g_capture = NULL;
+static const CAPTURE_RECORD** g_records = NULL;
+static unsigned char* g_received = NULL;
+static size_t g_record_count = 0;
+static size_t g_cursor = 0;
+static size_t g_next_incoming[NUM_CAPTURE_STREAMS];
+static uint64_t g_matched = 0;
+static uint64_t g_mismatched = 0;
+static uint64_t g_unexpected = 0;
+static int g_discard = 0;
+static int g_32bit_bridge = 0;
+static int g_h2t_hold = 0;
+static uint32_t g_h2t_held = 0;  // H2T descriptors received but not handed back to the driver
+// What the configuration CSRs report, the memory map stays the one of SIM_IP_H2T_T2H_MEM_SZ
+static uint32_t g_config_h2t_t2h_mem_sz = SIM_IP_H2T_T2H_MEM_SZ;
+static uint32_t g_descriptor_depth = SIM_IP_DESCRIPTOR_DEPTH;
+
+static int is_incoming(const CAPTURE_RECORD* record)
+{
+    return (record->stream == CAPTURE_STREAM_H2T) || (record->stream == CAPTURE_STREAM_MGMT);
+}
+
+static const unsigned char* get_record_payload(const CAPTURE_RECORD* record)
+{
+    return (const unsigned char*) (record + 1);
+}
+
+static void enqueue_packet(SIM_IP_QUEUE* queue, SIM_IP_PACKET* packet)
+{
+    packet->next = NULL;
+    if (queue->tail != NULL)
+    {
+        queue->tail->next = packet;
+    }
+    else
+    {
+        queue->head = packet;
+    }
+    queue->tail = packet;
+}
+
+static void dequeue_packet(SIM_IP_QUEUE* queue)
+{
+    SIM_IP_PACKET* packet = queue->head;
+    if (packet == NULL)
+    {
+        return;
+    }
+    queue->head = packet->next;
+    if (queue->head == NULL)
+    {
+        queue->tail = NULL;
+    }
+    queue->head_placed = 0;
+    free(packet);
+}
+
+static void reset_queue(SIM_IP_QUEUE* queue)
+{
+    while (queue->head != NULL)
+    {
+        dequeue_packet(queue);
+    }
+    queue->write_offset = 0;
+}
+
+static void place_head_packet(SIM_IP_QUEUE* queue)
+{
+    const SIM_IP_PACKET* packet = queue->head;
+    if ((packet == NULL) || queue->head_placed)
+    {
+        return;
+    }
+    const size_t first_len = MIN_MACRO(packet->length, queue->mem_sz - queue->write_offset);
+    memcpy(&(g_mem[queue->mem_base + queue->write_offset]), packet->data, first_len);
+    memcpy(&(g_mem[queue->mem_base]), packet->data + first_len, packet->length - first_len);
+    queue->where = queue->write_offset;
+    queue->write_offset = (queue->write_offset + GET_ALIGNED_SZ(packet->length)) % queue->mem_sz;
+    queue->head_placed = 1;
+}
+
+static uint32_t get_head_last_howlong(SIM_IP_QUEUE* queue)
+{
+    if (queue->head == NULL)
+    {
+        return 0;
+    }
+    place_head_packet(queue);
+    return queue->head->length | (queue->head->last ? ST_DBG_IP_LAST_DESCRIPTOR_MASK : 0);
+}
+
+static void send_packet(SIM_IP_QUEUE* queue,
+                        const unsigned char* data,
+                        size_t length,
+                        uint16_t channel,
+                        uint8_t conn_id,
+                        uint8_t last,
+                        int copy_data)
+{
+    SIM_IP_PACKET* packet;
+    if (length > queue->mem_sz)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "SW model: a %zu byte packet does not fit into the %u byte memory, it is "
+                        "truncated",
+                        length,
+                        queue->mem_sz);
+        length = queue->mem_sz;
+    }
+    if ((packet = (SIM_IP_PACKET*) malloc(sizeof(SIM_IP_PACKET) + (copy_data ? length : 0))) ==
+        NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "SW model: out of memory, a packet is lost");
+        return;
+    }
+    if (copy_data)
+    {
+        memcpy(packet->payload, data, length);
+        data = packet->payload;
+    }
+    packet->data = data;
+    packet->length = (uint16_t) length;
+    packet->channel = channel;
+    packet->conn_id = conn_id;
+    packet->last = last;
+    enqueue_packet(queue, packet);
+}
+
+// Sends the packets the server sent up to the next captured packet not received yet
+static void release_captured_packets()
+{
+    while ((g_cursor < g_record_count) &&
+           (!is_incoming(g_records[g_cursor]) || g_received[g_cursor]))
+    {
+        const CAPTURE_RECORD* record = g_records[g_cursor++];
+        if (is_incoming(record))
+        {
+            continue;
+        }
+        send_packet((record->stream == CAPTURE_STREAM_T2H) ? &g_t2h_queue : &g_mgmt_rsp_queue,
+                    get_record_payload(record),
+                    record->length,
+                    record->channel,
+                    record->conn_id,
+                    (record->sop_eop & H2T_PACKET_HEADER_MASK_EOP) ? 1 : 0,
+                    0);
+    }
+}
+
+static void report_mismatch(const char* what, CAPTURE_STREAM stream, uint16_t channel, size_t i)
+{
+    static const char* const stream_names[] = ETHERLINK_CAPTURE_STREAM_NAMES;
+    if (g_mismatched + g_unexpected <= SIM_IP_MAX_REPORTED_MISMATCHES)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "SW model: %s %s packet on channel %u, capture packet %zu",
+                        what,
+                        stream_names[stream],
+                        (unsigned) channel,
+                        i);
+    }
+}
+
+static void replay_packet(CAPTURE_STREAM stream,
+                          const unsigned char* data,
+                          size_t length,
+                          uint16_t channel,
+                          uint8_t conn_id,
+                          uint8_t last)
+{
+    size_t i = g_next_incoming[stream];
+    while ((i < g_record_count) && (g_records[i]->stream != stream))
+    {
+        ++i;
+    }
+    if (i < g_record_count)
+    {
+        const CAPTURE_RECORD* record = g_records[i];
+        if ((record->channel != channel) || (record->length != length) ||
+            ((stream == CAPTURE_STREAM_H2T) && (record->conn_id != conn_id)) ||
+            (((record->sop_eop & H2T_PACKET_HEADER_MASK_EOP) != 0) != (last != 0)) ||
+            (memcmp(get_record_payload(record), data, length) != 0))
+        {
+            g_mismatched++;
+            report_mismatch("Different", stream, channel, i);
+        }
+        else
+        {
+            g_matched++;
+        }
+        g_received[i] = 1;
+        g_next_incoming[stream] = i + 1;
+    }
+    else
+    {
+        g_unexpected++;
+        report_mismatch("Unexpected", stream, channel, i);
+    }
+    release_captured_packets();
+}
+
+static void receive_packet(CAPTURE_STREAM stream,
+                           const SIM_IP_DESCRIPTOR* descriptor,
+                           uint32_t mem_base,
+                           uint32_t mem_sz,
+                           uint16_t channel)
+{
+    if (g_discard)
+    {
+        return;
+    }
+    const size_t length = MIN_MACRO(descriptor->last_howlong & ST_DBG_IP_HOW_LONG_MASK, mem_sz);
+    const uint8_t last = (descriptor->last_howlong & ST_DBG_IP_LAST_DESCRIPTOR_MASK) ? 1 : 0;
+    const uint32_t offset = (descriptor->where - mem_base) % mem_sz;
+    const size_t first_len = MIN_MACRO(length, mem_sz - offset);
+    memcpy(g_rx_buff, &(g_mem[mem_base + offset]), first_len);
+    memcpy(&(g_rx_buff[first_len]), &(g_mem[mem_base]), length - first_len);
+
+    // The loopback bit takes precedence over the capture
+    const uint32_t loopback_field = (stream == CAPTURE_STREAM_H2T)
+                                        ? ST_DBG_IP_CONFIG_H2T_T2H_LOOPBACK_FIELD
+                                        : ST_DBG_IP_CONFIG_MGMT_AND_RSP_LOOPBACK_FIELD;
+    if ((g_records != NULL) && !(g_reset_and_loopback & loopback_field))
+    {
+        replay_packet(stream, g_rx_buff, length, channel, (uint8_t) descriptor->conn_id, last);
+    }
+    else
+    {
+        send_packet((stream == CAPTURE_STREAM_H2T) ? &g_t2h_queue : &g_mgmt_rsp_queue,
+                    g_rx_buff,
+                    length,
+                    channel,
+                    (uint8_t) descriptor->conn_id,
+                    last,
+                    1);
+    }
+}
+
+static uint32_t read_csr(uint64_t offset)
+{
+    switch (offset)
+    {
+        case ST_DBG_IP_CONFIG_TYPE:
+            return SUPPORTED_TYPE_SIGNATURE;
+        case ST_DBG_IP_CONFIG_VERSION:
+            return SUPPORTED_VERSION;
+        case ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK:
+            return g_reset_and_loopback;
+        case ST_DBG_IP_CONFIG_H2T_T2H_MEM:
+            return g_config_h2t_t2h_mem_sz;
+        case ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_MEM:
+            return SIM_IP_MGMT_MEM_SZ;
+        case ST_DBG_IP_H2T_AVAILABLE_SLOTS:
+            return g_descriptor_depth - g_h2t_held;
+        case ST_DBG_IP_CONFIG_H2T_T2H_DESC_DEPTH:
+        case ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_DESC_DEPTH:
+        case ST_DBG_IP_MGMT_AVAILABLE_SLOTS:  // Descriptors are consumed when pushed
+            return g_descriptor_depth;
+        case ST_DBG_IP_CONFIG_INTERRUPTS:
+            return g_interrupts;
+        case ST_DBG_IP_T2H_HOW_LONG:
+            return get_head_last_howlong(&g_t2h_queue);
+        case ST_DBG_IP_T2H_WHERE:
+            return (g_t2h_queue.head != NULL) ? g_t2h_queue.where : 0;
+        case ST_DBG_IP_T2H_CONNECTION_ID:
+            return (g_t2h_queue.head != NULL) ? g_t2h_queue.head->conn_id : 0;
+        case ST_DBG_IP_T2H_CHANNEL_ID_ADVANCE:
+            return (g_t2h_queue.head != NULL) ? g_t2h_queue.head->channel : 0;
+        case ST_DBG_IP_MGMT_RSP_HOW_LONG:
+            return get_head_last_howlong(&g_mgmt_rsp_queue);
+        case ST_DBG_IP_MGMT_RSP_WHERE:
+            return (g_mgmt_rsp_queue.head != NULL) ? g_mgmt_rsp_queue.where : 0;
+        case ST_DBG_IP_MGMT_RSP_CHANNEL_ID_ADVANCE:
+            return (g_mgmt_rsp_queue.head != NULL) ? g_mgmt_rsp_queue.head->channel : 0;
+        default:
+            return 0;
+    }
+}
+
+static void write_csr(uint64_t offset, uint32_t value)
+{
+    switch (offset)
+    {
+        case ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK:
+            if (value & ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD)
+            {
+                reset_queue(&g_t2h_queue);
+                g_h2t_held = 0;
+            }
+            if (value & ST_DBG_IP_CONFIG_MGMT_AND_RSP_RESET_FIELD)
+            {
+                reset_queue(&g_mgmt_rsp_queue);
+            }
+            // The resets clear themselves
+            g_reset_and_loopback = value & ~(ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD |
+                                             ST_DBG_IP_CONFIG_MGMT_AND_RSP_RESET_FIELD);
+            release_captured_packets();
+            break;
+        case ST_DBG_IP_CONFIG_INTERRUPTS:
+            g_interrupts = value;
+            break;
+        case ST_DBG_IP_H2T_HOW_LONG:
+            g_h2t_descriptor.last_howlong = value;
+            break;
+        case ST_DBG_IP_H2T_WHERE:
+            g_h2t_descriptor.where = value;
+            break;
+        case ST_DBG_IP_H2T_CONNECTION_ID:
+            g_h2t_descriptor.conn_id = value;
+            break;
+        case ST_DBG_IP_H2T_CHANNEL_ID_PUSH:
+            if (g_h2t_hold && (g_h2t_held < g_descriptor_depth))
+            {
+                g_h2t_held++;
+            }
+            receive_packet(CAPTURE_STREAM_H2T,
+                           &g_h2t_descriptor,
+                           SIM_IP_H2T_MEM_BASE,
+                           SIM_IP_H2T_T2H_MEM_SZ,
+                           (uint16_t) value);
+            break;
+        case ST_DBG_IP_T2H_DESCRIPTORS_DONE:
+            dequeue_packet(&g_t2h_queue);
+            break;
+        case ST_DBG_IP_MGMT_HOW_LONG:
+            g_mgmt_descriptor.last_howlong = value;
+            break;
+        case ST_DBG_IP_MGMT_WHERE:
+            g_mgmt_descriptor.where = value;
+            break;
+        case ST_DBG_IP_MGMT_CHANNEL_ID_PUSH:
+            receive_packet(CAPTURE_STREAM_MGMT,
+                           &g_mgmt_descriptor,
+                           SIM_IP_MGMT_MEM_BASE,
+                           SIM_IP_MGMT_MEM_SZ,
+                           (uint16_t) value);
+            break;
+        case ST_DBG_IP_MGMT_RSP_DESCRIPTORS_DONE:
+            dequeue_packet(&g_mgmt_rsp_queue);
+            break;
+        default:
+            break;
+    }
+}
+
+static int is_memory_access(uint64_t offset, size_t len)
+{
+    if ((offset < SIM_IP_H2T_MEM_BASE) || (offset + len > SIM_IP_ADDRESS_SPAN))
+    {
+        if (offset >= SIM_IP_H2T_MEM_BASE)
+        {
+            fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                            "SW model: access beyond the IP at 0x%llx",
+                            (unsigned long long) offset);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+uint32_t sim_ip_read_32(uint64_t offset)
+{
+    uint32_t value;
+    if (!is_memory_access(offset, sizeof(value)))
+    {
+        return read_csr(offset);
+    }
+    memcpy(&value, &(g_mem[offset]), sizeof(value));
+    return value;
+}
+
+uint64_t sim_ip_read_64(uint64_t offset)
+{
+    if (g_32bit_bridge)
+    {
+        return sim_ip_read_32(offset);
+    }
+    uint64_t value;
+    if (!is_memory_access(offset, sizeof(value)))
+    {
+        // 64-bit registers are pairs of 32-bit ones, low word first
+        return read_csr(offset) | ((uint64_t) read_csr(offset + 4) << 32);
+    }
+    memcpy(&value, &(g_mem[offset]), sizeof(value));
+    return value;
+}
+
+void sim_ip_write_32(uint64_t offset, uint32_t value)
+{
+    if (!is_memory_access(offset, sizeof(value)))
+    {
+        write_csr(offset, value);
+        return;
+    }
+    memcpy(&(g_mem[offset]), &value, sizeof(value));
+}
+
+void sim_ip_write_64(uint64_t offset, uint64_t value)
+{
+    if (g_32bit_bridge)
+    {
+        sim_ip_write_32(offset, (uint32_t) value);
+        return;
+    }
+    if (!is_memory_access(offset, sizeof(value)))
+    {
+        write_csr(offset, (uint32_t) value);
+        write_csr(offset + 4, (uint32_t) (value >> 32));
+        return;
+    }
+    memcpy(&(g_mem[offset]), &value, sizeof(value));
+}
+
+static RETURN_CODE load_capture(const char* path)
+{
+    const CAPTURE_FILE_HEADER* header;
+    const CAPTURE_FILE_FOOTER* footer;
+    size_t capture_len;
+    size_t records_end;
+    size_t pos;
+    size_t capacity = 0;
+    uint64_t dropped = 0;
+    long file_len;
+    FILE* file;
+
+    if ((file = fopen(path, "rb")) == NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "SW model: failed to open capture %s", path);
+        return FAILURE;
+    }
+    if ((fseek(file, 0, SEEK_END) != 0) || ((file_len = ftell(file)) < 0) ||
+        (fseek(file, 0, SEEK_SET) != 0) ||
+        ((g_capture = (unsigned char*) malloc((size_t) file_len + 1)) == NULL) ||
+        (fread(g_capture, 1, (size_t) file_len, file) != (size_t) file_len))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "SW model: failed to read capture %s", path);
+        fclose(file);
+        return FAILURE;
+    }
+    fclose(file);
+    capture_len = (size_t) file_len;
+
+    header = (const CAPTURE_FILE_HEADER*) g_capture;
+    if ((capture_len < sizeof(*header)) || (header->magic != ETHERLINK_CAPTURE_MAGIC) ||
+        (header->version != ETHERLINK_CAPTURE_VERSION) ||
+        (header->record_size != sizeof(CAPTURE_RECORD)))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "SW model: %s is not a capture file", path);
+        return FAILURE;
+    }
+
+    // Without a footer the capture was not closed cleanly and ends with the last whole record
+    records_end = capture_len;
+    footer = (const CAPTURE_FILE_FOOTER*) &(g_capture[capture_len - sizeof(*footer)]);
+    if ((capture_len >= sizeof(*header) + sizeof(*footer)) &&
+        (footer->magic == ETHERLINK_CAPTURE_INDEX_MAGIC) && (footer->index_offset <= capture_len))
+    {
+        records_end = (size_t) footer->index_offset;
+    }
+
+    for (pos = sizeof(*header); pos + sizeof(CAPTURE_RECORD) <= records_end;)
+    {
+        const CAPTURE_RECORD* record = (const CAPTURE_RECORD*) &(g_capture[pos]);
+        const size_t record_len = sizeof(*record) + GET_ALIGNED_SZ(record->length);
+        if (pos + record_len > records_end)
+        {
+            break;
+        }
+        if ((record->type == CAPTURE_RECORD_PACKET) && (record->stream < NUM_CAPTURE_STREAMS))
+        {
+            if (g_record_count == capacity)
+            {
+                capacity = (capacity != 0) ? 2 * capacity : 1024;
+                const CAPTURE_RECORD** records = (const CAPTURE_RECORD**) realloc(
+                    (void*) g_records, capacity * sizeof(const CAPTURE_RECORD*));
+                if (records == NULL)
+                {
+                    fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "SW model: out of memory");
+                    return FAILURE;
+                }
+                g_records = records;
+            }
+            g_records[g_record_count++] = record;
+        }
+        else if ((record->type == CAPTURE_RECORD_DROPPED) && (record->length >= sizeof(dropped)))
+        {
+            uint64_t count;
+            memcpy(&count, get_record_payload(record), sizeof(count));
+            dropped += count;
+        }
+        pos += record_len;
+    }
+    if (dropped != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "SW model: %llu packets are missing from the capture, the replay will "
+                        "differ from the original session",
+                        (unsigned long long) dropped);
+    }
+    if ((g_received = (unsigned char*) calloc(g_record_count + 1, 1)) == NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "SW model: out of memory");
+        return FAILURE;
+    }
+    fpga_msg_printf(
+        FPGA_MSG_PRINTF_INFO, "SW model: replaying %zu packets from %s", g_record_count, path);
+    return OK;
+}
+
+RETURN_CODE init_sim_ip(const char* capture_path)
+{
+    cleanup_sim_ip();
+    if ((capture_path != NULL) && (load_capture(capture_path) != OK))
+    {
+        cleanup_sim_ip();
+        return FAILURE;
+    }
+    if (capture_path == NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "SW model: H2T and MGMT packets are looped back");
+    }
+    return OK;
+}
+
+void cleanup_sim_ip()
+{
+    if (g_records != NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                        "SW model: %llu packets matched the capture, %llu differed, %llu were not "
+                        "expected, %zu of %zu capture packets were not reached",
+                        (unsigned long long) g_matched,
+                        (unsigned long long) g_mismatched,
+                        (unsigned long long) g_unexpected,
+                        g_record_count - g_cursor,
+                        g_record_count);
+    }
+    reset_queue(&g_t2h_queue);
+    reset_queue(&g_mgmt_rsp_queue);
+    free((void*) g_records);
+    free(g_received);
+    free(g_capture);
+    g_records = NULL;
+    g_received = NULL;
+    g_capture = NULL;
+    g_record_count = 0;
+    g_cursor = 0;
+    memset(g_next_incoming, 0, sizeof(g_next_incoming));
+    g_matched = 0;
+    g_mismatched = 0;
+    g_unexpected = 0;
+    g_discard = 0;
+    g_32bit_bridge = 0;
+    g_h2t_hold = 0;
+    g_h2t_held = 0;
+    g_config_h2t_t2h_mem_sz = SIM_IP_H2T_T2H_MEM_SZ;
+    g_descriptor_depth = SIM_IP_DESCRIPTOR_DEPTH;
+}
+
+void set_sim_ip_discard_mode(int discard)
+{
+    g_discard = discard;
+}
+
+void set_sim_ip_32bit_bridge(int enable)
+{
+    g_32bit_bridge = enable;
+}
+
+void set_sim_ip_config(uint32_t h2t_t2h_mem_sz, uint32_t descriptor_depth)
+{
+    g_config_h2t_t2h_mem_sz = (h2t_t2h_mem_sz != 0) ? h2t_t2h_mem_sz : SIM_IP_H2T_T2H_MEM_SZ;
+    g_descriptor_depth = (descriptor_depth != 0) ? descriptor_depth : SIM_IP_DESCRIPTOR_DEPTH;
+    g_h2t_held = 0;
+}
+
+void set_sim_ip_h2t_hold(int hold)
+{
+    g_h2t_hold = hold;
+    if (!hold)
+    {
+        g_h2t_held = 0;
+    }
+}
@@ -0,0 +1,76 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "intel_st_debug_if_common.h"
+
+// Address map of the simulated IP, in the layout the driver derives from the CSR sizes
+#ifndef SIM_IP_H2T_T2H_MEM_SZ
+#define SIM_IP_H2T_T2H_MEM_SZ 8192
+#endif
+#ifndef SIM_IP_MGMT_MEM_SZ
+#define SIM_IP_MGMT_MEM_SZ 8192
+#endif
+#define SIM_IP_DESCRIPTOR_DEPTH 64
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Software model of the ST Debug IP, used instead of the platform's MMIO in SW_MODEL builds.
+    // H2T and MGMT descriptors are consumed as soon as they are pushed. Without a capture the
+    // model loops them back as T2H and MGMT RSP. With a capture, each H2T / MGMT packet is
+    // matched against the next captured packet of its stream, and each captured T2H / MGMT RSP
+    // packet is sent once all packets captured before it have been received. Setting the
+    // loopback bit of a stream loops it back regardless of the capture.
+    RETURN_CODE init_sim_ip(const char* capture_path);
+    // Reports how the replayed packets matched the capture
+    void cleanup_sim_ip();
+    // Drops H2T and MGMT packets instead of looping them back, so that benchmarks of the driver
+    // do not pay for queueing the responses
+    void set_sim_ip_discard_mode(int discard);
+    // Behaves like a bridge without 64-bit MMIO: 64-bit accesses only carry their low word
+    void set_sim_ip_32bit_bridge(int enable);
+    // Keeps the H2T descriptors pushed while set, as an IP that has not consumed them yet, so that
+    // their H2T memory is not freed. The packets are still received. Clearing it consumes them.
+    void set_sim_ip_h2t_hold(int hold);
+    // Overrides the H2T/T2H memory size and the descriptor depth the configuration CSRs report, 0
+    // restores the default. The memory map does not change, so a driver can only go on to use
+    // the IP with the default memory size.
+    void set_sim_ip_config(uint32_t h2t_t2h_mem_sz, uint32_t descriptor_depth);
+
+    uint32_t sim_ip_read_32(uint64_t offset);
+    uint64_t sim_ip_read_64(uint64_t offset);
+    void sim_ip_write_32(uint64_t offset, uint32_t value);
+    void sim_ip_write_64(uint64_t offset, uint64_t value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,205 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_async_writer.h"
+
+enum
+{
+    ASYNC_WRITER_PERIOD_NS = 10000000
+};
+
+const ASYNC_WRITER ASYNC_WRITER_default = {.ring = NULL,
+                                           .ring_sz = 0,
+                                           .head = 0,
+                                           .tail = 0,
+                                           .reserve_pos = 0,
+                                           .reserve_end = 0,
+                                           .header_len = 0,
+                                           .fd = -1,
+                                           .running = 0};
+
+static int write_all(int fd, const unsigned char* buff, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t written = write(fd, buff, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        buff += written;
+        len -= (size_t) written;
+    }
+    return 0;
+}
+
+// Returns the number of bytes drained
+static uint64_t drain_ring(ASYNC_WRITER* writer)
+{
+    const uint64_t tail = writer->tail;
+    const uint64_t head = __atomic_load_n(&(writer->head), __ATOMIC_ACQUIRE);
+    if (head == tail)
+    {
+        return 0;
+    }
+    const size_t pos = (size_t) (tail & (writer->ring_sz - 1));
+    const size_t len = (size_t) (head - tail);
+    const size_t first_len = MIN_MACRO(len, writer->ring_sz - pos);
+    if ((write_all(writer->fd, &(writer->ring[pos]), first_len) != 0) ||
+        (write_all(writer->fd, writer->ring, len - first_len) != 0))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to write log file: %s", strerror(errno));
+    }
+    __atomic_store_n(&(writer->tail), head, __ATOMIC_RELEASE);
+    return len;
+}
+
+static void* async_writer_thread(void* arg)
+{
+    ASYNC_WRITER* writer = (ASYNC_WRITER*) arg;
+    const struct timespec period = {0, ASYNC_WRITER_PERIOD_NS};
+    while (__atomic_load_n(&(writer->running), __ATOMIC_ACQUIRE))
+    {
+        if (drain_ring(writer) == 0)
+        {
+            nanosleep(&period, NULL);
+        }
+    }
+    return NULL;
+}
+
+RETURN_CODE open_async_writer(ASYNC_WRITER* writer,
+                              const char* path,
+                              unsigned char* ring,
+                              size_t ring_sz,
+                              const void* header,
+                              size_t header_len)
+{
+    *writer = ASYNC_WRITER_default;
+    if ((writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to open %s: %s", path, strerror(errno));
+        return FAILURE;
+    }
+    if (write_all(writer->fd, (const unsigned char*) header, header_len) != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to write %s: %s", path, strerror(errno));
+        close(writer->fd);
+        writer->fd = -1;
+        return FAILURE;
+    }
+    writer->ring = ring;
+    writer->ring_sz = ring_sz;
+    writer->header_len = header_len;
+    writer->running = 1;
+    if (pthread_create(&(writer->thread), NULL, async_writer_thread, writer) != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to start the writer thread for %s", path);
+        writer->running = 0;
+        close(writer->fd);
+        writer->fd = -1;
+        return FAILURE;
+    }
+    return OK;
+}
+
+void close_async_writer(ASYNC_WRITER* writer, const void* trailer, size_t trailer_len)
+{
+    if (writer->fd < 0)
+    {
+        return;
+    }
+    __atomic_store_n(&(writer->running), 0, __ATOMIC_RELEASE);
+    pthread_join(writer->thread, NULL);
+    drain_ring(writer);
+    if ((trailer_len > 0) &&
+        (write_all(writer->fd, (const unsigned char*) trailer, trailer_len) != 0))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to write log file: %s", strerror(errno));
+    }
+    close(writer->fd);
+    writer->fd = -1;
+}
+
+int async_writer_reserve(ASYNC_WRITER* writer, size_t len)
+{
+    const uint64_t head = writer->head;
+    const uint64_t tail = __atomic_load_n(&(writer->tail), __ATOMIC_ACQUIRE);
+    if (writer->ring_sz - (head - tail) < len)
+    {
+        return 0;
+    }
+    writer->reserve_pos = head;
+    writer->reserve_end = head + len;
+    return 1;
+}
+
+void async_writer_append(ASYNC_WRITER* writer, const void* data, size_t len)
+{
+    const size_t pos = (size_t) (writer->reserve_pos & (writer->ring_sz - 1));
+    const size_t first_len = MIN_MACRO(len, writer->ring_sz - pos);
+    len = MIN_MACRO(len, (size_t) (writer->reserve_end - writer->reserve_pos));
+    memcpy(&(writer->ring[pos]), data, MIN_MACRO(first_len, len));
+    if (len > first_len)
+    {
+        memcpy(writer->ring, (const unsigned char*) data + first_len, len - first_len);
+    }
+    writer->reserve_pos += len;
+}
+
+void async_writer_commit(ASYNC_WRITER* writer)
+{
+    __atomic_store_n(&(writer->head), writer->reserve_end, __ATOMIC_RELEASE);
+}
+
+int async_writer_push(ASYNC_WRITER* writer, const void* data, size_t len)
+{
+    if (!async_writer_reserve(writer, len))
+    {
+        return 0;
+    }
+    async_writer_append(writer, data, len);
+    async_writer_commit(writer);
+    return 1;
+}
+
+uint64_t get_async_writer_file_offset(const ASYNC_WRITER* writer)
+{
+    return writer->header_len + writer->head;
+}
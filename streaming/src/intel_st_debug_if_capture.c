@@ -0,0 +1,307 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_async_writer.h"
+#include "intel_st_debug_if_capture.h"
+#include "intel_st_debug_if_timestamp.h"
+
+enum
+{
+    CAPTURE_RING_SZ = 1 << 22  // Power of two
+};
+
+_Static_assert((CAPTURE_RING_SZ & (CAPTURE_RING_SZ - 1)) == 0,
+               "The capture ring size must be a power of two");
+_Static_assert(sizeof(CAPTURE_RECORD) == 16, "Capture records keep payloads 8 byte aligned");
+
+int g_capture_enabled = 0;
+
+static char g_capture_file[PATH_MAX] = CAPTURE_DEFAULT_FILE;
+
+static unsigned char g_ring[CAPTURE_RING_SZ];
+static ASYNC_WRITER g_writer = {.fd = -1};
+static uint64_t g_dropped = 0;  // Packets not yet reported as dropped
+static uint64_t g_record_count = 0;
+
+// The packet between capture_packet_begin() and capture_packet_end(), if it fit into the ring
+static int g_packet_open = 0;
+static size_t g_packet_remaining = 0;  // Payload bytes still expected
+static size_t g_packet_padding = 0;
+
+static CAPTURE_INDEX_ENTRY* g_index = NULL;
+static size_t g_index_count = 0;
+static size_t g_index_capacity = 0;
+
+static const unsigned char g_zeros[8] = {0};
+
+static size_t get_padding(size_t len)
+{
+    return (8 - (len & 7)) & 7;
+}
+
+static void add_index_entry(uint64_t timestamp, uint64_t file_offset)
+{
+    if (g_index_count == g_index_capacity)
+    {
+        const size_t capacity = (g_index_capacity != 0) ? 2 * g_index_capacity : 256;
+        CAPTURE_INDEX_ENTRY* index =
+            (CAPTURE_INDEX_ENTRY*) realloc(g_index, capacity * sizeof(CAPTURE_INDEX_ENTRY));
+        if (index == NULL)
+        {
+            return;  // The index is an accelerator, the records stay readable without it
+        }
+        g_index = index;
+        g_index_capacity = capacity;
+    }
+    g_index[g_index_count].record_number = g_record_count;
+    g_index[g_index_count].timestamp = timestamp;
+    g_index[g_index_count].file_offset = file_offset;
+    g_index_count++;
+}
+
+// Reserves a record and its payload and writes the record. Returns 0 if they do not fit.
+static int begin_record(const CAPTURE_RECORD* record, size_t payload_len)
+{
+    const uint64_t file_offset = get_async_writer_file_offset(&g_writer);
+    if (!async_writer_reserve(&g_writer, sizeof(*record) + payload_len + get_padding(payload_len)))
+    {
+        return 0;
+    }
+    if ((g_record_count % CAPTURE_INDEX_INTERVAL) == 0)
+    {
+        add_index_entry(record->timestamp, file_offset);
+    }
+    async_writer_append(&g_writer, record, sizeof(*record));
+    return 1;
+}
+
+static void end_record()
+{
+    async_writer_commit(&g_writer);
+    g_record_count++;
+}
+
+static void flush_dropped(uint64_t timestamp)
+{
+    CAPTURE_RECORD record;
+    memset(&record, 0, sizeof(record));
+    record.timestamp = timestamp;
+    record.length = sizeof(g_dropped);
+    record.type = CAPTURE_RECORD_DROPPED;
+    if (begin_record(&record, sizeof(g_dropped)))
+    {
+        async_writer_append(&g_writer, &g_dropped, sizeof(g_dropped));
+        end_record();
+        g_dropped = 0;
+    }
+}
+
+void capture_session()
+{
+    CAPTURE_RECORD record;
+    if (!g_capture_enabled)
+    {
+        return;
+    }
+    memset(&record, 0, sizeof(record));
+    record.timestamp = get_timestamp_ticks();
+    record.type = CAPTURE_RECORD_SESSION;
+    if (begin_record(&record, 0))
+    {
+        end_record();
+    }
+}
+
+void capture_packet_begin(
+    CAPTURE_STREAM stream, uint8_t conn_id, uint16_t channel, uint16_t length, uint8_t sop_eop)
+{
+    CAPTURE_RECORD record;
+    record.timestamp = get_timestamp_ticks();
+    record.length = length;
+    record.channel = channel;
+    record.conn_id = conn_id;
+    record.stream = (uint8_t) stream;
+    record.sop_eop = sop_eop;
+    record.type = CAPTURE_RECORD_PACKET;
+
+    if (g_dropped != 0)
+    {
+        flush_dropped(record.timestamp);
+    }
+    g_packet_open = begin_record(&record, length);
+    if (!g_packet_open)
+    {
+        g_dropped++;
+        return;
+    }
+    g_packet_remaining = length;
+    g_packet_padding = get_padding(length);
+}
+
+void capture_packet_data(const void* data, size_t len)
+{
+    if (!g_packet_open)
+    {
+        return;
+    }
+    len = MIN_MACRO(len, g_packet_remaining);
+    async_writer_append(&g_writer, data, len);
+    g_packet_remaining -= len;
+}
+
+void capture_packet_end()
+{
+    if (!g_packet_open)
+    {
+        return;
+    }
+    // A payload cut short by a socket error is zero filled, the record keeps its length
+    while (g_packet_remaining > 0)
+    {
+        const size_t len = MIN_MACRO(g_packet_remaining, sizeof(g_zeros));
+        async_writer_append(&g_writer, g_zeros, len);
+        g_packet_remaining -= len;
+    }
+    async_writer_append(&g_writer, g_zeros, g_packet_padding);
+    end_record();
+    g_packet_open = 0;
+}
+
+RETURN_CODE set_capture_file(const char* path)
+{
+    int len = snprintf(g_capture_file,
+                       sizeof(g_capture_file),
+                       "%s",
+                       (path != NULL) ? path : CAPTURE_DEFAULT_FILE);
+    if ((len < 0) || ((size_t) len >= sizeof(g_capture_file)))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Capture path is too long: %s", path);
+        snprintf(g_capture_file, sizeof(g_capture_file), "%s", CAPTURE_DEFAULT_FILE);
+        return FAILURE;
+    }
+    return OK;
+}
+
+const char* get_capture_file()
+{
+    return g_capture_file;
+}
+
+RETURN_CODE start_capture()
+{
+    CAPTURE_FILE_HEADER header;
+    struct timespec now;
+
+    stop_capture();
+
+    g_dropped = 0;
+    g_record_count = 0;
+    g_packet_open = 0;
+    g_index_count = 0;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(&header, 0, sizeof(header));
+    header.magic = ETHERLINK_CAPTURE_MAGIC;
+    header.version = ETHERLINK_CAPTURE_VERSION;
+    header.record_size = sizeof(CAPTURE_RECORD);
+    header.ticks_per_second = get_timestamp_ticks_per_second();
+    header.start_ticks = get_timestamp_ticks();
+    header.start_realtime_ns = (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+    if (open_async_writer(
+            &g_writer, g_capture_file, g_ring, sizeof(g_ring), &header, sizeof(header)) != OK)
+    {
+        return FAILURE;
+    }
+    g_capture_enabled = 1;
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Packets are captured to: %s", g_capture_file);
+    return OK;
+}
+
+void stop_capture()
+{
+    CAPTURE_RECORD dropped_record;
+    CAPTURE_FILE_FOOTER footer;
+    unsigned char* trailer;
+    size_t trailer_len = 0;
+    const size_t dropped_len = sizeof(dropped_record) + sizeof(g_dropped);
+    const size_t index_len = g_index_count * sizeof(CAPTURE_INDEX_ENTRY);
+
+    if (!is_async_writer_open(&g_writer))
+    {
+        return;
+    }
+    capture_packet_end();
+    g_capture_enabled = 0;
+
+    // The drop count, index and footer are written after the ring is drained, so they cannot be
+    // dropped themselves
+    if ((trailer = (unsigned char*) malloc(dropped_len + index_len + sizeof(footer))) == NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "No memory for the capture index, it is omitted");
+        close_async_writer(&g_writer, NULL, 0);
+        return;
+    }
+    if (g_dropped != 0)
+    {
+        memset(&dropped_record, 0, sizeof(dropped_record));
+        dropped_record.timestamp = get_timestamp_ticks();
+        dropped_record.length = sizeof(g_dropped);
+        dropped_record.type = CAPTURE_RECORD_DROPPED;
+        memcpy(trailer, &dropped_record, sizeof(dropped_record));
+        memcpy(&(trailer[sizeof(dropped_record)]), &g_dropped, sizeof(g_dropped));
+        trailer_len += dropped_len;
+        g_record_count++;
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "%llu packets could not be captured",
+                        (unsigned long long) g_dropped);
+    }
+    footer.index_offset = get_async_writer_file_offset(&g_writer) + trailer_len;
+    footer.index_count = g_index_count;
+    footer.record_count = g_record_count;
+    footer.magic = ETHERLINK_CAPTURE_INDEX_MAGIC;
+    if (index_len > 0)
+    {
+        memcpy(&(trailer[trailer_len]), g_index, index_len);
+        trailer_len += index_len;
+    }
+    memcpy(&(trailer[trailer_len]), &footer, sizeof(footer));
+    trailer_len += sizeof(footer);
+    close_async_writer(&g_writer, trailer, trailer_len);
+    free(trailer);
+
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                    "Captured %llu records to: %s",
+                    (unsigned long long) g_record_count,
+                    g_capture_file);
+}
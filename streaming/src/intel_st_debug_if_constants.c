@@ -33,6 +33,7 @@ const char* MANAGEMENT_SOCK_NAME = "Management";
 const char* MANAGEMENT_RSP_SOCK_NAME = "Management Response";
 const char* H2T_SOCK_NAME = "H2T";
 const char* T2H_SOCK_NAME = "T2H";
+const char* MUX_SOCK_NAME = "MUX";  // Stands in for Control in the handle ack to multiplex
 
 /**
     Note: all string lengths include the NULL terminator.
@@ -63,6 +64,8 @@ const char* SET_DRIVER_PARAM_CMD = "SET_DRIVER_PARAM";
 const size_t SET_DRIVER_PARAM_CMD_LEN = 17;
 const char* GET_DRIVER_PARAM_CMD = "GET_DRIVER_PARAM";
 const size_t GET_DRIVER_PARAM_CMD_LEN = 17;
+const char* ATTACH_SHM_RINGS_CMD = "ATTACH_SHM_RINGS";
+const size_t ATTACH_SHM_RINGS_CMD_LEN = 17;
 
 // Control command responses
 const char* UNRECOGNIZED_CMD_RSP = "UNRECOGNIZED_COMMAND";
@@ -77,6 +80,10 @@ const char* GET_PARAM_CMD_FAIL_RSP = "GET_PARAM_FAILURE";
 const size_t GET_PARAM_CMD_FAIL_RSP_LEN = 18;
 const char* DISCONNECT_CMD_RSP = "DISCONNECT_ACK";
 const size_t DISCONNECT_CMD_RSP_LEN = 15;
+const char* ATTACH_SHM_RINGS_CMD_RSP = "ATTACH_SHM_RINGS_ACK";
+const size_t ATTACH_SHM_RINGS_CMD_RSP_LEN = 21;
+const char* ATTACH_SHM_RINGS_CMD_FAIL_RSP = "ATTACH_SHM_RINGS_FAIL_ACK";
+const size_t ATTACH_SHM_RINGS_CMD_FAIL_RSP_LEN = 26;
 
 // Server control params
 const size_t MAX_SERVER_PARAM_VALUE_LEN = 256;
@@ -94,3 +101,20 @@ const char* MGMT_RSP_NAGLE_PARAM = "MGMT_RSP_NAGLE";
 const size_t MGMT_RSP_NAGLE_PARAM_LEN = 15;
 const char* MGMT_SUPPORT_PARAM = "MGMT_SUPPORT";
 const size_t MGMT_SUPPORT_PARAM_LEN = 13;
+const char* MUX_SUPPORT_PARAM = "MUX_SUPPORT";
+const size_t MUX_SUPPORT_PARAM_LEN = 12;
+const char* STALL_STATS_PARAM = "STALL_STATS";
+const size_t STALL_STATS_PARAM_LEN = 12;
+const char* LATENCY_PARAM = "LATENCY";
+const size_t LATENCY_PARAM_LEN = 8;
+const char* LATENCY_RESET_PARAM = "LATENCY_RESET";
+const size_t LATENCY_RESET_PARAM_LEN = 14;
+const char* LATENCY_RESET_ALL = "all";
+const char* CHANNEL_TOP_PARAM = "CHANNEL_TOP";
+const size_t CHANNEL_TOP_PARAM_LEN = 12;
+const char* CHANNEL_STATS_PARAM = "CHANNEL_STATS";
+const size_t CHANNEL_STATS_PARAM_LEN = 14;
+const char* TRACE_DUMP_PARAM = "TRACE_DUMP";
+const size_t TRACE_DUMP_PARAM_LEN = 11;
+const char* CAPTURE_PARAM = "CAPTURE";
+const size_t CAPTURE_PARAM_LEN = 8;
@@ -0,0 +1,132 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_copy_calibration.h"
+#include "intel_st_debug_if_timestamp.h"
+
+static const COPY_STRATEGY COPY_CANDIDATES[] = {{COPY_KERNEL_MMIO64, 1},
+                                                {COPY_KERNEL_MMIO64, 4},
+                                                {COPY_KERNEL_MMIO64, 8},
+                                                {COPY_KERNEL_MMIO32, 1},
+                                                {COPY_KERNEL_MMIO32, 4},
+                                                {COPY_KERNEL_MMIO32, 8}};
+#define NUM_COPY_CANDIDATES (sizeof(COPY_CANDIDATES) / sizeof(COPY_CANDIDATES[0]))
+
+// Each candidate copies up to one maximum sized payload, the fastest of the trials counts
+#define CALIBRATION_COPY_BYTES H2T_PACKET_MAX_PAYLOAD_BYTES
+#define CALIBRATION_TRIALS 5
+
+static const char* const COPY_DIRECTION_NAMES[NUM_COPY_DIRECTIONS] = {"h2t", "t2h"};
+
+static uint64_t g_calibration_buff[CALIBRATION_COPY_BYTES / sizeof(uint64_t)];
+
+static uint64_t time_copy(COPY_DIRECTION direction, uint32_t fpga_buff, size_t len)
+{
+    uint64_t best = UINT64_MAX;
+    int trial;
+    for (trial = 0; trial < CALIBRATION_TRIALS; ++trial)
+    {
+        const uint64_t start = get_timestamp_ticks();
+        if (direction == COPY_DIRECTION_H2T)
+        {
+            memcpy64_host2fpga(g_calibration_buff, (int32_t) fpga_buff, len);
+        }
+        else
+        {
+            memcpy64_fpga2host((int32_t) fpga_buff, g_calibration_buff, len);
+        }
+        const uint64_t ticks = get_timestamp_ticks() - start;
+        best = MIN_MACRO(best, ticks);
+    }
+    return best;
+}
+
+int calibrate_copy_strategy(const ST_DBG_IP_DESIGN_INFO* info)
+{
+    const size_t len =
+        ALIGN_TO(MIN_MACRO(CALIBRATION_COPY_BYTES, MIN_MACRO(info->H2T_MEM_SZ, info->T2H_MEM_SZ)));
+    if (len == 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Copy calibration needs the H2T/T2H memory map, is the driver "
+                        "initialized?\n");
+        return -1;
+    }
+    const uint32_t fpga_buffs[NUM_COPY_DIRECTIONS] = {info->H2T_MEM_BASE_ADDR,
+                                                      info->T2H_MEM_BASE_ADDR};
+
+    // The H2T memory is written back with its own content, see the header
+    memcpy64_fpga2host((int32_t) info->H2T_MEM_BASE_ADDR, g_calibration_buff, len);
+
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Copy calibration over %zu bytes, MB/s:\n", len);
+    int d;
+    for (d = 0; d < NUM_COPY_DIRECTIONS; ++d)
+    {
+        const COPY_DIRECTION direction = (COPY_DIRECTION) d;
+        char line[256];
+        int line_len = 0;
+        size_t best = NUM_COPY_CANDIDATES - 1;
+        uint64_t best_ticks = UINT64_MAX;
+        size_t i;
+        for (i = 0; i < NUM_COPY_CANDIDATES; ++i)
+        {
+            if ((get_mmio_width() == MMIO_WIDTH_32) &&
+                (COPY_CANDIDATES[i].kernel == COPY_KERNEL_MMIO64))
+            {
+                continue;
+            }
+            set_copy_strategy(direction, COPY_CANDIDATES[i]);
+            const uint64_t ticks = time_copy(direction, fpga_buffs[direction], len);
+            if (ticks < best_ticks)
+            {
+                best = i;
+                best_ticks = ticks;
+            }
+
+            const uint64_t ns = MAX_MACRO(timestamp_ticks_to_ns(ticks), 1);
+            char name[COPY_STRATEGY_SPEC_MAX_LEN];
+            format_copy_strategy(COPY_CANDIDATES[i], name, sizeof(name));
+            line_len += snprintf(&line[line_len],
+                                 sizeof(line) - line_len,
+                                 " %s=%.1f",
+                                 name,
+                                 (double) len * 1e3 / (double) ns);
+        }
+        set_copy_strategy(direction, COPY_CANDIDATES[best]);
+
+        char name[COPY_STRATEGY_SPEC_MAX_LEN];
+        format_copy_strategy(COPY_CANDIDATES[best], name, sizeof(name));
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                        "  %s%s, using %s\n",
+                        COPY_DIRECTION_NAMES[direction],
+                        line,
+                        name);
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intel_st_debug_if_embed.h"
+#include "intel_st_debug_if_server.h"
+#include "intel_st_debug_if_st_dbg_ip_driver.h"
+#include "intel_fpga_api.h"
+
+// The driver copies whole 64-bit words, so payloads go through word aligned staging buffers that
+// hold the largest packet a header can describe
+#define STAGING_BUFF_WORDS (GET_ALIGNED_SZ(UINT16_MAX) / sizeof(uint64_t))
+
+struct ST_DBG_INSTANCE
+{
+    intel_stream_debug_if_driver_context driver_cxt;
+    int mgmt_support;
+    size_t h2t_payload_offset;  // Bytes of the current H2T payload already pushed in parts
+    char has_mgmt_pkt_sent;     // MGMT RSP is only polled while a MGMT packet is unanswered
+
+    ST_DBG_T2H_CALLBACK t2h_callback;
+    ST_DBG_MGMT_RSP_CALLBACK mgmt_rsp_callback;
+    void* user_data;
+
+    uint64_t tx_buff[STAGING_BUFF_WORDS];
+    uint64_t t2h_buff[STAGING_BUFF_WORDS];
+    uint64_t mgmt_rsp_buff[STAGING_BUFF_WORDS];
+};
+
+static int g_is_instance_open = 0;
+
+static void copy_to_ip(const uint64_t* host, uint32_t base, size_t sz, uint32_t where, size_t len)
+{
+    const size_t first_len = buff_len_to_wrap_boundary(base, sz, where, len);
+    if (first_len != 0)
+    {
+        memcpy64_host2fpga((uint64_t*) host, (int32_t) where, first_len);
+        memcpy64_host2fpga(
+            (uint64_t*) host + (first_len / sizeof(uint64_t)), (int32_t) base, len - first_len);
+    }
+    else
+    {
+        memcpy64_host2fpga((uint64_t*) host, (int32_t) where, len);
+    }
+}
+
+static void copy_from_ip(uint64_t* host, uint32_t base, size_t sz, uint32_t where, size_t len)
+{
+    const size_t first_len = buff_len_to_wrap_boundary(base, sz, where, len);
+    if (first_len != 0)
+    {
+        memcpy64_fpga2host((int32_t) where, host, first_len);
+        memcpy64_fpga2host((int32_t) base, host + (first_len / sizeof(uint64_t)), len - first_len);
+    }
+    else
+    {
+        memcpy64_fpga2host((int32_t) where, host, len);
+    }
+}
+
+ST_DBG_INSTANCE* open_st_dbg_instance(FPGA_MMIO_INTERFACE_HANDLE mmio_handle,
+                                      size_t h2t_t2h_mem_size)
+{
+    if (g_is_instance_open)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "An ST Debug instance is already open\n");
+        return NULL;
+    }
+    ST_DBG_INSTANCE* instance = (ST_DBG_INSTANCE*) calloc(1, sizeof(ST_DBG_INSTANCE));
+    if (instance == NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to allocate the ST Debug instance\n");
+        return NULL;
+    }
+    int init_driver_rc =
+        init_driver(&(instance->driver_cxt), (uint32_t) h2t_t2h_mem_size, mmio_handle);
+    if (init_driver_rc != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to initialize driver: %d\n", init_driver_rc);
+        free(instance);
+        return NULL;
+    }
+#if ENABLE_MGMT != 0
+    instance->mgmt_support = get_mgmt_support();
+#endif
+    g_is_instance_open = 1;
+    return instance;
+}
+
+void close_st_dbg_instance(ST_DBG_INSTANCE* instance)
+{
+    if (instance == NULL)
+    {
+        return;
+    }
+    free(instance);
+    g_is_instance_open = 0;
+}
+
+int has_st_dbg_mgmt_support(const ST_DBG_INSTANCE* instance)
+{
+    return instance->mgmt_support;
+}
+
+int submit_st_dbg_h2t(ST_DBG_INSTANCE* instance,
+                      const H2T_PACKET_HEADER* header,
+                      const void* payload)
+{
+    const ST_DBG_IP_DESIGN_INFO* info = &(instance->driver_cxt.std_dbg_ip_info);
+    const unsigned char* src = (const unsigned char*) payload;
+    do
+    {
+        const size_t offset = instance->h2t_payload_offset;
+        size_t granted_sz;
+        uint32_t h2t_buff = get_h2t_buffer_chunk(header->DATA_LEN_BYTES - offset, &granted_sz);
+        if (h2t_buff == 0)
+        {
+            return 0;
+        }
+
+        H2T_PACKET_HEADER part = *header;
+        part.DATA_LEN_BYTES = (unsigned short) granted_sz;
+        if (offset != 0)
+        {
+            part.SOP_EOP &= ~H2T_PACKET_HEADER_MASK_SOP;
+        }
+        if (offset + granted_sz < header->DATA_LEN_BYTES)
+        {
+            part.SOP_EOP &= ~H2T_PACKET_HEADER_MASK_EOP;
+        }
+        memcpy(instance->tx_buff, src + offset, granted_sz);
+        copy_to_ip(
+            instance->tx_buff, info->H2T_MEM_BASE_ADDR, info->H2T_MEM_SZ, h2t_buff, granted_sz);
+        if (push_h2t_data(&part, h2t_buff) != 0)
+        {
+            instance->h2t_payload_offset = 0;
+            return -1;
+        }
+        instance->h2t_payload_offset += granted_sz;
+    } while (instance->h2t_payload_offset < header->DATA_LEN_BYTES);
+    instance->h2t_payload_offset = 0;
+    return 1;
+}
+
+int submit_st_dbg_mgmt(ST_DBG_INSTANCE* instance,
+                       const MGMT_PACKET_HEADER* header,
+                       const void* payload)
+{
+    if (!instance->mgmt_support)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "The ST Debug IP has no MGMT interface\n");
+        return -1;
+    }
+    const ST_DBG_IP_DESIGN_INFO* info = &(instance->driver_cxt.std_dbg_ip_info);
+    uint32_t mgmt_buff = get_mgmt_buffer(header->DATA_LEN_BYTES);
+    if (mgmt_buff == 0)
+    {
+        return 0;
+    }
+    memcpy(instance->tx_buff, payload, header->DATA_LEN_BYTES);
+    copy_to_ip(instance->tx_buff,
+               info->MGMT_MEM_BASE_ADDR,
+               info->MGMT_MEM_SZ,
+               mgmt_buff,
+               header->DATA_LEN_BYTES);
+    MGMT_PACKET_HEADER pushed = *header;
+    if (push_mgmt_data(&pushed, mgmt_buff) != 0)
+    {
+        return -1;
+    }
+    instance->has_mgmt_pkt_sent = 1;
+    return 1;
+}
+
+int poll_st_dbg_t2h(ST_DBG_INSTANCE* instance,
+                    H2T_PACKET_HEADER* header,
+                    const unsigned char** payload)
+{
+    const ST_DBG_IP_DESIGN_INFO* info = &(instance->driver_cxt.std_dbg_ip_info);
+    uint32_t t2h_buff = 0;
+    if (get_t2h_data(header, &t2h_buff) != 0)
+    {
+        return -1;
+    }
+    if (header->DATA_LEN_BYTES == 0)
+    {
+        return 0;
+    }
+    copy_from_ip(instance->t2h_buff,
+                 info->T2H_MEM_BASE_ADDR,
+                 info->T2H_MEM_SZ,
+                 t2h_buff,
+                 header->DATA_LEN_BYTES);
+    t2h_data_complete();
+    *payload = (const unsigned char*) instance->t2h_buff;
+    return 1;
+}
+
+int poll_st_dbg_mgmt_rsp(ST_DBG_INSTANCE* instance,
+                         MGMT_PACKET_HEADER* header,
+                         const unsigned char** payload)
+{
+    if (!instance->has_mgmt_pkt_sent)
+    {
+        return 0;
+    }
+    const ST_DBG_IP_DESIGN_INFO* info = &(instance->driver_cxt.std_dbg_ip_info);
+    uint32_t mgmt_rsp_buff = 0;
+    if (get_mgmt_rsp_data(header, &mgmt_rsp_buff) != 0)
+    {
+        return -1;
+    }
+    if (header->DATA_LEN_BYTES == 0)
+    {
+        return 0;
+    }
+    copy_from_ip(instance->mgmt_rsp_buff,
+                 info->MGMT_RSP_MEM_BASE_ADDR,
+                 info->MGMT_RSP_MEM_SZ,
+                 mgmt_rsp_buff,
+                 header->DATA_LEN_BYTES);
+    mgmt_rsp_data_complete();
+    if (header->SOP_EOP & MGMT_PACKET_HEADER_MASK_EOP)
+    {
+        instance->has_mgmt_pkt_sent = 0;
+    }
+    *payload = (const unsigned char*) instance->mgmt_rsp_buff;
+    return 1;
+}
+
+void set_st_dbg_callbacks(ST_DBG_INSTANCE* instance,
+                          ST_DBG_T2H_CALLBACK t2h_callback,
+                          ST_DBG_MGMT_RSP_CALLBACK mgmt_rsp_callback,
+                          void* user_data)
+{
+    instance->t2h_callback = t2h_callback;
+    instance->mgmt_rsp_callback = mgmt_rsp_callback;
+    instance->user_data = user_data;
+}
+
+int dispatch_st_dbg_packets(ST_DBG_INSTANCE* instance, int max_packets)
+{
+    int dispatched = 0;
+    int has_packet = 1;
+    while (has_packet && (dispatched < max_packets))
+    {
+        has_packet = 0;
+        const unsigned char* payload;
+        if (instance->mgmt_rsp_callback != NULL)
+        {
+            MGMT_PACKET_HEADER header;
+            int rc = poll_st_dbg_mgmt_rsp(instance, &header, &payload);
+            if (rc < 0)
+            {
+                return rc;
+            }
+            if (rc > 0)
+            {
+                instance->mgmt_rsp_callback(instance->user_data, &header, payload);
+                dispatched++;
+                has_packet = 1;
+            }
+        }
+        if ((instance->t2h_callback != NULL) && (dispatched < max_packets))
+        {
+            H2T_PACKET_HEADER header;
+            int rc = poll_st_dbg_t2h(instance, &header, &payload);
+            if (rc < 0)
+            {
+                return rc;
+            }
+            if (rc > 0)
+            {
+                instance->t2h_callback(instance->user_data, &header, payload);
+                dispatched++;
+                has_packet = 1;
+            }
+        }
+    }
+    return dispatched;
+}
@@ -0,0 +1,86 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdlib.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_h2t_coalescer.h"
+#include "intel_st_debug_if_timestamp.h"
+
+RETURN_CODE parse_h2t_coalescer_spec(H2T_COALESCER* coalescer, const char* spec)
+{
+    char* end;
+    unsigned long max_bytes = strtoul(spec, &end, 10);
+    unsigned long window_us = H2T_COALESCE_DEFAULT_WINDOW_US;
+    char valid = (end != spec);
+    if (valid && (*end == ','))
+    {
+        const char* window = end + 1;
+        window_us = strtoul(window, &end, 10);
+        valid = (end != window);
+    }
+    if (!valid || (*end != '\0') || (max_bytes == 0) ||
+        (max_bytes > H2T_PACKET_MAX_PAYLOAD_BYTES) || (window_us > 999999))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Invalid H2T coalescing '%s', expected <bytes>[,<microseconds>] with 1 to "
+                        "%d bytes and up to 999999 microseconds\n",
+                        spec,
+                        H2T_PACKET_MAX_PAYLOAD_BYTES);
+        return FAILURE;
+    }
+    coalescer->max_bytes = (size_t) max_bytes;
+    coalescer->window_us = (unsigned int) window_us;
+    return OK;
+}
+
+RETURN_CODE alloc_h2t_coalescer(H2T_COALESCER* coalescer)
+{
+    if (coalescer->max_bytes == 0)
+    {
+        return OK;
+    }
+    // Whole words, the payload copy kernels move 64 bits at a time
+    coalescer->buff = (unsigned char*) malloc((coalescer->max_bytes + 7) & ~((size_t) 7));
+    coalescer->window_ticks = timestamp_ns_to_ticks((uint64_t) coalescer->window_us * 1000);
+    return (coalescer->buff != NULL) ? OK : FAILURE;
+}
+
+void free_h2t_coalescer(H2T_COALESCER* coalescer)
+{
+    if (coalescer->buff != NULL)
+    {
+        free(coalescer->buff);
+        coalescer->buff = NULL;
+    }
+}
+
+void reset_h2t_coalescer(H2T_COALESCER* coalescer, size_t h2t_mem_sz)
+{
+    coalescer->limit = (coalescer->max_bytes < h2t_mem_sz) ? coalescer->max_bytes : h2t_mem_sz;
+    h2t_coalescer_clear(coalescer);
+}
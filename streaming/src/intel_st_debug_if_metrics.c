@@ -0,0 +1,592 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_metrics.h"
+#include "intel_st_debug_if_sockets.h"
+
+#define SNAPSHOT_WORDS (sizeof(SERVER_METRICS_SNAPSHOT) / sizeof(uint64_t))
+_Static_assert(sizeof(SERVER_METRICS_SNAPSHOT) % sizeof(uint64_t) == 0,
+               "The metrics snapshot is copied word by word");
+
+enum
+{
+    METRICS_LISTEN_BACKLOG = 8,
+    METRICS_REQUEST_BUFF_SZ = 1024,
+    METRICS_RESPONSE_BUFF_SZ = 16384,
+    METRICS_RESPONSE_HEADER_MAX_LEN = 256,
+    METRICS_RECV_TIMEOUT_SEC = 2
+};
+
+// Published snapshot. Lives in process memory unless a shared memory stats page is opened.
+static SERVER_STATS_PAGE g_local_stats_page;
+static SERVER_STATS_PAGE* g_stats_page = &g_local_stats_page;
+static char g_stats_page_path[PATH_MAX];
+
+static SOCKET g_metrics_fd = INVALID_SOCKET;
+static char g_metrics_unix_path[sizeof(((struct sockaddr_un*) 0)->sun_path)];
+static pthread_t g_metrics_thread;
+static volatile int g_metrics_running = 0;
+
+void publish_server_metrics(const SERVER_METRICS_SNAPSHOT* snapshot)
+{
+    SERVER_STATS_PAGE* page = g_stats_page;
+    const uint64_t* words = (const uint64_t*) snapshot;
+    uint64_t* page_words = (uint64_t*) &(page->snapshot);
+    const uint64_t sequence = __atomic_load_n(&(page->sequence), __ATOMIC_RELAXED);
+    struct timespec now;
+    size_t i;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    __atomic_store_n(&(page->sequence), sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (i = 0; i < SNAPSHOT_WORDS; ++i)
+    {
+        __atomic_store_n(&(page_words[i]), words[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&(page->publish_time_ns),
+                     (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&(page->sequence), sequence + 2, __ATOMIC_RELEASE);
+}
+
+void read_server_metrics(SERVER_METRICS_SNAPSHOT* snapshot)
+{
+    const SERVER_STATS_PAGE* page = g_stats_page;
+    const uint64_t* page_words = (const uint64_t*) &(page->snapshot);
+    uint64_t* words = (uint64_t*) snapshot;
+    uint64_t begin;
+    uint64_t end;
+    size_t i;
+
+    do
+    {
+        begin = __atomic_load_n(&(page->sequence), __ATOMIC_ACQUIRE);
+        for (i = 0; i < SNAPSHOT_WORDS; ++i)
+        {
+            words[i] = __atomic_load_n(&(page_words[i]), __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&(page->sequence), __ATOMIC_RELAXED);
+    } while ((begin != end) || (begin & 1));
+}
+
+RETURN_CODE open_stats_page(const char* name)
+{
+    SERVER_STATS_PAGE* page;
+    int fd;
+
+    snprintf(g_stats_page_path,
+             sizeof(g_stats_page_path),
+             (name[0] == '/') ? "%s" : "/dev/shm/%s",
+             name);
+    if ((fd = open(g_stats_page_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Failed to open stats page %s: %s",
+                        g_stats_page_path,
+                        strerror(errno));
+        return FAILURE;
+    }
+    if (ftruncate(fd, sizeof(SERVER_STATS_PAGE)) < 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Failed to size stats page %s: %s",
+                        g_stats_page_path,
+                        strerror(errno));
+        close(fd);
+        return FAILURE;
+    }
+    page = (SERVER_STATS_PAGE*) mmap(
+        NULL, sizeof(SERVER_STATS_PAGE), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (page == MAP_FAILED)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Failed to map stats page %s: %s",
+                        g_stats_page_path,
+                        strerror(errno));
+        return FAILURE;
+    }
+
+    // Readers ignore the page until the magic is in place
+    __atomic_store_n(&(page->magic), 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&(page->sequence), 0, __ATOMIC_RELAXED);
+    page->version = ETHERLINK_STATS_VERSION;
+    page->size = sizeof(SERVER_STATS_PAGE);
+    page->pid = (uint64_t) getpid();
+    page->publish_time_ns = 0;
+    memcpy(&(page->snapshot), &(g_stats_page->snapshot), sizeof(page->snapshot));
+    __atomic_store_n(&(page->magic), ETHERLINK_STATS_MAGIC, __ATOMIC_RELEASE);
+
+    g_stats_page = page;
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Statistics are published to: %s", g_stats_page_path);
+    return OK;
+}
+
+void close_stats_page()
+{
+    if (g_stats_page != &g_local_stats_page)
+    {
+        SERVER_STATS_PAGE* page = g_stats_page;
+        memcpy(&(g_local_stats_page.snapshot), &(page->snapshot), sizeof(page->snapshot));
+        g_stats_page = &g_local_stats_page;
+        // Readers can tell from 'session_active' and 'pid' that the server is gone
+        munmap(page, sizeof(SERVER_STATS_PAGE));
+    }
+}
+
+// Appends to 'buff', output that does not fit is dropped
+static void append_text(char* buff, size_t buff_sz, size_t* len, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void append_text(char* buff, size_t buff_sz, size_t* len, const char* format, ...)
+{
+    va_list args;
+    int n;
+    if (*len >= buff_sz)
+    {
+        return;
+    }
+    va_start(args, format);
+    n = vsnprintf(buff + *len, buff_sz - *len, format, args);
+    va_end(args);
+    if (n > 0)
+    {
+        *len = MIN_MACRO(*len + (size_t) n, buff_sz - 1);
+    }
+}
+
+static void append_metric_header(
+    char* buff, size_t buff_sz, size_t* len, const char* name, const char* type, const char* help)
+{
+    append_text(buff, buff_sz, len, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static size_t format_metrics(char* buff, size_t buff_sz)
+{
+    SERVER_METRICS_SNAPSHOT snapshot;
+    struct rusage usage;
+    size_t len = 0;
+    int i;
+
+    read_server_metrics(&snapshot);
+    buff[0] = '\0';
+
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_packets_total",
+                         "counter",
+                         "Packets transferred per stream.");
+    for (i = 0; i < NUM_LATENCY_STREAMS; ++i)
+    {
+        append_text(buff,
+                    buff_sz,
+                    &len,
+                    "etherlink_packets_total{stream=\"%s\"} %llu\n",
+                    get_latency_stream_name((SERVER_LATENCY_STREAM) i),
+                    (unsigned long long) snapshot.packets[i]);
+    }
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_bytes_total",
+                         "counter",
+                         "Payload bytes transferred per stream.");
+    for (i = 0; i < NUM_LATENCY_STREAMS; ++i)
+    {
+        append_text(buff,
+                    buff_sz,
+                    &len,
+                    "etherlink_bytes_total{stream=\"%s\"} %llu\n",
+                    get_latency_stream_name((SERVER_LATENCY_STREAM) i),
+                    (unsigned long long) snapshot.bytes[i]);
+    }
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_stalls_total",
+                         "counter",
+                         "Stall events per reason. h2t_desc/h2t_ring and mgmt_desc/mgmt_ring are "
+                         "buffer waits, t2h_empty counts T2H polls that found no data.");
+    for (i = 0; i < NUM_STALL_REASONS; ++i)
+    {
+        append_text(buff,
+                    buff_sz,
+                    &len,
+                    "etherlink_stalls_total{reason=\"%s\"} %llu\n",
+                    get_stall_reason_name((SERVER_STALL_REASON) i),
+                    (unsigned long long) snapshot.stall_events[i]);
+    }
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_stall_seconds_total",
+                         "counter",
+                         "Time spent stalled per reason.");
+    for (i = 0; i < NUM_STALL_REASONS; ++i)
+    {
+        append_text(buff,
+                    buff_sz,
+                    &len,
+                    "etherlink_stall_seconds_total{reason=\"%s\"} %.9f\n",
+                    get_stall_reason_name((SERVER_STALL_REASON) i),
+                    (double) snapshot.stall_ns[i] / 1e9);
+    }
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_mmio_operations_total",
+                         "counter",
+                         "MMIO accesses issued by the driver.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_mmio_operations_total{op=\"read\"} %llu\n"
+                "etherlink_mmio_operations_total{op=\"write\"} %llu\n",
+                (unsigned long long) snapshot.mmio_reads,
+                (unsigned long long) snapshot.mmio_writes);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_sessions_total",
+                         "counter",
+                         "Client sessions accepted.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_sessions_total %llu\n",
+                (unsigned long long) snapshot.sessions);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_reconnects_total",
+                         "counter",
+                         "Client sessions accepted after the first one.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_reconnects_total %llu\n",
+                (unsigned long long) ((snapshot.sessions > 0) ? snapshot.sessions - 1 : 0));
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_session_active",
+                         "gauge",
+                         "1 while a client is connected.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_session_active %llu\n",
+                (unsigned long long) snapshot.session_active);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_server_loopback_mode",
+                         "gauge",
+                         "1 while the server loops H2T back to T2H without the IP.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_server_loopback_mode %llu\n",
+                (unsigned long long) snapshot.loopback_mode);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_buffer_used_bytes",
+                         "gauge",
+                         "Host memory of the IP currently handed to it per stream.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_buffer_used_bytes{stream=\"h2t\"} %llu\n"
+                "etherlink_buffer_used_bytes{stream=\"mgmt\"} %llu\n",
+                (unsigned long long) snapshot.h2t_ring_used,
+                (unsigned long long) snapshot.mgmt_ring_used);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_buffer_size_bytes",
+                         "gauge",
+                         "Size of the IP memory per stream.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_buffer_size_bytes{stream=\"h2t\"} %llu\n"
+                "etherlink_buffer_size_bytes{stream=\"mgmt\"} %llu\n",
+                (unsigned long long) snapshot.h2t_ring_size,
+                (unsigned long long) snapshot.mgmt_ring_size);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_descriptors_used",
+                         "gauge",
+                         "Descriptors currently handed to the IP per stream.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_descriptors_used{stream=\"h2t\"} %llu\n"
+                "etherlink_descriptors_used{stream=\"mgmt\"} %llu\n",
+                (unsigned long long) snapshot.h2t_descriptors_used,
+                (unsigned long long) snapshot.mgmt_descriptors_used);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_descriptor_depth",
+                         "gauge",
+                         "Descriptor slots of the IP per stream.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_descriptor_depth{stream=\"h2t\"} %llu\n"
+                "etherlink_descriptor_depth{stream=\"mgmt\"} %llu\n",
+                (unsigned long long) snapshot.h2t_descriptor_depth,
+                (unsigned long long) snapshot.mgmt_descriptor_depth);
+    append_metric_header(buff,
+                         buff_sz,
+                         &len,
+                         "etherlink_server_thread_cpu_seconds_total",
+                         "counter",
+                         "CPU time used by the data path thread.");
+    append_text(buff,
+                buff_sz,
+                &len,
+                "etherlink_server_thread_cpu_seconds_total %.9f\n",
+                (double) snapshot.server_thread_cpu_ns / 1e9);
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        append_metric_header(buff,
+                             buff_sz,
+                             &len,
+                             "process_cpu_seconds_total",
+                             "counter",
+                             "Total user and system CPU time spent in seconds.");
+        append_text(buff,
+                    buff_sz,
+                    &len,
+                    "process_cpu_seconds_total %.6f\n",
+                    (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+                        (double) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6);
+    }
+    return len;
+}
+
+static void serve_metrics_request(SOCKET client_fd)
+{
+    static const char* const NOT_FOUND_RSP =
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    static char response[METRICS_RESPONSE_BUFF_SZ];
+    char request[METRICS_REQUEST_BUFF_SZ];
+    size_t request_len = 0;
+    ssize_t bytes;
+
+    // Only the request line matters, the rest of the request is ignored
+    while (request_len < sizeof(request) - 1)
+    {
+        bytes = recv(client_fd, request + request_len, sizeof(request) - 1 - request_len, 0);
+        if (bytes <= 0)
+        {
+            return;
+        }
+        request_len += (size_t) bytes;
+        request[request_len] = '\0';
+        if (strstr(request, "\r\n") != NULL)
+        {
+            break;
+        }
+    }
+
+    if ((strncmp(request, "GET /metrics ", 13) == 0) || (strncmp(request, "GET / ", 6) == 0))
+    {
+        // The body is formatted first, the status line and headers are then put in front of it
+        char* body = response + METRICS_RESPONSE_HEADER_MAX_LEN;
+        size_t body_len = format_metrics(body, sizeof(response) - METRICS_RESPONSE_HEADER_MAX_LEN);
+        int header_len = snprintf(request,
+                                  sizeof(request),
+                                  "HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                  "Content-Length: %lu\r\n"
+                                  "Connection: close\r\n\r\n",
+                                  (unsigned long) body_len);
+        body -= header_len;
+        memcpy(body, request, (size_t) header_len);
+        socket_send_all(client_fd, body, (size_t) header_len + body_len, MSG_NOSIGNAL, &bytes);
+    }
+    else
+    {
+        socket_send_all(client_fd, NOT_FOUND_RSP, strlen(NOT_FOUND_RSP), MSG_NOSIGNAL, &bytes);
+    }
+}
+
+static void* metrics_server_thread(void* arg)
+{
+    (void) arg;
+    while (g_metrics_running)
+    {
+        SOCKET client_fd = accept(g_metrics_fd, NULL, NULL);
+        if (client_fd == INVALID_SOCKET)
+        {
+            if ((errno == EINTR) || (errno == ECONNABORTED))
+            {
+                continue;
+            }
+            break;
+        }
+        struct timeval timeout = {METRICS_RECV_TIMEOUT_SEC, 0};
+        setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serve_metrics_request(client_fd);
+        close_socket_fd(client_fd);
+    }
+    return NULL;
+}
+
+static SOCKET bind_metrics_socket(int port, const char* unix_path)
+{
+    SOCKET fd;
+    if (unix_path != NULL)
+    {
+        struct sockaddr_un addr;
+        if (strlen(unix_path) >= sizeof(addr.sun_path))
+        {
+            fpga_msg_printf(
+                FPGA_MSG_PRINTF_ERROR, "Metrics socket path is too long: %s", unix_path);
+            return INVALID_SOCKET;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, unix_path);
+        if (remove_stale_unix_socket(unix_path) < 0)
+        {
+            return INVALID_SOCKET;
+        }
+        if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == INVALID_SOCKET)
+        {
+            return INVALID_SOCKET;
+        }
+        if (bind(fd, (const struct sockaddr*) &addr, sizeof(addr)) < 0)
+        {
+            close_socket_fd(fd);
+            return INVALID_SOCKET;
+        }
+        strcpy(g_metrics_unix_path, unix_path);
+    }
+    else
+    {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons((unsigned short) port);
+        if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET)
+        {
+            return INVALID_SOCKET;
+        }
+        if ((set_boolean_socket_option(fd, SO_REUSEADDR, 1) < 0) ||
+            (bind(fd, (const struct sockaddr*) &addr, sizeof(addr)) < 0))
+        {
+            close_socket_fd(fd);
+            return INVALID_SOCKET;
+        }
+    }
+    if (listen(fd, METRICS_LISTEN_BACKLOG) < 0)
+    {
+        close_socket_fd(fd);
+        return INVALID_SOCKET;
+    }
+    // Not inherited by the replacement process on a listener hand-off
+    set_close_on_exec(fd, 1);
+    return fd;
+}
+
+RETURN_CODE start_metrics_server(int port, const char* unix_path)
+{
+    char error_msg[128];
+    if ((g_metrics_fd = bind_metrics_socket(port, unix_path)) == INVALID_SOCKET)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Failed to open metrics endpoint: %s",
+                        get_last_socket_error_msg(error_msg, sizeof(error_msg)));
+        return FAILURE;
+    }
+
+    g_metrics_running = 1;
+    if (pthread_create(&g_metrics_thread, NULL, metrics_server_thread, NULL) != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to start metrics thread");
+        g_metrics_running = 0;
+        close_socket_fd(g_metrics_fd);
+        g_metrics_fd = INVALID_SOCKET;
+        return FAILURE;
+    }
+
+    if (unix_path != NULL)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Metrics are served on unix socket: %s", unix_path);
+    }
+    else
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                        "Metrics are served on port: %d",
+                        get_socket_local_port(g_metrics_fd));
+    }
+    return OK;
+}
+
+void stop_metrics_server()
+{
+    if (g_metrics_fd == INVALID_SOCKET)
+    {
+        return;
+    }
+    g_metrics_running = 0;
+    // Wakes up the blocking accept()
+    shutdown(g_metrics_fd, SHUT_RDWR);
+    pthread_join(g_metrics_thread, NULL);
+    close_socket_fd(g_metrics_fd);
+    g_metrics_fd = INVALID_SOCKET;
+    if (g_metrics_unix_path[0] != '\0')
+    {
+        unlink(g_metrics_unix_path);
+        g_metrics_unix_path[0] = '\0';
+    }
+}
@@ -0,0 +1,233 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_async_writer.h"
+#include "intel_st_debug_if_mmio_log.h"
+#include "intel_st_debug_if_timestamp.h"
+
+enum
+{
+    MMIO_LOG_RING_SZ = 1 << 20,  // Power of two
+    MMIO_LOG_MAX_FUNCTIONS = 64,
+    MMIO_LOG_MAX_FUNCTION_NAME_LEN = 64,
+    MMIO_LOG_MAX_RECORD_SZ = 128  // Access plus function name
+};
+
+_Static_assert((MMIO_LOG_RING_SZ & (MMIO_LOG_RING_SZ - 1)) == 0,
+               "The MMIO log ring size must be a power of two");
+
+int g_mmio_log_enabled = 0;
+
+static char g_mmio_log_file[PATH_MAX] = MMIO_LOG_DEFAULT_FILE;
+
+static unsigned char g_ring[MMIO_LOG_RING_SZ];
+static ASYNC_WRITER g_writer = {.fd = -1};
+static uint64_t g_dropped = 0;  // Accesses not yet reported as dropped
+
+// Encoder state, the previous record that made it into the ring
+static uint64_t g_prev_ticks = 0;
+static uint64_t g_prev_offset = 0;
+static int g_prev_line = 0;
+static int g_prev_function = -1;
+static const char* g_functions[MMIO_LOG_MAX_FUNCTIONS];
+static int g_function_count = 0;
+
+static size_t put_varint(unsigned char* p, uint64_t value)
+{
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        p[len++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    p[len++] = (unsigned char) value;
+    return len;
+}
+
+static size_t put_zigzag(unsigned char* p, int64_t value)
+{
+    return put_varint(p, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static void flush_dropped()
+{
+    unsigned char record[16];
+    size_t len = 0;
+    record[len++] = MMIO_LOG_TAG_DROPPED;
+    len += put_varint(&(record[len]), g_dropped);
+    if (async_writer_push(&g_writer, record, len))
+    {
+        g_dropped = 0;
+    }
+}
+
+void mmio_log_access(
+    MMIO_LOG_OP op, uint64_t offset, uint64_t value, int line, const char* function)
+{
+    unsigned char record[MMIO_LOG_MAX_RECORD_SZ];
+    size_t len = 0;
+    const uint64_t ticks = get_timestamp_ticks();
+    int function_id;
+
+    if (g_dropped != 0)
+    {
+        flush_dropped();
+    }
+
+    // Functions are interned by address, a new one is defined in the same record
+    for (function_id = 0; function_id < g_function_count; ++function_id)
+    {
+        if (g_functions[function_id] == function)
+        {
+            break;
+        }
+    }
+    if (function_id == g_function_count)
+    {
+        if (function_id == MMIO_LOG_MAX_FUNCTIONS)
+        {
+            function_id = MMIO_LOG_MAX_FUNCTIONS - 1;  // Misattributed rather than lost
+        }
+        else
+        {
+            const size_t name_len = strnlen(function, MMIO_LOG_MAX_FUNCTION_NAME_LEN);
+            record[len++] = MMIO_LOG_TAG_FUNCTION_NAME;
+            len += put_varint(&(record[len]), (uint64_t) function_id);
+            record[len++] = (unsigned char) name_len;
+            memcpy(&(record[len]), function, name_len);
+            len += name_len;
+        }
+    }
+
+    const int function_changed = (function_id != g_prev_function);
+    record[len++] = (unsigned char) (op | (function_changed ? MMIO_LOG_TAG_FUNCTION_FLAG : 0));
+    len += put_varint(&(record[len]), ticks - g_prev_ticks);
+    len += put_zigzag(&(record[len]), (int64_t) line - g_prev_line);
+    if (function_changed)
+    {
+        len += put_varint(&(record[len]), (uint64_t) function_id);
+    }
+    len += put_zigzag(&(record[len]), (int64_t) (offset - g_prev_offset));
+    len += put_varint(&(record[len]), value);
+
+    if (!async_writer_push(&g_writer, record, len))
+    {
+        g_dropped++;
+        return;
+    }
+    if (function_id == g_function_count)
+    {
+        g_functions[g_function_count++] = function;
+    }
+    g_prev_ticks = ticks;
+    g_prev_offset = offset;
+    g_prev_line = line;
+    g_prev_function = function_id;
+}
+
+void mmio_log_regions(const uint64_t bases[NUM_MMIO_LOG_REGIONS])
+{
+    unsigned char record[MMIO_LOG_MAX_RECORD_SZ];
+    size_t len = 0;
+    int i;
+    record[len++] = MMIO_LOG_TAG_REGIONS;
+    for (i = 0; i < NUM_MMIO_LOG_REGIONS; ++i)
+    {
+        len += put_varint(&(record[len]), bases[i]);
+    }
+    async_writer_push(&g_writer, record, len);
+}
+
+RETURN_CODE set_mmio_log_file(const char* path)
+{
+    int len = snprintf(g_mmio_log_file,
+                       sizeof(g_mmio_log_file),
+                       "%s",
+                       (path != NULL) ? path : MMIO_LOG_DEFAULT_FILE);
+    if ((len < 0) || ((size_t) len >= sizeof(g_mmio_log_file)))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "MMIO log path is too long: %s", path);
+        snprintf(g_mmio_log_file, sizeof(g_mmio_log_file), "%s", MMIO_LOG_DEFAULT_FILE);
+        return FAILURE;
+    }
+    return OK;
+}
+
+RETURN_CODE start_mmio_log()
+{
+    MMIO_LOG_FILE_HEADER header;
+    struct timespec now;
+
+    stop_mmio_log();
+
+    g_dropped = 0;
+    g_prev_offset = 0;
+    g_prev_line = 0;
+    g_prev_function = -1;
+    g_function_count = 0;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    g_prev_ticks = get_timestamp_ticks();
+    memset(&header, 0, sizeof(header));
+    header.magic = ETHERLINK_MMIO_LOG_MAGIC;
+    header.version = ETHERLINK_MMIO_LOG_VERSION;
+    header.ticks_per_second = get_timestamp_ticks_per_second();
+    header.start_ticks = g_prev_ticks;
+    header.start_realtime_ns = (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+    if (open_async_writer(
+            &g_writer, g_mmio_log_file, g_ring, sizeof(g_ring), &header, sizeof(header)) != OK)
+    {
+        return FAILURE;
+    }
+    g_mmio_log_enabled = 1;
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "MMIO accesses are logged to: %s", g_mmio_log_file);
+    return OK;
+}
+
+void stop_mmio_log()
+{
+    if (!is_async_writer_open(&g_writer))
+    {
+        return;
+    }
+    unsigned char trailer[16];
+    size_t trailer_len = 0;
+    g_mmio_log_enabled = 0;
+    if (g_dropped != 0)
+    {
+        // Written after the ring is drained, so it cannot be dropped itself
+        trailer[trailer_len++] = MMIO_LOG_TAG_DROPPED;
+        trailer_len += put_varint(&(trailer[trailer_len]), g_dropped);
+    }
+    close_async_writer(&g_writer, trailer, trailer_len);
+}
@@ -0,0 +1,296 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <string.h>
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_self_bench.h"
+#include "intel_st_debug_if_server.h"
+#include "intel_st_debug_if_stats.h"
+#include "intel_st_debug_if_timestamp.h"
+
+// Payload sizes and channel counts swept, sizes that do not fit the H2T / T2H memory are skipped
+static const size_t SELF_BENCH_SIZES[] = {8, 64, 100, 1024, H2T_PACKET_MAX_PAYLOAD_BYTES};
+static const unsigned short SELF_BENCH_CHANNELS[] = {1, 16};
+#define NUM_SELF_BENCH_SIZES (sizeof(SELF_BENCH_SIZES) / sizeof(SELF_BENCH_SIZES[0]))
+#define NUM_SELF_BENCH_CHANNELS (sizeof(SELF_BENCH_CHANNELS) / sizeof(SELF_BENCH_CHANNELS[0]))
+
+#define SELF_BENCH_MS_PER_RUN 500
+// A run is abandoned when no packet looped back for this long
+#define SELF_BENCH_STALL_MS 1000
+// Bounds the packets pushed but not yet looped back, the push timestamps are kept per packet
+#define SELF_BENCH_MAX_IN_FLIGHT 64
+#define SELF_BENCH_MAX_REPORTED_MISMATCHES 8
+
+#define SELF_BENCH_PAYLOAD_WORDS (H2T_PACKET_MAX_PAYLOAD_BYTES / sizeof(uint64_t))
+
+typedef struct
+{
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t mismatches;
+    uint64_t ticks;
+    int stalled;
+    LATENCY_HISTOGRAM latency;
+} SELF_BENCH_RESULT;
+
+static uint64_t g_tx_payload[SELF_BENCH_PAYLOAD_WORDS];
+static uint64_t g_rx_payload[SELF_BENCH_PAYLOAD_WORDS];
+static uint64_t g_expected_payload[SELF_BENCH_PAYLOAD_WORDS];
+static uint64_t g_push_ticks[SELF_BENCH_MAX_IN_FLIGHT];
+static SELF_BENCH_RESULT g_result;
+static uint64_t g_reported_mismatches = 0;
+
+// Every word is unique to the packet sequence number and its position, so that dropped,
+// duplicated, reordered or shifted data all show up as mismatches.
+static void fill_pattern(uint64_t* payload, size_t len, uint64_t seq)
+{
+    const size_t words = (len + 7) / 8;
+    size_t i;
+    for (i = 0; i < words; ++i)
+    {
+        payload[i] = ((seq << 16) | i) * 0x9E3779B97F4A7C15ULL;
+    }
+}
+
+static void fill_header(H2T_PACKET_HEADER* header,
+                        size_t len,
+                        unsigned short channels,
+                        uint64_t seq)
+{
+    header->SOP_EOP = H2T_PACKET_HEADER_MASK_SOP | H2T_PACKET_HEADER_MASK_EOP;
+    header->CONN_ID = (unsigned char) (seq & H2T_PACKET_HEADER_MASK_CONN_ID);
+    header->CHANNEL = (unsigned short) ((seq % channels) & H2T_PACKET_HEADER_MASK_CHANNEL);
+    header->DATA_LEN_BYTES = (unsigned short) len;
+}
+
+static void report_mismatch(size_t len, uint64_t seq, const char* what)
+{
+    if (g_reported_mismatches++ < SELF_BENCH_MAX_REPORTED_MISMATCHES)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Self-bench: %s mismatch on packet %llu of %zu bytes\n",
+                        what,
+                        (unsigned long long) seq,
+                        len);
+    }
+}
+
+// Copies the payload to or from the wrapping H2T / T2H memory
+static void copy_to_ring(uint64_t* host, uint32_t base, size_t sz, uint32_t where, size_t len)
+{
+    const size_t first_len = buff_len_to_wrap_boundary(base, sz, where, len);
+    if (first_len != 0)
+    {
+        memcpy64_host2fpga(host, (int32_t) where, first_len);
+        memcpy64_host2fpga(host + (first_len / sizeof(uint64_t)), (int32_t) base, len - first_len);
+    }
+    else
+    {
+        memcpy64_host2fpga(host, (int32_t) where, len);
+    }
+}
+
+static void copy_from_ring(uint64_t* host, uint32_t base, size_t sz, uint32_t where, size_t len)
+{
+    const size_t first_len = buff_len_to_wrap_boundary(base, sz, where, len);
+    if (first_len != 0)
+    {
+        memcpy64_fpga2host((int32_t) where, host, first_len);
+        memcpy64_fpga2host((int32_t) base, host + (first_len / sizeof(uint64_t)), len - first_len);
+    }
+    else
+    {
+        memcpy64_fpga2host((int32_t) where, host, len);
+    }
+}
+
+// Pushes the next packet if there is room, returns non-zero if it was pushed
+static int push_packet(const ST_DBG_IP_DESIGN_INFO* info,
+                       size_t len,
+                       unsigned short channels,
+                       uint64_t seq)
+{
+    uint32_t buff = get_h2t_buffer(len);
+    if (buff == 0)
+    {
+        return 0;
+    }
+    H2T_PACKET_HEADER header;
+    fill_header(&header, len, channels, seq);
+    fill_pattern(g_tx_payload, len, seq);
+    copy_to_ring(g_tx_payload, info->H2T_MEM_BASE_ADDR, info->H2T_MEM_SZ, buff, len);
+    g_push_ticks[seq % SELF_BENCH_MAX_IN_FLIGHT] = get_timestamp_ticks();
+    push_h2t_data(&header, buff);
+    return 1;
+}
+
+// Reads and verifies the next looped back packet, returns non-zero if there was one
+static int receive_packet(const ST_DBG_IP_DESIGN_INFO* info,
+                          size_t len,
+                          unsigned short channels,
+                          uint64_t seq)
+{
+    H2T_PACKET_HEADER header;
+    uint32_t payload = 0;
+    get_t2h_data(&header, &payload);
+    if (header.DATA_LEN_BYTES == 0)
+    {
+        return 0;
+    }
+    latency_record(&g_result.latency,
+                   get_timestamp_ticks() - g_push_ticks[seq % SELF_BENCH_MAX_IN_FLIGHT]);
+
+    H2T_PACKET_HEADER expected;
+    fill_header(&expected, len, channels, seq);
+    int mismatch = 0;
+    if (header.DATA_LEN_BYTES != expected.DATA_LEN_BYTES)
+    {
+        report_mismatch(len, seq, "Length");
+        mismatch = 1;
+    }
+    else if ((header.SOP_EOP != expected.SOP_EOP) || (header.CONN_ID != expected.CONN_ID) ||
+             (header.CHANNEL != expected.CHANNEL))
+    {
+        report_mismatch(len, seq, "Header");
+        mismatch = 1;
+    }
+    else
+    {
+        copy_from_ring(g_rx_payload, info->T2H_MEM_BASE_ADDR, info->T2H_MEM_SZ, payload, len);
+        fill_pattern(g_expected_payload, len, seq);
+        if (memcmp(g_rx_payload, g_expected_payload, len) != 0)
+        {
+            report_mismatch(len, seq, "Payload");
+            mismatch = 1;
+        }
+    }
+    t2h_data_complete();
+
+    g_result.packets++;
+    g_result.bytes += header.DATA_LEN_BYTES;
+    g_result.mismatches += mismatch;
+    return 1;
+}
+
+static void run_self_bench_once(const ST_DBG_IP_DESIGN_INFO* info,
+                                size_t len,
+                                unsigned short channels)
+{
+    const uint64_t ticks_per_ms = get_timestamp_ticks_per_second() / 1000;
+    const uint64_t start = get_timestamp_ticks();
+    const uint64_t end = start + SELF_BENCH_MS_PER_RUN * ticks_per_ms;
+    uint64_t last_progress = start;
+    uint64_t pushed = 0;
+    uint64_t received = 0;
+
+    memset(&g_result, 0, sizeof(g_result));
+    uint64_t now = start;
+    // Stop pushing at the end of the run, then drain what is still in flight
+    while ((now < end) || (received < pushed))
+    {
+        while ((now < end) && (pushed - received < SELF_BENCH_MAX_IN_FLIGHT) &&
+               push_packet(info, len, channels, pushed))
+        {
+            ++pushed;
+        }
+        const uint64_t received_before = received;
+        while ((received < pushed) && receive_packet(info, len, channels, received))
+        {
+            ++received;
+        }
+        now = get_timestamp_ticks();
+        if ((received != received_before) || (received == pushed))
+        {
+            last_progress = now;
+        }
+        else if (now - last_progress > SELF_BENCH_STALL_MS * ticks_per_ms)
+        {
+            g_result.stalled = 1;
+            break;
+        }
+    }
+    g_result.ticks = now - start;
+}
+
+int run_self_bench(const intel_stream_debug_if_driver_context* context)
+{
+    const ST_DBG_IP_DESIGN_INFO* info = &(context->std_dbg_ip_info);
+    const size_t mem_sz = MIN_MACRO(info->H2T_MEM_SZ, info->T2H_MEM_SZ);
+    int failed = 0;
+
+    calibrate_timestamp_ticks();
+    g_reported_mismatches = 0;
+    // Also resets the H2T / T2H path, nothing may be in flight
+    set_loopback_mode(1);
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                    "Self-bench over H2T -> T2H loopback, %zu byte memories, %d ms per run:\n",
+                    mem_sz,
+                    SELF_BENCH_MS_PER_RUN);
+
+    size_t s, c;
+    for (s = 0; (s < NUM_SELF_BENCH_SIZES) && !failed; ++s)
+    {
+        const size_t len = SELF_BENCH_SIZES[s];
+        if (GET_ALIGNED_SZ(len) > mem_sz)
+        {
+            fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                            "  size=%-5zu skipped, larger than the H2T / T2H memory\n",
+                            len);
+            continue;
+        }
+        for (c = 0; (c < NUM_SELF_BENCH_CHANNELS) && !failed; ++c)
+        {
+            run_self_bench_once(info, len, SELF_BENCH_CHANNELS[c]);
+
+            const double seconds = (double) timestamp_ticks_to_ns(g_result.ticks) / 1e9;
+            char latency[256];
+            format_latency_histogram(&g_result.latency, latency, sizeof(latency));
+            fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                            "  size=%-5zu channels=%-3u packets=%-9llu %9.2f MB/s %11.0f pkt/s "
+                            "mismatches=%llu latency_ns %s\n",
+                            len,
+                            (unsigned int) SELF_BENCH_CHANNELS[c],
+                            (unsigned long long) g_result.packets,
+                            (seconds > 0) ? (double) g_result.bytes / seconds / 1e6 : 0.0,
+                            (seconds > 0) ? (double) g_result.packets / seconds : 0.0,
+                            (unsigned long long) g_result.mismatches,
+                            latency);
+            if (g_result.stalled)
+            {
+                fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                                "Self-bench: nothing looped back for %d ms, is loopback "
+                                "supported by the IP?\n",
+                                SELF_BENCH_STALL_MS);
+            }
+            failed = g_result.stalled || (g_result.mismatches != 0);
+        }
+    }
+
+    set_loopback_mode(0);
+    return failed ? -1 : 0;
+}
@@ -31,6 +31,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>  // offsetof
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
 
 #include "intel_fpga_api.h"
 
@@ -38,11 +41,31 @@
 #include "intel_st_debug_if_packet.h"
 #include "intel_st_debug_if_constants.h"
 
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+// H2T packets taken per pass of the server loop when the client has sent them already
+#define H2T_BURST_MAX_PACKETS 16
+
+// The server loopback echoes a whole packet from one buffer, MGMT packets being the largest
+#define LOOPBACK_BUFF_SZ \
+    (SIZEOF_PACKET_GUARDBAND + SIZEOF_MGMT_PACKET_HEADER + MGMT_PACKET_MAX_PAYLOAD_BYTES)
+
+// Names the inherited descriptor on which a replacement reports readiness after a listener hand-off
+#define HANDOFF_READY_FD_ENV "ETHERLINK_HANDOFF_FD"
+// Time a replacement has to initialize before the running server gives up on the hand-off
+#define HANDOFF_READY_TIMEOUT_MS 30000
+
 const SERVER_BUFFERS SERVER_BUFFERS_default = {.ctrl_rx_buff = NULL,
                                                .ctrl_rx_buff_sz = 0,
                                                .ctrl_tx_buff = NULL,
                                                .ctrl_tx_buff_sz = 0,
 
+                                               .mux_rx_buff = NULL,
+                                               .mux_tx_buff = NULL,
+
                                                .h2t_header_buff = {0},
                                                .t2h_header_buff = {0},
                                                .mgmt_header_buff = {0},
@@ -63,38 +86,68 @@ const SERVER_BUFFERS SERVER_BUFFERS_default = {.ctrl_rx_buff = NULL,
                                                .mgmt_rsp_tx_buff_sz = 0};
 const SERVER_CONN SERVER_CONN_default = {.buff = NULL,
                                          .h2t_waiting = 0,
+                                         .h2t_payload_offset = 0,
+                                         .h2t_coalescer = {0, 0, 0, 0, NULL, {0, 0, 0, 0}, 0, 0},
                                          .mgmt_waiting = 0,
                                          .has_mgmt_pkt_sent = 0,
                                          .hw_callbacks = {.init_driver = NULL,
                                                           .get_h2t_buffer = NULL,
+                                                          .get_h2t_buffer_chunk = NULL,
                                                           .h2t_data_received = NULL,
+                                                          .get_h2t_wait_reason = NULL,
                                                           .get_mgmt_buffer = NULL,
                                                           .mgmt_data_received = NULL,
+                                                          .get_mgmt_wait_reason = NULL,
                                                           .acquire_t2h_data = NULL,
                                                           .t2h_data_complete = NULL,
                                                           .acquire_mgmt_rsp_data = NULL,
                                                           .mgmt_rsp_data_complete = NULL,
                                                           .has_mgmt_support = NULL,
                                                           .set_param = NULL,
-                                                          .get_param = NULL},
+                                                          .get_param = NULL,
+                                                          .get_mmio_counts = NULL,
+                                                          .get_h2t_occupancy = NULL,
+                                                          .get_mgmt_occupancy = NULL,
+                                                          .begin_write_batch = NULL,
+                                                          .end_write_batch = NULL},
                                          .loopback_mode = 0,
+                                         .loopback_buff = NULL,
+                                         .path = SERVER_PATH_GENERIC,
                                          .server_fd = INVALID_SOCKET,
+                                         .unix_path = NULL,
+                                         .unix_listener = 0,
                                          .t2h_nagle = 0,
                                          .mgmt_rsp_nagle = 0,
-                                         .pkt_stats = {0, 0, 0, 0}};
+                                         .shm_rings = NULL,
+                                         .mux = 0,
+                                         .mux_rx_pending = 0,
+                                         .pkt_stats = {0, 0, 0, 0, 0, 0, 0, 0},
+                                         .stall_stats = {{0}, {0}, {0}, 0},
+                                         .latency_stats = {{{{0}, 0, 0, 0}}, 0, 0},
+                                         .channel_stats = {NULL},
+                                         .metrics_totals = {{0}},
+                                         .metrics_next_publish = 0};
 const SERVER_HW_CALLBACKS SERVER_HW_CALLBACKS_default = {.init_driver = NULL,
                                                          .get_h2t_buffer = NULL,
+                                                         .get_h2t_buffer_chunk = NULL,
                                                          .h2t_data_received = NULL,
+                                                         .get_h2t_wait_reason = NULL,
                                                          .get_mgmt_buffer = NULL,
                                                          .mgmt_data_received = NULL,
+                                                         .get_mgmt_wait_reason = NULL,
                                                          .acquire_t2h_data = NULL,
                                                          .t2h_data_complete = NULL,
                                                          .acquire_mgmt_rsp_data = NULL,
                                                          .mgmt_rsp_data_complete = NULL,
                                                          .has_mgmt_support = NULL,
                                                          .set_param = NULL,
-                                                         .get_param = NULL};
-const SERVER_PKT_STATS SERVER_PKT_STATS_default = {0, 0, 0, 0};
+                                                         .get_param = NULL,
+                                                         .get_mmio_counts = NULL,
+                                                         .get_h2t_occupancy = NULL,
+                                                         .get_mgmt_occupancy = NULL,
+                                                         .begin_write_batch = NULL,
+                                                         .end_write_batch = NULL};
+const SERVER_PKT_STATS SERVER_PKT_STATS_default = {0, 0, 0, 0, 0, 0, 0, 0};
 const CLIENT_CONN CLIENT_CONN_default = {
     INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET, INVALID_SOCKET};
 
@@ -106,6 +159,133 @@ int sizeof_addr = -1;
 uint32_t sizeof_addr = 0;
 #endif
 
+// Set from a signal handler to ask the server to pass its listening socket on to a replacement
+// process the next time it is idle.
+static volatile sig_atomic_t s_listener_handoff_requested = 0;
+
+// Set from the SIGINT handler. The server ends the session and stops serving from its own thread,
+// so that the capture and MMIO log are finished there and not inside the handler.
+static volatile sig_atomic_t s_server_termination_requested = 0;
+
+// Binary re-executed on a listener hand-off, resolved at start-up so that an upgrade which replaces
+// the file on disk starts the new version.
+static char s_handoff_exec_path[PATH_MAX] = "";
+
+// Write end of the pipe on which a replacement started by a listener hand-off reports that it is
+// ready to serve, -1 if this process was not started by a hand-off.
+static int s_handoff_ready_fd = -1;
+
+// Accepts a pending connection on the listening socket. Signals delivered while blocked in accept()
+// are retried unless a listener hand-off or termination has been requested. The peer address is
+// discarded so that listeners of any address family can be served.
+static SOCKET accept_client_socket(SERVER_CONN* server_conn)
+{
+    SOCKET client_fd;
+    do
+    {
+        struct sockaddr_storage peer_addr;
+        socklen_t peer_addr_len = sizeof(peer_addr);
+        client_fd =
+            accept(server_conn->server_fd, (struct sockaddr*) (&peer_addr), &peer_addr_len);
+    } while ((client_fd == INVALID_SOCKET) && (get_last_socket_error() == EINTR) &&
+             (s_listener_handoff_requested == 0) && (s_server_termination_requested == 0));
+    return client_fd;
+}
+
+// Sets TCP_NODELAY on a client socket. Sockets accepted on an AF_UNIX listener have no Nagle
+// algorithm and no such option, so there is nothing to set.
+static int set_client_no_delay(const SERVER_CONN* server_conn, SOCKET client_fd, int no_delay)
+{
+    return server_conn->unix_listener ? 0 : set_tcp_no_delay(client_fd, no_delay);
+}
+
+// Maps the driver's reason for not granting a buffer onto the stall it causes
+static SERVER_STALL_REASON get_buffer_stall_reason(int (*get_wait_reason)(),
+                                                   SERVER_STALL_REASON descriptor_slots_reason,
+                                                   SERVER_STALL_REASON space_reason)
+{
+    if ((get_wait_reason != NULL) && (get_wait_reason() == BUFFER_WAIT_DESCRIPTOR_SLOTS))
+    {
+        return descriptor_slots_reason;
+    }
+    return space_reason;
+}
+
+// Counters of the current session, if any, on top of those of all completed sessions
+static void collect_server_metrics(const SERVER_CONN* server_conn,
+                                   char session_active,
+                                   SERVER_METRICS_SNAPSHOT* snapshot)
+{
+    struct timespec cpu_time;
+    int i;
+
+    *snapshot = server_conn->metrics_totals;
+    if (session_active)
+    {
+        const SERVER_PKT_STATS* pkt_stats = &(server_conn->pkt_stats);
+        snapshot->packets[LATENCY_H2T] += pkt_stats->h2t_cnt;
+        snapshot->packets[LATENCY_T2H] += pkt_stats->t2h_cnt;
+        snapshot->packets[LATENCY_MGMT] += pkt_stats->mgmt_cnt;
+        snapshot->packets[LATENCY_MGMT_RSP] += pkt_stats->mgmt_rsp_cnt;
+        snapshot->bytes[LATENCY_H2T] += pkt_stats->h2t_bytes;
+        snapshot->bytes[LATENCY_T2H] += pkt_stats->t2h_bytes;
+        snapshot->bytes[LATENCY_MGMT] += pkt_stats->mgmt_bytes;
+        snapshot->bytes[LATENCY_MGMT_RSP] += pkt_stats->mgmt_rsp_bytes;
+        for (i = 0; i < NUM_STALL_REASONS; ++i)
+        {
+            snapshot->stall_events[i] += server_conn->stall_stats.events[i];
+            snapshot->stall_ns[i] +=
+                get_stall_time_ns(&(server_conn->stall_stats), (SERVER_STALL_REASON) i);
+        }
+    }
+    snapshot->session_active = session_active ? 1 : 0;
+    snapshot->loopback_mode = (uint64_t) server_conn->loopback_mode;
+    if (server_conn->hw_callbacks.get_mmio_counts != NULL)
+    {
+        server_conn->hw_callbacks.get_mmio_counts(&(snapshot->mmio_reads),
+                                                  &(snapshot->mmio_writes));
+    }
+    if (server_conn->hw_callbacks.get_h2t_occupancy != NULL)
+    {
+        BUFFER_OCCUPANCY occupancy;
+        server_conn->hw_callbacks.get_h2t_occupancy(&occupancy);
+        snapshot->h2t_ring_used = occupancy.ring_used;
+        snapshot->h2t_ring_size = occupancy.ring_size;
+        snapshot->h2t_descriptors_used = occupancy.descriptors_used;
+        snapshot->h2t_descriptor_depth = occupancy.descriptor_depth;
+    }
+    if (server_conn->hw_callbacks.get_mgmt_occupancy != NULL)
+    {
+        BUFFER_OCCUPANCY occupancy;
+        server_conn->hw_callbacks.get_mgmt_occupancy(&occupancy);
+        snapshot->mgmt_ring_used = occupancy.ring_used;
+        snapshot->mgmt_ring_size = occupancy.ring_size;
+        snapshot->mgmt_descriptors_used = occupancy.descriptors_used;
+        snapshot->mgmt_descriptor_depth = occupancy.descriptor_depth;
+    }
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time) == 0)
+    {
+        snapshot->server_thread_cpu_ns =
+            (uint64_t) cpu_time.tv_sec * 1000000000ULL + (uint64_t) cpu_time.tv_nsec;
+    }
+}
+
+static void update_server_metrics(SERVER_CONN* server_conn, char session_active)
+{
+    SERVER_METRICS_SNAPSHOT snapshot;
+    collect_server_metrics(server_conn, session_active, &snapshot);
+    publish_server_metrics(&snapshot);
+    server_conn->metrics_next_publish =
+        get_timestamp_ticks() + timestamp_ns_to_ticks(SERVER_METRICS_PUBLISH_INTERVAL_NS);
+}
+
+// Folds the counters of the session that just ended into the server totals
+static void end_session_metrics(SERVER_CONN* server_conn)
+{
+    collect_server_metrics(server_conn, 1, &(server_conn->metrics_totals));
+    update_server_metrics(server_conn, 0);
+}
+
 void reset_buffers(SERVER_CONN* conn)
 {
     zero_mem(conn->buff->ctrl_rx_buff, conn->buff->ctrl_rx_buff_sz);
@@ -147,7 +327,7 @@ void generate_server_welcome_message(
 {
     snprintf(buff,
              buff_size,
-             "Welcome to INTEL_ST_HOST_EP_SERVER: %s=%d %s=%ld %s=%ld %s=%ld HANDLE=%d",
+             "Welcome to INTEL_ST_HOST_EP_SERVER: %s=%d %s=%ld %s=%ld %s=%ld HANDLE=%d %s=%d",
              MGMT_SUPPORT_PARAM,
              mgmt_support,
              H2T_RX_BUFFER_SIZE_PARAM,
@@ -156,7 +336,9 @@ void generate_server_welcome_message(
              serv_buff->mgmt_rx_buff_sz,
              CTRL_RX_BUFFER_SIZE_PARAM,
              serv_buff->ctrl_rx_buff_sz,
-             handle);
+             handle,
+             MUX_SUPPORT_PARAM,
+             (serv_buff->mux_rx_buff != NULL) ? 1 : 0);
 }
 
 RETURN_CODE bind_server_socket(SERVER_CONN* server_conn)
@@ -223,16 +405,14 @@ RETURN_CODE connect_client_socket(SERVER_CONN* server_conn,
         MAX_HANDLE_RSP = 64
     };
     char socket_fail_msg[FAIL_MSG_SIZE];
-    if ((*client_fd = accept(server_conn->server_fd,
-                             (struct sockaddr*) (&(server_conn->server_addr)),
-                             &sizeof_addr)) == INVALID_SOCKET)
+    if ((*client_fd = accept_client_socket(server_conn)) == INVALID_SOCKET)
     {
         snprintf(socket_fail_msg, FAIL_MSG_SIZE, "Failed to accept %s socket", sock_name);
         print_last_socket_error(socket_fail_msg);
     }
     else
     {
-        if (set_tcp_no_delay(*client_fd, (use_nagle == 0) ? 1 : 0) == 0)
+        if (set_client_no_delay(server_conn, *client_fd, (use_nagle == 0) ? 1 : 0) == 0)
         {
             ssize_t bytes_transferred;
             if (socket_recv_until_null_reached(*client_fd,
@@ -298,6 +478,12 @@ RETURN_CODE connect_client(intel_stream_debug_if_driver_context* context,
     ssize_t bytes_transferred;
 
     server_conn->pkt_stats = SERVER_PKT_STATS_default;
+    server_conn->h2t_payload_offset = 0;
+    server_conn->mux = 0;
+    server_conn->mux_rx_pending = 0;
+    reset_stall_stats(&(server_conn->stall_stats));
+    reset_latency_stats(&(server_conn->latency_stats));
+    reset_channel_stats(&(server_conn->channel_stats));
 
     // Initialize the driver if required.  Initialization occurs here since it is the first thing
     // run per spec, and the welcome message requires querying the driver for MGMT support.
@@ -321,11 +507,22 @@ RETURN_CODE connect_client(intel_stream_debug_if_driver_context* context,
     server_conn->buff->mgmt_rx_buff_sz = context->std_dbg_ip_info.MGMT_MEM_SZ;
     server_conn->buff->mgmt_rsp_tx_buff = context->std_dbg_ip_info.MGMT_RSP_MEM_BASE_ADDR;
     server_conn->buff->mgmt_rsp_tx_buff_sz = context->std_dbg_ip_info.MGMT_RSP_MEM_SZ;
+    reset_h2t_coalescer(&(server_conn->h2t_coalescer), server_conn->buff->h2t_rx_buff_sz);
+
+    // Wait for the CTRL connection. A listener hand-off or termination request interrupts the wait.
+    int ready;
+    do
+    {
+        ready = wait_for_read_event(server_conn->server_fd, 1, 0);
+    } while (((ready == 0) || ((ready < 0) && (get_last_socket_error() == EINTR))) &&
+             (s_listener_handoff_requested == 0) && (s_server_termination_requested == 0));
+    if ((s_listener_handoff_requested != 0) || (s_server_termination_requested != 0))
+    {
+        return FAILURE;
+    }
 
     // Connect CTRL socket
-    if ((client_conn->ctrl_fd = accept(server_conn->server_fd,
-                                       (struct sockaddr*) (&(server_conn->server_addr)),
-                                       &sizeof_addr)) == INVALID_SOCKET)
+    if ((client_conn->ctrl_fd = accept_client_socket(server_conn)) == INVALID_SOCKET)
     {
         print_last_socket_error("Failed to accept CTRL socket");
         result = FAILURE;
@@ -367,9 +564,23 @@ RETURN_CODE connect_client(intel_stream_debug_if_driver_context* context,
                                              server_conn->buff->ctrl_tx_buff_sz,
                                              CONTROL_SOCK_NAME,
                                              handle);
-            if (strncmp(server_conn->buff->ctrl_rx_buff,
-                        server_conn->buff->ctrl_tx_buff,
-                        MAX_HANDLE_RSP) != 0)
+            if ((strncmp(server_conn->buff->ctrl_rx_buff,
+                         server_conn->buff->ctrl_tx_buff,
+                         MAX_HANDLE_RSP) != 0) &&
+                (server_conn->buff->mux_rx_buff != NULL))
+            {
+                // The client asks to multiplex all streams over the CTRL socket
+                generate_expected_handle_message(server_conn->buff->ctrl_tx_buff,
+                                                 server_conn->buff->ctrl_tx_buff_sz,
+                                                 MUX_SOCK_NAME,
+                                                 handle);
+                server_conn->mux = (strncmp(server_conn->buff->ctrl_rx_buff,
+                                            server_conn->buff->ctrl_tx_buff,
+                                            MAX_HANDLE_RSP) == 0);
+            }
+            if (!server_conn->mux && (strncmp(server_conn->buff->ctrl_rx_buff,
+                                               server_conn->buff->ctrl_tx_buff,
+                                               MAX_HANDLE_RSP) != 0))
             {
                 socket_send_all(client_conn->ctrl_fd, NOT_READY_MSG, NOT_READY_MSG_LEN, 0, NULL);
                 fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
@@ -396,38 +607,47 @@ RETURN_CODE connect_client(intel_stream_debug_if_driver_context* context,
         }
     }
 
-    if (result == OK)
-    {
-        result = connect_client_socket(
-            server_conn, handle, &(client_conn->mgmt_fd), MANAGEMENT_SOCK_NAME, 0);
-    }
-    if (result == OK)
+    if ((result == OK) && server_conn->mux)
     {
-        result = connect_client_socket(server_conn,
-                                       handle,
-                                       &(client_conn->mgmt_rsp_fd),
-                                       MANAGEMENT_RSP_SOCK_NAME,
-                                       server_conn->mgmt_rsp_nagle);
+        // Every stream shares the CTRL socket, so none of them may be held back by Nagle
+        if (set_client_no_delay(server_conn, client_conn->ctrl_fd, 1) != 0)
+        {
+            print_last_socket_error("Failed to set TCP_NODELAY on the multiplexed socket");
+            result = FAILURE;
+        }
     }
-    if (result == OK)
+    else if (result == OK)
     {
         result = connect_client_socket(
-            server_conn, handle, &(client_conn->h2t_data_fd), H2T_SOCK_NAME, 0);
-    }
-    if (result == OK)
-    {
-        result = connect_client_socket(server_conn,
-                                       handle,
-                                       &(client_conn->t2h_data_fd),
-                                       T2H_SOCK_NAME,
-                                       server_conn->t2h_nagle);
+            server_conn, handle, &(client_conn->mgmt_fd), MANAGEMENT_SOCK_NAME, 0);
+        if (result == OK)
+        {
+            result = connect_client_socket(server_conn,
+                                           handle,
+                                           &(client_conn->mgmt_rsp_fd),
+                                           MANAGEMENT_RSP_SOCK_NAME,
+                                           server_conn->mgmt_rsp_nagle);
+        }
+        if (result == OK)
+        {
+            result = connect_client_socket(
+                server_conn, handle, &(client_conn->h2t_data_fd), H2T_SOCK_NAME, 0);
+        }
+        if (result == OK)
+        {
+            result = connect_client_socket(server_conn,
+                                           handle,
+                                           &(client_conn->t2h_data_fd),
+                                           T2H_SOCK_NAME,
+                                           server_conn->t2h_nagle);
+        }
     }
 
     if (result != OK)
     {
         if (client_conn->ctrl_fd != INVALID_SOCKET)
         {
-            send(client_conn->ctrl_fd, NOT_READY_MSG, NOT_READY_MSG_LEN, 0);
+            send(client_conn->ctrl_fd, NOT_READY_MSG, NOT_READY_MSG_LEN, SEND_NO_SIGNAL);
         }
         return FAILURE;
     }
@@ -451,6 +671,11 @@ RETURN_CODE close_client_conn(CLIENT_CONN* client_conn, SERVER_CONN* server_conn
 {
     unsigned char errors = 0;
 
+    if (server_conn->shm_rings != NULL)
+    {
+        destroy_shm_rings(server_conn->shm_rings);
+        server_conn->shm_rings = NULL;
+    }
     if (client_conn->ctrl_fd != INVALID_SOCKET)
     {
         set_linger_socket_option(client_conn->ctrl_fd, 1, 0);
@@ -507,8 +732,33 @@ RETURN_CODE close_client_conn(CLIENT_CONN* client_conn, SERVER_CONN* server_conn
     }
 }
 
+// Matches "<name>" and "<name> <argument>". 'name_len' includes the terminating NUL, 'arg' is set
+// to the argument or NULL.
+static int match_param_with_arg(const char* param,
+                                const char* name,
+                                size_t name_len,
+                                const char** arg)
+{
+    if ((strncmp(param, name, name_len - 1) != 0) ||
+        ((param[name_len - 1] != '\0') && (param[name_len - 1] != ' ')))
+    {
+        return 0;
+    }
+    *arg = (param[name_len - 1] == ' ') ? param + name_len : NULL;
+    return 1;
+}
+
+// Responses are sent with at most MAX_SERVER_PARAM_VALUE_LEN characters
+static size_t get_param_rsp_buff_sz(const SERVER_CONN* server_conn)
+{
+    return ((size_t) (server_conn->buff->ctrl_tx_buff_sz) < MAX_SERVER_PARAM_VALUE_LEN)
+               ? (size_t) (server_conn->buff->ctrl_tx_buff_sz)
+               : MAX_SERVER_PARAM_VALUE_LEN;
+}
+
 const char* get_parameter(char* cmd, SERVER_CONN* server_conn)
 {
+    const char* param_arg;
     const char* param_name = strstr(cmd, GET_PARAM_CMD) + GET_PARAM_CMD_LEN;
     if (strncmp(param_name, SERVER_LOOPBACK_MODE_PARAM, SERVER_LOOPBACK_MODE_PARAM_LEN) == 0)
     {
@@ -554,6 +804,76 @@ const char* get_parameter(char* cmd, SERVER_CONN* server_conn)
                  (int) (server_conn->mgmt_rsp_nagle));
         return server_conn->buff->ctrl_tx_buff;
     }
+    else if (strncmp(param_name, CAPTURE_PARAM, CAPTURE_PARAM_LEN) == 0)
+    {
+        return is_capture_enabled() ? "1" : "0";
+    }
+    else if (match_param_with_arg(param_name, STALL_STATS_PARAM, STALL_STATS_PARAM_LEN, &param_arg))
+    {
+        // "STALL_STATS" reports every reason, "STALL_STATS <reason>" just one
+        if (format_stall_stats(&(server_conn->stall_stats),
+                               param_arg,
+                               server_conn->buff->ctrl_tx_buff,
+                               get_param_rsp_buff_sz(server_conn)) < 0)
+        {
+            return GET_PARAM_CMD_FAIL_RSP;
+        }
+        return server_conn->buff->ctrl_tx_buff;
+    }
+    else if (match_param_with_arg(param_name, LATENCY_PARAM, LATENCY_PARAM_LEN, &param_arg) &&
+             (param_arg != NULL))
+    {
+        SERVER_LATENCY_STREAM stream = get_latency_stream(param_arg);
+        if (stream == NUM_LATENCY_STREAMS)
+        {
+            return GET_PARAM_CMD_FAIL_RSP;
+        }
+        format_latency_histogram(&(server_conn->latency_stats.histograms[stream]),
+                                 server_conn->buff->ctrl_tx_buff,
+                                 get_param_rsp_buff_sz(server_conn));
+        return server_conn->buff->ctrl_tx_buff;
+    }
+    else if (match_param_with_arg(
+                 param_name, CHANNEL_TOP_PARAM, CHANNEL_TOP_PARAM_LEN, &param_arg) &&
+             (param_arg != NULL))
+    {
+        // "CHANNEL_TOP <h2t|t2h> [<N>]", busiest channels by bytes
+        char direction_name[4];
+        unsigned int top_n = 5;
+        CHANNEL_DIRECTION direction;
+        if ((sscanf(param_arg, "%3s %u", direction_name, &top_n) < 1) ||
+            ((direction = get_channel_direction(direction_name)) == NUM_CHANNEL_DIRECTIONS))
+        {
+            return GET_PARAM_CMD_FAIL_RSP;
+        }
+        format_channel_top(&(server_conn->channel_stats),
+                           direction,
+                           top_n,
+                           server_conn->buff->ctrl_tx_buff,
+                           get_param_rsp_buff_sz(server_conn));
+        return server_conn->buff->ctrl_tx_buff;
+    }
+    else if (match_param_with_arg(
+                 param_name, CHANNEL_STATS_PARAM, CHANNEL_STATS_PARAM_LEN, &param_arg) &&
+             (param_arg != NULL))
+    {
+        // "CHANNEL_STATS <h2t|t2h> <channel>"
+        char direction_name[4];
+        unsigned int channel;
+        CHANNEL_DIRECTION direction;
+        if ((sscanf(param_arg, "%3s %u", direction_name, &channel) != 2) ||
+            ((direction = get_channel_direction(direction_name)) == NUM_CHANNEL_DIRECTIONS) ||
+            (channel >= CHANNEL_STATS_CHANNEL_COUNT))
+        {
+            return GET_PARAM_CMD_FAIL_RSP;
+        }
+        format_channel_stats(&(server_conn->channel_stats),
+                             direction,
+                             (unsigned short) channel,
+                             server_conn->buff->ctrl_tx_buff,
+                             get_param_rsp_buff_sz(server_conn));
+        return server_conn->buff->ctrl_tx_buff;
+    }
     else
     {
         return GET_PARAM_CMD_FAIL_RSP;
@@ -571,9 +891,11 @@ const char* set_parameter(char* cmd, SERVER_CONN* server_conn, CLIENT_CONN* clie
     if (strstr(param_name, SERVER_LOOPBACK_MODE_PARAM) == param_name)
     {
         param_value = param_name + SERVER_LOOPBACK_MODE_PARAM_LEN;
-        if (strnlen(param_value, 1) == 1)
+        // The loopback echoes through the data sockets, which the shared memory rings replace
+        if ((strnlen(param_value, 1) == 1) && (server_conn->shm_rings == NULL))
         {
             server_conn->loopback_mode = (*param_value == '1' ? 1 : 0);
+            select_server_path(server_conn);
             return SET_PARAM_CMD_RSP;
         }
     }
@@ -583,7 +905,10 @@ const char* set_parameter(char* cmd, SERVER_CONN* server_conn, CLIENT_CONN* clie
         if (strnlen(param_value, 1) == 1)
         {
             const char t2h_nagle = (*param_value == '1' ? 1 : 0);
-            if (set_tcp_no_delay(client_conn->t2h_data_fd, t2h_nagle ? 0 : 1) == 0)
+            // A multiplexed session keeps Nagle off on its only socket
+            if (server_conn->mux ||
+                (set_client_no_delay(server_conn, client_conn->t2h_data_fd, t2h_nagle ? 0 : 1) ==
+                 0))
             {
                 server_conn->t2h_nagle = t2h_nagle;
                 return SET_PARAM_CMD_RSP;
@@ -596,13 +921,68 @@ const char* set_parameter(char* cmd, SERVER_CONN* server_conn, CLIENT_CONN* clie
         if (strnlen(param_value, 1) == 1)
         {
             const char mgmt_rsp_nagle = (*param_value == '1' ? 1 : 0);
-            if (set_tcp_no_delay(client_conn->mgmt_rsp_fd, mgmt_rsp_nagle ? 0 : 1) == 0)
+            if (server_conn->mux || (set_client_no_delay(server_conn,
+                                                         client_conn->mgmt_rsp_fd,
+                                                         mgmt_rsp_nagle ? 0 : 1) == 0))
             {
                 server_conn->mgmt_rsp_nagle = mgmt_rsp_nagle;
                 return SET_PARAM_CMD_RSP;
             }
         }
     }
+    else if ((strstr(param_name, LATENCY_RESET_PARAM) == param_name) &&
+             (param_name[LATENCY_RESET_PARAM_LEN - 1] == ' '))
+    {
+        param_value = param_name + LATENCY_RESET_PARAM_LEN;
+        if (strcmp(param_value, LATENCY_RESET_ALL) == 0)
+        {
+            int i;
+            for (i = 0; i < NUM_LATENCY_STREAMS; ++i)
+            {
+                reset_latency_histogram(&(server_conn->latency_stats.histograms[i]));
+            }
+            return SET_PARAM_CMD_RSP;
+        }
+        SERVER_LATENCY_STREAM stream = get_latency_stream(param_value);
+        if (stream != NUM_LATENCY_STREAMS)
+        {
+            reset_latency_histogram(&(server_conn->latency_stats.histograms[stream]));
+            return SET_PARAM_CMD_RSP;
+        }
+    }
+    else if (strcmp(param_name, TRACE_DUMP_PARAM) == 0)
+    {
+        if (dump_server_trace() == OK)
+        {
+            fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Trace dumped to: %s", get_server_trace_file());
+            return SET_PARAM_CMD_RSP;
+        }
+        fpga_msg_printf(
+            FPGA_MSG_PRINTF_ERROR, "Failed to dump trace to: %s", get_server_trace_file());
+    }
+    else if (strstr(param_name, CAPTURE_PARAM) == param_name)
+    {
+        param_value = param_name + CAPTURE_PARAM_LEN;
+        if (strcmp(param_value, "1") == 0)
+        {
+            // A running capture carries on, a new one replaces the capture file and starts with
+            // the session in progress
+            if (is_capture_enabled())
+            {
+                return SET_PARAM_CMD_RSP;
+            }
+            if (start_capture() == OK)
+            {
+                capture_session();
+                return SET_PARAM_CMD_RSP;
+            }
+        }
+        else if (strcmp(param_value, "0") == 0)
+        {
+            stop_capture();
+            return SET_PARAM_CMD_RSP;
+        }
+    }
     return SET_PARAM_CMD_FAIL_RSP;
 }
 
@@ -652,81 +1032,161 @@ const char* set_driver_parameter(char* cmd, SERVER_CONN* server_conn)
     return SET_PARAM_CMD_FAIL_RSP;
 }
 
+// Sends the response to a CTRL command, as a CTRL frame on a multiplexed session
+static RETURN_CODE send_control_response(CLIENT_CONN* client_conn,
+                                         SERVER_CONN* server_conn,
+                                         const char* resp,
+                                         size_t len,
+                                         ssize_t* bytes_sent)
+{
+    if (!server_conn->mux)
+    {
+        return socket_send_all(client_conn->ctrl_fd, resp, len, 0, bytes_sent);
+    }
+    unsigned char* frame = server_conn->buff->mux_tx_buff + MUX_FRAME_OFFSET;
+    mux_frame_header_pack(frame, MUX_STREAM_CTRL, (uint32_t) len);
+    memcpy(frame + MUX_FRAME_HEADER_SZ, resp, len);
+    return socket_send_all(
+        client_conn->ctrl_fd, (const char*) frame, MUX_FRAME_HEADER_SZ + len, 0, bytes_sent);
+}
+
+// Handles "ATTACH_SHM_RINGS [<ring bytes>]": creates the shared memory rings and sends them to the
+// client with the response. The rings replace the data sockets for the rest of the session. File
+// descriptors can only be passed over a unix socket.
+static RETURN_CODE attach_shm_rings(CLIENT_CONN* client_conn,
+                                    SERVER_CONN* server_conn,
+                                    ssize_t* bytes_sent)
+{
+    const char* arg = server_conn->buff->ctrl_rx_buff + ATTACH_SHM_RINGS_CMD_LEN - 1;
+    size_t ring_sz = SHM_RING_DEFAULT_SZ;
+    if (*arg != '\0')
+    {
+        char* end;
+        ring_sz = (*arg == ' ') ? strtoul(arg + 1, &end, 0) : 0;
+        if ((ring_sz != 0) && (*end != '\0'))
+        {
+            ring_sz = 0;  // Rejected by create_shm_rings()
+        }
+    }
+
+    // A packet the data sockets are in the middle of is not continued from the rings. The response
+    // of a multiplexed session would have to be framed.
+    if (server_conn->unix_listener && (server_conn->shm_rings == NULL) && !server_conn->mux &&
+        (server_conn->loopback_mode == 0) && (server_conn->h2t_payload_offset == 0) &&
+        !server_conn->h2t_waiting && !server_conn->mgmt_waiting &&
+        ((server_conn->shm_rings = create_shm_rings(ring_sz)) != NULL))
+    {
+        if (send_shm_rings(client_conn->ctrl_fd,
+                           server_conn->shm_rings,
+                           ATTACH_SHM_RINGS_CMD_RSP,
+                           ATTACH_SHM_RINGS_CMD_RSP_LEN) == OK)
+        {
+            *bytes_sent = (ssize_t) ATTACH_SHM_RINGS_CMD_RSP_LEN;
+            fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                            "Client attached shared memory rings of %zu bytes\n",
+                            ring_sz);
+            return OK;
+        }
+        *bytes_sent = -1;
+        destroy_shm_rings(server_conn->shm_rings);
+        server_conn->shm_rings = NULL;
+        return FAILURE;
+    }
+    return send_control_response(client_conn,
+                                 server_conn,
+                                 ATTACH_SHM_RINGS_CMD_FAIL_RSP,
+                                 ATTACH_SHM_RINGS_CMD_FAIL_RSP_LEN,
+                                 bytes_sent);
+}
+
+// Handles the CTRL command in ctrl_rx_buff
+static RETURN_CODE handle_control_message(CLIENT_CONN* client_conn,
+                                          SERVER_CONN* server_conn,
+                                          char* disconnect_client)
+{
+    ssize_t bytes_transferred;
+    RETURN_CODE result;
+    if (strstr(server_conn->buff->ctrl_rx_buff, GET_PARAM_CMD) == server_conn->buff->ctrl_rx_buff)
+    {
+        const char* resp = get_parameter(server_conn->buff->ctrl_rx_buff, server_conn);
+        result = send_control_response(client_conn,
+                                       server_conn,
+                                       resp,
+                                       strnlen(resp, MAX_SERVER_PARAM_VALUE_LEN) + 1,
+                                       &bytes_transferred);
+    }
+    else if (strncmp(server_conn->buff->ctrl_rx_buff, PING_CMD, PING_CMD_LEN) == 0)
+    {
+        result = send_control_response(
+            client_conn, server_conn, PING_CMD_RSP, PING_CMD_RSP_LEN, &bytes_transferred);
+    }
+    else if (strncmp(server_conn->buff->ctrl_rx_buff, DISCONNECT_CMD, DISCONNECT_CMD_LEN) == 0)
+    {
+        send_control_response(
+            client_conn, server_conn, DISCONNECT_CMD_RSP, DISCONNECT_CMD_RSP_LEN, NULL);
+        wait_for_read_event(client_conn->ctrl_fd,
+                            10,
+                            0);  // Wait 10 seconds at most for the client to close first
+        *disconnect_client = 1;
+        result = OK;
+    }
+    else if (strstr(server_conn->buff->ctrl_rx_buff, SET_PARAM_CMD) ==
+             server_conn->buff->ctrl_rx_buff)
+    {
+        const char* resp =
+            set_parameter(server_conn->buff->ctrl_rx_buff, server_conn, client_conn);
+        result = send_control_response(
+            client_conn, server_conn, resp, strnlen(resp, 128) + 1, &bytes_transferred);
+    }
+    else if (strstr(server_conn->buff->ctrl_rx_buff, SET_DRIVER_PARAM_CMD) ==
+             server_conn->buff->ctrl_rx_buff)
+    {
+        const char* resp = set_driver_parameter(server_conn->buff->ctrl_rx_buff, server_conn);
+        result = send_control_response(
+            client_conn, server_conn, resp, strnlen(resp, 256) + 1, &bytes_transferred);
+    }
+    else if (strstr(server_conn->buff->ctrl_rx_buff, GET_DRIVER_PARAM_CMD) ==
+             server_conn->buff->ctrl_rx_buff)
+    {
+        const char* resp = get_driver_parameter(server_conn->buff->ctrl_rx_buff, server_conn);
+        result = send_control_response(client_conn,
+                                       server_conn,
+                                       resp,
+                                       strnlen(resp, MAX_SERVER_PARAM_VALUE_LEN) + 1,
+                                       &bytes_transferred);
+    }
+    else if (strstr(server_conn->buff->ctrl_rx_buff, ATTACH_SHM_RINGS_CMD) ==
+             server_conn->buff->ctrl_rx_buff)
+    {
+        result = attach_shm_rings(client_conn, server_conn, &bytes_transferred);
+    }
+    else
+    {
+        result = send_control_response(client_conn,
+                                       server_conn,
+                                       UNRECOGNIZED_CMD_RSP,
+                                       UNRECOGNIZED_CMD_RSP_LEN,
+                                       &bytes_transferred);
+    }
+    if (result != OK)
+    {
+        print_last_socket_error_b("Failed to send CTRL message response", bytes_transferred);
+    }
+    return result;
+}
+
 RETURN_CODE process_control_message(CLIENT_CONN* client_conn,
                                     SERVER_CONN* server_conn,
                                     char* disconnect_client)
 {
     ssize_t bytes_transferred;
-    RETURN_CODE result;
     if (socket_recv_until_null_reached(client_conn->ctrl_fd,
                                        server_conn->buff->ctrl_rx_buff,
                                        server_conn->buff->ctrl_rx_buff_sz,
                                        0,
                                        &bytes_transferred) == OK)
     {
-        if (strstr(server_conn->buff->ctrl_rx_buff, GET_PARAM_CMD) ==
-            server_conn->buff->ctrl_rx_buff)
-        {
-            const char* resp = get_parameter(server_conn->buff->ctrl_rx_buff, server_conn);
-            result = socket_send_all(client_conn->ctrl_fd,
-                                     resp,
-                                     strnlen(resp, MAX_SERVER_PARAM_VALUE_LEN) + 1,
-                                     0,
-                                     &bytes_transferred);
-        }
-        else if (strncmp(server_conn->buff->ctrl_rx_buff, PING_CMD, PING_CMD_LEN) == 0)
-        {
-            result = socket_send_all(
-                client_conn->ctrl_fd, PING_CMD_RSP, PING_CMD_RSP_LEN, 0, &bytes_transferred);
-        }
-        else if (strncmp(server_conn->buff->ctrl_rx_buff, DISCONNECT_CMD, DISCONNECT_CMD_LEN) == 0)
-        {
-            socket_send_all(
-                client_conn->ctrl_fd, DISCONNECT_CMD_RSP, DISCONNECT_CMD_RSP_LEN, 0, NULL);
-            wait_for_read_event(client_conn->ctrl_fd,
-                                10,
-                                0);  // Wait 10 seconds at most for the client to close first
-            *disconnect_client = 1;
-            result = OK;
-        }
-        else if (strstr(server_conn->buff->ctrl_rx_buff, SET_PARAM_CMD) ==
-                 server_conn->buff->ctrl_rx_buff)
-        {
-            const char* resp =
-                set_parameter(server_conn->buff->ctrl_rx_buff, server_conn, client_conn);
-            result = socket_send_all(
-                client_conn->ctrl_fd, resp, strnlen(resp, 128) + 1, 0, &bytes_transferred);
-        }
-        else if (strstr(server_conn->buff->ctrl_rx_buff, SET_DRIVER_PARAM_CMD) ==
-                 server_conn->buff->ctrl_rx_buff)
-        {
-            const char* resp = set_driver_parameter(server_conn->buff->ctrl_rx_buff, server_conn);
-            result = socket_send_all(
-                client_conn->ctrl_fd, resp, strnlen(resp, 256) + 1, 0, &bytes_transferred);
-        }
-        else if (strstr(server_conn->buff->ctrl_rx_buff, GET_DRIVER_PARAM_CMD) ==
-                 server_conn->buff->ctrl_rx_buff)
-        {
-            const char* resp = get_driver_parameter(server_conn->buff->ctrl_rx_buff, server_conn);
-            result = socket_send_all(client_conn->ctrl_fd,
-                                     resp,
-                                     strnlen(resp, MAX_SERVER_PARAM_VALUE_LEN) + 1,
-                                     0,
-                                     &bytes_transferred);
-        }
-        else
-        {
-            result = socket_send_all(client_conn->ctrl_fd,
-                                     UNRECOGNIZED_CMD_RSP,
-                                     UNRECOGNIZED_CMD_RSP_LEN,
-                                     0,
-                                     &bytes_transferred);
-        }
-        if (result != OK)
-        {
-            print_last_socket_error_b("Failed to send CTRL message response", bytes_transferred);
-        }
-        return result;
+        return handle_control_message(client_conn, server_conn, disconnect_client);
     }
     else
     {
@@ -752,9 +1212,173 @@ unsigned long buff_len_to_wrap_boundary(uint64_t buff_sa,
     }
 }
 
+// The process_* functions below are instantiated once per SERVER_PATH. 'path' is a constant in
+// each instantiation, so the SERVER_PATH_ST_DBG_IP one has no callback, loopback or buffer mode
+// checks left and the compiler is free to inline the driver into it.
+#if defined(_MSC_VER)
+#define SERVER_PATH_INLINE static __forceinline
+#else
+#define SERVER_PATH_INLINE static inline __attribute__((always_inline))
+#endif
+
+void select_server_path(SERVER_CONN* server_conn)
+{
+    const SERVER_HW_CALLBACKS* callbacks = &(server_conn->hw_callbacks);
+    int st_dbg_ip = (callbacks->get_h2t_buffer == get_h2t_buffer) &&
+                    (callbacks->get_h2t_buffer_chunk == get_h2t_buffer_chunk) &&
+                    (callbacks->h2t_data_received == push_h2t_data) &&
+                    (callbacks->get_h2t_wait_reason == get_h2t_buffer_wait_reason) &&
+                    (callbacks->acquire_t2h_data == get_t2h_data) &&
+                    (callbacks->t2h_data_complete == t2h_data_complete);
+#if ENABLE_MGMT != 0
+    st_dbg_ip = st_dbg_ip && (callbacks->get_mgmt_buffer == get_mgmt_buffer) &&
+                (callbacks->mgmt_data_received == push_mgmt_data) &&
+                (callbacks->get_mgmt_wait_reason == get_mgmt_buffer_wait_reason) &&
+                (callbacks->acquire_mgmt_rsp_data == get_mgmt_rsp_data) &&
+                (callbacks->mgmt_rsp_data_complete == mgmt_rsp_data_complete);
+#endif
+    server_conn->path = (st_dbg_ip && server_conn->buff->use_wrapping_data_buffers &&
+                         (server_conn->loopback_mode == 0))
+                            ? SERVER_PATH_ST_DBG_IP
+                            : SERVER_PATH_GENERIC;
+}
+
+static inline char path_loopback_mode(const SERVER_CONN* server_conn, SERVER_PATH path)
+{
+    return (path == SERVER_PATH_ST_DBG_IP) ? 0 : server_conn->loopback_mode;
+}
+
+static inline char path_use_wrapping_data_buffers(const SERVER_CONN* server_conn, SERVER_PATH path)
+{
+    return (path == SERVER_PATH_ST_DBG_IP) ? 1 : server_conn->buff->use_wrapping_data_buffers;
+}
+
+static inline uint32_t path_get_h2t_buffer(const SERVER_CONN* server_conn,
+                                           SERVER_PATH path,
+                                           size_t sz,
+                                           size_t* granted_sz)
+{
+    if (path == SERVER_PATH_ST_DBG_IP)
+    {
+        return get_h2t_buffer_chunk(sz, granted_sz);
+    }
+    *granted_sz = sz;
+    if (server_conn->hw_callbacks.get_h2t_buffer_chunk != NULL)
+    {
+        return server_conn->hw_callbacks.get_h2t_buffer_chunk(sz, granted_sz);
+    }
+    return (server_conn->hw_callbacks.get_h2t_buffer != NULL)
+               ? server_conn->hw_callbacks.get_h2t_buffer(sz)
+               : server_conn->buff->h2t_rx_buff;
+}
+
+static inline int path_h2t_data_received(const SERVER_CONN* server_conn,
+                                         SERVER_PATH path,
+                                         H2T_PACKET_HEADER* header,
+                                         uint32_t payload)
+{
+    if (path == SERVER_PATH_ST_DBG_IP)
+    {
+        return push_h2t_data(header, payload);
+    }
+    return (server_conn->hw_callbacks.h2t_data_received != NULL)
+               ? server_conn->hw_callbacks.h2t_data_received(header, payload)
+               : OK;
+}
+
+static inline int (*path_get_h2t_wait_reason(const SERVER_CONN* server_conn, SERVER_PATH path))()
+{
+    return (path == SERVER_PATH_ST_DBG_IP) ? get_h2t_buffer_wait_reason
+                                           : server_conn->hw_callbacks.get_h2t_wait_reason;
+}
+
+static inline int path_acquire_t2h_data(const SERVER_CONN* server_conn,
+                                        SERVER_PATH path,
+                                        H2T_PACKET_HEADER* header,
+                                        uint32_t* payload)
+{
+    return (path == SERVER_PATH_ST_DBG_IP)
+               ? get_t2h_data(header, payload)
+               : server_conn->hw_callbacks.acquire_t2h_data(header, payload);
+}
+
+static inline void path_t2h_data_complete(const SERVER_CONN* server_conn, SERVER_PATH path)
+{
+    if (path == SERVER_PATH_ST_DBG_IP)
+    {
+        t2h_data_complete();
+    }
+    else if (server_conn->hw_callbacks.t2h_data_complete != NULL)
+    {
+        server_conn->hw_callbacks.t2h_data_complete();
+    }
+}
+
+// The MGMT driver functions are only installed as callbacks when MGMT is enabled
+#if ENABLE_MGMT != 0
+#define PATH_MGMT_ST_DBG_IP(path) ((path) == SERVER_PATH_ST_DBG_IP)
+#else
+#define PATH_MGMT_ST_DBG_IP(path) 0
+#endif
+
+static inline uint32_t path_get_mgmt_buffer(const SERVER_CONN* server_conn,
+                                            SERVER_PATH path,
+                                            size_t sz)
+{
+    if (PATH_MGMT_ST_DBG_IP(path))
+    {
+        return get_mgmt_buffer(sz);
+    }
+    return (server_conn->hw_callbacks.get_mgmt_buffer != NULL)
+               ? server_conn->hw_callbacks.get_mgmt_buffer(sz)
+               : server_conn->buff->mgmt_rx_buff;
+}
+
+static inline int path_mgmt_data_received(const SERVER_CONN* server_conn,
+                                          SERVER_PATH path,
+                                          MGMT_PACKET_HEADER* header,
+                                          uint32_t payload)
+{
+    if (PATH_MGMT_ST_DBG_IP(path))
+    {
+        return push_mgmt_data(header, payload);
+    }
+    return (server_conn->hw_callbacks.mgmt_data_received != NULL)
+               ? server_conn->hw_callbacks.mgmt_data_received(header, payload)
+               : OK;
+}
+
+static inline int (*path_get_mgmt_wait_reason(const SERVER_CONN* server_conn, SERVER_PATH path))()
+{
+    return PATH_MGMT_ST_DBG_IP(path) ? get_mgmt_buffer_wait_reason
+                                     : server_conn->hw_callbacks.get_mgmt_wait_reason;
+}
+
+static inline int path_acquire_mgmt_rsp_data(const SERVER_CONN* server_conn,
+                                             SERVER_PATH path,
+                                             MGMT_PACKET_HEADER* header,
+                                             uint32_t* payload)
+{
+    return PATH_MGMT_ST_DBG_IP(path)
+               ? get_mgmt_rsp_data(header, payload)
+               : server_conn->hw_callbacks.acquire_mgmt_rsp_data(header, payload);
+}
+
+static inline void path_mgmt_rsp_data_complete(const SERVER_CONN* server_conn, SERVER_PATH path)
+{
+    if (PATH_MGMT_ST_DBG_IP(path))
+    {
+        mgmt_rsp_data_complete();
+    }
+    else if (server_conn->hw_callbacks.mgmt_rsp_data_complete != NULL)
+    {
+        server_conn->hw_callbacks.mgmt_rsp_data_complete();
+    }
+}
+
 RETURN_CODE update_curr_h2t_header(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
 {
-    if (server_conn->h2t_waiting == 0)
+    if ((server_conn->h2t_waiting == 0) && (server_conn->h2t_payload_offset == 0))
     {
         ssize_t bytes_recvd;
         RETURN_CODE result =
@@ -767,42 +1391,351 @@ RETURN_CODE update_curr_h2t_header(CLIENT_CONN* client_conn, SERVER_CONN* server
         {
             print_last_socket_error_b("Failed to recv H2T header", bytes_recvd);
         }
+        else
+        {
+            trace_h2t_event(TRACE_EVENT_HEADER_RECEIVED,
+                            TRACE_STREAM_H2T,
+                            (H2T_PACKET_HEADER*) (server_conn->buff->h2t_header_buff +
+                                                  SIZEOF_PACKET_GUARDBAND));
+        }
+        server_conn->latency_stats.h2t_header_received = get_timestamp_ticks();
         return result;
     }
     return OK;
 }
 
-RETURN_CODE process_h2t_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+// Copies 'len' bytes of host memory to 'fpga_buff', granted in the buffer at 'buff_sa'
+SERVER_PATH_INLINE void copy_to_fpga_buffer(const SERVER_CONN* server_conn,
+                                            const SERVER_PATH path,
+                                            const unsigned char* src,
+                                            uint32_t fpga_buff,
+                                            uint32_t buff_sa,
+                                            size_t buff_sz,
+                                            size_t len)
+{
+    const size_t first_len = path_use_wrapping_data_buffers(server_conn, path)
+                                 ? buff_len_to_wrap_boundary(buff_sa, buff_sz, fpga_buff, len)
+                                 : 0;
+    if (first_len != 0)
+    {
+        memcpy64_host2fpga((uint64_t*) src, fpga_buff, first_len);
+        memcpy64_host2fpga((uint64_t*) (src + first_len), buff_sa, len - first_len);
+    }
+    else
+    {
+        memcpy64_host2fpga((uint64_t*) src, fpga_buff, len);
+    }
+}
+
+// Copies 'len' bytes at 'fpga_buff', acquired from the buffer at 'buff_sa', to host memory
+SERVER_PATH_INLINE void copy_from_fpga_buffer(const SERVER_CONN* server_conn,
+                                              const SERVER_PATH path,
+                                              uint32_t fpga_buff,
+                                              uint32_t buff_sa,
+                                              size_t buff_sz,
+                                              unsigned char* dst,
+                                              size_t len)
+{
+    const size_t first_len = path_use_wrapping_data_buffers(server_conn, path)
+                                 ? buff_len_to_wrap_boundary(buff_sa, buff_sz, fpga_buff, len)
+                                 : 0;
+    if (first_len != 0)
+    {
+        memcpy64_fpga2host(fpga_buff, (uint64_t*) dst, first_len);
+        memcpy64_fpga2host(buff_sa, (uint64_t*) (dst + first_len), len - first_len);
+    }
+    else
+    {
+        memcpy64_fpga2host(fpga_buff, (uint64_t*) dst, len);
+    }
+}
+
+// Pushes the held H2T run as one packet, or as much of it as the H2T memory has room for. The run
+// stays held if there is no room at all.
+SERVER_PATH_INLINE RETURN_CODE flush_h2t_coalescer_on(SERVER_CONN* server_conn,
+                                                      const SERVER_PATH path)
+{
+    H2T_COALESCER* coalescer = &(server_conn->h2t_coalescer);
+    const size_t held = h2t_coalescer_held(coalescer);
+    size_t granted_sz;
+    uint32_t h2t_buff = path_get_h2t_buffer(server_conn, path, held, &granted_sz);
+    if (h2t_buff == 0)
+    {
+        return OK;
+    }
+
+    H2T_PACKET_HEADER part = coalescer->header;
+    part.DATA_LEN_BYTES = (unsigned short) granted_sz;
+    if (granted_sz < held)
+    {
+        part.SOP_EOP &= ~H2T_PACKET_HEADER_MASK_EOP;
+    }
+    trace_h2t_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_H2T, &part);
+    copy_to_fpga_buffer(server_conn,
+                        path,
+                        coalescer->buff,
+                        h2t_buff,
+                        server_conn->buff->h2t_rx_buff,
+                        server_conn->buff->h2t_rx_buff_sz,
+                        granted_sz);
+    RETURN_CODE has_error = path_h2t_data_received(server_conn, path, &part, h2t_buff);
+    trace_h2t_event(TRACE_EVENT_DESCRIPTOR_PUSHED, TRACE_STREAM_H2T, &part);
+
+    if (granted_sz < held)
+    {
+        memmove(coalescer->buff, coalescer->buff + granted_sz, held - granted_sz);
+        coalescer->header.DATA_LEN_BYTES = (unsigned short) (held - granted_sz);
+        coalescer->header.SOP_EOP &= ~H2T_PACKET_HEADER_MASK_SOP;
+    }
+    else
+    {
+        latency_record(&(server_conn->latency_stats.histograms[LATENCY_H2T]),
+                       get_timestamp_ticks() - coalescer->first_received);
+        h2t_coalescer_clear(coalescer);
+    }
+    return has_error;
+}
+
+// Holds the payload of an H2T packet the coalescer accepted, and pushes the run if the packet
+// ended it
+SERVER_PATH_INLINE RETURN_CODE coalesce_h2t_data_on(CLIENT_CONN* client_conn,
+                                                    SERVER_CONN* server_conn,
+                                                    const SERVER_PATH path,
+                                                    const H2T_PACKET_HEADER* header)
+{
+    H2T_COALESCER* coalescer = &(server_conn->h2t_coalescer);
+    unsigned char* payload = h2t_coalescer_tail(coalescer);
+    ssize_t bytes_recvd;
+
+    if (server_conn->h2t_waiting)
+    {
+        stall_end(&(server_conn->stall_stats), STALL_H2T_DESCRIPTOR_SLOTS);
+        stall_end(&(server_conn->stall_stats), STALL_H2T_RING_SPACE);
+    }
+    server_conn->h2t_waiting = 0;
+
+    capture_h2t_packet_begin(CAPTURE_STREAM_H2T, header);
+    RETURN_CODE has_error = socket_recv_accumulate(
+        client_conn->h2t_data_fd, (char*) payload, header->DATA_LEN_BYTES, 0, &bytes_recvd);
+    if ((has_error == OK) && is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    if (has_error != OK)
+    {
+        print_last_socket_error_b("Failed to recv H2T data", bytes_recvd);
+        return has_error;
+    }
+
+    server_conn->pkt_stats.h2t_cnt++;
+    server_conn->pkt_stats.h2t_bytes += header->DATA_LEN_BYTES;
+    channel_stats_record(
+        &(server_conn->channel_stats), CHANNEL_H2T, header->CHANNEL, header->DATA_LEN_BYTES);
+    h2t_coalescer_add(coalescer, header, server_conn->latency_stats.h2t_header_received);
+    return coalescer->closed ? flush_h2t_coalescer_on(server_conn, path) : OK;
+}
+
+// Records that the current H2T packet waits for room in the H2T memory
+SERVER_PATH_INLINE void wait_for_h2t_buffer_on(SERVER_CONN* server_conn,
+                                               const SERVER_PATH path,
+                                               const H2T_PACKET_HEADER* header)
+{
+    if (!server_conn->h2t_waiting)
+    {
+        trace_h2t_event(TRACE_EVENT_BUFFER_WAIT, TRACE_STREAM_H2T, header);
+        stall_begin(&(server_conn->stall_stats),
+                    get_buffer_stall_reason(path_get_h2t_wait_reason(server_conn, path),
+                                            STALL_H2T_DESCRIPTOR_SLOTS,
+                                            STALL_H2T_RING_SPACE));
+    }
+    server_conn->h2t_waiting = 1;
+}
+
+// Accounts for the H2T memory granted to the next 'len' bytes of the current H2T packet, from
+// 'payload_offset' on, and returns the header of that part. Each part gets SOP on the first and
+// EOP on the last part only.
+SERVER_PATH_INLINE H2T_PACKET_HEADER begin_h2t_part(SERVER_CONN* server_conn,
+                                                    const H2T_PACKET_HEADER* header,
+                                                    size_t payload_offset,
+                                                    size_t len)
+{
+    H2T_PACKET_HEADER part = *header;
+    part.DATA_LEN_BYTES = (unsigned short) len;
+    if (payload_offset != 0)
+    {
+        part.SOP_EOP &= ~H2T_PACKET_HEADER_MASK_SOP;
+    }
+    if (payload_offset + len < header->DATA_LEN_BYTES)
+    {
+        part.SOP_EOP &= ~H2T_PACKET_HEADER_MASK_EOP;
+    }
+    trace_h2t_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_H2T, &part);
+    if (payload_offset == 0)
+    {
+        server_conn->pkt_stats.h2t_cnt++;
+        channel_stats_record(
+            &(server_conn->channel_stats), CHANNEL_H2T, header->CHANNEL, header->DATA_LEN_BYTES);
+    }
+    server_conn->pkt_stats.h2t_bytes += len;
+    if (server_conn->h2t_waiting)
+    {
+        stall_end(&(server_conn->stall_stats), STALL_H2T_DESCRIPTOR_SLOTS);
+        stall_end(&(server_conn->stall_stats), STALL_H2T_RING_SPACE);
+    }
+    server_conn->h2t_waiting = 0;
+    return part;
+}
+
+// Advances the current H2T packet past a part pushed to the HW. Returns nonzero once the whole
+// packet is pushed.
+SERVER_PATH_INLINE char end_h2t_part(SERVER_CONN* server_conn,
+                                     const H2T_PACKET_HEADER* header,
+                                     size_t payload_offset,
+                                     size_t len)
+{
+    server_conn->h2t_payload_offset = payload_offset + len;
+    if (server_conn->h2t_payload_offset != header->DATA_LEN_BYTES)
+    {
+        return 0;
+    }
+    server_conn->h2t_payload_offset = 0;
+    latency_record(&(server_conn->latency_stats.histograms[LATENCY_H2T]),
+                   get_timestamp_ticks() - server_conn->latency_stats.h2t_header_received);
+    return 1;
+}
+
+// Server loopback: echoes the current H2T packet as T2H through host memory. The payload is
+// received right behind a copy of the header and both go out in one send, without touching the
+// H2T or T2H memory.
+static RETURN_CODE loopback_h2t_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    const size_t header_sz = SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER;
+    const H2T_PACKET_HEADER* header =
+        (H2T_PACKET_HEADER*) (server_conn->buff->h2t_header_buff + SIZEOF_PACKET_GUARDBAND);
+    char* payload = server_conn->loopback_buff + header_sz;
+    ssize_t bytes_transferred;
+
+    trace_h2t_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_H2T, header);
+    if (server_conn->h2t_waiting)
+    {
+        stall_end(&(server_conn->stall_stats), STALL_H2T_DESCRIPTOR_SLOTS);
+        stall_end(&(server_conn->stall_stats), STALL_H2T_RING_SPACE);
+    }
+    server_conn->h2t_waiting = 0;
+    server_conn->pkt_stats.h2t_cnt++;
+    server_conn->pkt_stats.h2t_bytes += header->DATA_LEN_BYTES;
+    channel_stats_record(
+        &(server_conn->channel_stats), CHANNEL_H2T, header->CHANNEL, header->DATA_LEN_BYTES);
+
+    memcpy(server_conn->loopback_buff, server_conn->buff->h2t_header_buff, header_sz);
+    capture_h2t_packet_begin(CAPTURE_STREAM_H2T, header);
+    RETURN_CODE has_error = socket_recv_accumulate(
+        client_conn->h2t_data_fd, payload, header->DATA_LEN_BYTES, 0, &bytes_transferred);
+    if ((has_error == OK) && is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    if (has_error != OK)
+    {
+        print_last_socket_error_b("Failed to recv H2T data", bytes_transferred);
+        return has_error;
+    }
+
+    capture_h2t_packet_begin(CAPTURE_STREAM_T2H, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    if ((has_error = socket_send_all(client_conn->t2h_data_fd,
+                                     server_conn->loopback_buff,
+                                     header_sz + header->DATA_LEN_BYTES,
+                                     0,
+                                     &bytes_transferred)) != OK)
+    {
+        print_last_socket_error_b("Failed to send loopback T2H packet", bytes_transferred);
+    }
+    else
+    {
+        trace_h2t_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_T2H, header);
+    }
+    return has_error;
+}
+
+SERVER_PATH_INLINE RETURN_CODE process_h2t_data_on(CLIENT_CONN* client_conn,
+                                                   SERVER_CONN* server_conn,
+                                                   const SERVER_PATH path)
 {
     ssize_t bytes_recvd;
     RETURN_CODE has_error = OK;
+    H2T_COALESCER* coalescer = &(server_conn->h2t_coalescer);
+    const char coalescing = (coalescer->limit != 0) && (path_loopback_mode(server_conn, path) == 0);
+
+    // A held run that ended or timed out goes to the HW before anything else
+    if (coalescing && h2t_coalescer_due(coalescer, get_timestamp_ticks()))
+    {
+        has_error = flush_h2t_coalescer_on(server_conn, path);
+        if ((has_error != OK) || (h2t_coalescer_held(coalescer) != 0))
+        {
+            return has_error;
+        }
+    }
 
     if ((has_error = update_curr_h2t_header(client_conn, server_conn)) == OK)
     {
         H2T_PACKET_HEADER* header =
             (H2T_PACKET_HEADER*) (server_conn->buff->h2t_header_buff + SIZEOF_PACKET_GUARDBAND);
-        size_t bytes_to_transfer = header->DATA_LEN_BYTES;
+        const size_t payload_offset = server_conn->h2t_payload_offset;
+        size_t bytes_to_transfer;
 
-        // Polls to see if there is room for the packet
-        uint64_t h2t_buff = ((server_conn->hw_callbacks.get_h2t_buffer != NULL) &&
-                             (server_conn->loopback_mode == 0))
-                                ? server_conn->hw_callbacks.get_h2t_buffer(bytes_to_transfer)
-                                : server_conn->buff->h2t_rx_buff;
+        // A packet the HW path has started pushing in parts is finished by it
+        if ((path_loopback_mode(server_conn, path) != 0) && (payload_offset == 0))
+        {
+            return loopback_h2t_data(client_conn, server_conn);
+        }
+
+        if (coalescing && (payload_offset == 0))
+        {
+            if (h2t_coalescer_accepts(coalescer, header))
+            {
+                return coalesce_h2t_data_on(client_conn, server_conn, path, header);
+            }
+            // The packet ends the held run, which goes first
+            if ((h2t_coalescer_held(coalescer) != 0) &&
+                (((has_error = flush_h2t_coalescer_on(server_conn, path)) != OK) ||
+                 (h2t_coalescer_held(coalescer) != 0)))
+            {
+                if (has_error == OK)
+                {
+                    wait_for_h2t_buffer_on(server_conn, path, header);
+                }
+                return has_error;
+            }
+        }
+
+        // Polls to see if there is room for the packet, or at least for its next part
+        uint64_t h2t_buff = path_get_h2t_buffer(
+            server_conn, path, header->DATA_LEN_BYTES - payload_offset, &bytes_to_transfer);
 
         // Recv H2T payload
         if (h2t_buff != 0)
         {
-            server_conn->pkt_stats.h2t_cnt++;
-            server_conn->h2t_waiting = 0;
+            // A payload that does not fit into the H2T memory is pushed in parts, each captured as
+            // a packet of its own
+            H2T_PACKET_HEADER part =
+                begin_h2t_part(server_conn, header, payload_offset, bytes_to_transfer);
+            capture_h2t_packet_begin(CAPTURE_STREAM_H2T, &part);
             size_t first_len;
-            if (server_conn->buff->use_wrapping_data_buffers &&
+            if (path_use_wrapping_data_buffers(server_conn, path) &&
                 ((first_len = buff_len_to_wrap_boundary(server_conn->buff->h2t_rx_buff,
                                                         server_conn->buff->h2t_rx_buff_sz,
                                                         h2t_buff,
-                                                        header->DATA_LEN_BYTES)) != 0))
+                                                        bytes_to_transfer)) != 0))
             {
                 // Wrap, 2 recv necessary
-                size_t second_len = header->DATA_LEN_BYTES - first_len;
+                size_t second_len = bytes_to_transfer - first_len;
                 has_error = socket_recv_accumulate_h2t_or_mgmt_data(
                     client_conn->h2t_data_fd, h2t_buff, first_len, 0, &bytes_recvd);
                 if (has_error == OK)
@@ -821,45 +1754,14 @@ RETURN_CODE process_h2t_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
                 has_error = socket_recv_accumulate_h2t_or_mgmt_data(
                     client_conn->h2t_data_fd, h2t_buff, bytes_to_transfer, 0, &bytes_recvd);
             }
+            capture_packet_end();
 
-            // Push to driver or loopback
+            // Push the transaction to HW
             if (has_error == OK)
             {
-                if (server_conn->loopback_mode == 0)
-                {
-                    // Normal operation, push the transaction to HW
-                    has_error = (server_conn->hw_callbacks.h2t_data_received != NULL)
-                                    ? server_conn->hw_callbacks.h2t_data_received(header, h2t_buff)
-                                    : OK;
-                }
-                else
-                {
-                    // Send the header
-                    if ((has_error =
-                             socket_send_all(client_conn->t2h_data_fd,
-                                             server_conn->buff->h2t_header_buff,
-                                             SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER,
-                                             0,
-                                             &bytes_recvd)) == OK)
-                    {
-                        // Send the payload
-                        if ((has_error =
-                                 socket_send_all_t2h_or_mgmt_rsp_data(client_conn->t2h_data_fd,
-                                                                      h2t_buff,
-                                                                      bytes_to_transfer,
-                                                                      0,
-                                                                      &bytes_recvd)) != OK)
-                        {
-                            print_last_socket_error_b("Failed to send loopback T2H data",
-                                                      bytes_recvd);
-                        }
-                    }
-                    else
-                    {
-                        print_last_socket_error_b("Failed to send loopback T2H header",
-                                                  bytes_recvd);
-                    }
-                }
+                has_error = path_h2t_data_received(server_conn, path, &part, h2t_buff);
+                trace_h2t_event(TRACE_EVENT_DESCRIPTOR_PUSHED, TRACE_STREAM_H2T, &part);
+                end_h2t_part(server_conn, header, payload_offset, bytes_to_transfer);
             }
             else
             {
@@ -869,13 +1771,33 @@ RETURN_CODE process_h2t_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
         else
         {
             // Wait for buffer to be available!
-            server_conn->h2t_waiting = 1;
+            wait_for_h2t_buffer_on(server_conn, path, header);
         }
     }
 
     return has_error;
 }
 
+RETURN_CODE process_h2t_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_h2t_data_on(client_conn, server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_h2t_data_on(client_conn, server_conn, SERVER_PATH_GENERIC);
+}
+
+// Pushes the held H2T run once its time window has elapsed, whether or not more H2T data arrives
+static RETURN_CODE flush_due_h2t_data(SERVER_CONN* server_conn)
+{
+    if ((server_conn->loopback_mode != 0) ||
+        !h2t_coalescer_due(&(server_conn->h2t_coalescer), get_timestamp_ticks()))
+    {
+        return OK;
+    }
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? flush_h2t_coalescer_on(server_conn, SERVER_PATH_ST_DBG_IP)
+               : flush_h2t_coalescer_on(server_conn, SERVER_PATH_GENERIC);
+}
+
 RETURN_CODE update_curr_mgmt_header(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
 {
     if (server_conn->mgmt_waiting == 0)
@@ -891,12 +1813,128 @@ RETURN_CODE update_curr_mgmt_header(CLIENT_CONN* client_conn, SERVER_CONN* serve
         {
             print_last_socket_error_b("Failed to recv MGMT header", bytes_recvd);
         }
+        else
+        {
+            trace_mgmt_event(TRACE_EVENT_HEADER_RECEIVED,
+                             TRACE_STREAM_MGMT,
+                             (MGMT_PACKET_HEADER*) (server_conn->buff->mgmt_header_buff +
+                                                    SIZEOF_PACKET_GUARDBAND));
+        }
         return result;
     }
     return OK;
 }
 
-RETURN_CODE process_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+// Server loopback: echoes the current MGMT packet as MGMT RSP through host memory, as
+// loopback_h2t_data() does for H2T
+static RETURN_CODE loopback_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    const size_t header_sz = SIZEOF_PACKET_GUARDBAND + SIZEOF_MGMT_PACKET_HEADER;
+    const MGMT_PACKET_HEADER* header =
+        (MGMT_PACKET_HEADER*) (server_conn->buff->mgmt_header_buff + SIZEOF_PACKET_GUARDBAND);
+    char* payload = server_conn->loopback_buff + header_sz;
+    ssize_t bytes_transferred;
+
+    trace_mgmt_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_MGMT, header);
+    if (server_conn->mgmt_waiting)
+    {
+        stall_end(&(server_conn->stall_stats), STALL_MGMT_DESCRIPTOR_SLOTS);
+        stall_end(&(server_conn->stall_stats), STALL_MGMT_RING_SPACE);
+    }
+    server_conn->mgmt_waiting = 0;
+    server_conn->pkt_stats.mgmt_cnt++;
+    server_conn->pkt_stats.mgmt_bytes += header->DATA_LEN_BYTES;
+
+    memcpy(server_conn->loopback_buff, server_conn->buff->mgmt_header_buff, header_sz);
+    capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT, header);
+    RETURN_CODE has_error = socket_recv_accumulate(
+        client_conn->mgmt_fd, payload, header->DATA_LEN_BYTES, 0, &bytes_transferred);
+    if ((has_error == OK) && is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    if (has_error != OK)
+    {
+        print_last_socket_error_b("Failed to recv MGMT data", bytes_transferred);
+        return has_error;
+    }
+
+    capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT_RSP, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    if ((has_error = socket_send_all(client_conn->mgmt_rsp_fd,
+                                     server_conn->loopback_buff,
+                                     header_sz + header->DATA_LEN_BYTES,
+                                     0,
+                                     &bytes_transferred)) != OK)
+    {
+        print_last_socket_error_b("Failed to send loopback MGMT RSP packet", bytes_transferred);
+    }
+    else
+    {
+        trace_mgmt_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_MGMT_RSP, header);
+    }
+    return has_error;
+}
+
+// Accounts for the MGMT memory granted to the current MGMT packet
+static inline void begin_mgmt_packet(SERVER_CONN* server_conn, const MGMT_PACKET_HEADER* header)
+{
+    trace_mgmt_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_MGMT, header);
+    server_conn->pkt_stats.mgmt_cnt++;
+    server_conn->pkt_stats.mgmt_bytes += header->DATA_LEN_BYTES;
+    if (server_conn->mgmt_waiting)
+    {
+        stall_end(&(server_conn->stall_stats), STALL_MGMT_DESCRIPTOR_SLOTS);
+        stall_end(&(server_conn->stall_stats), STALL_MGMT_RING_SPACE);
+    }
+    server_conn->mgmt_waiting = 0;
+}
+
+// Records that the current MGMT packet was pushed to the HW, which gates MGMT RSP polling
+static inline void end_mgmt_packet(SERVER_CONN* server_conn, const MGMT_PACKET_HEADER* header)
+{
+    trace_mgmt_event(TRACE_EVENT_DESCRIPTOR_PUSHED, TRACE_STREAM_MGMT, header);
+    if (!server_conn->has_mgmt_pkt_sent)
+    {
+        server_conn->has_mgmt_pkt_sent = 1;
+        server_conn->latency_stats.mgmt_request_pushed = get_timestamp_ticks();
+        stall_begin(&(server_conn->stall_stats), STALL_MGMT_RSP_PENDING);
+    }
+    else if (header->SOP_EOP & H2T_PACKET_HEADER_MASK_SOP)
+    {
+        fpga_throw_runtime_exception(
+            __FUNCTION__,
+            __FILE__,
+            __LINE__,
+            "receiving two consecutive mgmt packets without mgmt resp pkt to match the "
+            "first one.");
+    }
+}
+
+// Records that the current MGMT packet waits for room in the MGMT memory
+SERVER_PATH_INLINE void wait_for_mgmt_buffer_on(SERVER_CONN* server_conn,
+                                                const SERVER_PATH path,
+                                                const MGMT_PACKET_HEADER* header)
+{
+    if (!server_conn->mgmt_waiting)
+    {
+        trace_mgmt_event(TRACE_EVENT_BUFFER_WAIT, TRACE_STREAM_MGMT, header);
+        stall_begin(&(server_conn->stall_stats),
+                    get_buffer_stall_reason(path_get_mgmt_wait_reason(server_conn, path),
+                                            STALL_MGMT_DESCRIPTOR_SLOTS,
+                                            STALL_MGMT_RING_SPACE));
+    }
+    server_conn->mgmt_waiting = 1;
+}
+
+SERVER_PATH_INLINE RETURN_CODE process_mgmt_data_on(CLIENT_CONN* client_conn,
+                                                    SERVER_CONN* server_conn,
+                                                    const SERVER_PATH path)
 {
     ssize_t bytes_recvd;
     RETURN_CODE has_error = OK;
@@ -907,19 +1945,21 @@ RETURN_CODE process_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn
             (MGMT_PACKET_HEADER*) (server_conn->buff->mgmt_header_buff + SIZEOF_PACKET_GUARDBAND);
         size_t bytes_to_transfer = header->DATA_LEN_BYTES;
 
+        if (path_loopback_mode(server_conn, path) != 0)
+        {
+            return loopback_mgmt_data(client_conn, server_conn);
+        }
+
         // Polls to see if there is room for the packet
-        uint64_t mgmt_buff = ((server_conn->hw_callbacks.get_mgmt_buffer != NULL) &&
-                              (server_conn->loopback_mode == 0))
-                                 ? server_conn->hw_callbacks.get_mgmt_buffer(bytes_to_transfer)
-                                 : server_conn->buff->mgmt_rx_buff;
+        uint64_t mgmt_buff = path_get_mgmt_buffer(server_conn, path, bytes_to_transfer);
 
         // Recv MGMT payload
         if (mgmt_buff != 0)
         {
-            server_conn->pkt_stats.mgmt_cnt++;
-            server_conn->mgmt_waiting = 0;
+            begin_mgmt_packet(server_conn, header);
+            capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT, header);
             size_t first_len;
-            if (server_conn->buff->use_wrapping_data_buffers &&
+            if (path_use_wrapping_data_buffers(server_conn, path) &&
                 ((first_len = buff_len_to_wrap_boundary(server_conn->buff->mgmt_rx_buff,
                                                         server_conn->buff->mgmt_rx_buff_sz,
                                                         mgmt_buff,
@@ -945,59 +1985,13 @@ RETURN_CODE process_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn
                 has_error = socket_recv_accumulate_h2t_or_mgmt_data(
                     client_conn->mgmt_fd, mgmt_buff, bytes_to_transfer, 0, &bytes_recvd);
             }
+            capture_packet_end();
 
-            // Push to driver or loopback
+            // Push the transaction to HW
             if (has_error == OK)
             {
-                if (server_conn->loopback_mode == 0)
-                {
-                    // Normal operation, push the transaction to HW
-                    has_error =
-                        (server_conn->hw_callbacks.mgmt_data_received != NULL)
-                            ? server_conn->hw_callbacks.mgmt_data_received(header, mgmt_buff)
-                            : OK;
-                    if (!server_conn->has_mgmt_pkt_sent)
-                    {
-                        server_conn->has_mgmt_pkt_sent = 1;
-                    }
-                    else if (header->SOP_EOP & H2T_PACKET_HEADER_MASK_SOP)
-                    {
-                        fpga_throw_runtime_exception(
-                            __FUNCTION__,
-                            __FILE__,
-                            __LINE__,
-                            "receiving two consecutive mgmt packets without mgmt resp pkt to match "
-                            "the first one.");
-                    }
-                }
-                else
-                {
-                    // Send the header
-                    if ((has_error =
-                             socket_send_all(client_conn->mgmt_rsp_fd,
-                                             server_conn->buff->mgmt_header_buff,
-                                             SIZEOF_PACKET_GUARDBAND + SIZEOF_MGMT_PACKET_HEADER,
-                                             0,
-                                             &bytes_recvd)) == OK)
-                    {
-                        // Send the payload
-                        if ((has_error =
-                                 socket_send_all_t2h_or_mgmt_rsp_data(client_conn->mgmt_rsp_fd,
-                                                                      mgmt_buff,
-                                                                      bytes_to_transfer,
-                                                                      0,
-                                                                      &bytes_recvd)) != OK)
-                        {
-                            print_last_socket_error_b("Failed to send loopback MGMT RSP data",
-                                                      bytes_recvd);
-                        }
-                    }
-                    else
-                    {
-                        print_last_socket_error_b("Failed to send loopback MGMT RSP header",
-                                                  bytes_recvd);
-                    }
-                }
+                has_error = path_mgmt_data_received(server_conn, path, header, mgmt_buff);
+                end_mgmt_packet(server_conn, header);
             }
             else
             {
@@ -1007,14 +2001,23 @@ RETURN_CODE process_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn
         else
         {
             // Wait for buffer to be available!
-            server_conn->mgmt_waiting = 1;
+            wait_for_mgmt_buffer_on(server_conn, path, header);
         }
     }
 
     return has_error;
 }
 
-RETURN_CODE process_t2h_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+RETURN_CODE process_mgmt_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_mgmt_data_on(client_conn, server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_mgmt_data_on(client_conn, server_conn, SERVER_PATH_GENERIC);
+}
+
+SERVER_PATH_INLINE RETURN_CODE process_t2h_data_on(CLIENT_CONN* client_conn,
+                                                   SERVER_CONN* server_conn,
+                                                   const SERVER_PATH path)
 {
     ssize_t bytes_sent;
     RETURN_CODE has_error = OK;
@@ -1022,24 +2025,34 @@ RETURN_CODE process_t2h_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
     H2T_PACKET_HEADER* header =
         (H2T_PACKET_HEADER*) (server_conn->buff->t2h_header_buff + SIZEOF_PACKET_GUARDBAND);
     uint32_t t2h_buff;
+    const uint64_t poll_start = get_timestamp_ticks();
     if ((has_error =
-             (server_conn->hw_callbacks.acquire_t2h_data(header, &t2h_buff) == 0) ? OK : FAILURE) ==
+             (path_acquire_t2h_data(server_conn, path, header, &t2h_buff) == 0) ? OK : FAILURE) ==
         OK)
     {
         unsigned short curr_payload_bytes;
         if ((curr_payload_bytes = header->DATA_LEN_BYTES) == 0)
         {
+            stall_add(&(server_conn->stall_stats),
+                      STALL_T2H_EMPTY_POLL,
+                      get_timestamp_ticks() - poll_start);
             return has_error;
         }
+        const uint64_t t2h_observed = get_timestamp_ticks();
+        trace_h2t_event(TRACE_EVENT_FETCHED, TRACE_STREAM_T2H, header);
         server_conn->pkt_stats.t2h_cnt++;
+        server_conn->pkt_stats.t2h_bytes += curr_payload_bytes;
+        channel_stats_record(
+            &(server_conn->channel_stats), CHANNEL_T2H, header->CHANNEL, curr_payload_bytes);
         if ((has_error = socket_send_all(client_conn->t2h_data_fd,
                                          (const char*) server_conn->buff->t2h_header_buff,
                                          SIZEOF_PACKET_GUARDBAND + SIZEOF_H2T_PACKET_HEADER,
                                          0,
                                          &bytes_sent)) == OK)
         {
+            capture_h2t_packet_begin(CAPTURE_STREAM_T2H, header);
             size_t first_len;
-            if (server_conn->buff->use_wrapping_data_buffers &&
+            if (path_use_wrapping_data_buffers(server_conn, path) &&
                 ((first_len = buff_len_to_wrap_boundary(server_conn->buff->t2h_tx_buff,
                                                         server_conn->buff->t2h_tx_buff_sz,
                                                         t2h_buff,
@@ -1063,12 +2076,14 @@ RETURN_CODE process_t2h_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
                 has_error = socket_send_all_t2h_or_mgmt_rsp_data(
                     client_conn->t2h_data_fd, t2h_buff, curr_payload_bytes, 0, &bytes_sent);
             }
+            capture_packet_end();
             if (has_error == OK)
             {
-                if (server_conn->hw_callbacks.t2h_data_complete != NULL)
-                {
-                    server_conn->hw_callbacks.t2h_data_complete();
-                }
+                latency_record(&(server_conn->latency_stats.histograms[LATENCY_T2H]),
+                               get_timestamp_ticks() - t2h_observed);
+                trace_h2t_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_T2H, header);
+                path_t2h_data_complete(server_conn, path);
+                trace_h2t_event(TRACE_EVENT_COMPLETION, TRACE_STREAM_T2H, header);
             }
         }
         if (has_error != OK)
@@ -1080,7 +2095,35 @@ RETURN_CODE process_t2h_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
     return has_error;
 }
 
-RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+RETURN_CODE process_t2h_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_t2h_data_on(client_conn, server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_t2h_data_on(client_conn, server_conn, SERVER_PATH_GENERIC);
+}
+
+// Records that the current MGMT RSP packet, fetched at 'observed', went out to the client. Its EOP
+// ends the MGMT exchange.
+static inline void end_mgmt_rsp_packet(SERVER_CONN* server_conn,
+                                       const MGMT_PACKET_HEADER* header,
+                                       uint64_t observed)
+{
+    const uint64_t mgmt_rsp_sent = get_timestamp_ticks();
+    latency_record(&(server_conn->latency_stats.histograms[LATENCY_MGMT_RSP]),
+                   mgmt_rsp_sent - observed);
+    trace_mgmt_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_MGMT_RSP, header);
+    if (header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP)
+    {
+        server_conn->has_mgmt_pkt_sent = 0;
+        stall_end(&(server_conn->stall_stats), STALL_MGMT_RSP_PENDING);
+        latency_record(&(server_conn->latency_stats.histograms[LATENCY_MGMT]),
+                       mgmt_rsp_sent - server_conn->latency_stats.mgmt_request_pushed);
+    }
+}
+
+SERVER_PATH_INLINE RETURN_CODE process_mgmt_rsp_data_on(CLIENT_CONN* client_conn,
+                                                        SERVER_CONN* server_conn,
+                                                        const SERVER_PATH path)
 {
     ssize_t bytes_sent;
     RETURN_CODE has_error = OK;
@@ -1095,7 +2138,7 @@ RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_
     MGMT_PACKET_HEADER* header =
         (MGMT_PACKET_HEADER*) (server_conn->buff->mgmt_rsp_header_buff + SIZEOF_PACKET_GUARDBAND);
     uint32_t mgmt_rsp_buff;
-    if ((has_error = (server_conn->hw_callbacks.acquire_mgmt_rsp_data(header, &mgmt_rsp_buff) == 0)
+    if ((has_error = (path_acquire_mgmt_rsp_data(server_conn, path, header, &mgmt_rsp_buff) == 0)
                          ? OK
                          : FAILURE) == OK)
     {
@@ -1104,15 +2147,19 @@ RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_
         {
             return has_error;
         }
+        const uint64_t mgmt_rsp_observed = get_timestamp_ticks();
+        trace_mgmt_event(TRACE_EVENT_FETCHED, TRACE_STREAM_MGMT_RSP, header);
         server_conn->pkt_stats.mgmt_rsp_cnt++;
+        server_conn->pkt_stats.mgmt_rsp_bytes += curr_payload_bytes;
         if ((has_error = socket_send_all(client_conn->mgmt_rsp_fd,
                                          (const char*) server_conn->buff->mgmt_rsp_header_buff,
                                          SIZEOF_PACKET_GUARDBAND + SIZEOF_MGMT_PACKET_HEADER,
                                          0,
                                          &bytes_sent)) == OK)
         {
+            capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT_RSP, header);
             size_t first_len;
-            if (server_conn->buff->use_wrapping_data_buffers &&
+            if (path_use_wrapping_data_buffers(server_conn, path) &&
                 ((first_len = buff_len_to_wrap_boundary(server_conn->buff->mgmt_rsp_tx_buff,
                                                         server_conn->buff->mgmt_rsp_tx_buff_sz,
                                                         mgmt_rsp_buff,
@@ -1137,18 +2184,12 @@ RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_
                 has_error = socket_send_all_t2h_or_mgmt_rsp_data(
                     client_conn->mgmt_rsp_fd, mgmt_rsp_buff, curr_payload_bytes, 0, &bytes_sent);
             }
+            capture_packet_end();
             if (has_error == OK)
             {
-                uint32_t eop = (header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP);
-                if (eop > 0)
-                {
-                    server_conn->has_mgmt_pkt_sent = 0;
-                }
-
-                if (server_conn->hw_callbacks.mgmt_rsp_data_complete != NULL)
-                {
-                    server_conn->hw_callbacks.mgmt_rsp_data_complete();
-                }
+                end_mgmt_rsp_packet(server_conn, header, mgmt_rsp_observed);
+                path_mgmt_rsp_data_complete(server_conn, path);
+                trace_mgmt_event(TRACE_EVENT_COMPLETION, TRACE_STREAM_MGMT_RSP, header);
             }
         }
         if (has_error != OK)
@@ -1160,49 +2201,852 @@ RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_
     return has_error;
 }
 
-void reject_client(SERVER_CONN* server_conn)
+RETURN_CODE process_mgmt_rsp_data(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
 {
-    SOCKET sock_fd = INVALID_SOCKET;
-    if ((sock_fd = accept(server_conn->server_fd,
-                          (struct sockaddr*) (&(server_conn->server_addr)),
-                          &sizeof_addr)) == INVALID_SOCKET)
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_mgmt_rsp_data_on(client_conn, server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_mgmt_rsp_data_on(client_conn, server_conn, SERVER_PATH_GENERIC);
+}
+
+// Copies the header of the oldest record of a ring the client writes to and sets 'payload' to its
+// payload, or to NULL if the ring is empty. Fails if the record does not lie within the ring.
+static RETURN_CODE peek_shm_ring_record(SHM_RINGS_LAYOUT* layout,
+                                        SHM_RING ring,
+                                        SHM_RING_RECORD_HEADER* header,
+                                        const unsigned char** payload)
+{
+    const SHM_RING_RECORD_HEADER* record = shm_ring_peek(layout, ring);
+    *payload = NULL;
+    if (record == NULL)
     {
-        print_last_socket_error("Failed to accept additional client");
+        return OK;
     }
-    else
+    // The client could change the record under our feet, the copy is what gets checked and used
+    memcpy(header, record, sizeof(*header));
+    const size_t offset = (size_t) ((const unsigned char*) record - shm_ring_at(layout, ring, 0));
+    if (offset + shm_ring_record_len(header->data_len_bytes) > layout->ring_sz)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Malformed record of %u bytes in shared memory ring %d\n",
+                        (unsigned int) header->data_len_bytes,
+                        (int) ring);
+        return FAILURE;
+    }
+    *payload = (const unsigned char*) (record + 1);
+    return OK;
+}
+
+// Pushes an H2T packet held in host memory to the HW, in parts if the H2T memory has no room for
+// all of it. '*pushed' is set once its last part is pushed; until then the packet must be kept and
+// offered again.
+SERVER_PATH_INLINE RETURN_CODE push_h2t_packet_on(SERVER_CONN* server_conn,
+                                                  const SERVER_PATH path,
+                                                  const H2T_PACKET_HEADER* header,
+                                                  const unsigned char* payload,
+                                                  char* pushed)
+{
+    const size_t payload_offset = server_conn->h2t_payload_offset;
+    *pushed = 0;
+    if ((payload_offset == 0) && !server_conn->h2t_waiting)
     {
-#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_WINDOWS
-        int flags = 0;
-#else
-        int flags = MSG_DONTWAIT;
-#endif
-        size_t reject_msg_len = 12;
-        if (send(sock_fd, REJECT_MSG, reject_msg_len, flags) < 0)
-        {
-            print_last_socket_error("Failed to send rejection message to additional client");
-        }
+        trace_h2t_event(TRACE_EVENT_HEADER_RECEIVED, TRACE_STREAM_H2T, header);
+        server_conn->latency_stats.h2t_header_received = get_timestamp_ticks();
+    }
 
-        fpga_msg_printf(FPGA_MSG_PRINTF_WARNING,
-                        "Rejected one connection request because only one connection has already "
-                        "been established.");
+    size_t bytes_to_transfer;
+    uint32_t h2t_buff = path_get_h2t_buffer(
+        server_conn, path, header->DATA_LEN_BYTES - payload_offset, &bytes_to_transfer);
+    if (h2t_buff == 0)
+    {
+        wait_for_h2t_buffer_on(server_conn, path, header);
+        return OK;
+    }
 
-        // Prevent TIME_WAIT
-        set_linger_socket_option(sock_fd, 1, 0);
-        close_socket_fd(sock_fd);
+    H2T_PACKET_HEADER part = begin_h2t_part(server_conn, header, payload_offset, bytes_to_transfer);
+    copy_to_fpga_buffer(server_conn,
+                        path,
+                        payload + payload_offset,
+                        h2t_buff,
+                        server_conn->buff->h2t_rx_buff,
+                        server_conn->buff->h2t_rx_buff_sz,
+                        bytes_to_transfer);
+    capture_h2t_packet_begin(CAPTURE_STREAM_H2T, &part);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload + payload_offset, bytes_to_transfer);
     }
+    capture_packet_end();
+    RETURN_CODE has_error = path_h2t_data_received(server_conn, path, &part, h2t_buff);
+    trace_h2t_event(TRACE_EVENT_DESCRIPTOR_PUSHED, TRACE_STREAM_H2T, &part);
+    *pushed = end_h2t_part(server_conn, header, payload_offset, bytes_to_transfer);
+    return has_error;
 }
 
-void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
+// Pushes a MGMT packet held in host memory to the HW once the MGMT memory has room for it.
+// '*pushed' is set once it is; until then the packet must be kept and offered again.
+SERVER_PATH_INLINE RETURN_CODE push_mgmt_packet_on(SERVER_CONN* server_conn,
+                                                   const SERVER_PATH path,
+                                                   const MGMT_PACKET_HEADER* header,
+                                                   const unsigned char* payload,
+                                                   char* pushed)
 {
-    fd_set read_fds;
-    fd_set write_fds;
-    fd_set except_fds;
-    enum
+    *pushed = 0;
+    if (!server_conn->mgmt_waiting)
     {
-        NUM_FDS = 6
-    };
-    SOCKET all_fds[NUM_FDS];
-    all_fds[0] = server_conn->server_fd;
+        trace_mgmt_event(TRACE_EVENT_HEADER_RECEIVED, TRACE_STREAM_MGMT, header);
+    }
+
+    uint32_t mgmt_buff = path_get_mgmt_buffer(server_conn, path, header->DATA_LEN_BYTES);
+    if (mgmt_buff == 0)
+    {
+        wait_for_mgmt_buffer_on(server_conn, path, header);
+        return OK;
+    }
+
+    begin_mgmt_packet(server_conn, header);
+    copy_to_fpga_buffer(server_conn,
+                        path,
+                        payload,
+                        mgmt_buff,
+                        server_conn->buff->mgmt_rx_buff,
+                        server_conn->buff->mgmt_rx_buff_sz,
+                        header->DATA_LEN_BYTES);
+    capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    MGMT_PACKET_HEADER pushed_header = *header;
+    RETURN_CODE has_error =
+        path_mgmt_data_received(server_conn, path, &pushed_header, mgmt_buff);
+    end_mgmt_packet(server_conn, header);
+    *pushed = 1;
+    return has_error;
+}
+
+// Takes the next T2H packet from the HW into 'header' and '*t2h_buff', a DATA_LEN_BYTES of 0 if
+// there is none. '*observed' is set to when it was taken.
+SERVER_PATH_INLINE RETURN_CODE acquire_t2h_packet_on(SERVER_CONN* server_conn,
+                                                     const SERVER_PATH path,
+                                                     H2T_PACKET_HEADER* header,
+                                                     uint32_t* t2h_buff,
+                                                     uint64_t* observed)
+{
+    const uint64_t poll_start = get_timestamp_ticks();
+    if (path_acquire_t2h_data(server_conn, path, header, t2h_buff) != 0)
+    {
+        return FAILURE;
+    }
+    *observed = get_timestamp_ticks();
+    if (header->DATA_LEN_BYTES == 0)
+    {
+        stall_add(&(server_conn->stall_stats), STALL_T2H_EMPTY_POLL, *observed - poll_start);
+        return OK;
+    }
+    trace_h2t_event(TRACE_EVENT_FETCHED, TRACE_STREAM_T2H, header);
+    server_conn->pkt_stats.t2h_cnt++;
+    server_conn->pkt_stats.t2h_bytes += header->DATA_LEN_BYTES;
+    channel_stats_record(
+        &(server_conn->channel_stats), CHANNEL_T2H, header->CHANNEL, header->DATA_LEN_BYTES);
+    return OK;
+}
+
+// Hands the T2H packet taken at 'observed', now delivered to the client, back to the HW
+SERVER_PATH_INLINE void complete_t2h_packet_on(SERVER_CONN* server_conn,
+                                               const SERVER_PATH path,
+                                               const H2T_PACKET_HEADER* header,
+                                               uint64_t observed)
+{
+    latency_record(&(server_conn->latency_stats.histograms[LATENCY_T2H]),
+                   get_timestamp_ticks() - observed);
+    trace_h2t_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_T2H, header);
+    path_t2h_data_complete(server_conn, path);
+    trace_h2t_event(TRACE_EVENT_COMPLETION, TRACE_STREAM_T2H, header);
+}
+
+// Takes the next MGMT RSP packet from the HW, as acquire_t2h_packet_on() does for T2H
+SERVER_PATH_INLINE RETURN_CODE acquire_mgmt_rsp_packet_on(SERVER_CONN* server_conn,
+                                                          const SERVER_PATH path,
+                                                          MGMT_PACKET_HEADER* header,
+                                                          uint32_t* mgmt_rsp_buff,
+                                                          uint64_t* observed)
+{
+    if (path_acquire_mgmt_rsp_data(server_conn, path, header, mgmt_rsp_buff) != 0)
+    {
+        return FAILURE;
+    }
+    *observed = get_timestamp_ticks();
+    if (header->DATA_LEN_BYTES == 0)
+    {
+        return OK;
+    }
+    trace_mgmt_event(TRACE_EVENT_FETCHED, TRACE_STREAM_MGMT_RSP, header);
+    server_conn->pkt_stats.mgmt_rsp_cnt++;
+    server_conn->pkt_stats.mgmt_rsp_bytes += header->DATA_LEN_BYTES;
+    return OK;
+}
+
+// Hands the MGMT RSP packet taken at 'observed', now delivered to the client, back to the HW
+SERVER_PATH_INLINE void complete_mgmt_rsp_packet_on(SERVER_CONN* server_conn,
+                                                    const SERVER_PATH path,
+                                                    const MGMT_PACKET_HEADER* header,
+                                                    uint64_t observed)
+{
+    end_mgmt_rsp_packet(server_conn, header, observed);
+    path_mgmt_rsp_data_complete(server_conn, path);
+    trace_mgmt_event(TRACE_EVENT_COMPLETION, TRACE_STREAM_MGMT_RSP, header);
+}
+
+// Pushes the oldest record of the H2T ring to the HW. The record stays in the ring until its last
+// part is pushed.
+SERVER_PATH_INLINE RETURN_CODE process_h2t_ring_data_on(SERVER_CONN* server_conn,
+                                                        const SERVER_PATH path)
+{
+    SHM_RINGS_LAYOUT* layout = server_conn->shm_rings->layout;
+    SHM_RING_RECORD_HEADER record;
+    const unsigned char* payload;
+    RETURN_CODE has_error = peek_shm_ring_record(layout, SHM_RING_H2T, &record, &payload);
+    if (payload == NULL)
+    {
+        return has_error;
+    }
+
+    H2T_PACKET_HEADER header;
+    memcpy(&header, &record, SIZEOF_H2T_PACKET_HEADER);
+    char pushed;
+    has_error = push_h2t_packet_on(server_conn, path, &header, payload, &pushed);
+    if (pushed)
+    {
+        shm_ring_release(layout, SHM_RING_H2T, &record);
+    }
+    return has_error;
+}
+
+// Pushes the oldest record of the MGMT ring to the HW once the MGMT memory has room for it
+SERVER_PATH_INLINE RETURN_CODE process_mgmt_ring_data_on(SERVER_CONN* server_conn,
+                                                         const SERVER_PATH path)
+{
+    SHM_RINGS_LAYOUT* layout = server_conn->shm_rings->layout;
+    SHM_RING_RECORD_HEADER record;
+    const unsigned char* payload;
+    RETURN_CODE has_error = peek_shm_ring_record(layout, SHM_RING_MGMT, &record, &payload);
+    if (payload == NULL)
+    {
+        return has_error;
+    }
+
+    MGMT_PACKET_HEADER header;
+    memcpy(&header, &record, SIZEOF_MGMT_PACKET_HEADER);
+    char pushed;
+    has_error = push_mgmt_packet_on(server_conn, path, &header, payload, &pushed);
+    if (pushed)
+    {
+        shm_ring_release(layout, SHM_RING_MGMT, &record);
+    }
+    return has_error;
+}
+
+// Moves the next T2H packet from the HW to the T2H ring. Acquiring a packet takes it from the HW,
+// so nothing is acquired unless the ring has room for a packet of any size.
+SERVER_PATH_INLINE RETURN_CODE process_t2h_ring_data_on(SERVER_CONN* server_conn,
+                                                        const SERVER_PATH path)
+{
+    SHM_RINGS* rings = server_conn->shm_rings;
+    if (!shm_ring_has_room(rings->layout, SHM_RING_T2H, UINT16_MAX))
+    {
+        // The client is not draining T2H data fast enough
+        stall_begin(&(server_conn->stall_stats), STALL_T2H_SEND_BLOCKED);
+        return OK;
+    }
+    stall_end(&(server_conn->stall_stats), STALL_T2H_SEND_BLOCKED);
+
+    H2T_PACKET_HEADER* header =
+        (H2T_PACKET_HEADER*) (server_conn->buff->t2h_header_buff + SIZEOF_PACKET_GUARDBAND);
+    uint32_t t2h_buff;
+    uint64_t t2h_observed;
+    RETURN_CODE has_error =
+        acquire_t2h_packet_on(server_conn, path, header, &t2h_buff, &t2h_observed);
+    if ((has_error != OK) || (header->DATA_LEN_BYTES == 0))
+    {
+        return has_error;
+    }
+
+    SHM_RING_RECORD_HEADER* record =
+        shm_ring_reserve(rings->layout, SHM_RING_T2H, header->DATA_LEN_BYTES);
+    unsigned char* payload = (unsigned char*) (record + 1);
+    copy_from_fpga_buffer(server_conn,
+                          path,
+                          t2h_buff,
+                          server_conn->buff->t2h_tx_buff,
+                          server_conn->buff->t2h_tx_buff_sz,
+                          payload,
+                          header->DATA_LEN_BYTES);
+    memset(record, 0, sizeof(*record));
+    memcpy(record, header, SIZEOF_H2T_PACKET_HEADER);
+    capture_h2t_packet_begin(CAPTURE_STREAM_T2H, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    rings->wake_client |= (char) shm_ring_commit(rings->layout, SHM_RING_T2H, record);
+    complete_t2h_packet_on(server_conn, path, header, t2h_observed);
+    return OK;
+}
+
+// Moves the next MGMT RSP packet from the HW to the MGMT RSP ring, as process_t2h_ring_data_on()
+// does for T2H
+SERVER_PATH_INLINE RETURN_CODE process_mgmt_rsp_ring_data_on(SERVER_CONN* server_conn,
+                                                             const SERVER_PATH path)
+{
+    SHM_RINGS* rings = server_conn->shm_rings;
+    if (!server_conn->has_mgmt_pkt_sent ||
+        !shm_ring_has_room(rings->layout, SHM_RING_MGMT_RSP, UINT16_MAX))
+    {
+        return OK;
+    }
+
+    MGMT_PACKET_HEADER* header =
+        (MGMT_PACKET_HEADER*) (server_conn->buff->mgmt_rsp_header_buff + SIZEOF_PACKET_GUARDBAND);
+    uint32_t mgmt_rsp_buff;
+    uint64_t mgmt_rsp_observed;
+    RETURN_CODE has_error = acquire_mgmt_rsp_packet_on(
+        server_conn, path, header, &mgmt_rsp_buff, &mgmt_rsp_observed);
+    if ((has_error != OK) || (header->DATA_LEN_BYTES == 0))
+    {
+        return has_error;
+    }
+
+    SHM_RING_RECORD_HEADER* record =
+        shm_ring_reserve(rings->layout, SHM_RING_MGMT_RSP, header->DATA_LEN_BYTES);
+    unsigned char* payload = (unsigned char*) (record + 1);
+    copy_from_fpga_buffer(server_conn,
+                          path,
+                          mgmt_rsp_buff,
+                          server_conn->buff->mgmt_rsp_tx_buff,
+                          server_conn->buff->mgmt_rsp_tx_buff_sz,
+                          payload,
+                          header->DATA_LEN_BYTES);
+    memset(record, 0, sizeof(*record));
+    memcpy(record, header, SIZEOF_MGMT_PACKET_HEADER);
+    capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT_RSP, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    rings->wake_client |= (char) shm_ring_commit(rings->layout, SHM_RING_MGMT_RSP, record);
+    complete_mgmt_rsp_packet_on(server_conn, path, header, mgmt_rsp_observed);
+    return OK;
+}
+
+// Takes the MGMT and H2T records of one pass of the server loop from the rings, H2T records up to
+// H2T_BURST_MAX_PACKETS
+SERVER_PATH_INLINE RETURN_CODE process_shm_ring_ingress_on(SERVER_CONN* server_conn,
+                                                           const SERVER_PATH path)
+{
+    RETURN_CODE result = process_mgmt_ring_data_on(server_conn, path);
+    int packets = 0;
+    while ((result != FAILURE) && (packets++ < H2T_BURST_MAX_PACKETS) &&
+           (shm_ring_peek(server_conn->shm_rings->layout, SHM_RING_H2T) != NULL))
+    {
+        result = process_h2t_ring_data_on(server_conn, path);
+        if (server_conn->h2t_waiting)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+static RETURN_CODE process_shm_ring_ingress(SERVER_CONN* server_conn)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_shm_ring_ingress_on(server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_shm_ring_ingress_on(server_conn, SERVER_PATH_GENERIC);
+}
+
+SERVER_PATH_INLINE RETURN_CODE process_shm_ring_egress_on(SERVER_CONN* server_conn,
+                                                          const SERVER_PATH path)
+{
+    RETURN_CODE result = OK;
+    if (server_conn->hw_callbacks.acquire_mgmt_rsp_data != NULL)
+    {
+        result = process_mgmt_rsp_ring_data_on(server_conn, path);
+    }
+    if ((result != FAILURE) && (server_conn->hw_callbacks.acquire_t2h_data != NULL))
+    {
+        result = process_t2h_ring_data_on(server_conn, path);
+    }
+    ring_shm_rings_client_doorbell(server_conn->shm_rings);
+    return result;
+}
+
+static RETURN_CODE process_shm_ring_egress(SERVER_CONN* server_conn)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_shm_ring_egress_on(server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_shm_ring_egress_on(server_conn, SERVER_PATH_GENERIC);
+}
+
+// Receives the next frame of a multiplexed session into mux_rx_buff. Fails unless the frame holds
+// a whole command or packet of a stream the client sends.
+static RETURN_CODE recv_mux_frame(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    unsigned char* frame = server_conn->buff->mux_rx_buff + MUX_FRAME_OFFSET;
+    unsigned char* body = frame + MUX_FRAME_HEADER_SZ;
+    ssize_t bytes_recvd;
+    if (socket_recv_accumulate(
+            client_conn->ctrl_fd, (char*) frame, MUX_FRAME_HEADER_SZ, 0, &bytes_recvd) != OK)
+    {
+        print_last_socket_error_b("Failed to recv frame header", bytes_recvd);
+        return FAILURE;
+    }
+    const MUX_STREAM stream = mux_frame_header_stream(frame);
+    const uint32_t len = mux_frame_header_len(frame);
+    if (len > MUX_MAX_BODY_LEN)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Frame of %u bytes on stream %d is too long\n",
+                        (unsigned int) len,
+                        (int) stream);
+        return FAILURE;
+    }
+    if (socket_recv_accumulate(client_conn->ctrl_fd, (char*) body, len, 0, &bytes_recvd) != OK)
+    {
+        print_last_socket_error_b("Failed to recv frame", bytes_recvd);
+        return FAILURE;
+    }
+
+    size_t expected_len = 0;  // T2H and MGMT RSP only flow to the client
+    if (stream == MUX_STREAM_CTRL)
+    {
+        const char terminated = (len != 0) && (body[len - 1] == '\0');
+        expected_len = (terminated && (len <= server_conn->buff->ctrl_rx_buff_sz)) ? len : 0;
+    }
+    else if ((stream == MUX_STREAM_H2T) && (len >= SIZEOF_H2T_PACKET_HEADER))
+    {
+        expected_len = SIZEOF_H2T_PACKET_HEADER + ((H2T_PACKET_HEADER*) body)->DATA_LEN_BYTES;
+    }
+    else if ((stream == MUX_STREAM_MGMT) && (len >= SIZEOF_MGMT_PACKET_HEADER))
+    {
+        expected_len = SIZEOF_MGMT_PACKET_HEADER + ((MGMT_PACKET_HEADER*) body)->DATA_LEN_BYTES;
+    }
+    if ((expected_len == 0) || (expected_len != len))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Malformed frame of %u bytes on stream %d\n",
+                        (unsigned int) len,
+                        (int) stream);
+        return FAILURE;
+    }
+    server_conn->mux_rx_pending = 1;
+    return OK;
+}
+
+// Server loopback on a multiplexed session: echoes the H2T or MGMT frame in mux_rx_buff as a T2H or
+// MGMT RSP frame, without touching the H2T, T2H, MGMT or MGMT RSP memory
+static RETURN_CODE loopback_mux_frame(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    unsigned char* frame = server_conn->buff->mux_rx_buff + MUX_FRAME_OFFSET;
+    const uint32_t len = mux_frame_header_len(frame);
+    const unsigned char* payload = frame + MUX_FRAME_HEADER_SZ + SIZEOF_H2T_PACKET_HEADER;
+    ssize_t bytes_sent;
+    RETURN_CODE has_error;
+
+    if (mux_frame_header_stream(frame) == MUX_STREAM_H2T)
+    {
+        const H2T_PACKET_HEADER* header = (H2T_PACKET_HEADER*) (frame + MUX_FRAME_HEADER_SZ);
+        trace_h2t_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_H2T, header);
+        server_conn->pkt_stats.h2t_cnt++;
+        server_conn->pkt_stats.h2t_bytes += header->DATA_LEN_BYTES;
+        channel_stats_record(
+            &(server_conn->channel_stats), CHANNEL_H2T, header->CHANNEL, header->DATA_LEN_BYTES);
+        capture_h2t_packet_begin(CAPTURE_STREAM_H2T, header);
+        if (is_capture_enabled())
+        {
+            capture_packet_data(payload, header->DATA_LEN_BYTES);
+        }
+        capture_packet_end();
+        capture_h2t_packet_begin(CAPTURE_STREAM_T2H, header);
+        if (is_capture_enabled())
+        {
+            capture_packet_data(payload, header->DATA_LEN_BYTES);
+        }
+        capture_packet_end();
+        mux_frame_header_pack(frame, MUX_STREAM_T2H, len);
+        if ((has_error = socket_send_all(client_conn->ctrl_fd,
+                                         (const char*) frame,
+                                         MUX_FRAME_HEADER_SZ + len,
+                                         0,
+                                         &bytes_sent)) == OK)
+        {
+            trace_h2t_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_T2H, header);
+        }
+    }
+    else
+    {
+        const MGMT_PACKET_HEADER* header = (MGMT_PACKET_HEADER*) (frame + MUX_FRAME_HEADER_SZ);
+        trace_mgmt_event(TRACE_EVENT_BUFFER_GRANTED, TRACE_STREAM_MGMT, header);
+        server_conn->pkt_stats.mgmt_cnt++;
+        server_conn->pkt_stats.mgmt_bytes += header->DATA_LEN_BYTES;
+        capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT, header);
+        if (is_capture_enabled())
+        {
+            capture_packet_data(payload, header->DATA_LEN_BYTES);
+        }
+        capture_packet_end();
+        capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT_RSP, header);
+        if (is_capture_enabled())
+        {
+            capture_packet_data(payload, header->DATA_LEN_BYTES);
+        }
+        capture_packet_end();
+        mux_frame_header_pack(frame, MUX_STREAM_MGMT_RSP, len);
+        if ((has_error = socket_send_all(client_conn->ctrl_fd,
+                                         (const char*) frame,
+                                         MUX_FRAME_HEADER_SZ + len,
+                                         0,
+                                         &bytes_sent)) == OK)
+        {
+            trace_mgmt_event(TRACE_EVENT_SEND_DONE, TRACE_STREAM_MGMT_RSP, header);
+        }
+    }
+    if (has_error != OK)
+    {
+        print_last_socket_error_b("Failed to send loopback frame", bytes_sent);
+    }
+    return has_error;
+}
+
+// Hands the frame in mux_rx_buff to its stream. An H2T or MGMT frame stays pending until the last
+// of its packet is pushed to the HW.
+SERVER_PATH_INLINE RETURN_CODE process_mux_frame_on(CLIENT_CONN* client_conn,
+                                                    SERVER_CONN* server_conn,
+                                                    const SERVER_PATH path,
+                                                    char* disconnect_client)
+{
+    const unsigned char* frame = server_conn->buff->mux_rx_buff + MUX_FRAME_OFFSET;
+    const unsigned char* body = frame + MUX_FRAME_HEADER_SZ;
+    const MUX_STREAM stream = mux_frame_header_stream(frame);
+    RETURN_CODE result;
+    char pushed = 1;
+    if (stream == MUX_STREAM_CTRL)
+    {
+        // Commands see the IP with the packets pushed so far flushed, as on the control socket
+        if (server_conn->hw_callbacks.end_write_batch != NULL)
+        {
+            server_conn->hw_callbacks.end_write_batch();
+        }
+        const uint64_t ctrl_start = get_timestamp_ticks();
+        memcpy(server_conn->buff->ctrl_rx_buff, body, mux_frame_header_len(frame));
+        result = handle_control_message(client_conn, server_conn, disconnect_client);
+        stall_add(&(server_conn->stall_stats), STALL_CONTROL, get_timestamp_ticks() - ctrl_start);
+        if (server_conn->hw_callbacks.begin_write_batch != NULL)
+        {
+            server_conn->hw_callbacks.begin_write_batch();
+        }
+    }
+    else if (path_loopback_mode(server_conn, path) != 0)
+    {
+        result = loopback_mux_frame(client_conn, server_conn);
+    }
+    else if (stream == MUX_STREAM_H2T)
+    {
+        result = push_h2t_packet_on(server_conn,
+                                    path,
+                                    (const H2T_PACKET_HEADER*) body,
+                                    body + SIZEOF_H2T_PACKET_HEADER,
+                                    &pushed);
+    }
+    else
+    {
+        result = push_mgmt_packet_on(server_conn,
+                                     path,
+                                     (const MGMT_PACKET_HEADER*) body,
+                                     body + SIZEOF_MGMT_PACKET_HEADER,
+                                     &pushed);
+    }
+    server_conn->mux_rx_pending = !pushed;
+    return result;
+}
+
+// Takes the frames of one pass of the server loop, up to H2T_BURST_MAX_PACKETS of them. Frames are
+// handled in order, so a packet waiting for room in the HW memory holds back the frames behind it.
+// A new frame is read if the select() of the pass found the socket readable, or once the socket has
+// buffered it.
+SERVER_PATH_INLINE RETURN_CODE process_mux_ingress_on(CLIENT_CONN* client_conn,
+                                                      SERVER_CONN* server_conn,
+                                                      const SERVER_PATH path,
+                                                      char readable,
+                                                      char* disconnect_client)
+{
+    RETURN_CODE result = OK;
+    int frames = 0;
+    while ((result == OK) && (frames++ < H2T_BURST_MAX_PACKETS) && !*disconnect_client)
+    {
+        if (!server_conn->mux_rx_pending)
+        {
+            if (!readable && (wait_for_read_event(client_conn->ctrl_fd, 0, 0) <= 0))
+            {
+                break;
+            }
+            readable = 0;
+            if ((result = recv_mux_frame(client_conn, server_conn)) != OK)
+            {
+                break;
+            }
+        }
+        const char is_ctrl =
+            mux_frame_header_stream(server_conn->buff->mux_rx_buff + MUX_FRAME_OFFSET) ==
+            MUX_STREAM_CTRL;
+        result = process_mux_frame_on(client_conn, server_conn, path, disconnect_client);
+        // A command can switch the server path, the frames after it wait for the next pass
+        if (server_conn->mux_rx_pending || is_ctrl)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+static RETURN_CODE process_mux_ingress(CLIENT_CONN* client_conn,
+                                       SERVER_CONN* server_conn,
+                                       char readable,
+                                       char* disconnect_client)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_mux_ingress_on(
+                     client_conn, server_conn, SERVER_PATH_ST_DBG_IP, readable, disconnect_client)
+               : process_mux_ingress_on(
+                     client_conn, server_conn, SERVER_PATH_GENERIC, readable, disconnect_client);
+}
+
+// Sends the next T2H packet from the HW to the client as a T2H frame. The packet header is acquired
+// straight into the frame.
+SERVER_PATH_INLINE RETURN_CODE process_t2h_mux_data_on(CLIENT_CONN* client_conn,
+                                                       SERVER_CONN* server_conn,
+                                                       const SERVER_PATH path)
+{
+    unsigned char* frame = server_conn->buff->mux_tx_buff + MUX_FRAME_OFFSET;
+    H2T_PACKET_HEADER* header = (H2T_PACKET_HEADER*) (frame + MUX_FRAME_HEADER_SZ);
+    uint32_t t2h_buff;
+    uint64_t t2h_observed;
+    RETURN_CODE has_error =
+        acquire_t2h_packet_on(server_conn, path, header, &t2h_buff, &t2h_observed);
+    if ((has_error != OK) || (header->DATA_LEN_BYTES == 0))
+    {
+        return has_error;
+    }
+
+    unsigned char* payload = (unsigned char*) header + SIZEOF_H2T_PACKET_HEADER;
+    copy_from_fpga_buffer(server_conn,
+                          path,
+                          t2h_buff,
+                          server_conn->buff->t2h_tx_buff,
+                          server_conn->buff->t2h_tx_buff_sz,
+                          payload,
+                          header->DATA_LEN_BYTES);
+    capture_h2t_packet_begin(CAPTURE_STREAM_T2H, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    const uint32_t len = SIZEOF_H2T_PACKET_HEADER + header->DATA_LEN_BYTES;
+    mux_frame_header_pack(frame, MUX_STREAM_T2H, len);
+    ssize_t bytes_sent;
+    if ((has_error = socket_send_all(client_conn->ctrl_fd,
+                                     (const char*) frame,
+                                     MUX_FRAME_HEADER_SZ + len,
+                                     0,
+                                     &bytes_sent)) != OK)
+    {
+        print_last_socket_error_b("An error occurred sending T2H data", bytes_sent);
+        return has_error;
+    }
+    complete_t2h_packet_on(server_conn, path, header, t2h_observed);
+    return OK;
+}
+
+// Sends the next MGMT RSP packet from the HW to the client, as process_t2h_mux_data_on() does for
+// T2H
+SERVER_PATH_INLINE RETURN_CODE process_mgmt_rsp_mux_data_on(CLIENT_CONN* client_conn,
+                                                            SERVER_CONN* server_conn,
+                                                            const SERVER_PATH path)
+{
+    if (!server_conn->has_mgmt_pkt_sent)
+    {
+        return OK;
+    }
+    unsigned char* frame = server_conn->buff->mux_tx_buff + MUX_FRAME_OFFSET;
+    MGMT_PACKET_HEADER* header = (MGMT_PACKET_HEADER*) (frame + MUX_FRAME_HEADER_SZ);
+    uint32_t mgmt_rsp_buff;
+    uint64_t mgmt_rsp_observed;
+    RETURN_CODE has_error = acquire_mgmt_rsp_packet_on(
+        server_conn, path, header, &mgmt_rsp_buff, &mgmt_rsp_observed);
+    if ((has_error != OK) || (header->DATA_LEN_BYTES == 0))
+    {
+        return has_error;
+    }
+
+    unsigned char* payload = (unsigned char*) header + SIZEOF_MGMT_PACKET_HEADER;
+    copy_from_fpga_buffer(server_conn,
+                          path,
+                          mgmt_rsp_buff,
+                          server_conn->buff->mgmt_rsp_tx_buff,
+                          server_conn->buff->mgmt_rsp_tx_buff_sz,
+                          payload,
+                          header->DATA_LEN_BYTES);
+    capture_mgmt_packet_begin(CAPTURE_STREAM_MGMT_RSP, header);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(payload, header->DATA_LEN_BYTES);
+    }
+    capture_packet_end();
+    const uint32_t len = SIZEOF_MGMT_PACKET_HEADER + header->DATA_LEN_BYTES;
+    mux_frame_header_pack(frame, MUX_STREAM_MGMT_RSP, len);
+    ssize_t bytes_sent;
+    if ((has_error = socket_send_all(client_conn->ctrl_fd,
+                                     (const char*) frame,
+                                     MUX_FRAME_HEADER_SZ + len,
+                                     0,
+                                     &bytes_sent)) != OK)
+    {
+        print_last_socket_error_b("An error occurred sending MGMT RSP data", bytes_sent);
+        return has_error;
+    }
+    complete_mgmt_rsp_packet_on(server_conn, path, header, mgmt_rsp_observed);
+    return OK;
+}
+
+SERVER_PATH_INLINE RETURN_CODE process_mux_egress_on(CLIENT_CONN* client_conn,
+                                                     SERVER_CONN* server_conn,
+                                                     const SERVER_PATH path)
+{
+    RETURN_CODE result = OK;
+    if (server_conn->hw_callbacks.acquire_mgmt_rsp_data != NULL)
+    {
+        result = process_mgmt_rsp_mux_data_on(client_conn, server_conn, path);
+    }
+    if ((result != FAILURE) && (server_conn->hw_callbacks.acquire_t2h_data != NULL))
+    {
+        result = process_t2h_mux_data_on(client_conn, server_conn, path);
+    }
+    return result;
+}
+
+static RETURN_CODE process_mux_egress(CLIENT_CONN* client_conn, SERVER_CONN* server_conn)
+{
+    return (server_conn->path == SERVER_PATH_ST_DBG_IP)
+               ? process_mux_egress_on(client_conn, server_conn, SERVER_PATH_ST_DBG_IP)
+               : process_mux_egress_on(client_conn, server_conn, SERVER_PATH_GENERIC);
+}
+
+void reject_client(SERVER_CONN* server_conn)
+{
+    SOCKET sock_fd = INVALID_SOCKET;
+    if ((sock_fd = accept_client_socket(server_conn)) == INVALID_SOCKET)
+    {
+        print_last_socket_error("Failed to accept additional client");
+    }
+    else
+    {
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_WINDOWS
+        int flags = 0;
+#else
+        int flags = MSG_DONTWAIT | SEND_NO_SIGNAL;
+#endif
+        size_t reject_msg_len = 12;
+        if (send(sock_fd, REJECT_MSG, reject_msg_len, flags) < 0)
+        {
+            print_last_socket_error("Failed to send rejection message to additional client");
+        }
+
+        fpga_msg_printf(FPGA_MSG_PRINTF_WARNING,
+                        "Rejected one connection request because only one connection has already "
+                        "been established.");
+
+        // Prevent TIME_WAIT
+        set_linger_socket_option(sock_fd, 1, 0);
+        close_socket_fd(sock_fd);
+    }
+}
+
+// Takes the incoming MGMT and H2T data of one pass of the server loop. H2T packets the socket has
+// already buffered are taken as well, up to H2T_BURST_MAX_PACKETS, so that the MMIO writes of all
+// of them go out as one burst rather than between socket calls. With shared memory rings attached
+// the data comes from the rings instead, and on a multiplexed session from the frames on the
+// control socket.
+static RETURN_CODE process_ingress_data(CLIENT_CONN* client_conn,
+                                        SERVER_CONN* server_conn,
+                                        fd_set* read_fds,
+                                        char* disconnect_client)
+{
+    RETURN_CODE result = OK;
+    if (server_conn->hw_callbacks.begin_write_batch != NULL)
+    {
+        server_conn->hw_callbacks.begin_write_batch();
+    }
+
+    if (server_conn->shm_rings != NULL)
+    {
+        if (FD_ISSET(server_conn->shm_rings->server_doorbell, read_fds))
+        {
+            drain_shm_rings_doorbell(server_conn->shm_rings);
+        }
+        result = process_shm_ring_ingress(server_conn);
+    }
+    else if (server_conn->mux)
+    {
+        result = process_mux_ingress(client_conn,
+                                     server_conn,
+                                     FD_ISSET(client_conn->ctrl_fd, read_fds) != 0,
+                                     disconnect_client);
+    }
+    else
+    {
+        if (FD_ISSET(client_conn->mgmt_fd, read_fds))
+        {
+            result = process_mgmt_data(client_conn, server_conn);
+        }
+
+        // Lastly handle incoming H2T data
+        if ((result != FAILURE) && FD_ISSET(client_conn->h2t_data_fd, read_fds))
+        {
+            int packets = 0;
+            do
+            {
+                result = process_h2t_data(client_conn, server_conn);
+            } while ((result != FAILURE) && (++packets < H2T_BURST_MAX_PACKETS) &&
+                     !server_conn->h2t_waiting &&
+                     (wait_for_read_event(client_conn->h2t_data_fd, 0, 0) > 0));
+        }
+    }
+    if (result != FAILURE)
+    {
+        result = flush_due_h2t_data(server_conn);
+    }
+
+    if (server_conn->hw_callbacks.end_write_batch != NULL)
+    {
+        server_conn->hw_callbacks.end_write_batch();
+    }
+    return result;
+}
+
+void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
+{
+    fd_set read_fds;
+    fd_set write_fds;
+    fd_set except_fds;
+    enum
+    {
+        NUM_FDS = 6
+    };
+    SOCKET all_fds[NUM_FDS];
+    all_fds[0] = server_conn->server_fd;
     all_fds[1] = client_conn->ctrl_fd;
     all_fds[2] = client_conn->mgmt_fd;
     all_fds[3] = client_conn->mgmt_rsp_fd;
@@ -1218,47 +3062,77 @@ void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
 
     SOCKET max_fd = max_of(all_fds, NUM_FDS) + 1;
 
-    while (1)
+    select_server_path(server_conn);
+    while (s_server_termination_requested == 0)
     {
         FD_ZERO(&read_fds);
         FD_ZERO(&write_fds);
         FD_ZERO(&except_fds);
 
-        // H2T, MGMT, and server listening socket are read-only
-        FD_SET(client_conn->h2t_data_fd, &read_fds);
-        FD_SET(client_conn->mgmt_fd, &read_fds);
+        // H2T, MGMT, and server listening socket are read-only. The shared memory rings replace
+        // the H2T and MGMT sockets, the client rings the doorbell after writing to them.
+        SOCKET select_max_fd = max_fd;
+        if (server_conn->shm_rings != NULL)
+        {
+            FD_SET(server_conn->shm_rings->server_doorbell, &read_fds);
+            if (server_conn->shm_rings->server_doorbell >= select_max_fd)
+            {
+                select_max_fd = server_conn->shm_rings->server_doorbell + 1;
+            }
+        }
+        else if (!server_conn->mux)
+        {
+            FD_SET(client_conn->h2t_data_fd, &read_fds);
+            FD_SET(client_conn->mgmt_fd, &read_fds);
+        }
         FD_SET(server_conn->server_fd, &read_fds);
 
-        // T2H & MGMT_RSP are write-only
-        FD_SET(client_conn->t2h_data_fd, &write_fds);
-        FD_SET(client_conn->mgmt_rsp_fd, &write_fds);
+        // T2H & MGMT_RSP are write-only, a multiplexed session has only the control socket
+        if (!server_conn->mux)
+        {
+            FD_SET(client_conn->t2h_data_fd, &write_fds);
+            FD_SET(client_conn->mgmt_rsp_fd, &write_fds);
+        }
 
         // Ctrl is R/W
         FD_SET(client_conn->ctrl_fd, &read_fds);
         FD_SET(client_conn->ctrl_fd, &write_fds);
 
         // Any socket can have an exception
-        FD_SET(client_conn->ctrl_fd, &except_fds);
-        FD_SET(client_conn->mgmt_fd, &except_fds);
-        FD_SET(client_conn->mgmt_rsp_fd, &except_fds);
-        FD_SET(client_conn->h2t_data_fd, &except_fds);
-        FD_SET(client_conn->t2h_data_fd, &except_fds);
+        int i;
+        for (i = 1; i < NUM_FDS; ++i)
+        {
+            if (all_fds[i] != INVALID_SOCKET)
+            {
+                FD_SET(all_fds[i], &except_fds);
+            }
+        }
 
+        // Wake up in time to push a held H2T run
+        const char h2t_held = h2t_coalescer_held(&(server_conn->h2t_coalescer)) != 0;
         struct timeval to;
-        to.tv_sec = 1;
-        to.tv_usec = 0;
-        if (select((int) max_fd, &read_fds, &write_fds, &except_fds, &to) < 0)
+        to.tv_sec = h2t_held ? 0 : 1;
+        to.tv_usec = h2t_held ? (long) server_conn->h2t_coalescer.window_us : 0;
+        if (select((int) select_max_fd, &read_fds, &write_fds, &except_fds, &to) < 0)
         {
+            if (get_last_socket_error() == EINTR)
+            {
+                continue;  // Interrupted by a signal, e.g. a listener hand-off request
+            }
             print_last_socket_error("Select failure");
             break;
         }
 
+        if (get_timestamp_ticks() >= server_conn->metrics_next_publish)
+        {
+            update_server_metrics(server_conn, 1);
+        }
+
         // First handle exceptional conditions
         char disconnect_client = 0;
-        int i;
         for (i = 0; i < NUM_FDS; ++i)
         {
-            if (FD_ISSET(all_fds[i], &except_fds))
+            if ((all_fds[i] != INVALID_SOCKET) && FD_ISSET(all_fds[i], &except_fds))
             {
                 fpga_msg_printf(
                     FPGA_MSG_PRINTF_ERROR, "Exception found on socket: %s\n", all_fd_names[i]);
@@ -1278,10 +3152,17 @@ void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
             reject_client(server_conn);
         }
 
-        // See if any incoming control messages are present
-        if (FD_ISSET(client_conn->ctrl_fd, &read_fds))
+        // See if any incoming control messages are present, a multiplexed session takes them in
+        // order with its packets
+        if (!server_conn->mux && FD_ISSET(client_conn->ctrl_fd, &read_fds))
         {
-            if (process_control_message(client_conn, server_conn, &disconnect_client) == FAILURE)
+            const uint64_t ctrl_start = get_timestamp_ticks();
+            RETURN_CODE ctrl_result =
+                process_control_message(client_conn, server_conn, &disconnect_client);
+            stall_add(&(server_conn->stall_stats),
+                      STALL_CONTROL,
+                      get_timestamp_ticks() - ctrl_start);
+            if (ctrl_result == FAILURE)
             {
                 break;
             }
@@ -1292,26 +3173,39 @@ void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
             }
         }
 
-        // See if any incoming management commands are present
-        if (FD_ISSET(client_conn->mgmt_fd, &read_fds))
+        // Incoming management commands and H2T data
+        if ((process_ingress_data(client_conn, server_conn, &read_fds, &disconnect_client) ==
+             FAILURE) ||
+            disconnect_client)
+        {
+            break;
+        }
+
+        // Outbound data goes to the shared memory rings whether or not the sockets are writable
+        if (server_conn->shm_rings != NULL)
         {
-            if (process_mgmt_data(client_conn, server_conn) == FAILURE)
+            if (process_shm_ring_egress(server_conn) == FAILURE)
             {
                 break;
             }
         }
-
-        // Lastly handle incoming H2T data
-        if (FD_ISSET(client_conn->h2t_data_fd, &read_fds))
+        else if ((server_conn->loopback_mode == 0) && server_conn->mux)
         {
-            if (process_h2t_data(client_conn, server_conn) == FAILURE)
+            if (FD_ISSET(client_conn->ctrl_fd, &write_fds))
             {
-                break;
+                stall_end(&(server_conn->stall_stats), STALL_T2H_SEND_BLOCKED);
+                if (process_mux_egress(client_conn, server_conn) == FAILURE)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                stall_begin(&(server_conn->stall_stats), STALL_T2H_SEND_BLOCKED);
             }
         }
-
         // See if any outbound management data is present, if so send it out
-        if (server_conn->loopback_mode == 0)
+        else if (server_conn->loopback_mode == 0)
         {
             if (FD_ISSET(client_conn->mgmt_rsp_fd, &write_fds))
             {
@@ -1327,6 +3221,7 @@ void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
             // See if any outbound t2h data is present, if so send it out
             if (FD_ISSET(client_conn->t2h_data_fd, &write_fds))
             {
+                stall_end(&(server_conn->stall_stats), STALL_T2H_SEND_BLOCKED);
                 if (server_conn->hw_callbacks.acquire_t2h_data != NULL)
                 {
                     if (process_t2h_data(client_conn, server_conn) == FAILURE)
@@ -1335,8 +3230,49 @@ void handle_client(SERVER_CONN* server_conn, CLIENT_CONN* client_conn)
                     }
                 }
             }
+            else
+            {
+                // The client is not draining T2H data fast enough
+                stall_begin(&(server_conn->stall_stats), STALL_T2H_SEND_BLOCKED);
+            }
+        }
+    }
+}
+
+// Reports the port the listening socket is bound to and writes out the port file.
+static void publish_server_port(SERVER_CONN* server_conn, const char* port_filename)
+{
+    if (server_conn->unix_listener)
+    {
+        // Clients find the server by its socket path, there is no port to publish
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Server socket is listening on a unix socket\n");
+        return;
+    }
+    int port_used = get_socket_local_port(server_conn->server_fd);
+    if (port_used < 0)
+    {
+        print_last_socket_error("getsockname failed");
+        port_used = ntohs(server_conn->server_addr.sin_port);
+    }
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Server socket is listening on port: %d\n", port_used);
+
+    // Write out the port used.  This is especially useful when an ephermal port is used.
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_WINDOWS || STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    if (port_filename != NULL)
+    {
+        FILE* port_fp = fopen(port_filename, "w");
+        if (port_fp != NULL)
+        {
+            fprintf(port_fp, "%d", port_used);
+            fclose(port_fp);
+        }
+        else
+        {
+            fpga_msg_printf(
+                FPGA_MSG_PRINTF_ERROR, "Failed to save out port file: %s\n", port_filename);
         }
     }
+#endif
 }
 
 RETURN_CODE initialize_server(unsigned short port,
@@ -1363,41 +3299,405 @@ RETURN_CODE initialize_server(unsigned short port,
         return FAILURE;
     }
 
-    // If a request to bind to any available port, take note of which port was assigned by the
-    // kernel
-    if (port == 0)
+    publish_server_port(server_conn, port_filename);
+
+    fflush(stdout);
+    return OK;
+}
+
+RETURN_CODE initialize_server_with_listener(SOCKET listen_fd,
+                                            SERVER_CONN* server_conn,
+                                            const char* port_filename)
+{
+    if (initialize_sockets_library() == FAILURE)
+    {
+        return FAILURE;
+    }
+
+    if (!is_listening_stream_socket(listen_fd))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "File descriptor %d is not a listening stream socket!\n",
+                        (int) listen_fd);
+        return FAILURE;
+    }
+
+    // Fill the guardband preamble just once
+    populate_guardband((unsigned char*) server_conn->buff->mgmt_rsp_header_buff);
+    populate_guardband((unsigned char*) server_conn->buff->t2h_header_buff);
+
+    // The socket is already bound and listening; keep it out of any unrelated child process.
+    set_close_on_exec(listen_fd, 1);
+    server_conn->server_fd = listen_fd;
+    server_conn->unix_listener = (char) is_unix_domain_socket(listen_fd);
+    fpga_msg_printf(
+        FPGA_MSG_PRINTF_INFO, "Using pre-bound listening socket, fd %d\n", (int) listen_fd);
+
+    publish_server_port(server_conn, port_filename);
+
+    fflush(stdout);
+    return OK;
+}
+
+RETURN_CODE initialize_server_on_unix_socket(const char* unix_path, SERVER_CONN* server_conn)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    const int MAX_LISTEN = 8;
+    struct sockaddr_un addr;
+    if (strlen(unix_path) >= sizeof(addr.sun_path))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Server socket path is too long: %s\n", unix_path);
+        return FAILURE;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, unix_path);
+
+    // Fill the guardband preamble just once
+    populate_guardband((unsigned char*) server_conn->buff->mgmt_rsp_header_buff);
+    populate_guardband((unsigned char*) server_conn->buff->t2h_header_buff);
+
+    if (remove_stale_unix_socket(unix_path) < 0)
+    {
+        print_last_socket_error("Failed to claim the unix socket path");
+        return FAILURE;
+    }
+    if ((server_conn->server_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == INVALID_SOCKET)
     {
-        if (getsockname(server_conn->server_fd,
-                        (struct sockaddr*) (&(server_conn->server_addr)),
-                        &sizeof_addr) < 0)
+        print_last_socket_error("Failed to create unix socket");
+        return FAILURE;
+    }
+    if ((bind(server_conn->server_fd, (const struct sockaddr*) &addr, sizeof(addr)) < 0) ||
+        (listen(server_conn->server_fd, MAX_LISTEN) < 0))
+    {
+        print_last_socket_error("Failed to bind unix socket");
+        close_socket_fd(server_conn->server_fd);
+        server_conn->server_fd = INVALID_SOCKET;
+        return FAILURE;
+    }
+    server_conn->unix_path = unix_path;
+    server_conn->unix_listener = 1;
+    fpga_msg_printf(
+        FPGA_MSG_PRINTF_INFO, "Server socket is listening on unix socket: %s\n", unix_path);
+
+    fflush(stdout);
+    return OK;
+#else
+    (void) server_conn;
+    fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                    "Unix sockets are not supported on this platform: %s\n",
+                    unix_path);
+    return FAILURE;
+#endif
+}
+
+SOCKET get_activated_listener_socket(int listen_fd)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    // sd_listen_fds() protocol: the sockets start at fd 3 and are only meant for the process
+    // named by LISTEN_PID.  The variables are consumed so that children do not pick them up.
+    const int SD_LISTEN_FDS_START = 3;
+    const char* listen_pid = getenv("LISTEN_PID");
+    const char* listen_fds = getenv("LISTEN_FDS");
+    if ((listen_pid != NULL) && (listen_fds != NULL))
+    {
+        long pid = strtol(listen_pid, NULL, 10);
+        long num_fds = strtol(listen_fds, NULL, 10);
+        unsetenv("LISTEN_PID");
+        unsetenv("LISTEN_FDS");
+        unsetenv("LISTEN_FDNAMES");
+        if ((pid == (long) getpid()) && (num_fds >= 1))
         {
-            print_last_socket_error("getsockname failed");
+            if (num_fds > 1)
+            {
+                fpga_msg_printf(FPGA_MSG_PRINTF_WARNING,
+                                "%ld sockets were passed in; only the first one is used.\n",
+                                num_fds);
+            }
+            const char* ready_fd = getenv(HANDOFF_READY_FD_ENV);
+            if (ready_fd != NULL)
+            {
+                s_handoff_ready_fd = (int) strtol(ready_fd, NULL, 10);
+                set_close_on_exec(s_handoff_ready_fd, 1);
+            }
+            unsetenv(HANDOFF_READY_FD_ENV);
+            return SD_LISTEN_FDS_START;
         }
     }
+    unsetenv(HANDOFF_READY_FD_ENV);
+#endif
+    return (listen_fd >= 0) ? (SOCKET) listen_fd : INVALID_SOCKET;
+}
 
-    unsigned short port_used = ntohs(server_conn->server_addr.sin_port);
-    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Server socket is listening on port: %d\n", port_used);
+void request_server_listener_handoff()
+{
+    s_listener_handoff_requested = 1;
+}
 
-    // Write out the port used.  This is especially useful when an ephermal port is used.
-#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_WINDOWS || STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
-    if (port_filename != NULL)
+void request_server_termination()
+{
+    s_server_termination_requested = 1;
+}
+
+RETURN_CODE set_server_exec_path(const char* argv0)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    // Resolved the way the shell found the binary: a path is made absolute, a bare name is looked
+    // up in PATH. /proc/self/exe is only the last resort since it names the running file, which an
+    // upgrade leaves deleted.
+    s_handoff_exec_path[0] = '\0';
+    if ((argv0 != NULL) && (strchr(argv0, '/') != NULL))
+    {
+        char cwd[PATH_MAX];
+        if (argv0[0] == '/')
+        {
+            snprintf(s_handoff_exec_path, sizeof(s_handoff_exec_path), "%s", argv0);
+        }
+        else if ((getcwd(cwd, sizeof(cwd)) != NULL) &&
+                 (strlen(cwd) + strlen(argv0) + 1 < sizeof(s_handoff_exec_path)))
+        {
+            strcpy(s_handoff_exec_path, cwd);
+            strcat(s_handoff_exec_path, "/");
+            strcat(s_handoff_exec_path, argv0);
+        }
+    }
+    else if ((argv0 != NULL) && (argv0[0] != '\0'))
     {
-        FILE* port_fp = fopen(port_filename, "w");
-        if (port_fp != NULL)
+        const char* path = getenv("PATH");
+        path = (path != NULL) ? path : "/usr/bin:/bin";
+        while (s_handoff_exec_path[0] == '\0')
         {
-            fprintf(port_fp, "%d", port_used);
-            fclose(port_fp);
+            const char* end = strchr(path, ':');
+            int dir_len = (end != NULL) ? (int) (end - path) : (int) strlen(path);
+            char candidate[PATH_MAX];
+            snprintf(candidate,
+                     sizeof(candidate),
+                     "%.*s/%s",
+                     dir_len,
+                     (dir_len > 0) ? path : ".",
+                     argv0);
+            if ((candidate[0] == '/') && (access(candidate, X_OK) == 0))
+            {
+                snprintf(s_handoff_exec_path, sizeof(s_handoff_exec_path), "%s", candidate);
+            }
+            if (end == NULL)
+            {
+                break;
+            }
+            path = end + 1;
         }
-        else
+    }
+    if (s_handoff_exec_path[0] == '\0')
+    {
+        ssize_t len = readlink("/proc/self/exe", s_handoff_exec_path, sizeof(s_handoff_exec_path));
+        if ((len <= 0) || (len >= (ssize_t) sizeof(s_handoff_exec_path)))
         {
-            fpga_msg_printf(
-                FPGA_MSG_PRINTF_ERROR, "Failed to save out port file: %s\n", port_filename);
+            s_handoff_exec_path[0] = '\0';
+            fpga_msg_printf(FPGA_MSG_PRINTF_WARNING,
+                            "Cannot resolve the server binary, listener hand-off is disabled.\n");
+            return FAILURE;
+        }
+        s_handoff_exec_path[len] = '\0';
+    }
+    return OK;
+#else
+    (void) argv0;
+    return FAILURE;
+#endif
+}
+
+const char* get_server_output_path(const char* path, char* buff, size_t buff_sz)
+{
+    // The predecessor keeps writing its file until its last session ends, so a replacement started
+    // by a hand-off must not truncate it.
+    if ((path == NULL) || (s_handoff_ready_fd < 0))
+    {
+        return path;
+    }
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    snprintf(buff, buff_sz, "%s.%d", path, (int) getpid());
+#else
+    snprintf(buff, buff_sz, "%s", path);
+#endif
+    return buff;
+}
+
+// Tells the server that handed its listener over that this process has initialized, after which
+// the predecessor stops accepting.
+static void report_server_ready()
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    if (s_handoff_ready_fd >= 0)
+    {
+        int ready_status = 0;
+        if (write(s_handoff_ready_fd, &ready_status, sizeof(ready_status)) < 0)
+        {
+            print_last_socket_error("Failed to report readiness to the previous server");
         }
+        close(s_handoff_ready_fd);
+        s_handoff_ready_fd = -1;
+    }
+#endif
+}
+
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+// Waits for the replacement to report on the status pipe. Returns 0 when it is ready to serve,
+// otherwise the exec() errno, or -1 if it exited or timed out during start-up.
+static int wait_for_replacement_server(int status_fd, pid_t pid)
+{
+    struct pollfd status_poll = {.fd = status_fd, .events = POLLIN, .revents = 0};
+    int status = -1;
+    int poll_rc;
+    do
+    {
+        poll_rc = poll(&status_poll, 1, HANDOFF_READY_TIMEOUT_MS);
+    } while ((poll_rc < 0) && (errno == EINTR));
+
+    if (poll_rc == 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Replacement server was not ready within %d ms\n",
+                        HANDOFF_READY_TIMEOUT_MS);
+        kill(pid, SIGKILL);
+        return -1;
+    }
+    ssize_t status_len;
+    do
+    {
+        status_len = read(status_fd, &status, sizeof(status));
+    } while ((status_len < 0) && (errno == EINTR));
+    if (status_len != (ssize_t) sizeof(status))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Replacement server exited during start-up.\n");
+        return -1;
     }
+    if (status != 0)
+    {
+        fpga_msg_printf(
+            FPGA_MSG_PRINTF_ERROR, "Replacement server failed to start: %s\n", strerror(status));
+    }
+    return status;
+}
 #endif
 
+RETURN_CODE handoff_server_listener(intel_remote_debug_server_context* context,
+                                    SERVER_CONN* server_conn)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    // The replacement process receives the listener through the sd_listen_fds() protocol so that
+    // connections queued in the backlog during the upgrade are served instead of refused. It
+    // reports on the status pipe once initialized; until then this process keeps the listener,
+    // and keeps it for good if the replacement fails to start.
+    const int SD_LISTEN_FDS_START = 3;
+    int status_pipe[2];
+    int metrics_enabled = (context->metrics_port >= 0) || (context->metrics_unix_path != NULL);
+
+    s_listener_handoff_requested = 0;
+    if ((context->exec_argv == NULL) || (s_handoff_exec_path[0] == '\0') ||
+        (server_conn->server_fd == INVALID_SOCKET))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Listener hand-off is not possible.\n");
+        return FAILURE;
+    }
+    if (pipe(status_pipe) < 0)
+    {
+        print_last_socket_error("Failed to create hand-off status pipe");
+        return FAILURE;
+    }
+    set_close_on_exec(status_pipe[0], 1);
+    set_close_on_exec(status_pipe[1], 1);
+
+    // The replacement binds the metrics endpoint itself
+    if (metrics_enabled)
+    {
+        stop_metrics_server();
+    }
+
     fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        char env_str[16];
+        // Moved above the listener slot and kept across exec() for the readiness report; exec()
+        // failure is reported on the close-on-exec original.
+        int ready_fd = fcntl(status_pipe[1], F_DUPFD, SD_LISTEN_FDS_START + 1);
+        close(status_pipe[0]);
+        if ((ready_fd >= 0) &&
+            ((server_conn->server_fd == SD_LISTEN_FDS_START) ||
+             (dup2(server_conn->server_fd, SD_LISTEN_FDS_START) == SD_LISTEN_FDS_START)))
+        {
+            set_close_on_exec(SD_LISTEN_FDS_START, 0);
+            snprintf(env_str, sizeof(env_str), "%d", (int) getpid());
+            setenv("LISTEN_PID", env_str, 1);
+            setenv("LISTEN_FDS", "1", 1);
+            snprintf(env_str, sizeof(env_str), "%d", ready_fd);
+            setenv(HANDOFF_READY_FD_ENV, env_str, 1);
+            execv(s_handoff_exec_path, context->exec_argv);
+        }
+        int exec_errno = (errno != 0) ? errno : EBADF;
+        if (write(status_pipe[1], &exec_errno, sizeof(exec_errno)) < 0)
+        {
+            // Nothing more can be reported from here
+        }
+        _exit(127);
+    }
+
+    close(status_pipe[1]);
+    int ready_status = -1;
+    if (pid < 0)
+    {
+        print_last_socket_error("Failed to fork replacement server");
+    }
+    else
+    {
+        ready_status = wait_for_replacement_server(status_pipe[0], pid);
+    }
+    close(status_pipe[0]);
+    if (ready_status != 0)
+    {
+        if (pid > 0)
+        {
+            waitpid(pid, NULL, 0);
+        }
+        if (metrics_enabled)
+        {
+            start_metrics_server(context->metrics_port, context->metrics_unix_path);
+        }
+        fpga_msg_printf(FPGA_MSG_PRINTF_WARNING, "Listener kept, server continues.\n");
+        return FAILURE;
+    }
+
+    // The replacement owns the listener now; stop accepting without resetting queued connections.
+    close_socket_fd(server_conn->server_fd);
+    server_conn->server_fd = INVALID_SOCKET;
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                    "Listening socket handed off to replacement server %s, pid %d\n",
+                    s_handoff_exec_path,
+                    (int) pid);
     return OK;
+#else
+    (void) context;
+    (void) server_conn;
+    s_listener_handoff_requested = 0;
+    fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                    "Listener hand-off is not supported on this platform.\n");
+    return FAILURE;
+#endif
+}
+
+// Removes the socket file of a unix socket listener once it is closed. A listener handed off to a
+// replacement server is not closed here, so its file stays.
+static void remove_server_unix_socket(SERVER_CONN* server_conn)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    if (server_conn->unix_path != NULL)
+    {
+        unlink(server_conn->unix_path);
+        server_conn->unix_path = NULL;
+    }
+#else
+    (void) server_conn;
+#endif
 }
 
 static SERVER_CONN* s_server_conn_ptr =
@@ -1406,8 +3706,8 @@ void server_terminate()
 {
     // free TCP/IP recv/send buffer
     free_tcpip_recv_send_buffer();
-    // Close the listening socket
-    if (s_server_conn_ptr->server_fd != INVALID_SOCKET)
+    // Close the listening socket, there is none if the server never ran (e.g. --self-bench)
+    if ((s_server_conn_ptr != NULL) && (s_server_conn_ptr->server_fd != INVALID_SOCKET))
     {
         set_linger_socket_option(s_server_conn_ptr->server_fd, 1, 0);
         if (close_socket_fd(s_server_conn_ptr->server_fd))
@@ -1417,6 +3717,7 @@ void server_terminate()
         else
         {
             s_server_conn_ptr->server_fd = INVALID_SOCKET;
+            remove_server_unix_socket(s_server_conn_ptr);
         }
     }
 
@@ -1430,13 +3731,30 @@ int server_main(intel_remote_debug_server_context* context,
 {
     int rc = 0;
     s_server_conn_ptr = server_conn;
+    calibrate_timestamp_ticks();
     rc = alloc_tcpip_recv_send_buffer(context->h2t_t2h_mem_size);
+    if (rc == OK)
+    {
+        rc = alloc_channel_stats(&(server_conn->channel_stats));
+    }
+    if (rc == OK)
+    {
+        rc = alloc_h2t_coalescer(&(server_conn->h2t_coalescer));
+    }
+    if (rc == OK)
+    {
+        server_conn->loopback_buff = (char*) malloc(LOOPBACK_BUFF_SZ);
+        rc = (server_conn->loopback_buff != NULL) ? OK : FAILURE;
+    }
     if (rc == FAILURE)
     {
         return rc;
     }
     else
     {
+        update_server_metrics(server_conn, 0);
+        report_server_ready();
+
         // Main loop of server app
         do
         {
@@ -1446,9 +3764,15 @@ int server_main(intel_remote_debug_server_context* context,
                 &(context->driver_cxt), context->h2t_t2h_mem_size, server_conn, &client_conn);
             if (rc == OK)
             {
+                server_conn->metrics_totals.sessions++;
+                capture_session();
+                update_server_metrics(server_conn, 1);
                 handle_client(server_conn, &client_conn);
+                end_session_metrics(server_conn);
+                dump_stall_stats(&(server_conn->stall_stats));
+                dump_latency_stats(&(server_conn->latency_stats));
             }
-            else
+            else if ((s_listener_handoff_requested == 0) && (s_server_termination_requested == 0))
             {
                 fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Rejected remote client.\n");
             }
@@ -1458,15 +3782,42 @@ int server_main(intel_remote_debug_server_context* context,
             {
                 break;
             }
+            if (s_server_termination_requested != 0)
+            {
+                fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Server is terminating on request.\n");
+                rc = OK;
+                break;
+            }
+
+            // Hand the listener over only between sessions so the replacement never competes with
+            // an active client for the IP.
+            if ((s_listener_handoff_requested != 0) &&
+                (handoff_server_listener(context, server_conn) == OK))
+            {
+                rc = OK;
+                break;
+            }
         } while (lifespan == MULTIPLE_CLIENTS);
     }
+    free_channel_stats(&(server_conn->channel_stats));
+    free_h2t_coalescer(&(server_conn->h2t_coalescer));
+    free(server_conn->loopback_buff);
+    server_conn->loopback_buff = NULL;
 
     // Close the listening socket
-    set_linger_socket_option(server_conn->server_fd, 1, 0);
-    if (close_socket_fd(server_conn->server_fd))
-        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Error closing server socket.\n");
-    else
-        server_conn->server_fd = INVALID_SOCKET;
+    if (server_conn->server_fd != INVALID_SOCKET)
+    {
+        set_linger_socket_option(server_conn->server_fd, 1, 0);
+        if (close_socket_fd(server_conn->server_fd))
+        {
+            fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Error closing server socket.\n");
+        }
+        else
+        {
+            server_conn->server_fd = INVALID_SOCKET;
+            remove_server_unix_socket(server_conn);
+        }
+    }
 
     // capture the server connection status, especially the server_fd, in case of SIGINT, grace
     // termination will close the server_fd
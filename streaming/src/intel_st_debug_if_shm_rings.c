@@ -0,0 +1,168 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_shm_rings.h"
+
+_Static_assert(sizeof(SHM_RING_RECORD_HEADER) == 8, "Ring records are 8 byte aligned");
+_Static_assert(sizeof(SHM_RINGS_LAYOUT) % 64 == 0, "Ring indices are cache line aligned");
+
+// The rings start page aligned behind the layout
+#define SHM_RINGS_HEADER_SZ 4096
+
+SHM_RINGS* create_shm_rings(size_t ring_sz)
+{
+    SHM_RINGS* rings;
+    int i;
+
+    if ((ring_sz < SHM_RING_MIN_SZ) || (ring_sz > SHM_RING_MAX_SZ) ||
+        ((ring_sz & (ring_sz - 1)) != 0))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Invalid shared memory ring size: %zu", ring_sz);
+        return NULL;
+    }
+    if ((rings = (SHM_RINGS*) calloc(1, sizeof(SHM_RINGS))) == NULL)
+    {
+        return NULL;
+    }
+    rings->map_sz = SHM_RINGS_HEADER_SZ + NUM_SHM_RINGS * ring_sz;
+    rings->server_doorbell = -1;
+    rings->client_doorbell = -1;
+
+    if (((rings->memfd = memfd_create("etherlink-rings", MFD_CLOEXEC)) < 0) ||
+        (ftruncate(rings->memfd, (off_t) rings->map_sz) < 0) ||
+        ((rings->layout = (SHM_RINGS_LAYOUT*) mmap(NULL,
+                                                   rings->map_sz,
+                                                   PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED,
+                                                   rings->memfd,
+                                                   0)) == MAP_FAILED) ||
+        ((rings->server_doorbell = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) ||
+        ((rings->client_doorbell = eventfd(0, EFD_CLOEXEC)) < 0))
+    {
+        fpga_msg_printf(
+            FPGA_MSG_PRINTF_ERROR, "Failed to create shared memory rings: %s", strerror(errno));
+        if (rings->layout == MAP_FAILED)
+        {
+            rings->layout = NULL;
+        }
+        destroy_shm_rings(rings);
+        return NULL;
+    }
+
+    // The memory is zero filled, which leaves every ring empty
+    rings->layout->version = ETHERLINK_SHM_RINGS_VERSION;
+    rings->layout->ring_sz = (uint32_t) ring_sz;
+    for (i = 0; i < NUM_SHM_RINGS; ++i)
+    {
+        rings->layout->ring_offset[i] = SHM_RINGS_HEADER_SZ + (uint64_t) i * ring_sz;
+    }
+    __atomic_store_n(&(rings->layout->magic), ETHERLINK_SHM_RINGS_MAGIC, __ATOMIC_RELEASE);
+    return rings;
+}
+
+void destroy_shm_rings(SHM_RINGS* rings)
+{
+    if (rings->layout != NULL)
+    {
+        munmap(rings->layout, rings->map_sz);
+    }
+    if (rings->memfd >= 0)
+    {
+        close(rings->memfd);
+    }
+    if (rings->server_doorbell >= 0)
+    {
+        close(rings->server_doorbell);
+    }
+    if (rings->client_doorbell >= 0)
+    {
+        close(rings->client_doorbell);
+    }
+    free(rings);
+}
+
+RETURN_CODE send_shm_rings(SOCKET fd, const SHM_RINGS* rings, const char* msg, size_t msg_len)
+{
+    const int fds[3] = {rings->memfd, rings->server_doorbell, rings->client_doorbell};
+    union
+    {
+        char buff[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov;
+    struct msghdr hdr;
+    struct cmsghdr* cmsg;
+
+    memset(&control, 0, sizeof(control));
+    memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = (void*) msg;
+    iov.iov_len = msg_len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control.buff;
+    hdr.msg_controllen = sizeof(control.buff);
+    cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    // The control responses are short, a partial send is not expected
+    return (sendmsg(fd, &hdr, MSG_NOSIGNAL) == (ssize_t) msg_len) ? OK : FAILURE;
+}
+
+void drain_shm_rings_doorbell(SHM_RINGS* rings)
+{
+    uint64_t count;
+    // Fails with EAGAIN if the doorbell was not rung since the last call
+    ssize_t bytes_read = read(rings->server_doorbell, &count, sizeof(count));
+    (void) bytes_read;
+}
+
+void ring_shm_rings_client_doorbell(SHM_RINGS* rings)
+{
+    if (rings->wake_client)
+    {
+        const uint64_t count = 1;
+        rings->wake_client = 0;
+        if (write(rings->client_doorbell, &count, sizeof(count)) < 0)
+        {
+            fpga_msg_printf(
+                FPGA_MSG_PRINTF_WARNING, "Failed to ring the client doorbell: %s", strerror(errno));
+        }
+    }
+}
@@ -34,6 +34,12 @@
 #include "intel_st_debug_if_st_dbg_ip_driver.h"
 #include "intel_st_debug_if_common.h"
 #include "intel_st_debug_if_constants.h"
+#include "intel_st_debug_if_capture.h"
+
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
 
 #define PACKET_HEADER_SIZE 64
 
@@ -89,8 +95,10 @@ RETURN_CODE socket_send_all(
 
     while (bytes_remaining > 0)
     {
-        if ((curr_bytes_sent = send(fd, buff + (len - bytes_remaining), bytes_remaining, flags)) <=
-            0)
+        if ((curr_bytes_sent = send(fd,
+                                    buff + (len - bytes_remaining),
+                                    bytes_remaining,
+                                    flags | SEND_NO_SIGNAL)) <= 0)
         {
             if (bytes_sent != NULL)
             {
@@ -112,6 +120,10 @@ RETURN_CODE socket_send_all_t2h_or_mgmt_rsp_data(
 {
     // First copy the mmio ptr into local memory domain
     memcpy64_fpga2host(buff, (uint64_t*) g_socket_send_buff, len);
+    if (is_capture_enabled())
+    {
+        capture_packet_data(g_socket_send_buff, len);
+    }
 
     RETURN_CODE ret = socket_send_all(fd, g_socket_send_buff, len, flags, bytes_sent);
 
@@ -193,6 +205,10 @@ RETURN_CODE socket_recv_accumulate_h2t_or_mgmt_data(
     {
         // Copy the local memory ptr into the mmio domain
         memcpy64_host2fpga((uint64_t*) g_socket_recv_buff, buff, len);
+        if (is_capture_enabled())
+        {
+            capture_packet_data(g_socket_recv_buff, len);
+        }
     }
 
     return OK;
@@ -276,7 +292,7 @@ int close_socket_fd(SOCKET socket_fd)
 #endif
 }
 
-void wait_for_read_event(SOCKET socket_fd, long seconds, long useconds)
+int wait_for_read_event(SOCKET socket_fd, long seconds, long useconds)
 {
     struct timeval timeout;
     timeout.tv_sec = seconds;
@@ -284,7 +300,121 @@ void wait_for_read_event(SOCKET socket_fd, long seconds, long useconds)
     fd_set readfds;
     FD_ZERO(&readfds);
     FD_SET(socket_fd, &readfds);
-    select((int) (socket_fd + 1), &readfds, NULL, NULL, &timeout);
+    return select((int) (socket_fd + 1), &readfds, NULL, NULL, &timeout);
+}
+
+int is_listening_stream_socket(SOCKET socket_fd)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    int option_val = 0;
+    socklen_t option_len = sizeof(option_val);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_TYPE, &option_val, &option_len) < 0 ||
+        option_val != SOCK_STREAM)
+    {
+        return 0;
+    }
+    option_len = sizeof(option_val);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_ACCEPTCONN, &option_val, &option_len) < 0)
+    {
+        return 0;
+    }
+    return option_val != 0;
+#else
+    return 1;
+#endif
+}
+
+int is_unix_domain_socket(SOCKET socket_fd)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    return (getsockname(socket_fd, (struct sockaddr*) &addr, &addr_len) == 0) &&
+           (addr.ss_family == AF_UNIX);
+#else
+    (void) socket_fd;
+    return 0;
+#endif
+}
+
+int remove_stale_unix_socket(const char* unix_path)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    struct stat path_stat;
+    if (lstat(unix_path, &path_stat) < 0)
+    {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    if (!S_ISSOCK(path_stat.st_mode))
+    {
+        errno = ENOTSOCK;
+        return -1;
+    }
+
+    // Only a socket nobody accepts on any more refuses the connection
+    struct sockaddr_un addr;
+    if (strlen(unix_path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, unix_path);
+    SOCKET probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe_fd == INVALID_SOCKET)
+    {
+        return -1;
+    }
+    const int stale = (connect(probe_fd, (const struct sockaddr*) &addr, sizeof(addr)) < 0) &&
+                      (errno == ECONNREFUSED);
+    close_socket_fd(probe_fd);
+    if (!stale)
+    {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    return unlink(unix_path);
+#else
+    (void) unix_path;
+    return 0;
+#endif
+}
+
+int get_socket_local_port(SOCKET socket_fd)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (getsockname(socket_fd, (struct sockaddr*) &addr, &addr_len) < 0)
+    {
+        return -1;
+    }
+    if (addr.ss_family == AF_INET)
+    {
+        return ntohs(((struct sockaddr_in*) &addr)->sin_port);
+    }
+#if STI_NOSYS_PROT_PLATFORM != STI_PLATFORM_NIOS_UC_TCPIP
+    if (addr.ss_family == AF_INET6)
+    {
+        return ntohs(((struct sockaddr_in6*) &addr)->sin6_port);
+    }
+#endif
+    return 0;
+}
+
+int set_close_on_exec(SOCKET socket_fd, int close_on_exec)
+{
+#if STI_NOSYS_PROT_PLATFORM == STI_PLATFORM_LINUX
+    int flags = fcntl(socket_fd, F_GETFD);
+    if (flags < 0)
+    {
+        return -1;
+    }
+    flags = close_on_exec ? (flags | FD_CLOEXEC) : (flags & ~FD_CLOEXEC);
+    return fcntl(socket_fd, F_SETFD, flags);
+#else
+    return 0;
+#endif
 }
 
 int get_last_socket_error()
@@ -24,27 +24,88 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 #include "intel_fpga_platform.h"
 #include "intel_fpga_api.h"
 
 #include "intel_st_debug_if_constants.h"
+#include "intel_st_debug_if_copy_calibration.h"
+#include "intel_st_debug_if_mmio_log.h"
 #include "intel_st_debug_if_st_dbg_ip_driver.h"
 #include "intel_st_debug_if_st_dbg_ip_allocator.h"
+#include "intel_st_debug_if_st_dbg_ip_write_queue.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// SW model builds drive the simulated IP instead of the platform's MMIO
+#ifdef ST_DBG_IP_SW_MODEL
+#include "intel_st_debug_if_sim_ip.h"
+#define ip_read_32(offset) sim_ip_read_32(offset)
+#define ip_read_64(offset) sim_ip_read_64(offset)
+#define ip_write_32(offset, value) sim_ip_write_32((offset), (value))
+#define ip_write_64(offset, value) sim_ip_write_64((offset), (value))
+#else
+#define ip_read_32(offset) fpga_read_32(g_mmio_handle, (offset))
+#define ip_read_64(offset) fpga_read_64(g_mmio_handle, (offset))
+#define ip_write_32(offset, value) fpga_write_32(g_mmio_handle, (offset), (value))
+#define ip_write_64(offset, value) fpga_write_64(g_mmio_handle, (offset), (value))
+#endif
 
 static ST_DBG_IP_DESIGN_INFO g_std_dbg_ip_info;
 static FPGA_MMIO_INTERFACE_HANDLE g_mmio_handle = FPGA_MMIO_INTERFACE_INVALID_HANDLE;
 
-// Descriptor tracking
-static unsigned short g_h2t_descriptor_slots_available = 0;
-static unsigned short g_mgmt_descriptor_slots_available = 0;
-static unsigned short g_h2t_descriptor_chain[MAX_H2T_DESCRIPTOR_DEPTH] = {0};
-static unsigned short g_mgmt_descriptor_chain[MAX_MGMT_DESCRIPTOR_DEPTH] = {0};
-static unsigned short g_h2t_descriptor_write_idx = 0;
-static unsigned short g_h2t_descriptor_read_idx = 0;
-static unsigned short g_mgmt_descriptor_write_idx = 0;
-static unsigned short g_mgmt_descriptor_read_idx = 0;
+// Descriptor tracking, sized from the IP's descriptor depth CSRs
+static DESCRIPTOR_TRACKER g_h2t_descriptors = DESCRIPTOR_TRACKER_default;
+static DESCRIPTOR_TRACKER g_mgmt_descriptors = DESCRIPTOR_TRACKER_default;
+
+// Platforms that emulate 64-bit MMIO with 32-bit accesses are driven with 32-bit accesses
+#if defined(FPGA_PLATFORM_FORCE_64BIT_MMIO_EMULATION_WITH_32BIT) || \
+    !defined(FPGA_PLATFORM_HAS_NATIVE_MMIO_READ_64) ||                \
+    !defined(FPGA_PLATFORM_HAS_NATIVE_MMIO_WRITE_64)
+static MMIO_WIDTH g_requested_mmio_width = MMIO_WIDTH_32;
+static MMIO_WIDTH g_mmio_width = MMIO_WIDTH_32;
+#define DEFAULT_COPY_KERNEL COPY_KERNEL_MMIO32
+#else
+static MMIO_WIDTH g_requested_mmio_width = MMIO_WIDTH_AUTO;
+static MMIO_WIDTH g_mmio_width = MMIO_WIDTH_64;
+#define DEFAULT_COPY_KERNEL COPY_KERNEL_MMIO64
+#endif
+
+// Payload copy strategy per direction, one access per word until calibrated
+static const char* const COPY_KERNEL_NAMES[NUM_COPY_KERNELS] = {"mmio64", "mmio32"};
+static COPY_STRATEGY g_copy_strategy[NUM_COPY_DIRECTIONS] = {{DEFAULT_COPY_KERNEL, 1},
+                                                             {DEFAULT_COPY_KERNEL, 1}};
+
+// Reason the last buffer request was not granted
+static BUFFER_WAIT_REASON g_h2t_wait_reason = BUFFER_GRANTED;
+static BUFFER_WAIT_REASON g_mgmt_wait_reason = BUFFER_GRANTED;
+
+// Posted writes of the open write batch
+static MMIO_WRITE_QUEUE g_write_queue;
+
+// Shadow of the config CSRs, loaded by init_driver(). The sizes and depths are static. The host
+// owns RESET_AND_LOOPBACK, the shadow holds what was last written to it without the resets, which
+// clear themselves.
+typedef struct
+{
+    bool valid;
+    uint32_t h2t_t2h_mem;
+    uint32_t mgmt_mem;
+    uint32_t h2t_t2h_desc_depth;
+    uint32_t mgmt_desc_depth;
+    uint32_t reset_and_loopback;
+} CONFIG_CSR_SHADOW;
+
+static CONFIG_CSR_SHADOW g_config_shadow = {false, 0, 0, 0, 0, 0};
+
+// MMIO operations issued since start-up
+static uint64_t g_mmio_read_count = 0;
+static uint64_t g_mmio_write_count = 0;
 
 // SOP tracking
 static unsigned char g_t2h_sop = 1;
@@ -56,7 +117,187 @@ static CIRCLE_BUFF g_mgmt_rx_cbuff;
 
 static bool has_init_once = false;
 
-static void init_descriptor();
+// All CSR and memory accesses of the driver go through these so that they can be counted and
+// logged
+#define mmio_read_32(offset) mmio_read_32_at((offset), __LINE__, __func__)
+#define mmio_read_64(offset) mmio_read_64_at((offset), __LINE__, __func__)
+#define mmio_write_32(offset, value) mmio_write_32_at((offset), (value), __LINE__, __func__)
+#define mmio_write_64(offset, value) mmio_write_64_at((offset), (value), __LINE__, __func__)
+
+static inline uint32_t mmio_read_32_at(uint64_t offset, int line, const char* function)
+{
+    g_mmio_read_count++;
+    uint32_t value = ip_read_32(offset);
+    if (is_mmio_log_enabled())
+    {
+        mmio_log_access(MMIO_LOG_OP_READ_32, offset, value, line, function);
+    }
+    return value;
+}
+
+static inline uint64_t mmio_read_64_at(uint64_t offset, int line, const char* function)
+{
+    g_mmio_read_count++;
+    uint64_t value = ip_read_64(offset);
+    if (is_mmio_log_enabled())
+    {
+        mmio_log_access(MMIO_LOG_OP_READ_64, offset, value, line, function);
+    }
+    return value;
+}
+
+static inline void mmio_write_32_at(uint64_t offset,
+                                    uint32_t value,
+                                    int line,
+                                    const char* function)
+{
+    g_mmio_write_count++;
+    if (is_mmio_log_enabled())
+    {
+        mmio_log_access(MMIO_LOG_OP_WRITE_32, offset, value, line, function);
+    }
+    ip_write_32(offset, value);
+}
+
+static inline void mmio_write_64_at(uint64_t offset,
+                                    uint64_t value,
+                                    int line,
+                                    const char* function)
+{
+    g_mmio_write_count++;
+    if (is_mmio_log_enabled())
+    {
+        mmio_log_access(MMIO_LOG_OP_WRITE_64, offset, value, line, function);
+    }
+    ip_write_64(offset, value);
+}
+
+// Ordering point for posted MMIO writes: those issued before it reach the IP before any issued
+// after it, also over write-combining mappings
+static inline void mmio_write_fence()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_sfence();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("dmb oshst" ::: "memory");
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+static void copy_host2fpga(const uint64_t* host_buff, int32_t fpga_buff, size_t len);
+
+// Issues the queued payload stores, then the queued descriptor CSR writes
+static void flush_write_queue()
+{
+    MMIO_WRITE_QUEUE* queue = &g_write_queue;
+    uint32_t i;
+    for (i = 0; i < queue->num_payloads; ++i)
+    {
+        const QUEUED_PAYLOAD* payload = &(queue->payloads[i]);
+        copy_host2fpga(
+            &(queue->staging[payload->first_word]), (int32_t) payload->fpga_buff, payload->len);
+    }
+    mmio_write_fence();
+    for (i = 0; i < queue->num_csr_writes; ++i)
+    {
+        const QUEUED_CSR_WRITE* write = &(queue->csr_writes[i]);
+        if (write->is_64bit)
+        {
+            mmio_write_64_at(write->offset, write->value, write->line, write->function);
+        }
+        else
+        {
+            mmio_write_32_at(write->offset, (uint32_t) write->value, write->line, write->function);
+        }
+    }
+    write_queue_clear(queue);
+}
+
+// Ordering point ahead of a descriptor push, its payload has to reach the IP first. Inside a write
+// batch the fence is left to the flush, room is made for the 'num_writes' CSR writes and the push
+// is counted in 'queued_pushes'.
+static inline void begin_descriptor_push(uint32_t num_writes, uint32_t* queued_pushes)
+{
+    if (!g_write_queue.is_open)
+    {
+        mmio_write_fence();
+        return;
+    }
+    if (!write_queue_has_csr_room(&g_write_queue, num_writes))
+    {
+        flush_write_queue();
+    }
+    ++*queued_pushes;
+}
+
+// Descriptor CSR writes, queued while a write batch is open
+#define descriptor_write_32(offset, value) \
+    descriptor_write_at((offset), (value), 0, __LINE__, __func__)
+#define descriptor_write_64(offset, value) \
+    descriptor_write_at((offset), (value), 1, __LINE__, __func__)
+
+static inline void descriptor_write_at(
+    uint64_t offset, uint64_t value, char is_64bit, int line, const char* function)
+{
+    if (g_write_queue.is_open)
+    {
+        write_queue_add_csr_write(&g_write_queue, offset, value, is_64bit, line, function);
+    }
+    else if (is_64bit)
+    {
+        mmio_write_64_at(offset, value, line, function);
+    }
+    else
+    {
+        mmio_write_32_at(offset, (uint32_t) value, line, function);
+    }
+}
+
+// Reads the config CSRs once. Version 0 IPs lack the memory size CSRs.
+static void load_config_shadow(uint32_t version)
+{
+    g_config_shadow.h2t_t2h_mem = (version > 0) ? mmio_read_32(ST_DBG_IP_CONFIG_H2T_T2H_MEM) : 0;
+    g_config_shadow.mgmt_mem = (version > 0) ? mmio_read_32(ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_MEM) : 0;
+    g_config_shadow.h2t_t2h_desc_depth = mmio_read_32(ST_DBG_IP_CONFIG_H2T_T2H_DESC_DEPTH);
+    g_config_shadow.mgmt_desc_depth = mmio_read_32(ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_DESC_DEPTH);
+    g_config_shadow.reset_and_loopback = mmio_read_32(ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK);
+    g_config_shadow.valid = true;
+}
+
+// Until init_driver() has loaded the shadow, the CSRs are read from the IP
+static uint32_t read_reset_and_loopback()
+{
+    return g_config_shadow.valid ? g_config_shadow.reset_and_loopback
+                                 : mmio_read_32(ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK);
+}
+
+static uint32_t read_mgmt_desc_depth()
+{
+    return g_config_shadow.valid ? g_config_shadow.mgmt_desc_depth
+                                 : mmio_read_32(ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_DESC_DEPTH);
+}
+
+static void write_reset_and_loopback(uint32_t value)
+{
+    mmio_write_32(ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK, value);
+    g_config_shadow.reset_and_loopback =
+        value & ~(ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD | ST_DBG_IP_CONFIG_MGMT_AND_RSP_RESET_FIELD);
+}
+
+static void log_mmio_regions()
+{
+    const uint64_t bases[NUM_MMIO_LOG_REGIONS] = {g_std_dbg_ip_info.ST_DBG_IP_CSR_BASE_ADDR,
+                                                  g_std_dbg_ip_info.H2T_MEM_BASE_ADDR,
+                                                  g_std_dbg_ip_info.T2H_MEM_BASE_ADDR,
+                                                  g_std_dbg_ip_info.MGMT_MEM_BASE_ADDR,
+                                                  g_std_dbg_ip_info.MGMT_RSP_MEM_BASE_ADDR};
+    mmio_log_regions(bases);
+}
+
+static int init_descriptor();
+static MMIO_WIDTH probe_mmio_width(uint32_t version);
+static void apply_mmio_width(MMIO_WIDTH width);
 static void init_st_dbg_ip_info_given_sizes(uint32_t h2t_t2h_mem_size, uint32_t mgmt_mem_size);
 
 int init_driver(intel_stream_debug_if_driver_context* context,
@@ -76,26 +317,18 @@ int init_driver(intel_stream_debug_if_driver_context* context,
 
     int ret = 0;
     g_mmio_handle = context->mmio_handle = mmio_handle;
-
-#ifdef MMIO_LOG
-    g_mmio_log_f = fopen("mmlink_mmio_log.csv", "w");
-
-    ::setbuf(g_mmio_log_f, NULL);
-    ::fprintf(g_mmio_log_f,
-              "CSR base_addr:64'h%llx\n"
-              "H2T base_addr:64'h%llx\n"
-              "T2H base_addr:64'h%llx\n"
-              "line_no,function,type,base_addr,offset,value\n",
-              g_std_dbg_ip_info.ST_DBG_IP_CSR_BASE_ADDR,
-              g_std_dbg_ip_info.H2T_MEM_BASE_ADDR,
-              g_std_dbg_ip_info.T2H_MEM_BASE_ADDR);
-#endif
+    g_config_shadow.valid = false;
 
     uint32_t version;
     if (check_version_and_type(&version) != 0)
     {
         return INIT_ERROR_CODE_INCOMPATIBLE_IP;
     }
+    load_config_shadow(version);
+    if (g_requested_mmio_width == MMIO_WIDTH_AUTO)
+    {
+        apply_mmio_width(probe_mmio_width(version));
+    }
 
     // Use CSR to set up configuration, instead of argument.
     if (version>0)
@@ -116,8 +349,24 @@ int init_driver(intel_stream_debug_if_driver_context* context,
         init_st_dbg_ip_info_given_sizes(user_input_h2t_t2h_mem_size, 0);
     }
     context->std_dbg_ip_info = g_std_dbg_ip_info;
+    if (is_mmio_log_enabled())
+    {
+        log_mmio_regions();
+    }
 
-    init_descriptor();
+    if (!is_pow_2(g_std_dbg_ip_info.H2T_MEM_SZ) || !is_pow_2(g_std_dbg_ip_info.MGMT_MEM_SZ))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "H2T/T2H memory size %u and MGMT memory size %u must be powers of two\n",
+                        (unsigned int) g_std_dbg_ip_info.H2T_MEM_SZ,
+                        (unsigned int) g_std_dbg_ip_info.MGMT_MEM_SZ);
+        return INIT_ERROR_CODE_UNSUPPORTED_CONFIG;
+    }
+    if (init_descriptor() != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to allocate the descriptor trackers\n");
+        return INIT_ERROR_CODE_UNSUPPORTED_CONFIG;
+    }
 
     assert_h2t_t2h_reset();
 
@@ -132,9 +381,7 @@ int init_driver(intel_stream_debug_if_driver_context* context,
 
 void init_st_dbg_ip_info()
 {
-    uint32_t h2t_t2h_mem_size = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_H2T_T2H_MEM);
-    uint32_t mgmt_mem_size = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_MEM);
-    init_st_dbg_ip_info_given_sizes(h2t_t2h_mem_size, mgmt_mem_size);
+    init_st_dbg_ip_info_given_sizes(g_config_shadow.h2t_t2h_mem, g_config_shadow.mgmt_mem);
 }
 
 void init_st_dbg_ip_info_given_sizes(uint32_t h2t_t2h_mem_size, uint32_t mgmt_mem_size)
@@ -177,70 +424,135 @@ void init_st_dbg_ip_info_given_sizes(uint32_t h2t_t2h_mem_size, uint32_t mgmt_me
 #endif
 }
 
-void init_descriptor()
+int init_descriptor()
 {
-    g_h2t_descriptor_slots_available = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_H2T_T2H_DESC_DEPTH);
-    g_mgmt_descriptor_slots_available = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_DESC_DEPTH);
-    g_h2t_descriptor_write_idx = 0;
-    g_h2t_descriptor_read_idx = 0;
-    g_mgmt_descriptor_write_idx = 0;
-    g_mgmt_descriptor_read_idx = 0;
+    if (desc_tracker_init(&g_h2t_descriptors, g_config_shadow.h2t_t2h_desc_depth) != 0)
+    {
+        return -1;
+    }
+    return desc_tracker_init(&g_mgmt_descriptors, g_config_shadow.mgmt_desc_depth);
 }
 
-// Returns a non-NULL buffer if there is both space in the H2T memory & H2T descriptor memory.
-// Checks to see if any descriptors have been processed by the ST Debug IP, and if so frees
-// the associated memory.
-uint32_t get_h2t_buffer(size_t sz)
+// Returns a non-NULL buffer if there is both space in 'cbuff' & descriptor memory. First frees
+// the memory of the descriptors the ST Debug IP has processed, as told by its available slots CSR.
+// If 'min_chunk_sz' is not 0 and only part of 'sz' fits, grants that part if it is at least
+// 'min_chunk_sz' bytes or all of 'cbuff'. '*granted_sz' is set to the bytes granted.
+static inline uint32_t alloc_descriptor_buffer(CIRCLE_BUFF* cbuff,
+                                               DESCRIPTOR_TRACKER* descriptors,
+                                               uint32_t available_slots,
+                                               size_t sz,
+                                               size_t min_chunk_sz,
+                                               size_t* granted_sz,
+                                               BUFFER_WAIT_REASON* wait_reason)
 {
-    // First update available descriptor slots, and free space in the buffer
-    uint32_t freed_descriptor_slots = fpga_read_32(g_mmio_handle, ST_DBG_IP_H2T_AVAILABLE_SLOTS) -
-                                      g_h2t_descriptor_slots_available;
-    if (freed_descriptor_slots > 0)
+    const uint32_t tracked_slots = desc_tracker_slots_available(descriptors);
+    if (available_slots > tracked_slots)
     {
-        g_h2t_descriptor_slots_available += freed_descriptor_slots;
-        size_t bytes_freed = 0;
-        char i;
-        for (i = 0; i < freed_descriptor_slots; ++i)
-        {
-            bytes_freed +=
-                g_h2t_descriptor_chain[(g_h2t_descriptor_read_idx + i) % MAX_H2T_DESCRIPTOR_DEPTH];
-        }
-        g_h2t_descriptor_read_idx =
-            (g_h2t_descriptor_read_idx + freed_descriptor_slots) % MAX_H2T_DESCRIPTOR_DEPTH;
-
-        // Update the cbuff, freeing up space
-        cbuff_free(&g_h2t_rx_cbuff, bytes_freed);
+        cbuff_free_to(cbuff, desc_tracker_complete(descriptors, available_slots - tracked_slots));
     }
 
     // Make sure we have space in descriptor mem
-    if (g_h2t_descriptor_slots_available > 0)
+    if (desc_tracker_slots_available(descriptors) > 0)
     {
         // Make sure we have space in cbuff
         const size_t aligned_sz = GET_ALIGNED_SZ(sz);
-        if (g_h2t_rx_cbuff.space_available >= aligned_sz)
+        const size_t space_available = cbuff_space_available(cbuff);
+        size_t alloc_sz = 0;
+        if (space_available >= aligned_sz)
         {
-            g_h2t_descriptor_chain[g_h2t_descriptor_write_idx++ % MAX_H2T_DESCRIPTOR_DEPTH] =
-                aligned_sz;
-            return cbuff_alloc(&g_h2t_rx_cbuff, aligned_sz);
+            alloc_sz = aligned_sz;
+            *granted_sz = sz;
         }
+        else if ((min_chunk_sz != 0) &&
+                 (ALIGN_TO(space_available) >= MIN_MACRO(min_chunk_sz, cbuff->span)))
+        {
+            // Part of the payload, aligned so the next part starts aligned as well
+            alloc_sz = *granted_sz = ALIGN_TO(space_available);
+        }
+        if (alloc_sz != 0)
+        {
+            *wait_reason = BUFFER_GRANTED;
+            const uint32_t result = cbuff_alloc(cbuff, alloc_sz);
+            desc_tracker_reserve(descriptors, cbuff->write_offset);
+            return result;
+        }
+        *wait_reason = BUFFER_WAIT_SPACE;
+    }
+    else
+    {
+        *wait_reason = BUFFER_WAIT_DESCRIPTOR_SLOTS;
     }
 
     return 0;
 }
 
+// Descriptor slots the IP has free, as the tracker counts them: descriptors still queued in the
+// write batch are not in the IP yet but already occupy a slot
+static inline uint32_t get_h2t_available_slots()
+{
+    return mmio_read_32(ST_DBG_IP_H2T_AVAILABLE_SLOTS) - g_write_queue.num_h2t_pushes;
+}
+
+static inline uint32_t get_mgmt_available_slots()
+{
+    return mmio_read_32(ST_DBG_IP_MGMT_AVAILABLE_SLOTS) - g_write_queue.num_mgmt_pushes;
+}
+
+// Returns a non-NULL buffer if there is both space in the H2T memory & H2T descriptor memory.
+// Checks to see if any descriptors have been processed by the ST Debug IP, and if so frees
+// the associated memory.
+uint32_t get_h2t_buffer(size_t sz)
+{
+    size_t granted_sz;
+    return alloc_descriptor_buffer(&g_h2t_rx_cbuff,
+                                   &g_h2t_descriptors,
+                                   get_h2t_available_slots(),
+                                   sz,
+                                   0,
+                                   &granted_sz,
+                                   &g_h2t_wait_reason);
+}
+
+uint32_t get_h2t_buffer_chunk(size_t sz, size_t* granted_sz)
+{
+    return alloc_descriptor_buffer(&g_h2t_rx_cbuff,
+                                   &g_h2t_descriptors,
+                                   get_h2t_available_slots(),
+                                   sz,
+                                   ST_DBG_IP_H2T_MIN_CHUNK_SZ,
+                                   granted_sz,
+                                   &g_h2t_wait_reason);
+}
+
+int get_h2t_buffer_wait_reason()
+{
+    return g_h2t_wait_reason;
+}
+
 // Assumes there is space in both the buffer and descriptor memory
 int push_h2t_data(H2T_PACKET_HEADER* header, uint32_t payload)
 {
-    --g_h2t_descriptor_slots_available;
+    desc_tracker_push(&g_h2t_descriptors);
     unsigned long last_howlong = (header->DATA_LEN_BYTES & ST_DBG_IP_HOW_LONG_MASK);
     if (header->SOP_EOP & H2T_PACKET_HEADER_MASK_EOP)
     {
         last_howlong |= ST_DBG_IP_LAST_DESCRIPTOR_MASK;
     }
+    if (g_mmio_width == MMIO_WIDTH_32)
+    {
+        // CHANNEL_ID_PUSH goes last, it hands the descriptor to the IP
+        begin_descriptor_push(4, &(g_write_queue.num_h2t_pushes));
+        descriptor_write_32(ST_DBG_IP_H2T_HOW_LONG, (uint32_t) last_howlong);
+        descriptor_write_32(ST_DBG_IP_H2T_WHERE, payload);
+        descriptor_write_32(ST_DBG_IP_H2T_CONNECTION_ID, header->CONN_ID);
+        descriptor_write_32(ST_DBG_IP_H2T_CHANNEL_ID_PUSH, header->CHANNEL);
+        return 0;
+    }
+    begin_descriptor_push(2, &(g_write_queue.num_h2t_pushes));
     uint64_t howlong_where = last_howlong | ((uint64_t) ((uint64_t) payload) << 32);
-    fpga_write_64(g_mmio_handle, ST_DBG_IP_H2T_HOW_LONG, howlong_where);
+    descriptor_write_64(ST_DBG_IP_H2T_HOW_LONG, howlong_where);
     uint64_t connid_channelpush = header->CONN_ID | ((uint64_t) header->CHANNEL << 32);
-    fpga_write_64(g_mmio_handle, ST_DBG_IP_H2T_CONNECTION_ID, connid_channelpush);
+    descriptor_write_64(ST_DBG_IP_H2T_CONNECTION_ID, connid_channelpush);
 
     return 0;
 }
@@ -250,69 +562,60 @@ int push_h2t_data(H2T_PACKET_HEADER* header, uint32_t payload)
 // the associated memory.
 uint32_t get_mgmt_buffer(size_t sz)
 {
-    // First update available descriptor slots, and free space in the buffer
-    uint32_t freed_descriptor_slots = fpga_read_32(g_mmio_handle, ST_DBG_IP_MGMT_AVAILABLE_SLOTS) -
-                                      g_mgmt_descriptor_slots_available;
-    if (freed_descriptor_slots > 0)
-    {
-        g_mgmt_descriptor_slots_available += freed_descriptor_slots;
-        size_t bytes_freed = 0;
-        char i;
-        for (i = 0; i < freed_descriptor_slots; ++i)
-        {
-            bytes_freed += g_mgmt_descriptor_chain[(g_mgmt_descriptor_read_idx + i) %
-                                                   MAX_MGMT_DESCRIPTOR_DEPTH];
-        }
-        g_mgmt_descriptor_read_idx =
-            (g_mgmt_descriptor_read_idx + freed_descriptor_slots) % MAX_MGMT_DESCRIPTOR_DEPTH;
-
-        // Update the cbuff, freeing up space
-        cbuff_free(&g_mgmt_rx_cbuff, bytes_freed);
-    }
-
-    // Make sure we have space in descriptor mem
-    if (g_mgmt_descriptor_slots_available > 0)
-    {
-        // Make sure we have space in cbuff
-        const size_t aligned_sz = GET_ALIGNED_SZ(sz);
-        if (g_mgmt_rx_cbuff.space_available >= aligned_sz)
-        {
-            g_mgmt_descriptor_chain[g_mgmt_descriptor_write_idx++ % MAX_MGMT_DESCRIPTOR_DEPTH] =
-                aligned_sz;
-            return cbuff_alloc(&g_mgmt_rx_cbuff, aligned_sz);
-        }
-    }
+    size_t granted_sz;
+    return alloc_descriptor_buffer(&g_mgmt_rx_cbuff,
+                                   &g_mgmt_descriptors,
+                                   get_mgmt_available_slots(),
+                                   sz,
+                                   0,
+                                   &granted_sz,
+                                   &g_mgmt_wait_reason);
+}
 
-    return 0;
+int get_mgmt_buffer_wait_reason()
+{
+    return g_mgmt_wait_reason;
 }
 
 // Assumes there is space in both the buffer and descriptor memory
 int push_mgmt_data(MGMT_PACKET_HEADER* header, uint32_t payload)
 {
-    --g_mgmt_descriptor_slots_available;
+    desc_tracker_push(&g_mgmt_descriptors);
     unsigned long last_howlong = (header->DATA_LEN_BYTES & ST_DBG_IP_HOW_LONG_MASK);
     if (header->SOP_EOP & MGMT_PACKET_HEADER_MASK_EOP)
     {
         last_howlong |= ST_DBG_IP_LAST_DESCRIPTOR_MASK;
     }
-    uint64_t howlong_where = last_howlong | ((uint64_t) ((uint64_t) payload) << 32);
-    fpga_write_64(g_mmio_handle, ST_DBG_IP_MGMT_HOW_LONG, howlong_where);
-    fpga_write_32(g_mmio_handle, ST_DBG_IP_MGMT_CHANNEL_ID_PUSH, header->CHANNEL);
+    if (g_mmio_width == MMIO_WIDTH_32)
+    {
+        begin_descriptor_push(3, &(g_write_queue.num_mgmt_pushes));
+        descriptor_write_32(ST_DBG_IP_MGMT_HOW_LONG, (uint32_t) last_howlong);
+        descriptor_write_32(ST_DBG_IP_MGMT_WHERE, payload);
+    }
+    else
+    {
+        begin_descriptor_push(2, &(g_write_queue.num_mgmt_pushes));
+        uint64_t howlong_where = last_howlong | ((uint64_t) ((uint64_t) payload) << 32);
+        descriptor_write_64(ST_DBG_IP_MGMT_HOW_LONG, howlong_where);
+    }
+    descriptor_write_32(ST_DBG_IP_MGMT_CHANNEL_ID_PUSH, header->CHANNEL);
     return 0;
 }
 
 // Reads out the next T2H data if non-empty
 int get_t2h_data(H2T_PACKET_HEADER* header, uint32_t* payload)
 {
-    uint64_t howlong_where = fpga_read_64(g_mmio_handle, ST_DBG_IP_T2H_HOW_LONG);
+    const int mmio_32 = (g_mmio_width == MMIO_WIDTH_32);
+    uint64_t howlong_where = mmio_32 ? mmio_read_32(ST_DBG_IP_T2H_HOW_LONG)
+                                     : mmio_read_64(ST_DBG_IP_T2H_HOW_LONG);
     uint32_t last_howlong = (uint32_t) howlong_where;
-    uint32_t where = (uint32_t) (howlong_where >> 32);
     // Early return no need to do more work if there is no data
     header->DATA_LEN_BYTES = (unsigned short) (last_howlong & ST_DBG_IP_HOW_LONG_MASK);
     if (header->DATA_LEN_BYTES == 0)
     {
         return 0;
     }
+    uint32_t where = mmio_32 ? mmio_read_32(ST_DBG_IP_T2H_WHERE) : (uint32_t) (howlong_where >> 32);
     *payload = where + g_std_dbg_ip_info.T2H_MEM_BASE_ADDR;
     header->SOP_EOP = 0;  // Be sure to clear this!
     if (g_t2h_sop)
@@ -328,7 +631,14 @@ int get_t2h_data(H2T_PACKET_HEADER* header, uint32_t* payload)
     {
         g_t2h_sop = 0;
     }
-    uint64_t connid_channelid = fpga_read_64(g_mmio_handle, ST_DBG_IP_T2H_CONNECTION_ID);
+    if (mmio_32)
+    {
+        // CHANNEL_ID_ADVANCE goes last, reading it pops the descriptor
+        header->CONN_ID = (unsigned char) mmio_read_32(ST_DBG_IP_T2H_CONNECTION_ID);
+        header->CHANNEL = (uint16_t) mmio_read_32(ST_DBG_IP_T2H_CHANNEL_ID_ADVANCE);
+        return 0;
+    }
+    uint64_t connid_channelid = mmio_read_64(ST_DBG_IP_T2H_CONNECTION_ID);
     header->CONN_ID = (unsigned char) (connid_channelid);
     header->CHANNEL = (uint16_t) (connid_channelid >> 32);
     return 0;
@@ -336,15 +646,16 @@ int get_t2h_data(H2T_PACKET_HEADER* header, uint32_t* payload)
 
 inline void t2h_data_complete()
 {
-    fpga_write_32(g_mmio_handle, ST_DBG_IP_T2H_DESCRIPTORS_DONE, 1);
+    mmio_write_32(ST_DBG_IP_T2H_DESCRIPTORS_DONE, 1);
 }
 
 // Reads out the next MGMT RSP data if non-empty
 int get_mgmt_rsp_data(MGMT_PACKET_HEADER* header, uint32_t* payload)
 {
-    uint64_t howlong_where = fpga_read_64(g_mmio_handle, ST_DBG_IP_MGMT_RSP_HOW_LONG);
+    const int mmio_32 = (g_mmio_width == MMIO_WIDTH_32);
+    uint64_t howlong_where = mmio_32 ? mmio_read_32(ST_DBG_IP_MGMT_RSP_HOW_LONG)
+                                     : mmio_read_64(ST_DBG_IP_MGMT_RSP_HOW_LONG);
     uint32_t last_howlong = (uint32_t) howlong_where;
-    uint32_t where = (uint32_t) (howlong_where >> 32);
 
     // Early return no need to do more work if there is no data
     header->DATA_LEN_BYTES = (unsigned short) (last_howlong & ST_DBG_IP_HOW_LONG_MASK);
@@ -352,6 +663,8 @@ int get_mgmt_rsp_data(MGMT_PACKET_HEADER* header, uint32_t* payload)
     {
         return 0;
     }
+    uint32_t where =
+        mmio_32 ? mmio_read_32(ST_DBG_IP_MGMT_RSP_WHERE) : (uint32_t) (howlong_where >> 32);
     *payload = where + g_std_dbg_ip_info.MGMT_RSP_MEM_BASE_ADDR;
     header->SOP_EOP = 0;  // Be sure to clear this!
     if (g_mgmt_rsp_sop)
@@ -368,42 +681,30 @@ int get_mgmt_rsp_data(MGMT_PACKET_HEADER* header, uint32_t* payload)
         g_mgmt_rsp_sop = 0;
     }
 
-    header->CHANNEL = fpga_read_32(g_mmio_handle, ST_DBG_IP_MGMT_RSP_CHANNEL_ID_ADVANCE);
+    header->CHANNEL = mmio_read_32(ST_DBG_IP_MGMT_RSP_CHANNEL_ID_ADVANCE);
 
     return 0;
 }
 
 void mgmt_rsp_data_complete()
 {
-    fpga_write_32(g_mmio_handle, ST_DBG_IP_MGMT_RSP_DESCRIPTORS_DONE, 1);
+    mmio_write_32(ST_DBG_IP_MGMT_RSP_DESCRIPTORS_DONE, 1);
 }
 
+// Switching resets both queues
 void set_loopback_mode(int val)
 {
-    uint32_t rd = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK);
-    if (val == 1)
-    {
-        fpga_write_32(g_mmio_handle,
-                      ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK,
-                      rd | ST_DBG_IP_CONFIG_H2T_T2H_LOOPBACK_FIELD |
-                          ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD |
-                          ST_DBG_IP_CONFIG_MGMT_AND_RSP_RESET_FIELD |
-                          ST_DBG_IP_CONFIG_MGMT_AND_RSP_LOOPBACK_FIELD);
-    }
-    else
-    {
-        fpga_write_32(g_mmio_handle,
-                      ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK,
-                      (rd & ~ST_DBG_IP_CONFIG_H2T_T2H_LOOPBACK_FIELD) |
-                          ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD |
-                          ~ST_DBG_IP_CONFIG_MGMT_AND_RSP_RESET_FIELD |
-                          ST_DBG_IP_CONFIG_MGMT_AND_RSP_LOOPBACK_FIELD);
-    }
+    const uint32_t loopback_fields =
+        ST_DBG_IP_CONFIG_H2T_T2H_LOOPBACK_FIELD | ST_DBG_IP_CONFIG_MGMT_AND_RSP_LOOPBACK_FIELD;
+    const uint32_t rd = read_reset_and_loopback();
+    write_reset_and_loopback(((val == 1) ? (rd | loopback_fields) : (rd & ~loopback_fields)) |
+                             ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD |
+                             ST_DBG_IP_CONFIG_MGMT_AND_RSP_RESET_FIELD);
 }
 
 int get_loopback_mode()
 {
-    uint32_t rd = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK);
+    uint32_t rd = read_reset_and_loopback();
     if ((rd & ST_DBG_IP_CONFIG_H2T_T2H_LOOPBACK_FIELD) > 0)
     {
         return 1;
@@ -416,24 +717,20 @@ int get_loopback_mode()
 
 void enable_interrupts(int val)
 {
-    uint32_t rd = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK);
+    uint32_t rd = read_reset_and_loopback();
     if (val == 1)
     {
-        fpga_write_32(g_mmio_handle,
-                      ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK,
-                      rd | ST_DBG_IP_CONFIG_ENABLE_INT_FIELD);
+        write_reset_and_loopback(rd | ST_DBG_IP_CONFIG_ENABLE_INT_FIELD);
     }
     else
     {
-        fpga_write_32(g_mmio_handle,
-                      ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK,
-                      rd & ~ST_DBG_IP_CONFIG_ENABLE_INT_FIELD);
+        write_reset_and_loopback(rd & ~ST_DBG_IP_CONFIG_ENABLE_INT_FIELD);
     }
 }
 
 int get_mgmt_support()
 {
-    uint32_t rd = fpga_read_32(g_mmio_handle, ST_DBG_IP_CONFIG_MGMT_MGMT_RSP_DESC_DEPTH);
+    uint32_t rd = read_mgmt_desc_depth();
     if (rd > 0)
     {
         return 1;
@@ -446,9 +743,9 @@ int get_mgmt_support()
 
 int check_version_and_type(uint32_t *version)
 {
-    uint64_t type_version = fpga_read_64(g_mmio_handle, ST_DBG_IP_CONFIG_TYPE);
-    uint32_t type = (uint32_t) type_version;
-    *version = (uint32_t) (type_version >> 32);
+    // 32-bit reads, the MMIO width is not known yet
+    uint32_t type = mmio_read_32(ST_DBG_IP_CONFIG_TYPE);
+    *version = mmio_read_32(ST_DBG_IP_CONFIG_VERSION);
     if ((type != SUPPORTED_TYPE_SIGNATURE) || (*version > SUPPORTED_VERSION))
     {
         if (type != SUPPORTED_TYPE_SIGNATURE)
@@ -475,30 +772,241 @@ int check_version_and_type(uint32_t *version)
 
 void assert_h2t_t2h_reset()
 {
-    fpga_write_32(
-        g_mmio_handle, ST_DBG_IP_CONFIG_RESET_AND_LOOPBACK, ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD);
+    write_reset_and_loopback(ST_DBG_IP_CONFIG_H2T_T2H_RESET_FIELD);
+}
+
+static inline uint64_t copy_read_word(COPY_KERNEL kernel, uint64_t offset)
+{
+    if (kernel == COPY_KERNEL_MMIO32)
+    {
+        uint64_t low = mmio_read_32(offset);
+        return low | ((uint64_t) mmio_read_32(offset + 4) << 32);
+    }
+    return mmio_read_64(offset);
+}
+
+static inline void copy_write_word(COPY_KERNEL kernel, uint64_t offset, uint64_t value)
+{
+    if (kernel == COPY_KERNEL_MMIO32)
+    {
+        mmio_write_32(offset, (uint32_t) value);
+        mmio_write_32(offset + 4, (uint32_t) (value >> 32));
+    }
+    else
+    {
+        mmio_write_64(offset, value);
+    }
 }
 
 void memcpy64_fpga2host(int32_t fpga_buff, uint64_t* host_buff, size_t len)
 {
-    size_t transfers = (len + 7) / 8;
-    size_t i;
-    for (i = 0; i < transfers; ++i)
+    // The memory may have been written in the open batch, e.g. by a server loopback
+    if (!write_queue_is_empty(&g_write_queue))
     {
-        *host_buff++ = fpga_read_64(g_mmio_handle, fpga_buff);
-        fpga_buff += 8;
+        flush_write_queue();
+    }
+    const COPY_STRATEGY strategy = g_copy_strategy[COPY_DIRECTION_T2H];
+    const size_t transfers = (len + 7) / 8;
+    uint64_t chunk[COPY_STRATEGY_MAX_CHUNK_WORDS];
+    size_t i = 0;
+    while (i < transfers)
+    {
+        const size_t words = MIN_MACRO(strategy.chunk_words, transfers - i);
+        size_t j;
+        for (j = 0; j < words; ++j)
+        {
+            chunk[j] = copy_read_word(strategy.kernel, (uint64_t) fpga_buff + (i + j) * 8);
+        }
+        memcpy(&host_buff[i], chunk, words * sizeof(uint64_t));
+        i += words;
     }
 }
 
 void memcpy64_host2fpga(uint64_t* host_buff, int32_t fpga_buff, size_t len)
 {
-    size_t transfers = (len + 7) / 8;
-    size_t i;
-    for (i = 0; i < transfers; ++i)
+    if (g_write_queue.is_open)
     {
-        fpga_write_64(g_mmio_handle, fpga_buff, *host_buff++);
-        fpga_buff += 8;
+        if (!write_queue_has_payload_room(&g_write_queue, len))
+        {
+            flush_write_queue();
+        }
+        if (write_queue_has_payload_room(&g_write_queue, len))
+        {
+            write_queue_add_payload(&g_write_queue, host_buff, (uint32_t) fpga_buff, len);
+            return;
+        }
+        // Too large to stage, it goes out right away, still ahead of its descriptor
     }
+    copy_host2fpga(host_buff, fpga_buff, len);
+}
+
+static void copy_host2fpga(const uint64_t* host_buff, int32_t fpga_buff, size_t len)
+{
+    const COPY_STRATEGY strategy = g_copy_strategy[COPY_DIRECTION_H2T];
+    const size_t transfers = (len + 7) / 8;
+    uint64_t chunk[COPY_STRATEGY_MAX_CHUNK_WORDS];
+    size_t i = 0;
+    while (i < transfers)
+    {
+        const size_t words = MIN_MACRO(strategy.chunk_words, transfers - i);
+        size_t j;
+        memcpy(chunk, &host_buff[i], words * sizeof(uint64_t));
+        for (j = 0; j < words; ++j)
+        {
+            copy_write_word(strategy.kernel, (uint64_t) fpga_buff + (i + j) * 8, chunk[j]);
+        }
+        i += words;
+    }
+}
+
+void begin_mmio_write_batch()
+{
+    g_write_queue.is_open = 1;
+}
+
+void end_mmio_write_batch()
+{
+    if (!write_queue_is_empty(&g_write_queue))
+    {
+        flush_write_queue();
+    }
+    g_write_queue.is_open = 0;
+}
+
+// The type and version CSRs read as one 64-bit register. A bridge without 64-bit MMIO does not
+// return both halves of it.
+static MMIO_WIDTH probe_mmio_width(uint32_t version)
+{
+    const uint64_t type_version = mmio_read_64(ST_DBG_IP_CONFIG_TYPE);
+    const uint64_t expected = SUPPORTED_TYPE_SIGNATURE | ((uint64_t) version << 32);
+    return (type_version == expected) ? MMIO_WIDTH_64 : MMIO_WIDTH_32;
+}
+
+static void apply_mmio_width(MMIO_WIDTH width)
+{
+    if (width != g_mmio_width)
+    {
+        fpga_msg_printf(
+            FPGA_MSG_PRINTF_INFO, "Using %d-bit MMIO\n", (width == MMIO_WIDTH_32) ? 32 : 64);
+    }
+    g_mmio_width = width;
+    // 64-bit payload accesses are not available either
+    int direction;
+    for (direction = 0; direction < NUM_COPY_DIRECTIONS; ++direction)
+    {
+        set_copy_strategy((COPY_DIRECTION) direction, g_copy_strategy[direction]);
+    }
+}
+
+void set_mmio_width(MMIO_WIDTH width)
+{
+    g_requested_mmio_width = width;
+    if (width != MMIO_WIDTH_AUTO)
+    {
+        apply_mmio_width(width);
+    }
+}
+
+MMIO_WIDTH get_mmio_width()
+{
+    return g_mmio_width;
+}
+
+void set_copy_strategy(COPY_DIRECTION direction, COPY_STRATEGY strategy)
+{
+    if (g_mmio_width == MMIO_WIDTH_32)
+    {
+        strategy.kernel = COPY_KERNEL_MMIO32;
+    }
+    g_copy_strategy[direction] = strategy;
+}
+
+COPY_STRATEGY get_copy_strategy(COPY_DIRECTION direction)
+{
+    return g_copy_strategy[direction];
+}
+
+int format_copy_strategy(COPY_STRATEGY strategy, char* buff, size_t buff_sz)
+{
+    return snprintf(buff,
+                    buff_sz,
+                    "%s:%u",
+                    COPY_KERNEL_NAMES[strategy.kernel],
+                    (unsigned int) strategy.chunk_words);
+}
+
+// Parses one "<kernel>:<chunk words>", returns where it stopped or NULL if it is malformed
+static const char* parse_copy_strategy(const char* text, COPY_STRATEGY* strategy)
+{
+    int kernel;
+    for (kernel = 0; kernel < NUM_COPY_KERNELS; ++kernel)
+    {
+        const size_t name_len = strlen(COPY_KERNEL_NAMES[kernel]);
+        if ((strncmp(text, COPY_KERNEL_NAMES[kernel], name_len) == 0) && (text[name_len] == ':'))
+        {
+            char* end;
+            unsigned long chunk_words = strtoul(&text[name_len + 1], &end, 10);
+            if ((end == &text[name_len + 1]) || (chunk_words == 0) ||
+                (chunk_words > COPY_STRATEGY_MAX_CHUNK_WORDS))
+            {
+                return NULL;
+            }
+            strategy->kernel = (COPY_KERNEL) kernel;
+            strategy->chunk_words = (uint32_t) chunk_words;
+            return end;
+        }
+    }
+    return NULL;
+}
+
+int set_copy_strategy_spec(const char* spec)
+{
+    COPY_STRATEGY h2t;
+    COPY_STRATEGY t2h;
+    const char* end = parse_copy_strategy(spec, &h2t);
+    if ((end != NULL) && (*end == ','))
+    {
+        end = parse_copy_strategy(end + 1, &t2h);
+    }
+    else
+    {
+        t2h = h2t;
+    }
+    // Allow trailing white space, e.g. the line end of a control command
+    if ((end == NULL) || ((*end != '\0') && !isspace((unsigned char) *end)))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR,
+                        "Invalid copy strategy '%s', expected <kernel>:<chunk words>[,...] with "
+                        "kernel mmio64 or mmio32 and 1 to %d words\n",
+                        spec,
+                        COPY_STRATEGY_MAX_CHUNK_WORDS);
+        return -1;
+    }
+    set_copy_strategy(COPY_DIRECTION_H2T, h2t);
+    set_copy_strategy(COPY_DIRECTION_T2H, t2h);
+    return 0;
+}
+
+void get_h2t_occupancy(BUFFER_OCCUPANCY* occupancy)
+{
+    occupancy->ring_size = g_h2t_rx_cbuff.span;
+    occupancy->ring_used = g_h2t_rx_cbuff.span - cbuff_space_available(&g_h2t_rx_cbuff);
+    occupancy->descriptor_depth = g_h2t_descriptors.depth;
+    occupancy->descriptors_used = desc_tracker_in_flight(&g_h2t_descriptors);
+}
+
+void get_mgmt_occupancy(BUFFER_OCCUPANCY* occupancy)
+{
+    occupancy->ring_size = g_mgmt_rx_cbuff.span;
+    occupancy->ring_used = g_mgmt_rx_cbuff.span - cbuff_space_available(&g_mgmt_rx_cbuff);
+    occupancy->descriptor_depth = g_mgmt_descriptors.depth;
+    occupancy->descriptors_used = desc_tracker_in_flight(&g_mgmt_descriptors);
+}
+
+void get_mmio_op_counts(uint64_t* reads, uint64_t* writes)
+{
+    *reads = g_mmio_read_count;
+    *writes = g_mmio_write_count;
 }
 
 int set_driver_param(const char* param, const char* val)
@@ -514,6 +1022,29 @@ int set_driver_param(const char* param, const char* val)
             set_loopback_mode(0);
         }
     }
+    else if (strncmp(param, MMIO_LOG_PARAM, MMIO_LOG_PARAM_LEN) == 0)
+    {
+        if (strncmp(val, "1", 1) == 0)
+        {
+            if (start_mmio_log() != OK)
+            {
+                return -1;
+            }
+            log_mmio_regions();
+        }
+        else
+        {
+            stop_mmio_log();
+        }
+    }
+    else if (strncmp(param, COPY_STRATEGY_PARAM, COPY_STRATEGY_PARAM_LEN) == 0)
+    {
+        if (strncmp(val, "auto", 4) == 0)
+        {
+            return calibrate_copy_strategy(&g_std_dbg_ip_info);
+        }
+        return set_copy_strategy_spec(val);
+    }
 
     return 0;
 }
@@ -531,6 +1062,22 @@ char* get_driver_param(const char* param)
             return "1";
         }
     }
+    else if (strncmp(param, MMIO_LOG_PARAM, MMIO_LOG_PARAM_LEN) == 0)
+    {
+        return is_mmio_log_enabled() ? "1" : "0";
+    }
+    else if (strncmp(param, MMIO_WIDTH_PARAM, MMIO_WIDTH_PARAM_LEN) == 0)
+    {
+        return (g_mmio_width == MMIO_WIDTH_32) ? "32" : "64";
+    }
+    else if (strncmp(param, COPY_STRATEGY_PARAM, COPY_STRATEGY_PARAM_LEN) == 0)
+    {
+        static char spec[COPY_STRATEGY_SPEC_MAX_LEN];
+        int len = format_copy_strategy(g_copy_strategy[COPY_DIRECTION_H2T], spec, sizeof(spec));
+        spec[len++] = ',';
+        format_copy_strategy(g_copy_strategy[COPY_DIRECTION_T2H], &spec[len], sizeof(spec) - len);
+        return spec;
+    }
     else if (strncmp(param, MGMT_SUPPORT_PARAM, MGMT_SUPPORT_PARAM_LEN) == 0)
     {
         if (get_mgmt_support() == 1)
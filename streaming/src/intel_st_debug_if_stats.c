@@ -0,0 +1,354 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_common.h"
+#include "intel_st_debug_if_stats.h"
+#include "intel_st_debug_if_metrics_layout.h"
+
+_Static_assert(NUM_STALL_REASONS == ETHERLINK_STATS_STALL_REASON_COUNT,
+               "Stall reasons are out of sync with the stats page layout");
+_Static_assert(NUM_LATENCY_STREAMS == ETHERLINK_STATS_STREAM_COUNT,
+               "Streams are out of sync with the stats page layout");
+
+static const char* const STALL_REASON_NAMES[NUM_STALL_REASONS] =
+    ETHERLINK_STATS_STALL_REASON_NAMES;
+
+#define MAX_LATENCY_LINE_LEN 160
+
+static const char* const LATENCY_STREAM_NAMES[NUM_LATENCY_STREAMS] = ETHERLINK_STATS_STREAM_NAMES;
+
+// Includes the still open part of an ongoing stall
+static uint64_t get_stall_ticks(const SERVER_STALL_STATS* stats, int reason, uint64_t now)
+{
+    uint64_t ticks = stats->ticks[reason];
+    if (stats->since[reason] != 0)
+    {
+        ticks += now - stats->since[reason];
+    }
+    return ticks;
+}
+
+void reset_stall_stats(SERVER_STALL_STATS* stats)
+{
+    zero_mem(stats, sizeof(*stats));
+    stats->session_start = get_timestamp_ticks();
+}
+
+const char* get_stall_reason_name(SERVER_STALL_REASON reason)
+{
+    return (reason < NUM_STALL_REASONS) ? STALL_REASON_NAMES[reason] : "unknown";
+}
+
+uint64_t get_stall_time_ns(const SERVER_STALL_STATS* stats, SERVER_STALL_REASON reason)
+{
+    return timestamp_ticks_to_ns(get_stall_ticks(stats, reason, get_timestamp_ticks()));
+}
+
+int format_stall_stats(const SERVER_STALL_STATS* stats,
+                       const char* reason_name,
+                       char* buff,
+                       size_t buff_sz)
+{
+    const uint64_t now = get_timestamp_ticks();
+    int i;
+    if ((reason_name != NULL) && (*reason_name != '\0'))
+    {
+        for (i = 0; i < NUM_STALL_REASONS; ++i)
+        {
+            if (strcmp(reason_name, STALL_REASON_NAMES[i]) == 0)
+            {
+                return snprintf(buff,
+                                buff_sz,
+                                "%llu %llu",
+                                (unsigned long long) stats->events[i],
+                                (unsigned long long) (timestamp_ticks_to_ns(
+                                                          get_stall_ticks(stats, i, now)) /
+                                                      1000));
+            }
+        }
+        return -1;
+    }
+
+    size_t len = 0;
+    buff[0] = '\0';
+    for (i = 0; (i < NUM_STALL_REASONS) && (len < buff_sz); ++i)
+    {
+        int n = snprintf(buff + len,
+                         buff_sz - len,
+                         "%s%s=%llu:%llu",
+                         (i == 0) ? "" : " ",
+                         STALL_REASON_NAMES[i],
+                         (unsigned long long) stats->events[i],
+                         (unsigned long long) (timestamp_ticks_to_ns(
+                                                   get_stall_ticks(stats, i, now)) /
+                                               1000));
+        if (n < 0)
+        {
+            break;
+        }
+        len += (size_t) n;
+    }
+    return (int) MIN_MACRO(len, buff_sz);
+}
+
+void dump_stall_stats(const SERVER_STALL_STATS* stats)
+{
+    const uint64_t now = get_timestamp_ticks();
+    const uint64_t session_ns = timestamp_ticks_to_ns(now - stats->session_start);
+    int i;
+
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                    "Session stall accounting over %llu ms:\n",
+                    (unsigned long long) (session_ns / 1000000));
+    for (i = 0; i < NUM_STALL_REASONS; ++i)
+    {
+        uint64_t stall_ns = timestamp_ticks_to_ns(get_stall_ticks(stats, i, now));
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO,
+                        "  %-10s events=%-10llu time=%llu us (%.1f%%)\n",
+                        STALL_REASON_NAMES[i],
+                        (unsigned long long) stats->events[i],
+                        (unsigned long long) (stall_ns / 1000),
+                        (session_ns > 0) ? (100.0 * (double) stall_ns / (double) session_ns) : 0.0);
+    }
+}
+
+// Largest value that falls into the bucket
+static uint64_t get_latency_bucket_upper_bound(unsigned int index)
+{
+    if (index < LATENCY_SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+    const unsigned int shift = (index >> LATENCY_SUB_BUCKET_BITS) - 1;
+    const uint64_t sub_bucket = LATENCY_SUB_BUCKET_COUNT + (index & (LATENCY_SUB_BUCKET_COUNT - 1));
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+// 'per_mille' of the recorded values are at or below the returned value
+static uint64_t get_latency_percentile(const LATENCY_HISTOGRAM* histogram, unsigned int per_mille)
+{
+    const uint64_t rank = (histogram->total * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    unsigned int i;
+    for (i = 0; i < LATENCY_BUCKET_COUNT; ++i)
+    {
+        seen += histogram->counts[i];
+        if ((seen >= rank) && (seen > 0))
+        {
+            const uint64_t upper_bound = get_latency_bucket_upper_bound(i);
+            return (upper_bound < histogram->max) ? upper_bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void reset_latency_histogram(LATENCY_HISTOGRAM* histogram)
+{
+    zero_mem(histogram, sizeof(*histogram));
+}
+
+void reset_latency_stats(SERVER_LATENCY_STATS* stats)
+{
+    zero_mem(stats, sizeof(*stats));
+}
+
+SERVER_LATENCY_STREAM get_latency_stream(const char* stream_name)
+{
+    int i;
+    for (i = 0; i < NUM_LATENCY_STREAMS; ++i)
+    {
+        if (strcmp(stream_name, LATENCY_STREAM_NAMES[i]) == 0)
+        {
+            return (SERVER_LATENCY_STREAM) i;
+        }
+    }
+    return NUM_LATENCY_STREAMS;
+}
+
+const char* get_latency_stream_name(SERVER_LATENCY_STREAM stream)
+{
+    return (stream < NUM_LATENCY_STREAMS) ? LATENCY_STREAM_NAMES[stream] : "unknown";
+}
+
+int format_latency_histogram(const LATENCY_HISTOGRAM* histogram, char* buff, size_t buff_sz)
+{
+    return snprintf(
+        buff,
+        buff_sz,
+        "n=%llu min=%llu p50=%llu p90=%llu p99=%llu p999=%llu max=%llu",
+        (unsigned long long) histogram->total,
+        (unsigned long long) timestamp_ticks_to_ns(histogram->min),
+        (unsigned long long) timestamp_ticks_to_ns(get_latency_percentile(histogram, 500)),
+        (unsigned long long) timestamp_ticks_to_ns(get_latency_percentile(histogram, 900)),
+        (unsigned long long) timestamp_ticks_to_ns(get_latency_percentile(histogram, 990)),
+        (unsigned long long) timestamp_ticks_to_ns(get_latency_percentile(histogram, 999)),
+        (unsigned long long) timestamp_ticks_to_ns(histogram->max));
+}
+
+void dump_latency_stats(const SERVER_LATENCY_STATS* stats)
+{
+    char line[MAX_LATENCY_LINE_LEN];
+    int i;
+
+    fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "Session latency (ns):\n");
+    for (i = 0; i < NUM_LATENCY_STREAMS; ++i)
+    {
+        format_latency_histogram(&(stats->histograms[i]), line, sizeof(line));
+        fpga_msg_printf(FPGA_MSG_PRINTF_INFO, "  %-10s %s\n", LATENCY_STREAM_NAMES[i], line);
+    }
+}
+
+static uint64_t get_channel_packets(const CHANNEL_STATS_ENTRY* entry)
+{
+    uint64_t packets = 0;
+    int i;
+    for (i = 0; i < CHANNEL_STATS_SIZE_BUCKET_COUNT; ++i)
+    {
+        packets += entry->size_buckets[i];
+    }
+    return packets;
+}
+
+RETURN_CODE alloc_channel_stats(SERVER_CHANNEL_STATS* stats)
+{
+    stats->entries = (CHANNEL_STATS_ENTRY*) calloc(
+        NUM_CHANNEL_DIRECTIONS * CHANNEL_STATS_CHANNEL_COUNT, sizeof(CHANNEL_STATS_ENTRY));
+    return (stats->entries != NULL) ? OK : FAILURE;
+}
+
+void free_channel_stats(SERVER_CHANNEL_STATS* stats)
+{
+    if (stats->entries != NULL)
+    {
+        free(stats->entries);
+        stats->entries = NULL;
+    }
+}
+
+void reset_channel_stats(SERVER_CHANNEL_STATS* stats)
+{
+    zero_mem(stats->entries,
+             NUM_CHANNEL_DIRECTIONS * CHANNEL_STATS_CHANNEL_COUNT * sizeof(CHANNEL_STATS_ENTRY));
+}
+
+CHANNEL_DIRECTION get_channel_direction(const char* direction_name)
+{
+    if (strcmp(direction_name, "h2t") == 0)
+    {
+        return CHANNEL_H2T;
+    }
+    if (strcmp(direction_name, "t2h") == 0)
+    {
+        return CHANNEL_T2H;
+    }
+    return NUM_CHANNEL_DIRECTIONS;
+}
+
+int format_channel_top(const SERVER_CHANNEL_STATS* stats,
+                       CHANNEL_DIRECTION direction,
+                       unsigned int top_n,
+                       char* buff,
+                       size_t buff_sz)
+{
+    const CHANNEL_STATS_ENTRY* entries = &(stats->entries[direction * CHANNEL_STATS_CHANNEL_COUNT]);
+    unsigned short top[CHANNEL_STATS_MAX_TOP_N];
+    unsigned int top_count = 0;
+    unsigned int channel;
+    unsigned int i;
+
+    buff[0] = '\0';
+    top_n = MIN_MACRO(top_n, CHANNEL_STATS_MAX_TOP_N);
+    if (top_n == 0)
+    {
+        return 0;
+    }
+
+    // Insertion into a short sorted list, idle channels are skipped
+    for (channel = 0; channel < CHANNEL_STATS_CHANNEL_COUNT; ++channel)
+    {
+        const uint64_t bytes = entries[channel].bytes;
+        if ((get_channel_packets(&(entries[channel])) == 0) ||
+            ((top_count == top_n) && (bytes <= entries[top[top_count - 1]].bytes)))
+        {
+            continue;
+        }
+        i = (top_count < top_n) ? top_count++ : top_count - 1;
+        for (; (i > 0) && (entries[top[i - 1]].bytes < bytes); --i)
+        {
+            top[i] = top[i - 1];
+        }
+        top[i] = (unsigned short) channel;
+    }
+
+    size_t len = 0;
+    for (i = 0; i < top_count; ++i)
+    {
+        char item[64];
+        int n = snprintf(item,
+                         sizeof(item),
+                         "%s%u=%llu:%llu",
+                         (i == 0) ? "" : " ",
+                         (unsigned int) top[i],
+                         (unsigned long long) entries[top[i]].bytes,
+                         (unsigned long long) get_channel_packets(&(entries[top[i]])));
+        // Only whole entries are reported
+        if ((n < 0) || (len + (size_t) n >= buff_sz))
+        {
+            break;
+        }
+        memcpy(buff + len, item, (size_t) n + 1);
+        len += (size_t) n;
+    }
+    return (int) len;
+}
+
+int format_channel_stats(const SERVER_CHANNEL_STATS* stats,
+                         CHANNEL_DIRECTION direction,
+                         unsigned short channel,
+                         char* buff,
+                         size_t buff_sz)
+{
+    const CHANNEL_STATS_ENTRY* entry =
+        &(stats->entries[direction * CHANNEL_STATS_CHANNEL_COUNT +
+                         (channel & H2T_PACKET_HEADER_MASK_CHANNEL)]);
+    return snprintf(buff,
+                    buff_sz,
+                    "bytes=%llu packets=%llu le64=%u le256=%u le512=%u le1k=%u le2k=%u gt2k=%u",
+                    (unsigned long long) entry->bytes,
+                    (unsigned long long) get_channel_packets(entry),
+                    (unsigned int) entry->size_buckets[0],
+                    (unsigned int) entry->size_buckets[1],
+                    (unsigned int) entry->size_buckets[2],
+                    (unsigned int) entry->size_buckets[3],
+                    (unsigned int) entry->size_buckets[4],
+                    (unsigned int) entry->size_buckets[5]);
+}
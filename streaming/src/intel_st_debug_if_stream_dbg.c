@@ -24,9 +24,15 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <limits.h>
+#include <string.h>
 #include "intel_st_debug_if_stream_dbg.h"
 #include "intel_st_debug_if_server.h"
+#include "intel_st_debug_if_self_bench.h"
+#include "intel_st_debug_if_copy_calibration.h"
+#include "intel_st_debug_if_timestamp.h"
 #include "intel_st_debug_if_st_dbg_ip_driver.h"
+#include "intel_st_debug_if_mmio_log.h"
 #include "intel_st_debug_if_platform.h"
 #include "intel_fpga_api.h"
 
@@ -39,6 +45,9 @@ enum
 };
 static char g_ctrl_rx_buff[CTRL_RX_BUFF_SZ] = {0};
 static char g_ctrl_tx_buff[CTRL_TX_BUFF_SZ] = {0};
+// uint64_t keeps the packet payloads of the frames 8-byte aligned for the driver copies
+static uint64_t g_mux_rx_buff[(MUX_BUFF_SZ + 7) / 8] = {0};
+static uint64_t g_mux_tx_buff[(MUX_BUFF_SZ + 7) / 8] = {0};
 
 static SERVER_HW_CALLBACKS get_hw_callbacks()
 {
@@ -46,16 +55,24 @@ static SERVER_HW_CALLBACKS get_hw_callbacks()
     result.init_driver = init_driver;
     result.set_param = set_driver_param;
     result.get_param = get_driver_param;
+    result.get_mmio_counts = get_mmio_op_counts;
+    result.get_h2t_occupancy = get_h2t_occupancy;
     result.get_h2t_buffer = get_h2t_buffer;
+    result.get_h2t_buffer_chunk = get_h2t_buffer_chunk;
+    result.get_h2t_wait_reason = get_h2t_buffer_wait_reason;
     result.h2t_data_received = push_h2t_data;
     result.acquire_t2h_data = get_t2h_data;
     result.t2h_data_complete = t2h_data_complete;
+    result.begin_write_batch = begin_mmio_write_batch;
+    result.end_write_batch = end_mmio_write_batch;
 #if ENABLE_MGMT != 0
     result.has_mgmt_support = get_mgmt_support;
     result.get_mgmt_buffer = get_mgmt_buffer;
+    result.get_mgmt_wait_reason = get_mgmt_buffer_wait_reason;
     result.mgmt_data_received = push_mgmt_data;
     result.acquire_mgmt_rsp_data = get_mgmt_rsp_data;
     result.mgmt_rsp_data_complete = mgmt_rsp_data_complete;
+    result.get_mgmt_occupancy = get_mgmt_occupancy;
 #endif
     return result;
 }
@@ -67,11 +84,50 @@ void init_st_dbg_transport_server_over_tcpip(intel_remote_debug_server_context*
 {
     context->port = port;
     context->h2t_t2h_mem_size = size;
+    context->listen_fd = -1;
+    context->unix_socket_path = NULL;
+    context->exec_argv = NULL;
+    context->metrics_port = -1;
+    context->metrics_unix_path = NULL;
+    context->stats_page_name = NULL;
+    context->trace_file = NULL;
+    context->mmio_log_file = NULL;
+    context->capture_file = NULL;
+    context->copy_strategy = NULL;
+    context->mmio_width = MMIO_WIDTH_AUTO;
+    context->h2t_coalesce = NULL;
     context->driver_cxt.mmio_handle =
         mmio_handle;  // TODO: this should be filled by the driver init(). driver_init() should be
                       // called here as well.
 }
 
+// Applies the MMIO width and copy strategy given on the command line, or picks a copy strategy
+// by timing the IP memories. The memory map comes from the driver, which is initialized again for
+// each client.
+static RETURN_CODE init_mmio_access(intel_remote_debug_server_context* context)
+{
+    if (context->mmio_width != MMIO_WIDTH_AUTO)
+    {
+        set_mmio_width(context->mmio_width);
+    }
+    if ((context->copy_strategy != NULL) && (strcmp(context->copy_strategy, "auto") != 0))
+    {
+        return (set_copy_strategy_spec(context->copy_strategy) == 0) ? OK : FAILURE;
+    }
+    int init_driver_rc = init_driver(
+        &(context->driver_cxt), context->h2t_t2h_mem_size, context->driver_cxt.mmio_handle);
+    if (init_driver_rc != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_WARNING,
+                        "Failed to initialize driver: %d, copy calibration skipped\n",
+                        init_driver_rc);
+        return OK;
+    }
+    calibrate_timestamp_ticks();
+    calibrate_copy_strategy(&(context->driver_cxt.std_dbg_ip_info));
+    return OK;
+}
+
 int start_st_dbg_transport_server_over_tcpip(intel_remote_debug_server_context* context)
 {
     int ret = 0;
@@ -82,14 +138,72 @@ int start_st_dbg_transport_server_over_tcpip(intel_remote_debug_server_context*
     buffers.ctrl_rx_buff_sz = CTRL_RX_BUFF_SZ;
     buffers.ctrl_tx_buff = g_ctrl_tx_buff;
     buffers.ctrl_tx_buff_sz = CTRL_TX_BUFF_SZ;
+    buffers.mux_rx_buff = (unsigned char*) g_mux_rx_buff;
+    buffers.mux_tx_buff = (unsigned char*) g_mux_tx_buff;
 
     SERVER_CONN server_conn = SERVER_CONN_default;
     server_conn.buff = &buffers;
     server_conn.hw_callbacks = get_hw_callbacks();
 
-    if (initialize_server((unsigned short) context->port, &server_conn, SERVER_PORT_FILE) == OK)
+    SOCKET listen_fd = get_activated_listener_socket(context->listen_fd);
+    RETURN_CODE init_rc;
+    if (listen_fd != INVALID_SOCKET)
+    {
+        init_rc = initialize_server_with_listener(listen_fd, &server_conn, SERVER_PORT_FILE);
+    }
+    else if (context->unix_socket_path != NULL)
+    {
+        init_rc = initialize_server_on_unix_socket(context->unix_socket_path, &server_conn);
+    }
+    else
+    {
+        init_rc = initialize_server((unsigned short) context->port, &server_conn, SERVER_PORT_FILE);
+    }
+    if ((init_rc == OK) && (context->h2t_coalesce != NULL))
+    {
+        init_rc = parse_h2t_coalescer_spec(&(server_conn.h2t_coalescer), context->h2t_coalesce);
+    }
+    if (init_rc == OK)
+    {
+        init_rc = set_server_trace_file(context->trace_file);
+    }
+    if ((init_rc == OK) && (context->exec_argv != NULL))
+    {
+        set_server_exec_path(context->exec_argv[0]);
+    }
+    if ((init_rc == OK) && (context->mmio_log_file != NULL))
+    {
+        char path[PATH_MAX];
+        init_rc = set_mmio_log_file(
+            get_server_output_path(context->mmio_log_file, path, sizeof(path)));
+        init_rc = (init_rc == OK) ? start_mmio_log() : init_rc;
+    }
+    if ((init_rc == OK) && (context->capture_file != NULL))
+    {
+        char path[PATH_MAX];
+        init_rc =
+            set_capture_file(get_server_output_path(context->capture_file, path, sizeof(path)));
+        init_rc = (init_rc == OK) ? start_capture() : init_rc;
+    }
+    if (init_rc == OK)
+    {
+        init_rc = init_mmio_access(context);
+    }
+    if ((init_rc == OK) && (context->stats_page_name != NULL))
+    {
+        init_rc = open_stats_page(context->stats_page_name);
+    }
+    if ((init_rc == OK) && ((context->metrics_port >= 0) || (context->metrics_unix_path != NULL)))
+    {
+        init_rc = start_metrics_server(context->metrics_port, context->metrics_unix_path);
+    }
+    if (init_rc == OK)
     {
         ret = server_main(context, MULTIPLE_CLIENTS, &server_conn);
+        stop_metrics_server();
+        close_stats_page();
+        stop_mmio_log();
+        stop_capture();
     }
     else
     {
@@ -101,7 +215,41 @@ int start_st_dbg_transport_server_over_tcpip(intel_remote_debug_server_context*
     return ret;
 }
 
+int run_st_dbg_transport_self_bench(intel_remote_debug_server_context* context)
+{
+    if (init_mmio_access(context) != OK)
+    {
+        return -1;
+    }
+    int init_driver_rc = init_driver(
+        &(context->driver_cxt), context->h2t_t2h_mem_size, context->driver_cxt.mmio_handle);
+    if (init_driver_rc != 0)
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Failed to initialize driver: %d\n", init_driver_rc);
+        return -1;
+    }
+    return run_self_bench(&(context->driver_cxt));
+}
+
 void terminate_st_dbg_transport_server_over_tcpip()
 {
+    stop_metrics_server();
+    stop_mmio_log();
+    stop_capture();
     server_terminate();
 }
+
+void request_st_dbg_transport_server_termination()
+{
+    request_server_termination();
+}
+
+void request_st_dbg_transport_server_listener_handoff()
+{
+    request_server_listener_handoff();
+}
+
+int dump_st_dbg_transport_server_trace()
+{
+    return (dump_server_trace() == OK) ? 0 : -1;
+}
@@ -0,0 +1,80 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdint.h>
+#include <time.h>
+
+#include "intel_st_debug_if_timestamp.h"
+
+static uint64_t g_ticks_per_second = 1000000000ULL;
+
+static uint64_t get_monotonic_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+void calibrate_timestamp_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    const uint64_t CALIBRATION_NS = 10000000;  // 10 ms
+    uint64_t start_ns = get_monotonic_ns();
+    uint64_t start_ticks = get_timestamp_ticks();
+    uint64_t elapsed_ns;
+    do
+    {
+        elapsed_ns = get_monotonic_ns() - start_ns;
+    } while (elapsed_ns < CALIBRATION_NS);
+    uint64_t elapsed_ticks = get_timestamp_ticks() - start_ticks;
+    g_ticks_per_second = (uint64_t) ((double) elapsed_ticks * 1e9 / (double) elapsed_ns);
+#elif defined(__aarch64__)
+    uint64_t freq;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    g_ticks_per_second = freq;
+#else
+    g_ticks_per_second = 1000000000ULL;
+#endif
+    if (g_ticks_per_second == 0)
+    {
+        g_ticks_per_second = 1000000000ULL;
+    }
+}
+
+uint64_t timestamp_ticks_to_ns(uint64_t ticks)
+{
+    return (uint64_t) ((double) ticks * 1e9 / (double) g_ticks_per_second);
+}
+
+uint64_t timestamp_ns_to_ticks(uint64_t ns)
+{
+    return (uint64_t) ((double) ns * (double) g_ticks_per_second / 1e9);
+}
+
+uint64_t get_timestamp_ticks_per_second()
+{
+    return g_ticks_per_second;
+}
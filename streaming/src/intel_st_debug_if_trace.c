@@ -0,0 +1,155 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "intel_fpga_api.h"
+
+#include "intel_st_debug_if_trace.h"
+
+_Static_assert((SERVER_TRACE_RING_RECORDS & (SERVER_TRACE_RING_RECORDS - 1)) == 0,
+               "The trace ring size must be a power of two");
+_Static_assert(sizeof(TRACE_RECORD) == 16, "Trace records are meant to fit 4 per cache line");
+
+SERVER_TRACE_RING g_server_trace_ring;
+
+// Formatted up front, dump_server_trace() runs in signal handlers
+static char g_trace_file[PATH_MAX];
+
+RETURN_CODE set_server_trace_file(const char* path)
+{
+    int len = (path != NULL)
+                  ? snprintf(g_trace_file, sizeof(g_trace_file), "%s", path)
+                  : snprintf(g_trace_file,
+                             sizeof(g_trace_file),
+                             "/tmp/etherlink-trace.%ld.bin",
+                             (long) getpid());
+    if ((len < 0) || ((size_t) len >= sizeof(g_trace_file)))
+    {
+        fpga_msg_printf(FPGA_MSG_PRINTF_ERROR, "Trace file path is too long: %s", path);
+        g_trace_file[0] = '\0';
+        return FAILURE;
+    }
+    return OK;
+}
+
+const char* get_server_trace_file()
+{
+    return g_trace_file;
+}
+
+static int write_all(int fd, const void* buff, size_t len)
+{
+    const char* p = (const char*) buff;
+    while (len > 0)
+    {
+        ssize_t written = write(fd, p, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += written;
+        len -= (size_t) written;
+    }
+    return 0;
+}
+
+RETURN_CODE dump_server_trace()
+{
+    const int saved_errno = errno;
+    RETURN_CODE rc = FAILURE;
+    TRACE_FILE_HEADER header;
+    struct timespec now;
+    int fd;
+
+    if ((g_trace_file[0] == '\0') ||
+        ((fd = open(g_trace_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0))
+    {
+        errno = saved_errno;
+        return FAILURE;
+    }
+
+    // The slot at 'head' may be half written by an interrupted writer, so at most
+    // SERVER_TRACE_RING_RECORDS - 1 records are taken.
+    const uint64_t head = __atomic_load_n(&(g_server_trace_ring.head), __ATOMIC_ACQUIRE);
+    const uint64_t count =
+        (head < SERVER_TRACE_RING_RECORDS) ? head : SERVER_TRACE_RING_RECORDS - 1;
+    const uint64_t first = head - count;
+    const size_t first_slot = (size_t) (first & (SERVER_TRACE_RING_RECORDS - 1));
+    const size_t first_len = (first_slot + count <= SERVER_TRACE_RING_RECORDS)
+                                 ? (size_t) count
+                                 : SERVER_TRACE_RING_RECORDS - first_slot;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(&header, 0, sizeof(header));
+    header.magic = ETHERLINK_TRACE_MAGIC;
+    header.version = ETHERLINK_TRACE_VERSION;
+    header.record_size = sizeof(TRACE_RECORD);
+    header.record_count = count;
+    header.records_invalid = 0;
+    header.records_total = head;
+    header.ticks_per_second = get_timestamp_ticks_per_second();
+    header.dump_ticks = get_timestamp_ticks();
+    header.dump_realtime_ns = (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+    header.pid = (uint64_t) getpid();
+
+    if ((write_all(fd, &header, sizeof(header)) == 0) &&
+        (write_all(fd,
+                   &(g_server_trace_ring.records[first_slot]),
+                   first_len * sizeof(TRACE_RECORD)) == 0) &&
+        (write_all(fd, g_server_trace_ring.records, (count - first_len) * sizeof(TRACE_RECORD)) ==
+         0))
+    {
+        // Records the writer reached while they were copied
+        const uint64_t end = __atomic_load_n(&(g_server_trace_ring.head), __ATOMIC_ACQUIRE);
+        const uint64_t valid_from = end - (SERVER_TRACE_RING_RECORDS - 1);
+        if ((end >= SERVER_TRACE_RING_RECORDS) && (valid_from > first))
+        {
+            header.records_invalid = (valid_from - first < count) ? valid_from - first : count;
+            if (pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header))
+            {
+                rc = OK;
+            }
+        }
+        else
+        {
+            rc = OK;
+        }
+    }
+    close(fd);
+    errno = saved_errno;
+    return rc;
+}
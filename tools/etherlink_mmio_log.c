@@ -0,0 +1,310 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// etherlink-mmio-log: decodes the binary MMIO access logs that etherlink writes with --mmio-log or
+// "SET_DRIVER_PARAM #MMIO_LOG 1" into the CSV format of the former MMIO_LOG build option.
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intel_st_debug_if_mmio_log_layout.h"
+
+enum
+{
+    MAX_FUNCTIONS = 256
+};
+
+static const char* const OP_NAMES[NUM_MMIO_LOG_OPS] = ETHERLINK_MMIO_LOG_OP_NAMES;
+
+typedef struct
+{
+    const unsigned char* p;
+    const unsigned char* end;
+    int truncated;
+} READER;
+
+static void show_help(const char* program)
+{
+    printf(
+        "Usage:\n"
+        " %s [--timestamps] <mmio log>\n\n"
+        "Prints an etherlink MMIO access log as CSV.\n\n"
+        "Optional arguments:\n"
+        " --timestamps, -t   Add a column with the time since the start of the log in us\n"
+        " --help, -h         Print this usage description\n",
+        program);
+}
+
+static uint64_t get_varint(READER* reader)
+{
+    uint64_t value = 0;
+    int shift = 0;
+    while (reader->p < reader->end)
+    {
+        const unsigned char byte = *(reader->p++);
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+        shift += 7;
+    }
+    reader->truncated = 1;
+    return value;
+}
+
+static int64_t get_zigzag(READER* reader)
+{
+    const uint64_t value = get_varint(reader);
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static uint64_t get_region_base(const uint64_t bases[NUM_MMIO_LOG_REGIONS], uint64_t offset)
+{
+    uint64_t base = 0;
+    int i;
+    for (i = 0; i < NUM_MMIO_LOG_REGIONS; ++i)
+    {
+        if ((bases[i] <= offset) && (bases[i] > base))
+        {
+            base = bases[i];
+        }
+    }
+    return base;
+}
+
+// Fills 'bases' from the first region record, accesses before it are attributed with these
+static void find_first_regions(READER reader, uint64_t bases[NUM_MMIO_LOG_REGIONS])
+{
+    int i;
+    while ((reader.p < reader.end) && !reader.truncated)
+    {
+        const unsigned char tag = *(reader.p++);
+        if (tag == MMIO_LOG_TAG_REGIONS)
+        {
+            for (i = 0; i < NUM_MMIO_LOG_REGIONS; ++i)
+            {
+                bases[i] = get_varint(&reader);
+            }
+            return;
+        }
+        else if (tag == MMIO_LOG_TAG_FUNCTION_NAME)
+        {
+            get_varint(&reader);
+            reader.p += (reader.p < reader.end) ? *(reader.p) + 1 : 0;
+        }
+        else if (tag == MMIO_LOG_TAG_DROPPED)
+        {
+            get_varint(&reader);
+        }
+        else
+        {
+            get_varint(&reader);
+            get_zigzag(&reader);
+            if (tag & MMIO_LOG_TAG_FUNCTION_FLAG)
+            {
+                get_varint(&reader);
+            }
+            get_zigzag(&reader);
+            get_varint(&reader);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    MMIO_LOG_FILE_HEADER header;
+    char functions[MAX_FUNCTIONS][256];
+    uint64_t bases[NUM_MMIO_LOG_REGIONS] = {0};
+    int timestamps = 0;
+    int c;
+    int i;
+
+    const struct option longopts[] = {{"help", no_argument, NULL, 'h'},
+                                      {"timestamps", no_argument, NULL, 't'},
+                                      {0, 0, 0, 0}};
+    while ((c = getopt_long(argc, argv, "ht", longopts, NULL)) != -1)
+    {
+        switch (c)
+        {
+            case 't':
+                timestamps = 1;
+                break;
+
+            case 'h':
+            default:
+                show_help(argv[0]);
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        show_help(argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[optind], "rb");
+    if (file == NULL)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    if ((fread(&header, sizeof(header), 1, file) != 1) ||
+        (header.magic != ETHERLINK_MMIO_LOG_MAGIC) || (header.ticks_per_second == 0))
+    {
+        fprintf(stderr, "ERROR: %s is not an etherlink MMIO log\n", argv[optind]);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != ETHERLINK_MMIO_LOG_VERSION)
+    {
+        fprintf(stderr, "ERROR: Unsupported MMIO log version %u\n", header.version);
+        fclose(file);
+        return 1;
+    }
+
+    // Logs are decoded in memory, they are delta encoded and small
+    size_t data_len = 0;
+    size_t data_sz = 1 << 20;
+    unsigned char* data = (unsigned char*) malloc(data_sz);
+    size_t n;
+    while ((data != NULL) && ((n = fread(data + data_len, 1, data_sz - data_len, file)) > 0))
+    {
+        data_len += n;
+        if (data_len == data_sz)
+        {
+            unsigned char* grown = (unsigned char*) realloc(data, data_sz * 2);
+            if (grown == NULL)
+            {
+                free(data);
+            }
+            data = grown;
+            data_sz *= 2;
+        }
+    }
+    fclose(file);
+    if (data == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return 1;
+    }
+
+    READER reader = {data, data + data_len, 0};
+    find_first_regions(reader, bases);
+    for (i = 0; i < MAX_FUNCTIONS; ++i)
+    {
+        strcpy(functions[i], "?");
+    }
+
+    printf("CSR base_addr:64'h%llx\n"
+           "H2T base_addr:64'h%llx\n"
+           "T2H base_addr:64'h%llx\n",
+           (unsigned long long) bases[MMIO_LOG_REGION_CSR],
+           (unsigned long long) bases[MMIO_LOG_REGION_H2T],
+           (unsigned long long) bases[MMIO_LOG_REGION_T2H]);
+    printf("%sline_no,function,type,base_addr,offset,value\n", timestamps ? "time_us," : "");
+
+    const double us_per_tick = 1e6 / (double) header.ticks_per_second;
+    uint64_t ticks = header.start_ticks;
+    uint64_t offset = 0;
+    int64_t line = 0;
+    uint64_t function_id = 0;
+    while ((reader.p < reader.end) && !reader.truncated)
+    {
+        const unsigned char tag = *(reader.p++);
+        if (tag == MMIO_LOG_TAG_FUNCTION_NAME)
+        {
+            const uint64_t id = get_varint(&reader);
+            const size_t len = (reader.p < reader.end) ? *(reader.p++) : 0;
+            if (reader.p + len > reader.end)
+            {
+                reader.truncated = 1;
+                break;
+            }
+            if (id < MAX_FUNCTIONS)
+            {
+                memcpy(functions[id], reader.p, len);
+                functions[id][len] = '\0';
+            }
+            reader.p += len;
+        }
+        else if (tag == MMIO_LOG_TAG_REGIONS)
+        {
+            for (i = 0; i < NUM_MMIO_LOG_REGIONS; ++i)
+            {
+                bases[i] = get_varint(&reader);
+            }
+        }
+        else if (tag == MMIO_LOG_TAG_DROPPED)
+        {
+            const uint64_t dropped = get_varint(&reader);
+            printf("%s,,DROPPED,,,%llu\n", timestamps ? "," : "", (unsigned long long) dropped);
+        }
+        else if ((tag & ~(MMIO_LOG_TAG_OP_MASK | MMIO_LOG_TAG_FUNCTION_FLAG)) == 0)
+        {
+            const int op = tag & MMIO_LOG_TAG_OP_MASK;
+            ticks += get_varint(&reader);
+            line += get_zigzag(&reader);
+            if (tag & MMIO_LOG_TAG_FUNCTION_FLAG)
+            {
+                function_id = get_varint(&reader);
+            }
+            offset += (uint64_t) get_zigzag(&reader);
+            const uint64_t value = get_varint(&reader);
+            if (reader.truncated)
+            {
+                break;
+            }
+            const uint64_t base = get_region_base(bases, offset);
+            if (timestamps)
+            {
+                printf("%.3f,", (double) (ticks - header.start_ticks) * us_per_tick);
+            }
+            printf((op == MMIO_LOG_OP_READ_32) || (op == MMIO_LOG_OP_WRITE_32)
+                       ? "%lld,%s,%s,64'h%llx,64'h%llx,32'h%llx\n"
+                       : "%lld,%s,%s,64'h%llx,64'h%llx,64'h%llx\n",
+                   (long long) line,
+                   (function_id < MAX_FUNCTIONS) ? functions[function_id] : "?",
+                   OP_NAMES[op],
+                   (unsigned long long) base,
+                   (unsigned long long) (offset - base),
+                   (unsigned long long) value);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unknown record 0x%02x\n", tag);
+            break;
+        }
+    }
+    if (reader.truncated)
+    {
+        fprintf(stderr, "WARNING: The log ends with a partial record\n");
+    }
+    free(data);
+    return 0;
+}
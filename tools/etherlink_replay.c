@@ -0,0 +1,1145 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// etherlink-replay: feeds the H2T and MGMT packets of an etherlink capture back to a server and
+// checks the T2H and MGMT RSP packets it answers with against the capture. Run against a SW_MODEL
+// build of etherlink given the same capture (--sim-capture), a captured session becomes a
+// regression and performance test that needs no hardware. With --shm-rings the packets go through
+// the shared memory rings of a unix socket listener instead of the data sockets, with --mux they
+// go as frames over the control socket.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "intel_st_debug_if_capture_layout.h"
+#include "intel_st_debug_if_mux.h"
+#include "intel_st_debug_if_shm_ring_layout.h"
+
+#define GUARDBAND "\xDE\xAD\xBE\xEF"
+
+enum
+{
+    GUARDBAND_LEN = 4,
+    PACKET_HEADER_LEN = GUARDBAND_LEN + 6,
+    MAX_PACKET_LEN = PACKET_HEADER_LEN + 0xFFFF,
+    MAX_REPORTED_MISMATCHES = 10,
+    HANDSHAKE_LEN = 256,
+    RING_RETRY_NS = 100000,  // Wait before retrying a full ring, the server signals no room
+    SOP = 0x01,
+    EOP = 0x02
+};
+
+static const char* const STREAM_NAMES[NUM_CAPTURE_STREAMS] = ETHERLINK_CAPTURE_STREAM_NAMES;
+
+// Data sockets in the order the server expects them after the control socket
+static const char* const SOCKET_NAMES[NUM_CAPTURE_STREAMS] = {
+    "H2T", "T2H", "Management", "Management Response"};
+static const CAPTURE_STREAM SOCKET_ORDER[NUM_CAPTURE_STREAMS] = {
+    CAPTURE_STREAM_MGMT, CAPTURE_STREAM_MGMT_RSP, CAPTURE_STREAM_H2T, CAPTURE_STREAM_T2H};
+static const SHM_RING STREAM_RINGS[NUM_CAPTURE_STREAMS] = {
+    SHM_RING_H2T, SHM_RING_T2H, SHM_RING_MGMT, SHM_RING_MGMT_RSP};
+static const MUX_STREAM STREAM_MUX[NUM_CAPTURE_STREAMS] = {
+    MUX_STREAM_H2T, MUX_STREAM_T2H, MUX_STREAM_MGMT, MUX_STREAM_MGMT_RSP};
+
+typedef struct
+{
+    const CAPTURE_RECORD** records;
+    size_t count;
+    size_t capacity;
+    size_t next;  // Next record to send or to expect
+} PACKET_LIST;
+
+typedef struct
+{
+    int fd;
+    PACKET_LIST packets;
+    unsigned char buff[MAX_PACKET_LEN];
+    size_t buff_len;  // Bytes of the packet being sent or received
+    size_t buff_pos;
+    uint64_t bytes;
+} STREAM;
+
+static STREAM g_streams[NUM_CAPTURE_STREAMS];
+static const CAPTURE_FILE_HEADER* g_header;
+static uint64_t g_dropped = 0;
+static uint64_t g_sessions = 0;
+static uint64_t g_mismatched = 0;
+static uint64_t g_unexpected = 0;
+
+// Shared memory rings attached with --shm-rings, NULL when the data sockets carry the packets
+static SHM_RINGS_LAYOUT* g_rings = NULL;
+static int g_server_doorbell = -1;
+static int g_client_doorbell = -1;
+
+// The control socket when --mux carries all streams over it, else -1. Frames arrive in g_mux_rx.
+static int g_mux_fd = -1;
+static STREAM g_mux_rx;
+
+static void show_help(const char* program)
+{
+    printf(
+        "Usage:\n"
+        " %s [--host=<ip>] --port=<port> | --unix-socket=<path> [--shm-rings | --mux] "
+        "[--max-speed] [--timeout=<seconds>] [--no-verify] <capture>\n"
+        " %s --info <capture>\n\n"
+        "Sends the H2T and MGMT packets of an etherlink capture to a server, at their original "
+        "pace or as fast as\n"
+        "possible, and checks the T2H and MGMT RSP packets received against the capture. All "
+        "sessions of the capture\n"
+        "are replayed over one connection.\n\n"
+        "Optional arguments:\n"
+        " --host=<ip>, -H <ip>         Server address (default: 127.0.0.1)\n"
+        " --port=<port>, -p <port>     Server port\n"
+        " --unix-socket=<path>         Server unix socket, used instead of the host and port\n"
+        " --shm-rings                  Send and receive packets through shared memory rings, "
+        "needs --unix-socket\n"
+        " --mux                        Send all packets as frames over the control connection\n"
+        " --max-speed, -m              Send packets as fast as the server takes them\n"
+        " --timeout=<seconds>, -t <s>  Give up after this long without progress (default: 5)\n"
+        " --no-verify                  Only count the packets received\n"
+        " --info                       Summarize the capture and exit\n"
+        " --help, -h                   Print this usage description\n",
+        program,
+        program);
+}
+
+static uint64_t get_monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static size_t get_aligned_len(size_t len)
+{
+    return (len + 7) & ~(size_t) 7;
+}
+
+static int add_packet(PACKET_LIST* list, const CAPTURE_RECORD* record)
+{
+    if (list->count == list->capacity)
+    {
+        const size_t capacity = (list->capacity != 0) ? 2 * list->capacity : 1024;
+        const CAPTURE_RECORD** records = (const CAPTURE_RECORD**) realloc(
+            (void*) list->records, capacity * sizeof(const CAPTURE_RECORD*));
+        if (records == NULL)
+        {
+            return -1;
+        }
+        list->records = records;
+        list->capacity = capacity;
+    }
+    list->records[list->count++] = record;
+    return 0;
+}
+
+static unsigned char* load_capture(const char* path)
+{
+    const CAPTURE_FILE_FOOTER* footer;
+    unsigned char* capture;
+    size_t records_end;
+    size_t pos;
+    long len;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+    if ((fseek(file, 0, SEEK_END) != 0) || ((len = ftell(file)) < 0) ||
+        (fseek(file, 0, SEEK_SET) != 0) || ((capture = (unsigned char*) malloc(len + 1)) == NULL) ||
+        (fread(capture, 1, (size_t) len, file) != (size_t) len))
+    {
+        fprintf(stderr, "ERROR: Failed to read %s\n", path);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    g_header = (const CAPTURE_FILE_HEADER*) capture;
+    if (((size_t) len < sizeof(*g_header)) || (g_header->magic != ETHERLINK_CAPTURE_MAGIC))
+    {
+        fprintf(stderr, "ERROR: %s is not an etherlink capture\n", path);
+        return NULL;
+    }
+    if ((g_header->version != ETHERLINK_CAPTURE_VERSION) ||
+        (g_header->record_size != sizeof(CAPTURE_RECORD)) || (g_header->ticks_per_second == 0))
+    {
+        fprintf(stderr,
+                "ERROR: Unsupported capture version %u, record size %u\n",
+                g_header->version,
+                g_header->record_size);
+        return NULL;
+    }
+
+    // Without a footer the capture was not closed cleanly and ends with the last whole record
+    records_end = (size_t) len;
+    footer = (const CAPTURE_FILE_FOOTER*) &(capture[len - sizeof(*footer)]);
+    if (((size_t) len >= sizeof(*g_header) + sizeof(*footer)) &&
+        (footer->magic == ETHERLINK_CAPTURE_INDEX_MAGIC) && (footer->index_offset <= (size_t) len))
+    {
+        records_end = (size_t) footer->index_offset;
+    }
+    else
+    {
+        fprintf(stderr, "WARNING: %s was not closed, replaying the records it holds\n", path);
+    }
+
+    for (pos = sizeof(*g_header); pos + sizeof(CAPTURE_RECORD) <= records_end;)
+    {
+        const CAPTURE_RECORD* record = (const CAPTURE_RECORD*) &(capture[pos]);
+        const size_t record_len = sizeof(*record) + get_aligned_len(record->length);
+        if (pos + record_len > records_end)
+        {
+            break;
+        }
+        if ((record->type == CAPTURE_RECORD_PACKET) && (record->stream < NUM_CAPTURE_STREAMS))
+        {
+            if (add_packet(&(g_streams[record->stream].packets), record) != 0)
+            {
+                fprintf(stderr, "ERROR: Out of memory\n");
+                return NULL;
+            }
+        }
+        else if (record->type == CAPTURE_RECORD_SESSION)
+        {
+            g_sessions++;
+        }
+        else if ((record->type == CAPTURE_RECORD_DROPPED) && (record->length >= sizeof(uint64_t)))
+        {
+            uint64_t count;
+            memcpy(&count, record + 1, sizeof(count));
+            g_dropped += count;
+        }
+        pos += record_len;
+    }
+    return capture;
+}
+
+static void print_info()
+{
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+    int i;
+    printf("%llu sessions\n", (unsigned long long) g_sessions);
+    for (i = 0; i < NUM_CAPTURE_STREAMS; ++i)
+    {
+        const PACKET_LIST* list = &(g_streams[i].packets);
+        uint64_t bytes = 0;
+        size_t j;
+        for (j = 0; j < list->count; ++j)
+        {
+            bytes += list->records[j]->length;
+        }
+        if (list->count > 0)
+        {
+            first = (list->records[0]->timestamp < first) ? list->records[0]->timestamp : first;
+            last = (list->records[list->count - 1]->timestamp > last)
+                       ? list->records[list->count - 1]->timestamp
+                       : last;
+        }
+        printf("%-9s %10zu packets %14llu bytes\n",
+               STREAM_NAMES[i],
+               list->count,
+               (unsigned long long) bytes);
+    }
+    if (first <= last)
+    {
+        printf("Duration  %.6f s\n", (double) (last - first) / (double) g_header->ticks_per_second);
+    }
+    if (g_dropped != 0)
+    {
+        printf("Dropped   %10llu packets\n", (unsigned long long) g_dropped);
+    }
+}
+
+static int connect_unix_socket(const char* unix_path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(unix_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "ERROR: Socket path is too long: %s\n", unix_path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, unix_path);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "ERROR: Failed to connect to %s: %s\n", unix_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int connect_socket(const char* host, int port, const char* unix_path)
+{
+    struct sockaddr_in addr;
+    const int one = 1;
+    int fd;
+
+    if (unix_path != NULL)
+    {
+        return connect_unix_socket(unix_path);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) port);
+    if (inet_pton(AF_INET, host, &(addr.sin_addr)) != 1)
+    {
+        fprintf(stderr, "ERROR: Invalid address %s\n", host);
+        return -1;
+    }
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0)
+    {
+        fprintf(stderr, "ERROR: Failed to connect to %s:%d: %s\n", host, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Reads one NUL terminated handshake message
+static int recv_message(int fd, char* message, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len)
+    {
+        ssize_t n = recv(fd, &(message[pos]), 1, 0);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        if (message[pos++] == '\0')
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int send_message(int fd, const char* message)
+{
+    return (send(fd, message, strlen(message) + 1, MSG_NOSIGNAL) == (ssize_t) (strlen(message) + 1))
+               ? 0
+               : -1;
+}
+
+// Sends a control command, framed once the session is multiplexed
+static int send_ctrl_message(int fd, const char* message)
+{
+    unsigned char frame[MUX_FRAME_HEADER_SZ + HANDSHAKE_LEN];
+    const size_t len = strlen(message) + 1;
+    if ((g_mux_fd < 0) || (len > HANDSHAKE_LEN))
+    {
+        return send_message(fd, message);
+    }
+    mux_frame_header_pack(frame, MUX_STREAM_CTRL, (uint32_t) len);
+    memcpy(&(frame[MUX_FRAME_HEADER_SZ]), message, len);
+    return (send(fd, frame, MUX_FRAME_HEADER_SZ + len, MSG_NOSIGNAL) ==
+            (ssize_t) (MUX_FRAME_HEADER_SZ + len))
+               ? 0
+               : -1;
+}
+
+static int expect_ready(int fd, const char* name)
+{
+    char message[HANDSHAKE_LEN];
+    if ((recv_message(fd, message, sizeof(message)) != 0) || (strcmp(message, "READY") != 0))
+    {
+        fprintf(stderr, "ERROR: The server did not accept the %s connection\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+// Opens the control and data connections the way a debug client does, or only the control
+// connection when 'mux' is set. Returns the control socket.
+static int connect_session(const char* host, int port, const char* unix_path, int mux)
+{
+    char message[HANDSHAKE_LEN];
+    const char* handle;
+    int ctrl_fd;
+    int i;
+
+    if ((ctrl_fd = connect_socket(host, port, unix_path)) < 0)
+    {
+        return -1;
+    }
+    if ((recv_message(ctrl_fd, message, sizeof(message)) != 0) ||
+        ((handle = strstr(message, "HANDLE=")) == NULL))
+    {
+        fprintf(stderr, "ERROR: Unexpected welcome message from the server\n");
+        close(ctrl_fd);
+        return -1;
+    }
+    const long session_handle = strtol(handle + strlen("HANDLE="), NULL, 10);
+    if (mux)
+    {
+        if (strstr(message, "MUX_SUPPORT=1") == NULL)
+        {
+            fprintf(stderr, "ERROR: The server does not offer the multiplexed transport\n");
+            close(ctrl_fd);
+            return -1;
+        }
+        snprintf(message, sizeof(message), "MUX HANDLE=%ld", session_handle);
+        if ((send_message(ctrl_fd, message) != 0) || (expect_ready(ctrl_fd, "MUX") != 0) ||
+            (expect_ready(ctrl_fd, "MUX") != 0))
+        {
+            close(ctrl_fd);
+            return -1;
+        }
+        fcntl(ctrl_fd, F_SETFL, fcntl(ctrl_fd, F_GETFL) | O_NONBLOCK);
+        for (i = 0; i < NUM_CAPTURE_STREAMS; ++i)
+        {
+            g_streams[i].fd = ctrl_fd;
+        }
+        g_mux_fd = ctrl_fd;
+        return ctrl_fd;
+    }
+    snprintf(message, sizeof(message), "Control HANDLE=%ld", session_handle);
+    if ((send_message(ctrl_fd, message) != 0) || (expect_ready(ctrl_fd, "Control") != 0))
+    {
+        close(ctrl_fd);
+        return -1;
+    }
+    for (i = 0; i < NUM_CAPTURE_STREAMS; ++i)
+    {
+        STREAM* stream = &(g_streams[SOCKET_ORDER[i]]);
+        const char* name = SOCKET_NAMES[SOCKET_ORDER[i]];
+        snprintf(message, sizeof(message), "%s HANDLE=%ld", name, session_handle);
+        if (((stream->fd = connect_socket(host, port, unix_path)) < 0) ||
+            (send_message(stream->fd, message) != 0) || (expect_ready(stream->fd, name) != 0))
+        {
+            close(ctrl_fd);
+            return -1;
+        }
+        fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) | O_NONBLOCK);
+    }
+    if (expect_ready(ctrl_fd, "Control") != 0)
+    {
+        close(ctrl_fd);
+        return -1;
+    }
+    return ctrl_fd;
+}
+
+// Asks the server for shared memory rings over the control socket and maps them
+static int attach_shm_rings(int ctrl_fd)
+{
+    char message[HANDSHAKE_LEN];
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov;
+    struct msghdr hdr;
+    struct stat memfd_stat;
+    int fds[3];
+
+    if (send_message(ctrl_fd, "ATTACH_SHM_RINGS") != 0)
+    {
+        fprintf(stderr, "ERROR: Failed to send ATTACH_SHM_RINGS\n");
+        return -1;
+    }
+    iov.iov_base = message;
+    iov.iov_len = sizeof(message) - 1;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+    const ssize_t n = recvmsg(ctrl_fd, &hdr, MSG_CMSG_CLOEXEC);
+    const struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+    message[(n > 0) ? n : 0] = '\0';
+    if ((strcmp(message, "ATTACH_SHM_RINGS_ACK") != 0) || (cmsg == NULL) ||
+        (cmsg->cmsg_type != SCM_RIGHTS) || (cmsg->cmsg_len != CMSG_LEN(sizeof(fds))))
+    {
+        fprintf(stderr, "ERROR: The server did not attach shared memory rings: %s\n", message);
+        return -1;
+    }
+
+    // The memfd holding the rings, the server doorbell and the client doorbell
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    void* map = MAP_FAILED;
+    if (fstat(fds[0], &memfd_stat) == 0)
+    {
+        map = mmap(
+            NULL, (size_t) memfd_stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    }
+    close(fds[0]);
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+    g_rings = (SHM_RINGS_LAYOUT*) map;
+    g_server_doorbell = fds[1];
+    g_client_doorbell = fds[2];
+    if ((g_rings->magic != ETHERLINK_SHM_RINGS_MAGIC) ||
+        (g_rings->version != ETHERLINK_SHM_RINGS_VERSION))
+    {
+        fprintf(stderr, "ERROR: Unsupported shared memory rings version %u\n", g_rings->version);
+        return -1;
+    }
+    return 0;
+}
+
+static void build_packet(STREAM* stream, const CAPTURE_RECORD* record)
+{
+    unsigned char* p = stream->buff;
+    if (g_mux_fd >= 0)
+    {
+        // The frame header takes the place of the guardband
+        mux_frame_header_pack(
+            p, STREAM_MUX[record->stream], PACKET_HEADER_LEN - GUARDBAND_LEN + record->length);
+    }
+    else
+    {
+        memcpy(p, GUARDBAND, GUARDBAND_LEN);
+    }
+    p[4] = record->sop_eop;
+    p[5] = record->conn_id;
+    p[6] = (unsigned char) record->channel;
+    p[7] = (unsigned char) (record->channel >> 8);
+    p[8] = (unsigned char) record->length;
+    p[9] = (unsigned char) (record->length >> 8);
+    memcpy(&(p[PACKET_HEADER_LEN]), record + 1, record->length);
+    stream->buff_len = PACKET_HEADER_LEN + record->length;
+    stream->buff_pos = 0;
+}
+
+static void report(const char* what, CAPTURE_STREAM stream, size_t packet)
+{
+    if (g_mismatched + g_unexpected <= MAX_REPORTED_MISMATCHES)
+    {
+        fprintf(stderr, "MISMATCH: %s %s packet %zu\n", what, STREAM_NAMES[stream], packet);
+    }
+}
+
+// Compares a received packet with the next one expected
+static void check_packet(CAPTURE_STREAM id, int verify)
+{
+    STREAM* stream = &(g_streams[id]);
+    PACKET_LIST* list = &(stream->packets);
+    const unsigned char* p = stream->buff;
+    const uint16_t channel = (uint16_t) (p[6] | (p[7] << 8));
+    const uint16_t length = (uint16_t) (p[8] | (p[9] << 8));
+
+    if (list->next == list->count)
+    {
+        g_unexpected++;
+        report("Unexpected", id, list->next);
+        return;
+    }
+    const CAPTURE_RECORD* record = list->records[list->next++];
+    if (verify && ((memcmp(p, GUARDBAND, GUARDBAND_LEN) != 0) || (p[4] != record->sop_eop) ||
+                   ((id == CAPTURE_STREAM_T2H) && (p[5] != record->conn_id)) ||
+                   (channel != record->channel) || (length != record->length) ||
+                   (memcmp(&(p[PACKET_HEADER_LEN]), record + 1, length) != 0)))
+    {
+        g_mismatched++;
+        report("Different", id, list->next - 1);
+    }
+}
+
+// Returns 1 if a whole packet was received, 0 if more data is needed, -1 on errors
+static int recv_packet(STREAM* stream)
+{
+    if (stream->buff_len == 0)
+    {
+        stream->buff_len = PACKET_HEADER_LEN;
+        stream->buff_pos = 0;
+    }
+    ssize_t n =
+        recv(stream->fd, &(stream->buff[stream->buff_pos]), stream->buff_len - stream->buff_pos, 0);
+    if (n <= 0)
+    {
+        return ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+                   ? 0
+                   : -1;
+    }
+    stream->buff_pos += (size_t) n;
+    stream->bytes += (uint64_t) n;
+    if (stream->buff_pos < stream->buff_len)
+    {
+        return 0;
+    }
+    if (stream->buff_len == PACKET_HEADER_LEN)
+    {
+        const size_t length = stream->buff[8] | (stream->buff[9] << 8);
+        if (length > 0)
+        {
+            stream->buff_len += length;
+            return 0;
+        }
+    }
+    stream->buff_len = 0;
+    return 1;
+}
+
+// Returns 1 once the current packet is sent, 0 if the socket is full, -1 on errors
+static int send_packet(STREAM* stream)
+{
+    ssize_t n = send(stream->fd,
+                     &(stream->buff[stream->buff_pos]),
+                     stream->buff_len - stream->buff_pos,
+                     MSG_NOSIGNAL);
+    if (n < 0)
+    {
+        return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? 0 : -1;
+    }
+    stream->buff_pos += (size_t) n;
+    stream->bytes += (uint64_t) n;
+    if (stream->buff_pos < stream->buff_len)
+    {
+        return 0;
+    }
+    stream->buff_len = 0;
+    return 1;
+}
+
+// Returns 1 once a whole frame is in g_mux_rx, 0 if more data is needed, -1 on errors
+static int recv_mux_frame()
+{
+    STREAM* rx = &g_mux_rx;
+    if (rx->buff_len == 0)
+    {
+        rx->buff_len = MUX_FRAME_HEADER_SZ;
+        rx->buff_pos = 0;
+    }
+    ssize_t n = recv(g_mux_fd, &(rx->buff[rx->buff_pos]), rx->buff_len - rx->buff_pos, 0);
+    if (n <= 0)
+    {
+        return ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+                   ? 0
+                   : -1;
+    }
+    rx->buff_pos += (size_t) n;
+    if (rx->buff_pos < rx->buff_len)
+    {
+        return 0;
+    }
+    if (rx->buff_len == MUX_FRAME_HEADER_SZ)
+    {
+        const size_t length = mux_frame_header_len(rx->buff);
+        if (length > sizeof(rx->buff) - MUX_FRAME_HEADER_SZ)
+        {
+            return -1;
+        }
+        if (length > 0)
+        {
+            rx->buff_len += length;
+            return 0;
+        }
+    }
+    rx->buff_len = 0;
+    return 1;
+}
+
+// Moves the T2H or MGMT RSP packet framed in g_mux_rx into the buffer of its stream, laid out as
+// on a data socket. Returns the stream, or NUM_CAPTURE_STREAMS for any other frame.
+static CAPTURE_STREAM take_mux_packet()
+{
+    const MUX_STREAM mux_stream = mux_frame_header_stream(g_mux_rx.buff);
+    const CAPTURE_STREAM id = (mux_stream == MUX_STREAM_T2H)        ? CAPTURE_STREAM_T2H
+                              : (mux_stream == MUX_STREAM_MGMT_RSP) ? CAPTURE_STREAM_MGMT_RSP
+                                                                    : NUM_CAPTURE_STREAMS;
+    if ((id == NUM_CAPTURE_STREAMS) || (g_mux_rx.buff_pos < PACKET_HEADER_LEN))
+    {
+        return NUM_CAPTURE_STREAMS;
+    }
+    STREAM* stream = &(g_streams[id]);
+    memcpy(stream->buff, GUARDBAND, GUARDBAND_LEN);
+    memcpy(&(stream->buff[GUARDBAND_LEN]),
+           &(g_mux_rx.buff[MUX_FRAME_HEADER_SZ]),
+           g_mux_rx.buff_pos - MUX_FRAME_HEADER_SZ);
+    stream->bytes += g_mux_rx.buff_pos;
+    return id;
+}
+
+// Returns 1 once the current packet is in its ring, 0 if the ring is full
+static int send_ring_packet(STREAM* stream, SHM_RING ring)
+{
+    const size_t length = stream->buff_len - PACKET_HEADER_LEN;
+    SHM_RING_RECORD_HEADER* record = shm_ring_reserve(g_rings, ring, length);
+    if (record == NULL)
+    {
+        return 0;
+    }
+    record->sop_eop = stream->buff[4];
+    record->conn_id = stream->buff[5];
+    record->channel = (uint16_t) (stream->buff[6] | (stream->buff[7] << 8));
+    record->data_len_bytes = (uint16_t) length;
+    record->reserved = 0;
+    memcpy(record + 1, &(stream->buff[PACKET_HEADER_LEN]), length);
+    if (shm_ring_commit(g_rings, ring, record))
+    {
+        const uint64_t one = 1;
+        if (write(g_server_doorbell, &one, sizeof(one)) != (ssize_t) sizeof(one))
+        {
+            perror("write");
+        }
+    }
+    stream->bytes += stream->buff_len;
+    stream->buff_len = 0;
+    return 1;
+}
+
+// Takes the oldest record of a ring into the stream buffer, laid out as on a data socket. Returns
+// 1 if a packet was taken, 0 if the ring is empty.
+static int recv_ring_packet(STREAM* stream, SHM_RING ring)
+{
+    const SHM_RING_RECORD_HEADER* shared = shm_ring_peek(g_rings, ring);
+    if (shared == NULL)
+    {
+        return 0;
+    }
+    const SHM_RING_RECORD_HEADER record = *shared;
+    unsigned char* p = stream->buff;
+    memcpy(p, GUARDBAND, GUARDBAND_LEN);
+    p[4] = record.sop_eop;
+    p[5] = record.conn_id;
+    p[6] = (unsigned char) record.channel;
+    p[7] = (unsigned char) (record.channel >> 8);
+    p[8] = (unsigned char) record.data_len_bytes;
+    p[9] = (unsigned char) (record.data_len_bytes >> 8);
+    memcpy(&(p[PACKET_HEADER_LEN]), shared + 1, record.data_len_bytes);
+    stream->bytes += PACKET_HEADER_LEN + record.data_len_bytes;
+    shm_ring_release(g_rings, ring, &record);
+    return 1;
+}
+
+static int is_replay_done()
+{
+    int i;
+    for (i = 0; i < NUM_CAPTURE_STREAMS; ++i)
+    {
+        const STREAM* stream = &(g_streams[i]);
+        if ((stream->packets.next < stream->packets.count) || (stream->buff_len != 0))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Builds the next packet of a sent stream once it is due. Returns 0 when a packet was built, the
+// nanoseconds until the next one is due, or -1 when there is nothing to send for now.
+static int64_t build_due_packet(CAPTURE_STREAM id,
+                                int max_speed,
+                                uint64_t start_ns,
+                                uint64_t first_ticks,
+                                uint64_t now_ns,
+                                int* mgmt_pending)
+{
+    STREAM* stream = &(g_streams[id]);
+    PACKET_LIST* list = &(stream->packets);
+    if (list->next == list->count)
+    {
+        return -1;
+    }
+    const CAPTURE_RECORD* record = list->records[list->next];
+    // The server accepts a new MGMT request only once the last one was answered
+    if ((id == CAPTURE_STREAM_MGMT) && (record->sop_eop & SOP) && *mgmt_pending)
+    {
+        return -1;
+    }
+    if (!max_speed)
+    {
+        const uint64_t due_ns =
+            start_ns + (uint64_t) ((double) (record->timestamp - first_ticks) * 1e9 /
+                                   (double) g_header->ticks_per_second);
+        if (due_ns > now_ns)
+        {
+            return (int64_t) (due_ns - now_ns);
+        }
+    }
+    build_packet(stream, record);
+    list->next++;
+    if ((id == CAPTURE_STREAM_MGMT) && (record->sop_eop & EOP))
+    {
+        *mgmt_pending = 1;
+    }
+    return 0;
+}
+
+// Called for each whole T2H or MGMT RSP packet received
+static void handle_received_packet(CAPTURE_STREAM id, int verify, int* mgmt_pending)
+{
+    if ((id == CAPTURE_STREAM_MGMT_RSP) && (g_streams[id].buff[4] & EOP))
+    {
+        *mgmt_pending = 0;
+    }
+    check_packet(id, verify);
+}
+
+static int replay(int max_speed, int verify, double timeout)
+{
+    static const CAPTURE_STREAM sent[] = {CAPTURE_STREAM_H2T, CAPTURE_STREAM_MGMT};
+    static const CAPTURE_STREAM received[] = {CAPTURE_STREAM_T2H, CAPTURE_STREAM_MGMT_RSP};
+    int mgmt_pending = 0;  // A MGMT request is waiting for the end of its response
+    uint64_t first_ticks = UINT64_MAX;
+    size_t i;
+
+    for (i = 0; i < 2; ++i)
+    {
+        const PACKET_LIST* list = &(g_streams[sent[i]].packets);
+        if ((list->count > 0) && (list->records[0]->timestamp < first_ticks))
+        {
+            first_ticks = list->records[0]->timestamp;
+        }
+    }
+
+    const uint64_t start_ns = get_monotonic_ns();
+    uint64_t progress_ns = start_ns;
+    while (!is_replay_done())
+    {
+        struct pollfd fds[4];
+        uint64_t now_ns = get_monotonic_ns();
+        int64_t wait_ns = -1;
+
+        for (i = 0; i < 2; ++i)
+        {
+            STREAM* stream = &(g_streams[sent[i]]);
+            int64_t until_due = -1;
+            if (stream->buff_len == 0)
+            {
+                until_due = build_due_packet(
+                    sent[i], max_speed, start_ns, first_ticks, now_ns, &mgmt_pending);
+            }
+            // A ring takes packets until it is full, there is no socket to wait on
+            while ((g_rings != NULL) && (stream->buff_len != 0))
+            {
+                if (!send_ring_packet(stream, STREAM_RINGS[sent[i]]))
+                {
+                    // The server does not signal when it frees room in a ring
+                    until_due = RING_RETRY_NS;
+                    break;
+                }
+                progress_ns = now_ns;
+                until_due = build_due_packet(
+                    sent[i], max_speed, start_ns, first_ticks, now_ns, &mgmt_pending);
+            }
+            if (until_due > 0)
+            {
+                wait_ns = ((wait_ns < 0) || (until_due < wait_ns)) ? until_due : wait_ns;
+            }
+            fds[i].fd = (g_rings == NULL) ? stream->fd : -1;
+            fds[i].events = (stream->buff_len != 0) ? POLLOUT : 0;
+        }
+        if (g_rings != NULL)
+        {
+            fds[2].fd = g_client_doorbell;
+            fds[2].events = POLLIN;
+            fds[3].fd = -1;
+            fds[3].events = 0;
+        }
+        else
+        {
+            for (i = 0; i < 2; ++i)
+            {
+                fds[2 + i].fd = ((g_mux_fd >= 0) && (i > 0)) ? -1 : g_streams[received[i]].fd;
+                fds[2 + i].events = POLLIN;
+            }
+        }
+
+        const int64_t timeout_left_ns =
+            (int64_t) (progress_ns + (uint64_t) (timeout * 1e9)) - (int64_t) now_ns;
+        if (timeout_left_ns <= 0)
+        {
+            fprintf(stderr, "ERROR: No progress for %.1f s, giving up\n", timeout);
+            return -1;
+        }
+        wait_ns = ((wait_ns < 0) || (timeout_left_ns < wait_ns)) ? timeout_left_ns : wait_ns;
+        if (poll(fds, 4, (int) ((wait_ns + 999999) / 1000000)) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("poll");
+            return -1;
+        }
+
+        for (i = 0; i < 2; ++i)
+        {
+            const STREAM* other = &(g_streams[sent[1 - i]]);
+            int rc;
+            // Frames must not interleave, a stream waits while the other one is partly sent
+            if ((g_mux_fd >= 0) && (other->buff_len != 0) && (other->buff_pos != 0))
+            {
+                continue;
+            }
+            if ((fds[i].revents & (POLLOUT | POLLERR | POLLHUP)) &&
+                ((rc = send_packet(&(g_streams[sent[i]]))) != 0))
+            {
+                if (rc < 0)
+                {
+                    fprintf(stderr, "ERROR: The server closed the %s connection\n",
+                            SOCKET_NAMES[sent[i]]);
+                    return -1;
+                }
+                progress_ns = get_monotonic_ns();
+            }
+        }
+        if (g_rings != NULL)
+        {
+            uint64_t rings;
+            if ((fds[2].revents & POLLIN) &&
+                (read(g_client_doorbell, &rings, sizeof(rings)) != (ssize_t) sizeof(rings)))
+            {
+                perror("read");
+                return -1;
+            }
+            // Drain both rings, the server rings the doorbell only when it finds a ring empty
+            for (i = 0; i < 2; ++i)
+            {
+                while (recv_ring_packet(&(g_streams[received[i]]), STREAM_RINGS[received[i]]))
+                {
+                    handle_received_packet(received[i], verify, &mgmt_pending);
+                    progress_ns = get_monotonic_ns();
+                }
+            }
+            continue;
+        }
+        if (g_mux_fd >= 0)
+        {
+            int rc = 0;
+            while ((fds[2].revents & (POLLIN | POLLERR | POLLHUP)) && ((rc = recv_mux_frame()) > 0))
+            {
+                const CAPTURE_STREAM id = take_mux_packet();
+                if (id == NUM_CAPTURE_STREAMS)
+                {
+                    g_unexpected++;
+                    fprintf(stderr, "MISMATCH: Unexpected frame on mux stream %u\n",
+                            (unsigned) mux_frame_header_stream(g_mux_rx.buff));
+                    continue;
+                }
+                handle_received_packet(id, verify, &mgmt_pending);
+                progress_ns = get_monotonic_ns();
+            }
+            if (rc < 0)
+            {
+                fprintf(stderr, "ERROR: The server closed the Control connection\n");
+                return -1;
+            }
+            continue;
+        }
+        for (i = 0; i < 2; ++i)
+        {
+            int rc;
+            if (!(fds[2 + i].revents & (POLLIN | POLLERR | POLLHUP)))
+            {
+                continue;
+            }
+            if ((rc = recv_packet(&(g_streams[received[i]]))) < 0)
+            {
+                fprintf(stderr, "ERROR: The server closed the %s connection\n",
+                        SOCKET_NAMES[received[i]]);
+                return -1;
+            }
+            if (rc > 0)
+            {
+                handle_received_packet(received[i], verify, &mgmt_pending);
+                progress_ns = get_monotonic_ns();
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* host = "127.0.0.1";
+    int port = -1;
+    const char* unix_path = NULL;
+    int shm_rings = 0;
+    int mux = 0;
+    int max_speed = 0;
+    int verify = 1;
+    int info = 0;
+    double timeout = 5.0;
+    int c;
+    int i;
+
+    const struct option longopts[] = {{"help", no_argument, NULL, 'h'},
+                                      {"host", required_argument, NULL, 'H'},
+                                      {"port", required_argument, NULL, 'p'},
+                                      {"unix-socket", required_argument, NULL, 'U'},
+                                      {"shm-rings", no_argument, NULL, 'S'},
+                                      {"mux", no_argument, NULL, 'X'},
+                                      {"max-speed", no_argument, NULL, 'm'},
+                                      {"timeout", required_argument, NULL, 't'},
+                                      {"no-verify", no_argument, NULL, 'V'},
+                                      {"info", no_argument, NULL, 'I'},
+                                      {0, 0, 0, 0}};
+    while ((c = getopt_long(argc, argv, "hH:p:mt:", longopts, NULL)) != -1)
+    {
+        switch (c)
+        {
+            case 'H':
+                host = optarg;
+                break;
+
+            case 'p':
+                port = atoi(optarg);
+                break;
+
+            case 'U':
+                unix_path = optarg;
+                break;
+
+            case 'S':
+                shm_rings = 1;
+                break;
+
+            case 'X':
+                mux = 1;
+                break;
+
+            case 'm':
+                max_speed = 1;
+                break;
+
+            case 't':
+                timeout = atof(optarg);
+                break;
+
+            case 'V':
+                verify = 0;
+                break;
+
+            case 'I':
+                info = 1;
+                break;
+
+            case 'h':
+            default:
+                show_help(argv[0]);
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+    if ((optind != argc - 1) || (!info && (port <= 0) && (unix_path == NULL)) ||
+        (shm_rings && ((unix_path == NULL) || mux)))
+    {
+        show_help(argv[0]);
+        return 1;
+    }
+    if (load_capture(argv[optind]) == NULL)
+    {
+        return 1;
+    }
+    if (info)
+    {
+        print_info();
+        return 0;
+    }
+    if (g_dropped != 0)
+    {
+        fprintf(stderr,
+                "WARNING: %llu packets are missing from the capture, expect mismatches\n",
+                (unsigned long long) g_dropped);
+    }
+
+    const int ctrl_fd = connect_session(host, port, unix_path, mux);
+    if (ctrl_fd < 0)
+    {
+        return 1;
+    }
+    if (shm_rings && (attach_shm_rings(ctrl_fd) != 0))
+    {
+        return 1;
+    }
+    const uint64_t start_ns = get_monotonic_ns();
+    const int rc = replay(max_speed, verify, timeout);
+    const double seconds = (double) (get_monotonic_ns() - start_ns) / 1e9;
+
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    size_t missing = 0;
+    for (i = 0; i < NUM_CAPTURE_STREAMS; ++i)
+    {
+        packets += g_streams[i].packets.next;
+        bytes += g_streams[i].bytes;
+        if ((i == CAPTURE_STREAM_T2H) || (i == CAPTURE_STREAM_MGMT_RSP))
+        {
+            missing += g_streams[i].packets.count - g_streams[i].packets.next;
+        }
+        printf("%-9s %10zu of %10zu packets\n",
+               STREAM_NAMES[i],
+               g_streams[i].packets.next,
+               g_streams[i].packets.count);
+    }
+    printf("%llu packets, %llu bytes in %.6f s: %.0f packets/s, %.3f MB/s\n",
+           (unsigned long long) packets,
+           (unsigned long long) bytes,
+           seconds,
+           (seconds > 0) ? (double) packets / seconds : 0.0,
+           (seconds > 0) ? (double) bytes / seconds / 1e6 : 0.0);
+    if (verify)
+    {
+        printf("%llu packets differed from the capture, %llu were not expected, %zu are missing\n",
+               (unsigned long long) g_mismatched,
+               (unsigned long long) g_unexpected,
+               missing);
+    }
+
+    send_ctrl_message(ctrl_fd, "DISCONNECT");
+    close(ctrl_fd);
+    for (i = 0; (g_mux_fd < 0) && (i < NUM_CAPTURE_STREAMS); ++i)
+    {
+        close(g_streams[i].fd);
+    }
+    return ((rc == 0) && (!verify || ((g_mismatched == 0) && (g_unexpected == 0)))) ? 0 : 1;
+}
@@ -0,0 +1,364 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// etherlink-top: shows live per-board rates from the statistics pages that etherlink publishes with
+// --stats-shm. Pages are only mapped read-only, the servers are never contacted.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "intel_st_debug_if_metrics_layout.h"
+
+#define SHM_DIR "/dev/shm"
+
+enum
+{
+    MAX_BOARDS = 256,
+    MAX_NAME_LEN = 255
+};
+
+typedef struct
+{
+    char name[MAX_NAME_LEN + 1];
+    const SERVER_STATS_PAGE* page;
+    SERVER_METRICS_SNAPSHOT last;
+    uint64_t last_time_ns;
+    uint64_t last_pid;
+} BOARD;
+
+static const char* const STALL_REASON_NAMES[ETHERLINK_STATS_STALL_REASON_COUNT] =
+    ETHERLINK_STATS_STALL_REASON_NAMES;
+
+static BOARD s_boards[MAX_BOARDS];
+static int s_board_count = 0;
+
+static void show_help(const char* program)
+{
+    printf(
+        "Usage:\n"
+        " %s [--interval=<seconds>] [--count=<n>] [--batch] [<name or path> ...]\n\n"
+        "Shows per-board rates from the statistics pages etherlink publishes with --stats-shm.\n"
+        "Without names, every statistics page found in " SHM_DIR " is shown.\n\n"
+        "Optional arguments:\n"
+        " --interval=<seconds>, -i <seconds>   Refresh interval (default: 1)\n"
+        " --count=<n>, -n <n>                  Exit after <n> refreshes (default: run forever)\n"
+        " --batch, -b                          Do not clear the screen between refreshes\n"
+        " --help, -h                           Print this usage description\n",
+        program);
+}
+
+static const SERVER_STATS_PAGE* map_stats_page(const char* path)
+{
+    struct stat st;
+    const SERVER_STATS_PAGE* page = NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode) &&
+        ((size_t) st.st_size >= sizeof(SERVER_STATS_PAGE)))
+    {
+        void* addr = mmap(NULL, sizeof(SERVER_STATS_PAGE), PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            page = (const SERVER_STATS_PAGE*) addr;
+            if ((page->magic != ETHERLINK_STATS_MAGIC) || (page->version < 1))
+            {
+                munmap(addr, sizeof(SERVER_STATS_PAGE));
+                page = NULL;
+            }
+        }
+    }
+    close(fd);
+    return page;
+}
+
+static void add_board(const char* name, const char* path)
+{
+    const SERVER_STATS_PAGE* page;
+    if (s_board_count >= MAX_BOARDS)
+    {
+        return;
+    }
+    if ((page = map_stats_page(path)) == NULL)
+    {
+        fprintf(stderr, "WARNING: %s is not an etherlink statistics page; ignored\n", path);
+        return;
+    }
+    BOARD* board = &(s_boards[s_board_count++]);
+    memset(board, 0, sizeof(*board));
+    snprintf(board->name, sizeof(board->name), "%s", name);
+    board->page = page;
+}
+
+static void find_boards()
+{
+    DIR* dir = opendir(SHM_DIR);
+    struct dirent* entry;
+    if (dir == NULL)
+    {
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char path[sizeof(SHM_DIR) + MAX_NAME_LEN + 1];
+        const SERVER_STATS_PAGE* page;
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), SHM_DIR "/%s", entry->d_name);
+        if ((page = map_stats_page(path)) != NULL)
+        {
+            munmap((void*) page, sizeof(SERVER_STATS_PAGE));
+            add_board(entry->d_name, path);
+        }
+    }
+    closedir(dir);
+}
+
+// Seqlock read, see SERVER_STATS_PAGE
+static void read_snapshot(const SERVER_STATS_PAGE* page,
+                          SERVER_METRICS_SNAPSHOT* snapshot,
+                          uint64_t* publish_time_ns,
+                          uint64_t* pid)
+{
+    const uint64_t* page_words = (const uint64_t*) &(page->snapshot);
+    uint64_t* words = (uint64_t*) snapshot;
+    const size_t word_count = sizeof(SERVER_METRICS_SNAPSHOT) / sizeof(uint64_t);
+    uint64_t begin;
+    uint64_t end;
+    size_t i;
+    do
+    {
+        begin = __atomic_load_n(&(page->sequence), __ATOMIC_ACQUIRE);
+        for (i = 0; i < word_count; ++i)
+        {
+            words[i] = __atomic_load_n(&(page_words[i]), __ATOMIC_RELAXED);
+        }
+        *publish_time_ns = __atomic_load_n(&(page->publish_time_ns), __ATOMIC_RELAXED);
+        *pid = __atomic_load_n(&(page->pid), __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&(page->sequence), __ATOMIC_RELAXED);
+    } while ((begin != end) || (begin & 1));
+}
+
+static double rate(uint64_t now, uint64_t then, double seconds)
+{
+    return ((seconds > 0) && (now >= then)) ? (double) (now - then) / seconds : 0.0;
+}
+
+static void print_board(BOARD* board)
+{
+    SERVER_METRICS_SNAPSHOT now;
+    uint64_t time_ns;
+    uint64_t pid;
+    char state[8];
+    char ring[8];
+    char descriptors[16];
+    char stall[32];
+    int i;
+
+    read_snapshot(board->page, &now, &time_ns, &pid);
+
+    // A new writer behind the same page starts its counters over
+    if ((pid != board->last_pid) || (time_ns < board->last_time_ns))
+    {
+        board->last = now;
+        board->last_time_ns = time_ns;
+        board->last_pid = pid;
+    }
+    const double seconds = (double) (time_ns - board->last_time_ns) / 1e9;
+    const SERVER_METRICS_SNAPSHOT* last = &(board->last);
+
+    if ((kill((pid_t) pid, 0) != 0) && (errno == ESRCH))
+    {
+        snprintf(state, sizeof(state), "gone");
+    }
+    else
+    {
+        snprintf(state, sizeof(state), "%s", now.session_active ? "active" : "idle");
+    }
+
+    snprintf(ring,
+             sizeof(ring),
+             "%3u%%",
+             (now.h2t_ring_size > 0) ? (unsigned int) (100 * now.h2t_ring_used / now.h2t_ring_size)
+                                     : 0);
+    snprintf(descriptors,
+             sizeof(descriptors),
+             "%llu/%llu",
+             (unsigned long long) now.h2t_descriptors_used,
+             (unsigned long long) now.h2t_descriptor_depth);
+
+    // Reason with the largest share of the interval
+    int top_reason = -1;
+    uint64_t top_stall_ns = 0;
+    for (i = 0; i < ETHERLINK_STATS_STALL_REASON_COUNT; ++i)
+    {
+        uint64_t stall_ns = (now.stall_ns[i] >= last->stall_ns[i])
+                                ? now.stall_ns[i] - last->stall_ns[i]
+                                : 0;
+        if (stall_ns > top_stall_ns)
+        {
+            top_stall_ns = stall_ns;
+            top_reason = i;
+        }
+    }
+    if ((top_reason >= 0) && (seconds > 0))
+    {
+        snprintf(stall,
+                 sizeof(stall),
+                 "%s %.0f%%",
+                 STALL_REASON_NAMES[top_reason],
+                 100.0 * (double) top_stall_ns / (seconds * 1e9));
+    }
+    else
+    {
+        snprintf(stall, sizeof(stall), "-");
+    }
+
+    printf("%-24.24s %7llu %-6s %9.2f %9.2f %10.0f %10.0f %8.0f %5s %9s  %s\n",
+           board->name,
+           (unsigned long long) pid,
+           state,
+           rate(now.bytes[0], last->bytes[0], seconds) / 1e6,
+           rate(now.bytes[1], last->bytes[1], seconds) / 1e6,
+           rate(now.packets[0], last->packets[0], seconds),
+           rate(now.packets[1], last->packets[1], seconds),
+           rate(now.packets[2], last->packets[2], seconds),
+           ring,
+           descriptors,
+           stall);
+
+    if (seconds > 0)
+    {
+        board->last = now;
+        board->last_time_ns = time_ns;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double interval = 1.0;
+    long count = -1;
+    int batch = 0;
+    int c;
+    int i;
+
+    const struct option longopts[] = {{"help", no_argument, NULL, 'h'},
+                                      {"interval", required_argument, NULL, 'i'},
+                                      {"count", required_argument, NULL, 'n'},
+                                      {"batch", no_argument, NULL, 'b'},
+                                      {0, 0, 0, 0}};
+    while ((c = getopt_long(argc, argv, "hi:n:b", longopts, NULL)) != -1)
+    {
+        switch (c)
+        {
+            case 'i':
+                interval = strtod(optarg, NULL);
+                if (interval <= 0)
+                {
+                    fprintf(stderr, "ERROR: Invalid interval: %s\n", optarg);
+                    return 1;
+                }
+                break;
+
+            case 'n':
+                count = strtol(optarg, NULL, 0);
+                break;
+
+            case 'b':
+                batch = 1;
+                break;
+
+            case 'h':
+            default:
+                show_help(argv[0]);
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+
+    if (optind < argc)
+    {
+        for (i = optind; i < argc; ++i)
+        {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), (argv[i][0] == '/') ? "%s" : SHM_DIR "/%s", argv[i]);
+            add_board(argv[i], path);
+        }
+    }
+    else
+    {
+        find_boards();
+    }
+    if (s_board_count == 0)
+    {
+        fprintf(stderr, "ERROR: No etherlink statistics pages found\n");
+        return 1;
+    }
+
+    while (count != 0)
+    {
+        if (!batch)
+        {
+            printf("\033[H\033[2J");
+        }
+        printf("%-24s %7s %-6s %9s %9s %10s %10s %8s %5s %9s  %s\n",
+               "BOARD",
+               "PID",
+               "STATE",
+               "H2T MB/s",
+               "T2H MB/s",
+               "H2T pkt/s",
+               "T2H pkt/s",
+               "MGMT/s",
+               "RING",
+               "DESC",
+               "TOP STALL");
+        for (i = 0; i < s_board_count; ++i)
+        {
+            print_board(&(s_boards[i]));
+        }
+        fflush(stdout);
+        if ((count < 0) || (--count > 0))
+        {
+            usleep((useconds_t) (interval * 1e6));
+        }
+    }
+    return 0;
+}
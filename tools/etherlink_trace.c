@@ -0,0 +1,184 @@
+// Copyright(c) 2021, Intel Corporation
+//
+// Redistribution  and  use  in source  and  binary  forms,  with  or  without
+// modification, are permitted provided that the following conditions are met:
+//
+// * Redistributions of  source code  must retain the  above copyright notice,
+//   this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+// * Neither the name  of Intel Corporation  nor the names of its contributors
+//   may be used to  endorse or promote  products derived  from this  software
+//   without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,  BUT NOT LIMITED TO,  THE
+// IMPLIED WARRANTIES OF  MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED.  IN NO EVENT  SHALL THE COPYRIGHT OWNER  OR CONTRIBUTORS BE
+// LIABLE  FOR  ANY  DIRECT,  INDIRECT,  INCIDENTAL,  SPECIAL,  EXEMPLARY,  OR
+// CONSEQUENTIAL  DAMAGES  (INCLUDING,  BUT  NOT LIMITED  TO,  PROCUREMENT  OF
+// SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE,  DATA, OR PROFITS;  OR BUSINESS
+// INTERRUPTION)  HOWEVER CAUSED  AND ON ANY THEORY  OF LIABILITY,  WHETHER IN
+// CONTRACT,  STRICT LIABILITY,  OR TORT  (INCLUDING NEGLIGENCE  OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,  EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// etherlink-trace: decodes the packet trace dumps that etherlink writes on SIGUSR1 or on
+// "SET_PARAM TRACE_DUMP".
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "intel_st_debug_if_trace_layout.h"
+
+static const char* const STREAM_NAMES[NUM_TRACE_STREAMS] = ETHERLINK_TRACE_STREAM_NAMES;
+static const char* const EVENT_NAMES[NUM_TRACE_EVENTS] = ETHERLINK_TRACE_EVENT_NAMES;
+
+static void show_help(const char* program)
+{
+    printf(
+        "Usage:\n"
+        " %s [--csv] [--last=<n>] <trace file>\n\n"
+        "Prints the records of an etherlink trace dump, oldest first. Times are relative to the "
+        "dump.\n\n"
+        "Optional arguments:\n"
+        " --csv              Print comma separated values\n"
+        " --last=<n>, -n <n> Print only the last <n> records\n"
+        " --help, -h         Print this usage description\n",
+        program);
+}
+
+static const char* get_name(const char* const* names, int count, int index)
+{
+    return ((index >= 0) && (index < count)) ? names[index] : "?";
+}
+
+int main(int argc, char** argv)
+{
+    TRACE_FILE_HEADER header;
+    TRACE_RECORD record;
+    int csv = 0;
+    unsigned long long last = 0;
+    int c;
+
+    const struct option longopts[] = {{"help", no_argument, NULL, 'h'},
+                                      {"csv", no_argument, NULL, 'c'},
+                                      {"last", required_argument, NULL, 'n'},
+                                      {0, 0, 0, 0}};
+    while ((c = getopt_long(argc, argv, "hcn:", longopts, NULL)) != -1)
+    {
+        switch (c)
+        {
+            case 'c':
+                csv = 1;
+                break;
+
+            case 'n':
+                last = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'h':
+            default:
+                show_help(argv[0]);
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1)
+    {
+        show_help(argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[optind], "rb");
+    if (file == NULL)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+    if ((fread(&header, sizeof(header), 1, file) != 1) || (header.magic != ETHERLINK_TRACE_MAGIC))
+    {
+        fprintf(stderr, "ERROR: %s is not an etherlink trace dump\n", argv[optind]);
+        fclose(file);
+        return 1;
+    }
+    if ((header.version != ETHERLINK_TRACE_VERSION) || (header.record_size < sizeof(record)) ||
+        (header.ticks_per_second == 0))
+    {
+        fprintf(stderr,
+                "ERROR: Unsupported trace dump version %u, record size %u\n",
+                header.version,
+                header.record_size);
+        fclose(file);
+        return 1;
+    }
+
+    const time_t dump_seconds = (time_t) (header.dump_realtime_ns / 1000000000ULL);
+    char dump_time[64];
+    strftime(dump_time, sizeof(dump_time), "%Y-%m-%d %H:%M:%S", gmtime(&dump_seconds));
+    const unsigned long long valid = header.record_count - header.records_invalid;
+    const unsigned long long skip =
+        header.records_invalid + (((last != 0) && (last < valid)) ? valid - last : 0);
+    printf("# pid %llu, dumped %s.%06llu UTC, %llu of %llu events since start-up kept",
+           (unsigned long long) header.pid,
+           dump_time,
+           (unsigned long long) (header.dump_realtime_ns % 1000000000ULL / 1000),
+           valid,
+           (unsigned long long) header.records_total);
+    if (header.records_invalid != 0)
+    {
+        printf(", %llu overwritten during the dump", (unsigned long long) header.records_invalid);
+    }
+    printf("\n");
+    printf(csv ? "time_us,delta_us,stream,event,conn_id,channel,length,sop,eop\n"
+               : "%14s %10s %-9s %-18s %4s %5s %6s %3s %3s\n",
+           "TIME_US",
+           "DELTA_US",
+           "STREAM",
+           "EVENT",
+           "CONN",
+           "CH",
+           "LEN",
+           "SOP",
+           "EOP");
+
+    const double us_per_tick = 1e6 / (double) header.ticks_per_second;
+    uint64_t prev_timestamp = 0;
+    unsigned long long i;
+    for (i = 0; i < header.record_count; ++i)
+    {
+        if ((fread(&record, sizeof(record), 1, file) != 1) ||
+            ((header.record_size > sizeof(record)) &&
+             (fseek(file, header.record_size - sizeof(record), SEEK_CUR) != 0)))
+        {
+            fprintf(stderr, "ERROR: Trace dump is truncated after %llu records\n", i);
+            break;
+        }
+        if (i < skip)
+        {
+            prev_timestamp = record.timestamp;
+            continue;
+        }
+        const double time_us =
+            ((double) record.timestamp - (double) header.dump_ticks) * us_per_tick;
+        const double delta_us =
+            (prev_timestamp != 0) ? (double) (record.timestamp - prev_timestamp) * us_per_tick : 0;
+        prev_timestamp = record.timestamp;
+        printf(csv ? "%.3f,%.3f,%s,%s,%u,%u,%u,%u,%u\n"
+                   : "%14.3f %10.3f %-9s %-18s %4u %5u %6u %3u %3u\n",
+               time_us,
+               delta_us,
+               get_name(STREAM_NAMES, NUM_TRACE_STREAMS, record.stream),
+               get_name(EVENT_NAMES, NUM_TRACE_EVENTS, record.event),
+               record.conn_id,
+               record.channel,
+               record.length,
+               record.sop_eop & 1,
+               (record.sop_eop >> 1) & 1);
+    }
+    fclose(file);
+    return 0;
+}